@@ -22,6 +22,9 @@
 
    See COPYRIGHT file for further copyright information	   
    >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+
+#ifndef __BIGBZIP_H__
+#define __BIGBZIP_H__
 	
 
 // ------------------------------------------------------------------------
@@ -34,12 +37,78 @@
 void bigbzip_compress(UChar text[], int text_len, UChar *ctext[], int *ctext_len);
 void bigbzip_decompress(UChar ctext[], int ctext_len, UChar *text[], int *text_len);
 
+// ------------------------------------------------------------------------
+// Reusable workspace
+//
+// A bigbzip_ctx keeps the ds_ssort context and grow-only buffers across
+// calls, so that (de)compressing many blocks of similar sizes allocates
+// nothing after the first ones. The output goes to a buffer of the caller:
+// BIGBZIP_BOUND(text_len) bytes for the compressed data, 
+// bigbzip_text_len(ctext) bytes for the decompressed text. 
+// One ctx per thread.
+// -------------------------------------------------------------------------
+typedef struct bigbzip_ctx {
+	struct ds_ssort_context *ds;	// created by the first compression
+	int *sa;				// suffix array, RLE0 symbols, inverse BWT map
+	UChar *buf;				// text with the ds_ssort overshoot, MTF string
+	UChar *bwt;				// BWT, multihuf selectors
+	int sa_size;			// #entries allocated in the buffers above
+	int buf_size;
+	int bwt_size;
+} bigbzip_ctx;
+
+#define BIGBZIP_BOUND(len)	max(2000, (int) floor(1.1 * (len)))
+#define BIGBZIP_MAX_LEN		0x74000000	// longest text whose bound fits an int
+
+void bigbzip_ctx_init(bigbzip_ctx *ctx);
+void bigbzip_ctx_free(bigbzip_ctx *ctx);
+void bigbzip_compress_ctx(bigbzip_ctx *ctx, UChar text[], int text_len, 
+						  UChar ctext[], int *ctext_len);
+void bigbzip_decompress_ctx(bigbzip_ctx *ctx, UChar ctext[], int ctext_len, 
+							UChar text[], int *text_len);
+int bigbzip_text_len(UChar ctext[], int ctext_len);
+
+// ------------------------------------------------------------------------
+// Block-parallel mode
+//
+// The text is split into blocks of block_len bytes (the last one may be
+// shorter), compressed independently by up to 'threads' threads. The
+// stream starts with a table of the compressed block lengths, so that
+// the blocks are decompressed in parallel too. With block_len <= 0, or
+// not smaller than text_len, the text is a single block and the stream
+// is the one of bigbzip_compress() (maximum compression ratio).
+// bigbzip_decompress() decodes both kinds of stream, in one thread.
+// -------------------------------------------------------------------------
+#define BBZ_BLOCKED_MARK	0xFFFFFFFF	// first word of a block-parallel stream
+#define BBZ_BLOCK_LEN		(16 << 20)	// suggested block length (16Mb)
+
+// ------------------------------------------------------------------------
+// The inverse BWT follows one row per decoded symbol, a cache miss per 
+// byte on large texts. A text of at least BBZ_CHAIN_MIN bytes is cut 
+// into BBZ_CHAINS pieces whose starting rows are stored in the header
+// (after BBZ_CHAINED_MARK), so that the pieces are decoded by chains 
+// walked interleaved, whose cache misses overlap. Shorter texts keep
+// the header of a single chain.
+// -------------------------------------------------------------------------
+#define BBZ_CHAINED_MARK	0xFFFFFFFE	// first word of a stream with chains
+#define BBZ_CHAINS			16			// #chains of a long text
+#define BBZ_CHAIN_MIN		(1 << 20)	// min text length to use them
+#define BBZ_MAX_CHAINS		64			// max #chains accepted by the decoder
+
+void bigbzip_compress_blocks(UChar text[], int text_len, int block_len, int threads, 
+							 UChar *ctext[], int *ctext_len);
+void bigbzip_decompress_blocks(UChar ctext[], int ctext_len, int threads, 
+							   UChar *text[], int *text_len);
+
 
 // ------------------------------------------------------------------------
 // Auxiliary functions
 // -------------------------------------------------------------------------
 void bwt(UChar text[], UChar  bwt[], int *text_row, int length);
 void unbwt(UChar bwt[], UChar text[], int text_row, int length);
+void bwt_ctx(bigbzip_ctx *ctx, UChar text[], UChar bwt[], int rows[], int chains, int length);
+void unbwt_ctx(bigbzip_ctx *ctx, UChar bwt[], UChar text[], int rows[], int chains, int length);
+void *bbz_grow(void *p, int *size, int need, int elem);
 
 void mtf(UChar bwt[], UChar mtfc[], int length);
 void unmtf(UChar mtfc[], UChar bwt[], int length);
@@ -48,16 +117,70 @@ void rle0_wheeler(UChar mtfc[], int mtf_length, UInt16 rle[], int *rle_length);
 void unrle0_wheeler(UInt16 rle[], int rle_length, UChar mtfc[], int *mtf_length);
 
 void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len);
+void multihuf_compr_ws(UChar in[], int in_len, UChar out[], int *out_len,
+					   UInt16 mtfv[], UChar selector[]);
 void multihuf_decompr(UChar in[], int in_len, UChar out[], int *out_len);
 
+typedef struct bbz_blocks_type {
+	UChar *text;			// text to be compressed, or the decompressed one
+	int text_len;
+	int block_len;			// #bytes in a block, the last one may be shorter
+	int num;				// #blocks
+	UChar **cblock;			// compressed blocks
+	int *cblock_len;		// and their lengths
+	int decompress;			// 1 if the blocks are to be decompressed
+} bbz_blocks_type;
+
+int bbz_read_blocks(bbz_blocks_type *b, UChar ctext[], int ctext_len);
+
+// ------------------------------------------------------------------------
+// Pool of threads running 'num' independent tasks, taken in order by
+// up to 'threads' threads: the calling one joins them in bbz_pool_wait(),
+// so that between bbz_pool_start() and bbz_pool_wait() it can do other 
+// work. Each thread passes its worker (the argument of the pool and a
+// bigbzip_ctx of its own) to the tasks it runs. Used by the blocks of
+// bigbzip and by the jobs of xbzip.
+// -------------------------------------------------------------------------
+typedef struct bbz_worker_type {
+	void *arg;				// argument of the pool
+	bigbzip_ctx ctx;		// workspace of the thread
+} bbz_worker_type;
+
+typedef struct bbz_pool_type {
+	void (*task)(bbz_worker_type *w, int i);	// runs the i-th task
+	void *arg;
+	int num;				// #tasks
+	int next;				// first task not yet taken by a thread
+	pthread_t *thread;
+	int threads;			// #threads started, besides the calling one
+	pthread_mutex_t lock;	// protects 'next'
+} bbz_pool_type;
+
+void bbz_pool_start(bbz_pool_type *p, int num, int threads, 
+					void (*task)(bbz_worker_type *w, int i), void *arg);
+void bbz_pool_wait(bbz_pool_type *p);
+void bbz_pool_run(int num, int threads, void (*task)(bbz_worker_type *w, int i), void *arg);
+void *bbz_pool_thread(void *arg);
+void bbz_run_block(bbz_worker_type *w, int i);
+
 // ------------------------------------------------------------------------
 // Other functions
 // -------------------------------------------------------------------------
-void init_buffer(UChar *mem, int size);
-int get_buffer_fill (void);
-void bbz_bit_write(int n, int vv);
-int bbz_bit_read(int n);
-void bbz_bit_flush( void );
-void bbz_byte_align( void );
+typedef struct bit_stream_type {
+	UChar *BufferAddr;		// memory address where to write/read 
+	int ProcdBytes;			// #bytes read or written 
+	int BufferSize;			// number of bytes in the buffer
+	UInt64 Buffer;			// 64bit Word to manage bits going in/from buffer
+	int BufferFill;			// Current #bits present in the 64bit Word
+} bit_stream_type;
+
+void init_buffer(bit_stream_type *bs, UChar *mem, int size);
+int get_buffer_fill (bit_stream_type *bs);
+void bbz_bit_write(bit_stream_type *bs, int n, int vv);
+int bbz_bit_read(bit_stream_type *bs, int n);
+void bbz_bit_flush(bit_stream_type *bs);
+void bbz_byte_align(bit_stream_type *bs);
 int bbz_int_log2(int u);
 void fatal_error(char *s);
+
+#endif
@@ -48,9 +48,9 @@ int main (int argc, char *argv[])
   int fd = -1;
   FILE *outfile; 
   UChar *ctext, *text;
-  UInt32 text_len, ctext_len;
+  int text_len, ctext_len;
   double tot_time;            // time usage
-  int decompress;
+  int decompress, block_mb, threads;
   char c, *infile_name, *outfile_name;
 
   fprintf(stderr, "\n ----------------------------------------------------------\n");
@@ -63,19 +63,25 @@ int main (int argc, char *argv[])
 
  if (argc<2) {
   fprintf(stderr, "\nUsage:\n\t");
-  fprintf(stderr, "%s [-d] infile [-o outfile]\n\n", argv[0]);
+  fprintf(stderr, "%s [-d] [-b MB] [-j NUMT] infile [-o outfile]\n\n", argv[0]);
   fprintf(stderr, "\t-d \t\tto decompress;\n");
+  fprintf(stderr, "\t-b MB \t\tcompress blocks of MB Mb independently (default: one block);\n");
+  fprintf(stderr, "\t-j NUMT \t#threads (de)compressing the blocks (default is 1);\n");
   fprintf(stderr, "\t-o outfile      output filename;\n");
   fprintf(stderr, "\n\n");
  }
-  decompress=0;
+  decompress=0; block_mb=0; threads=1;
   infile_name=outfile_name=NULL;
   opterr=0;
-  while ((c=getopt(argc, argv, "do:")) != -1) {
+  while ((c=getopt(argc, argv, "db:j:o:")) != -1) {
     switch (c)
       {
         case 'd':
           decompress = 1;  break;
+        case 'b':
+          block_mb = atoi(optarg);  break;
+        case 'j':
+          threads = atoi(optarg);  break;
         case 'o':
           outfile_name = optarg;  break;
         case '?':
@@ -84,6 +90,9 @@ int main (int argc, char *argv[])
       }
   }
 
+  if ((block_mb < 0) || (block_mb > 2047) || (threads <= 0))
+	  fatal_error("Wrong value for -b (0..2047 Mb) or -j (at least 1 thread)\n");
+
   // Manage the input file
   if (optind<argc)
     infile_name=argv[optind];
@@ -110,12 +119,14 @@ int main (int argc, char *argv[])
 
 		// MMAPping the input file to an internal memory array
 		stat(infile_name, &info); 
-  		text_len = (UInt32) info.st_size;
+		if (info.st_size > BIGBZIP_MAX_LEN) 
+			fatal_error("The input file exceeds the max length of bigbzip!\n");
+  		text_len = (int) info.st_size;
 		text = (UChar *) mmap(0, text_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!text) fatal_error("Failed MMAPping the input file!\n");
 	
 		// Issuing the compress function
-		bigbzip_compress(text, text_len, &ctext, &ctext_len);
+		bigbzip_compress_blocks(text, text_len, block_mb << 20, threads, &ctext, &ctext_len);
 
 		// Writing the compressed file to disk
 		// NOTE: The first 4 bytes encode the original text length
@@ -127,13 +138,15 @@ int main (int argc, char *argv[])
 
 		// MMAPping the input file to an internal memory array
 		stat(infile_name, &info); 
-  		ctext_len = (UInt32) info.st_size;
+		if (info.st_size > 0x7FFFFFFF) 
+			fatal_error("The compressed file exceeds 2Gb!\n");
+  		ctext_len = (int) info.st_size;
 		ctext = (UChar *) mmap(0, ctext_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		text = NULL;
 		if (!ctext) fatal_error("MMAPping the input compressed text failed\n");
 
 		// Issuing the decompress function
-		bigbzip_decompress(ctext, ctext_len, &text, &text_len);
+		bigbzip_decompress_blocks(ctext, ctext_len, threads, &text, &text_len);
 		
 		// Writing the uncompressed text to disk
 		fwrite(text, sizeof(UChar), text_len, outfile);
@@ -45,59 +45,29 @@
 	The first 4 bytes of the compressed data indicate the size of 
 	text, and the next 4 bytes indicate the row
 	of the BWT matrix containing this text.
+	Texts of at least BBZ_CHAIN_MIN bytes start with BBZ_CHAINED_MARK,
+	the size of text, the number of chains and their rows (4 bytes 
+	each, see bwt_ctx).
 	ctext is allocated inside this procedure.
 	----------------------------------------------------------------- */
 void bigbzip_compress(UChar text[], int text_len, 
 					  UChar *ctext[], int *ctext_len)
 {
-	void init_buffer(UChar mem[], int size);
-	void bbz_bit_write(int n, int vv);
 	void fatal_error(char *s);
-	int text_row,mtfc_len;
-	UChar *bwtc, *mtfc;
-
-	// ---------------------------------------------------------------------
-	// PHASE I: BWT calculation
-	// Calculates also the row containing the text in the BWT matrix
-	// ---------------------------------------------------------------------
-	
-	bwtc = (UChar *) malloc(text_len * sizeof(UChar));    
-	if (!bwtc) fatal_error("error in allocating BWT array!\n");
-	bwt(text, bwtc, &text_row, text_len);
-
-	// ---------------------------------------------------------------------
-	// PHASE II: MTF encoding
-	// ---------------------------------------------------------------------
-	
-	mtfc= (UChar *) malloc(text_len * sizeof(UChar));   
-	if (!mtfc) fatal_error("error in allocating MTF array!\n");
-	mtf(bwtc, mtfc, text_len);        
-	mtfc_len=text_len;
-	free(bwtc);
-	
-	// ---------------------------------------------------------------
-	// PHASE III: MultiTable Huffman encoding (bzlib)
-	//	This includes an RLE stage
-	// ----------------------------------------------------------------
+	bigbzip_ctx ctx;
 
 	// Overestimate the compressed text size (whose length is unknown)
-	*ctext_len = max(2000, floor(1.1 * text_len));
+	if ((text_len < 0) || (text_len > BIGBZIP_MAX_LEN))
+		fatal_error("The text exceeds the max length of bigbzip! (bigbzip_compress)\n");
+	*ctext_len = BIGBZIP_BOUND(text_len);
 	*ctext = (UChar *) malloc((*ctext_len) * sizeof(UChar));
 	if (! (*ctext) ) fatal_error("Failed allocating the compressed data!\n");
 
-	// Write the prologue of the compressed data
-	init_buffer(*ctext,10);
-	bbz_bit_write(32, text_len);
-	bbz_bit_write(32, text_row);
-	*ctext_len -=8; // "discards" the initial 8 bytes
-	
-	// Multi-Table Huffamn compression
-	multihuf_compr(mtfc, mtfc_len, (*ctext) + 8, ctext_len);
-	
-	(*ctext_len) += 8; // "considers" again the initial 8 bytes
-	
-	free(mtfc);
-	realloc(*ctext,*ctext_len); // adjusts memory to fit compressed data
+	bigbzip_ctx_init(&ctx);
+	bigbzip_compress_ctx(&ctx, text, text_len, *ctext, ctext_len);
+	bigbzip_ctx_free(&ctx);
+
+	*ctext = realloc(*ctext,*ctext_len); // adjusts memory to fit compressed data
 } 
 
 
@@ -113,58 +83,447 @@ void bigbzip_compress(UChar text[], int text_len,
 	text we have compressed, and the next 4 bytes indicate the row
 	of the BWT matrix containing this text.
 	text is allocated inside this procedure.
+	Streams of bigbzip_compress_blocks() are decoded too.
 	----------------------------------------------------------------- */
 
 void bigbzip_decompress(UChar ctext[], int ctext_len, 
 						UChar *text[], int *text_len)
 {
-	void init_buffer(UChar mem[], int size);
-	int bbz_bit_read(int n);
+	bigbzip_decompress_blocks(ctext, ctext_len, 1, text, text_len);
+} 
+
+
+/* ----------------------------------------------------------------
+	Procedures bigbzip_ctx_init() and bigbzip_ctx_free()
+
+	A bigbzip_ctx keeps the ds_ssort context and the buffers of 
+	the three phases of (de)compression from one call to the next.
+	The buffers only grow, so a ctx used on blocks of similar sizes
+	stops allocating after the first ones. A ctx must not be shared 
+	by distinct threads.
+	----------------------------------------------------------------- */
+void bigbzip_ctx_init(bigbzip_ctx *ctx)
+{
+	ctx->ds = NULL;
+	ctx->sa = NULL; ctx->sa_size = 0;
+	ctx->buf = NULL; ctx->buf_size = 0;
+	ctx->bwt = NULL; ctx->bwt_size = 0;
+}
+
+void bigbzip_ctx_free(bigbzip_ctx *ctx)
+{
+	if (ctx->ds) ds_ssort_free(ctx->ds);
+	if (ctx->sa) free(ctx->sa);
+	if (ctx->buf) free(ctx->buf);
+	if (ctx->bwt) free(ctx->bwt);
+	bigbzip_ctx_init(ctx);
+}
+
+/* ----------------------------------------------------------------
+	Returns buffer p (of *size entries of elem bytes) with room for
+	at least 'need' entries. The content is not preserved.
+	----------------------------------------------------------------- */
+void *bbz_grow(void *p, int *size, int need, int elem)
+{
 	void fatal_error(char *s);
-	UChar *mtfc, *bwtc;	 
-	int text_row, mtfc_len;
+
+	need = max(need, 1);
+	if (need <= *size) return p;
+	if (p) free(p);
+	p = malloc((size_t) need * elem);
+	if (!p) fatal_error("error in allocating the workspace!\n");
+	*size = need;
+	return p;
+}
+
+
+/* ----------------------------------------------------------------
+	Procedure bigbzip_compress_ctx()
+
+	As bigbzip_compress(), with the workspace of ctx. ctext is 
+	provided by the caller with room for *ctext_len bytes, at least
+	BIGBZIP_BOUND(text_len): *ctext_len is set to the length of the 
+	compressed data. The buffers of ctx serve two phases each:
+		sa:  suffix array, then the RLE0 symbols of multihuf
+		buf: text for ds_ssort (with overshoot), then the MTF string
+		bwt: BWT, then the selectors of multihuf
+	----------------------------------------------------------------- */
+void bigbzip_compress_ctx(bigbzip_ctx *ctx, UChar text[], int text_len, 
+						  UChar ctext[], int *ctext_len)
+{
+	void fatal_error(char *s);
+	bit_stream_type bs;
+	int rows[BBZ_MAX_CHAINS], chains, header, c, room;
+
+	if ((text_len < 0) || (text_len > BIGBZIP_MAX_LEN) || (*ctext_len < BIGBZIP_BOUND(text_len)))
+		fatal_error("The compressed data may not fit! (bigbzip_compress_ctx)\n");
+
+	// Long texts are decoded along BBZ_CHAINS chains
+	chains = (text_len >= BBZ_CHAIN_MIN) ? BBZ_CHAINS : 1;
+	header = (chains == 1) ? 8 : 12 + 4 * chains;
+
+	// ---------------------------------------------------------------------
+	// PHASE I: BWT calculation
+	// Calculates also the row containing the text in the BWT matrix
+	// ---------------------------------------------------------------------
+	ctx->bwt = (UChar *) bbz_grow(ctx->bwt, &ctx->bwt_size, text_len + 1, sizeof(UChar));
+	bwt_ctx(ctx, text, ctx->bwt, rows, chains, text_len);
+
+	// ---------------------------------------------------------------------
+	// PHASE II: MTF encoding (buf has room for text_len bytes at least)
+	// ---------------------------------------------------------------------
+	mtf(ctx->bwt, ctx->buf, text_len);        
+	
+	// ---------------------------------------------------------------
+	// PHASE III: MultiTable Huffman encoding (bzlib)
+	//	This includes an RLE stage
+	// ----------------------------------------------------------------
+
+	// Write the prologue of the compressed data: the text length and
+	// text_row, or BBZ_CHAINED_MARK, the text length, chains and the rows
+	init_buffer(&bs,ctext,header+2);
+	if (chains > 1) bbz_bit_write(&bs,32, (int) BBZ_CHAINED_MARK);
+	bbz_bit_write(&bs,32, text_len);
+	if (chains > 1) bbz_bit_write(&bs,32, chains);
+	for(c=0; c < chains; c++)
+		bbz_bit_write(&bs,32, rows[c]);
+	room = *ctext_len - header; // "discards" the header
+	
+	// Multi-Table Huffamn compression: sa has room for text_len+1
+	// UInt16 symbols, bwt for the text_len+1 selectors at most
+	multihuf_compr_ws(ctx->buf, text_len, ctext + header, &room, 
+					  (UInt16 *) ctx->sa, ctx->bwt);
+	
+	*ctext_len = room + header; // "considers" again the header
+} 
+
+
+/* ----------------------------------------------------------------
+	Procedure bigbzip_decompress_ctx()
+
+	As bigbzip_decompress(), with the workspace of ctx, into text 
+	provided by the caller with room for *text_len bytes (see
+	bigbzip_text_len): *text_len is set to the length of the 
+	decompressed text. The blocks of a stream of 
+	bigbzip_compress_blocks() are decompressed in order.
+	----------------------------------------------------------------- */
+void bigbzip_decompress_ctx(bigbzip_ctx *ctx, UChar ctext[], int ctext_len, 
+							UChar text[], int *text_len)
+{
+	void fatal_error(char *s);
+	bit_stream_type bs;
+	bbz_blocks_type b;
+	int i, rows[BBZ_MAX_CHAINS], chains, header, mtfc_len, room;
   	
+	if (bbz_read_blocks(&b, ctext, ctext_len)) {
+		if (b.text_len > *text_len) 
+			fatal_error("The decompressed text does not fit! (bigbzip_decompress_ctx)\n");
+		for(i=0; i < b.num; i++){
+			room = min(b.block_len, b.text_len - i * b.block_len);
+			mtfc_len = room;
+			bigbzip_decompress_ctx(ctx, b.cblock[i], b.cblock_len[i], 
+								   text + (size_t) i * b.block_len, &mtfc_len);
+			if (mtfc_len != room) fatal_error("A decompressed block is too short!\n");
+			}
+		*text_len = b.text_len;
+		free(b.cblock); free(b.cblock_len);
+		return;
+		}
+
 	// temporary buffer to read the header
-	init_buffer(ctext,ctext_len); 
+	init_buffer(&bs,ctext,ctext_len); 
 	
-	// read the length of the original text
-	*text_len = bbz_bit_read(32);
-	*text = (UChar *) malloc((*text_len) * sizeof(UChar));
+	// read the length of the original text, and the number of chains
+	mtfc_len = bbz_bit_read(&bs,32);
+	chains = 1;
+	if ((UInt32) mtfc_len == BBZ_CHAINED_MARK) {
+		mtfc_len = bbz_bit_read(&bs,32);
+		chains = bbz_bit_read(&bs,32);
+		if ((chains < 1) || (chains > BBZ_MAX_CHAINS) || (12 + 4 * chains > ctext_len))
+			fatal_error("Corrupted compressed data! (bigbzip_decompress_ctx)\n");
+		}
+	header = (chains == 1) ? 8 : 12 + 4 * chains;
+	if ((mtfc_len < 0) || (mtfc_len > *text_len)) 
+		fatal_error("The decompressed text does not fit! (bigbzip_decompress_ctx)\n");
 
-	// Position of the text_row in the BWT
-	text_row = bbz_bit_read(32);
+	// Position of the text_row in the BWT, and of the other chains
+	for(i=0; i < chains; i++)
+		rows[i] = bbz_bit_read(&bs,32);
 
 	// ---------------------------------------------------------------
-	// PHASE I: MultiTable Huffamn decoding
+	// PHASE I: MultiTable Huffamn decoding (the MTF string goes in buf)
 	// ----------------------------------------------------------------
-	mtfc_len = *text_len;
-	mtfc = (UChar *) malloc(mtfc_len * sizeof(UChar));   
-	if (!mtfc) fatal_error("error in allocating MTF array!\n");
+	ctx->buf = (UChar *) bbz_grow(ctx->buf, &ctx->buf_size, mtfc_len, sizeof(UChar));
 	
 	// Sets mtfc_len to the length of the decompressed data
-	multihuf_decompr(ctext+8, ctext_len-8, mtfc, &mtfc_len);
+	multihuf_decompr(ctext+header, ctext_len-header, ctx->buf, &mtfc_len);
 	*text_len=mtfc_len; // adjusts *text_len
 
 	// ---------------------------------------------------------------------
 	// PHASE II: MTF decoding
 	// ---------------------------------------------------------------------
-	bwtc = (UChar *) malloc((*text_len) * sizeof(UChar));   
-	if (!bwtc) fatal_error("error in allocating BWT array!\n");
-	unmtf(mtfc, bwtc, *text_len);
-	free(mtfc);
+	ctx->bwt = (UChar *) bbz_grow(ctx->bwt, &ctx->bwt_size, *text_len, sizeof(UChar));
+	unmtf(ctx->buf, ctx->bwt, *text_len);
 
 	// ---------------------------------------------------------------------
 	// PHASE III: BWT inversion
 	// ---------------------------------------------------------------------
-	*text = (UChar *) malloc((*text_len) * sizeof(UChar));   
-	if (! (*text)) fatal_error("error in allocating MTF array!\n");
-	unbwt(bwtc, *text, text_row, *text_len);
-
-	free(bwtc);
-	realloc(*text, *text_len);
+	unbwt_ctx(ctx, ctx->bwt, text, rows, chains, *text_len);
 } 
 
 
+/* ----------------------------------------------------------------
+	Returns the length of the text compressed in ctext, so that
+	the caller can provide the room to bigbzip_decompress_ctx()
+	----------------------------------------------------------------- */
+int bigbzip_text_len(UChar ctext[], int ctext_len)
+{
+	void fatal_error(char *s);
+	bit_stream_type bs;
+	int len;
+
+	if (ctext_len < 8) fatal_error("Corrupted compressed data! (bigbzip_text_len)\n");
+	init_buffer(&bs,ctext,ctext_len); 
+	len = bbz_bit_read(&bs,32);
+	if (((UInt32) len == BBZ_BLOCKED_MARK) || ((UInt32) len == BBZ_CHAINED_MARK))
+		len = bbz_bit_read(&bs,32);
+	return len;
+}
+
+
+/* ----------------------------------------------------------------
+	Procedure bigbzip_compress_blocks()
+
+	As bigbzip_compress(), with the text split into blocks of 
+	block_len bytes compressed by up to 'threads' threads.
+	The compressed data start with 4 words (4 bytes each):
+	BBZ_BLOCKED_MARK, the text length, block_len and the number 
+	of blocks; then the length of each compressed block (4 bytes)
+	and the compressed blocks, in order. A text of one block
+	gets the stream of bigbzip_compress(), without the table.
+	----------------------------------------------------------------- */
+void bigbzip_compress_blocks(UChar text[], int text_len, int block_len, int threads, 
+							 UChar *ctext[], int *ctext_len)
+{
+	void fatal_error(char *s);
+	bit_stream_type bs;
+	bbz_blocks_type b;
+	UInt64 len;
+	int i, header;
+
+	if ((text_len < 0) || (text_len > BIGBZIP_MAX_LEN))
+		fatal_error("The text exceeds the max length of bigbzip! (bigbzip_compress_blocks)\n");
+	if ((block_len <= 0) || (block_len >= text_len)) {
+		bigbzip_compress(text, text_len, ctext, ctext_len);
+		return;
+		}
+
+	b.text = text;
+	b.text_len = text_len;
+	b.block_len = block_len;
+	b.num = text_len / block_len + ((text_len % block_len) != 0);
+	b.cblock = (UChar **) malloc(b.num * sizeof(UChar *));
+	b.cblock_len = (int *) malloc(b.num * sizeof(int));
+	if (!b.cblock || !b.cblock_len) fatal_error("error in allocating the block table!\n");
+	b.decompress = 0;
+	bbz_pool_run(b.num, threads, bbz_run_block, &b);
+
+	// Block table, then the blocks
+	header = 16 + 4 * b.num;
+	for(i=0, len=header; i < b.num; i++)
+		len += b.cblock_len[i];
+	if (len > 0x7FFFFFFF) fatal_error("The compressed data exceed 2Gb!\n");
+	*ctext_len = (int) len;
+	*ctext = (UChar *) malloc((*ctext_len) * sizeof(UChar));
+	if (! (*ctext) ) fatal_error("Failed allocating the compressed data!\n");
+
+	init_buffer(&bs,*ctext,header);
+	bbz_bit_write(&bs,32, (int) BBZ_BLOCKED_MARK);
+	bbz_bit_write(&bs,32, text_len);
+	bbz_bit_write(&bs,32, block_len);
+	bbz_bit_write(&bs,32, b.num);
+	for(i=0, len=header; i < b.num; i++){
+		bbz_bit_write(&bs,32, b.cblock_len[i]);
+		memcpy((*ctext) + len, b.cblock[i], b.cblock_len[i]);
+		len += b.cblock_len[i];
+		free(b.cblock[i]);
+		}
+	free(b.cblock); free(b.cblock_len);
+}
+
+
+/* ----------------------------------------------------------------
+	Procedure bigbzip_decompress_blocks()
+
+	As bigbzip_decompress(), the blocks of a stream of 
+	bigbzip_compress_blocks() are decompressed by up to 'threads' 
+	threads, each one in its place of the text.
+	----------------------------------------------------------------- */
+void bigbzip_decompress_blocks(UChar ctext[], int ctext_len, int threads, 
+							   UChar *text[], int *text_len)
+{
+	void fatal_error(char *s);
+	bbz_blocks_type b;
+	bigbzip_ctx ctx;
+
+	if (!bbz_read_blocks(&b, ctext, ctext_len)) {
+		// a single block
+		*text_len = bigbzip_text_len(ctext, ctext_len);
+		*text = (UChar *) malloc(max(*text_len, 1) * sizeof(UChar));
+		if (! (*text)) fatal_error("error in allocating the text!\n");
+		bigbzip_ctx_init(&ctx);
+		bigbzip_decompress_ctx(&ctx, ctext, ctext_len, *text, text_len);
+		bigbzip_ctx_free(&ctx);
+		return;
+		}
+
+	*text = (UChar *) malloc(max(b.text_len, 1) * sizeof(UChar));
+	if (! (*text)) fatal_error("error in allocating the text!\n");
+	b.text = *text;
+	b.decompress = 1;
+	bbz_pool_run(b.num, threads, bbz_run_block, &b);
+	*text_len = b.text_len;
+	free(b.cblock); free(b.cblock_len);
+}
+
+
+/* ----------------------------------------------------------------
+	Reads the block table of a stream of bigbzip_compress_blocks()
+	into b, pointing b->cblock[i] into ctext: returns 0, and reads
+	nothing, if ctext is the stream of a single block.
+	----------------------------------------------------------------- */
+int bbz_read_blocks(bbz_blocks_type *b, UChar ctext[], int ctext_len)
+{
+	void fatal_error(char *s);
+	bit_stream_type bs;
+	UInt64 len;
+	int i;
+
+	init_buffer(&bs,ctext,ctext_len); 
+	if ((ctext_len < 16) || ((UInt32) bbz_bit_read(&bs,32) != BBZ_BLOCKED_MARK)) 
+		return 0;
+
+	b->text_len = bbz_bit_read(&bs,32);
+	b->block_len = bbz_bit_read(&bs,32);
+	b->num = bbz_bit_read(&bs,32);
+	if ((b->text_len < 0) || (b->block_len <= 0) || (b->num < 0) || 
+		(b->num != b->text_len / b->block_len + ((b->text_len % b->block_len) != 0)) ||
+		((UInt64) 16 + 4 * (UInt64) b->num > (UInt64) ctext_len))
+		fatal_error("Corrupted block table!\n");
+
+	b->cblock = (UChar **) malloc(max(b->num, 1) * sizeof(UChar *));
+	b->cblock_len = (int *) malloc(max(b->num, 1) * sizeof(int));
+	if (!b->cblock || !b->cblock_len) 
+		fatal_error("error in allocating the blocks!\n");
+	for(i=0, len=16 + 4 * b->num; i < b->num; i++){
+		b->cblock_len[i] = bbz_bit_read(&bs,32);
+		b->cblock[i] = ctext + len;
+		len += b->cblock_len[i];
+		if ((b->cblock_len[i] < 8) || (len > (UInt64) ctext_len))
+			fatal_error("Corrupted block table!\n");
+		}
+	return 1;
+}
+
+
+/* ----------------------------------------------------------------
+	Task of the pool: (de)compresses the i-th block. Blocks are 
+	independent, and each thread has its own bigbzip_ctx (the 
+	coders keep their tables per thread too).
+	----------------------------------------------------------------- */
+void bbz_run_block(bbz_worker_type *w, int i)
+{
+	void fatal_error(char *s);
+	bbz_blocks_type *b = (bbz_blocks_type *) w->arg;
+	UChar *text;
+	int len, room;
+
+	text = b->text + (size_t) i * b->block_len;
+	room = min(b->block_len, b->text_len - i * b->block_len);
+	if (b->decompress) {
+		len = room;
+		bigbzip_decompress_ctx(&w->ctx, b->cblock[i], b->cblock_len[i], text, &len);
+		if (len != room) fatal_error("A decompressed block is too short!\n");
+		}
+	else {
+		b->cblock_len[i] = BIGBZIP_BOUND(room);
+		b->cblock[i] = (UChar *) malloc(b->cblock_len[i] * sizeof(UChar));
+		if (!b->cblock[i]) fatal_error("Failed allocating the compressed data!\n");
+		bigbzip_compress_ctx(&w->ctx, text, room, b->cblock[i], &b->cblock_len[i]);
+		b->cblock[i] = realloc(b->cblock[i], b->cblock_len[i]);
+		}
+}
+
+
+/* ----------------------------------------------------------------
+	Procedures of the pool of threads (see bbz_pool_type).
+	bbz_pool_start() starts min(threads, num) - 1 threads, 
+	bbz_pool_wait() runs the tasks left with the calling thread 
+	and then waits for the others; bbz_pool_run() does both.
+	----------------------------------------------------------------- */
+void bbz_pool_start(bbz_pool_type *p, int num, int threads, 
+					void (*task)(bbz_worker_type *w, int i), void *arg)
+{
+	void fatal_error(char *s);
+	int t;
+
+	p->task = task;
+	p->arg = arg;
+	p->num = num;
+	p->next = 0;
+	pthread_mutex_init(&p->lock, NULL);
+	p->threads = max(min(threads, num) - 1, 0);
+	p->thread = (pthread_t *) malloc(max(p->threads, 1) * sizeof(pthread_t));
+	if (!p->thread) fatal_error("error in allocating the threads!\n");
+
+	for(t=0; t < p->threads; t++)
+		if (pthread_create(&p->thread[t], NULL, bbz_pool_thread, p) != 0)
+			fatal_error("error in creating a thread!\n");
+}
+
+void bbz_pool_wait(bbz_pool_type *p)
+{
+	int t;
+
+	bbz_pool_thread(p);
+	for(t=0; t < p->threads; t++)
+		pthread_join(p->thread[t], NULL);
+	free(p->thread);
+	pthread_mutex_destroy(&p->lock);
+}
+
+void bbz_pool_run(int num, int threads, void (*task)(bbz_worker_type *w, int i), void *arg)
+{
+	bbz_pool_type p;
+
+	bbz_pool_start(&p, num, threads, task, arg);
+	bbz_pool_wait(&p);
+}
+
+/* ----------------------------------------------------------------
+	Body of each thread: runs the next task until there are no more
+	----------------------------------------------------------------- */
+void *bbz_pool_thread(void *arg)
+{
+	bbz_pool_type *p = (bbz_pool_type *) arg;
+	bbz_worker_type w;
+	int i;
+
+	w.arg = p->arg;
+	bigbzip_ctx_init(&w.ctx);
+	while (1) {
+		pthread_mutex_lock(&p->lock);
+		i = (p->next < p->num) ? p->next++ : -1;
+		pthread_mutex_unlock(&p->lock);
+		if (i < 0) break;
+		p->task(&w, i);
+		}
+	bigbzip_ctx_free(&w.ctx);
+
+	return NULL;
+}
+
+
 
 /* ------------------------------------------------
 	Procedure to MTF encoding [UChar+ --> UChar+]
@@ -177,19 +536,7 @@ void bigbzip_decompress(UChar ctext[], int ctext_len,
 	---------------------------------------------- */
 void mtf(UChar in[], UChar out[], int length)
 {
-  int i,j,k;
-  UChar c, mtf_list[256];
-
-  for (i=0; i<256; i++)  // Initialize the MTF-list
-    mtf_list[i]= (UChar) i;
-  for (i=0; i < length; i++) {
-    c=in[i];   // symbol to process
-    for (j=0; mtf_list[j] != c; j++) ; // mtf_list rank of c
-    out[i]=j;
-	for (k=j; k>0; k--) // move-to-front c
-		mtf_list[k]=mtf_list[k-1];
-	mtf_list[0] = c;
-  }
+  mtf_encode(in, out, length);   // vector kernels of ds_ssort (mtf.c)
 }
 
 
@@ -205,18 +552,7 @@ void mtf(UChar in[], UChar out[], int length)
 
 void unmtf(UChar in[], UChar out[], int length)
 {
-  int i,k, pos;
-  UChar mtf_list[256];
-
-  for (i=0; i<256; i++)  // Initialize the MTF list
-    mtf_list[i]= (UChar)i;
-  for (i=0; i < length; i++) {
-	pos= (int) in[i];
-	out[i] = mtf_list[pos]; // MTF unencode the next symbol
-	for (k=pos; k>0; k--) // move-to-front bwt[i]
-		mtf_list[k]=mtf_list[k-1];
-	mtf_list[0]=out[i];
-  }
+  mtf_decode(in, out, length);   // vector kernels of ds_ssort (mtf.c)
 }
 
 /* -------------------------------------------------------------------
@@ -321,31 +657,51 @@ void unrle0_wheeler(UInt16 in[], int in_length,
   ----------------------------------------------------------------- */
 void bwt(UChar text[], UChar bwt[], int *text_row, int length)
 {
-	void fatal_error(char *s);
-	int overshoot, *sa, i, j;
-	UChar *text_tmp;
+	bigbzip_ctx ctx;
+
+	bigbzip_ctx_init(&ctx);
+	bwt_ctx(&ctx, text, bwt, text_row, 1, length);
+	bigbzip_ctx_free(&ctx);
+}
 
+/* -----------------------------------------------------------------
+   As bwt(), with the suffix array and the ds_ssort context of ctx.
+   The text is split into 'chains' pieces of step = ceil(length/chains) 
+   bytes: rows[c] is the row of the suffix starting at c*step, which
+   is where unbwt_ctx() starts decoding the c-th piece (rows[0] is 
+   text_row). Every piece must be non-empty: (chains-1)*step < length.
+  ----------------------------------------------------------------- */
+void bwt_ctx(bigbzip_ctx *ctx, UChar text[], UChar bwt[], int rows[], int chains, int length)
+{
+	void fatal_error(char *s);
+	int overshoot, *sa, i, j, step;
 
-	// ----- init ds suffix sort routine
-	overshoot=init_ds_ssort(500,2000);
-	if(overshoot==0) fatal_error("ds_ssort initialization failed! \n");
+	// ----- init ds suffix sort routine (once per ctx)
+	if (!ctx->ds) {
+		ctx->ds=ds_ssort_new(500,2000);
+		if(ctx->ds==NULL) fatal_error("ds_ssort initialization failed! \n");
+		}
+	overshoot=ds_ssort_overshoot(ctx->ds);
 	
-	// ----- allocate suffix array, text (because of overshoot) and bwt
-	sa= (int *) malloc(length * sizeof(int));                 
-	text_tmp= (UChar *) malloc((length+overshoot)* sizeof(UChar));   
-	if (!sa || !text_tmp) fatal_error("SA-BWT initialization failed! \n");
+	// ----- suffix array, text (because of overshoot)
+	ctx->sa = (int *) bbz_grow(ctx->sa, &ctx->sa_size, length + 1, sizeof(int));
+	ctx->buf = (UChar *) bbz_grow(ctx->buf, &ctx->buf_size, length + overshoot, sizeof(UChar));
+	sa = ctx->sa;
   
 	// ----- compute the BWT and the text_row ------
-	memcpy(text_tmp,text,length);
-	ds_ssort(text_tmp,sa,length); 
-	free(text_tmp);  
+	memcpy(ctx->buf,text,length);
+	ds_ssort_r(ctx->ds,ctx->buf,sa,length); 
 
 	bwt[0] = text[length-1];
     for(i=0,j=1;i<length;i++)
 		if(sa[i]>0)	bwt[j++]=text[sa[i]-1];
-			else *text_row=i;
+			else rows[0]=i;
 
-	free(sa); 
+	if (chains > 1) {
+		step = (length + chains - 1) / chains;
+		for(i=0;i<length;i++)
+			if (sa[i] % step == 0) rows[sa[i] / step] = i;
+		}
 }
 
 
@@ -360,15 +716,37 @@ void bwt(UChar text[], UChar bwt[], int *text_row, int length)
 	text must have been preallocated to length positions
 	------------------------------------------------------- */
 void unbwt(UChar bwt[], UChar text[], int text_row, int length)
+{
+	bigbzip_ctx ctx;
+
+	bigbzip_ctx_init(&ctx);
+	unbwt_ctx(&ctx, bwt, text, &text_row, 1, length);
+	bigbzip_ctx_free(&ctx);
+}
+
+/* ------------------------------------------------------
+   As unbwt(), with the walk split into 'chains' chains 
+   (see bwt_ctx): rows[c] is the row of the c-th chain, 
+   rows[0] = text_row. The chains are walked interleaved,
+   so that their cache misses overlap, over the table t
+   (in the sa buffer of ctx) which maps a row of column F 
+   to its symbol and to the next row: one access per symbol.
+	------------------------------------------------------- */
+void unbwt_ctx(bigbzip_ctx *ctx, UChar bwt[], UChar text[], int rows[], int chains, int length)
 {
   void fatal_error(char *s);
-  int i,j,k, *fl, occ[256];
+  int i, c, k, n, steps, step, last_len, packed, text_row, occ[256];
+  UInt32 *t, x, end, j[BBZ_MAX_CHAINS];
+  UChar *p[BBZ_MAX_CHAINS];
 
+  if ((chains < 1) || (chains > BBZ_MAX_CHAINS) || (chains > max(length, 1))) 
+    fatal_error("Wrong number of chains! (unbwt_ctx)\n");
+  if (length == 0) return;
+  text_row = rows[0];
 
-  // Compute FL[i] as the position in the BWT 
-  // of the character F[i] (the first column of the BWT matrix)
+  // Compute, for the i-th position in the BWT, its row 
+  // in the column F (the first column of the BWT matrix)
   // ignoring the eof symbol
-
   for(i=0;i<256;i++) occ[i]=0;
   for(i=0;i<length;i++) occ[bwt[i]]++;
   for(i=1;i<256;i++) occ[i] += occ[i-1];
@@ -376,23 +754,53 @@ void unbwt(UChar bwt[], UChar text[], int text_row, int length)
   for(i=255;i>0;i--) occ[i] = occ[i-1];
   occ[0]=0;
   
-  // Mapping from column F to column L
-  fl = (int *) malloc(length * sizeof(int));
-  for(i=0;i<length;i++) fl[occ[bwt[i]]++] = i;
-
-  // i is an index in column L (of the bwt)
-  // j is an index in the column F
-  // k is a cursor over the text to be decompressed
-  k=0;
-  j = text_row;   // this is the first text char
-  while(1) {
-    i = fl[j];     // get last column index corresponding to j
-    text[k++] = bwt[i];  
-    assert(i>=0 && i<length && k<=length);
-    if(k==length) break;
-    if(i<=text_row) j=i-1;
-		else j=i;
-	  }
-  if(i!=0) 
+  // Mapping from column F to column L: t[j] = (next row << 8) | symbol
+  // if the rows fit 24 bits, else t[j] = position in the BWT
+  ctx->sa = (int *) bbz_grow(ctx->sa, &ctx->sa_size, length, sizeof(int));
+  t = (UInt32 *) ctx->sa;
+  packed = (length < (1 << 24));
+  if (packed) {
+    for(i=0;i<length;i++) 
+      t[occ[bwt[i]]++] = (((UInt32) ((i <= text_row) ? i-1 : i)) << 8) | bwt[i];
+    end = 0xFFFFFF; // the row after the one of position 0 in the BWT 
+    }
+  else {
+    for(i=0;i<length;i++) t[occ[bwt[i]]++] = i;
+    end = 0xFFFFFFFF;
+    }
+
+  // Chain c decodes text[c*step, (c+1)*step): the last one may be shorter
+  step = (length + chains - 1) / chains;
+  last_len = length - (chains - 1) * step;
+  if (last_len <= 0) fatal_error("Wrong number of chains! (unbwt_ctx)\n");
+  for(c=0; c < chains; c++) {
+    j[c] = rows[c];
+    p[c] = text + (size_t) c * step;
+    if (j[c] >= (UInt32) length) fatal_error("Error writing inverse BWT\n");
+    }
+  for(k=0; k < 2; k++) {
+    // first all the chains for last_len symbols, then all but the last one
+    n = (k == 0) ? chains : chains - 1;
+    steps = (k == 0) ? last_len : step - last_len;
+    if (packed) 
+      for(i=0; i < steps; i++)
+        for(c=0; c < n; c++) {
+          x = t[j[c]];
+          *(p[c]++) = (UChar) x;
+          j[c] = x >> 8;
+          }
+    else 
+      for(i=0; i < steps; i++)
+        for(c=0; c < n; c++) {
+          x = t[j[c]];
+          *(p[c]++) = bwt[x];
+          j[c] = (x <= (UInt32) text_row) ? x-1 : x;
+          }
+    }
+
+  // each chain must stop at the row of the next one, the last at the end
+  for(c=0; c < chains - 1; c++)
+    if (j[c] != (UInt32) rows[c+1]) fatal_error("Error writing inverse BWT\n");  
+  if (j[chains-1] != end) 
     fatal_error("Error writing inverse BWT\n");  
 }
@@ -42,17 +42,92 @@ typedef unsigned long long UInt64;
 // constant and macro for marking groups
 #define SETMASK (1 << 30)
 #define CLEARMASK (~(SETMASK))
-#define IS_SORTED_BUCKET(sb) (ftab[sb] & SETMASK)
-#define BUCKET_FIRST(sb) (ftab[sb]&CLEARMASK)
-#define BUCKET_LAST(sb) ((ftab[sb+1]&CLEARMASK)-1)
-#define BUCKET_SIZE(sb) ((ftab[sb+1]&CLEARMASK)-(ftab[sb]&CLEARMASK))
-
+#define IS_SORTED_BUCKET(sb) (ds->ftab[sb] & SETMASK)
+#define BUCKET_FIRST(sb) (ds->ftab[sb]&CLEARMASK)
+#define BUCKET_LAST(sb) ((ds->ftab[sb+1]&CLEARMASK)-1)
+#define BUCKET_SIZE(sb) ((ds->ftab[sb+1]&CLEARMASK)-(ds->ftab[sb]&CLEARMASK))
+
+// size of the buffers of trie nodes used by blind_ssort()
+#define BUFSIZE 1000
+#define FREESIZE 5000
+
+/* ------- node of blind trie -------- */ 
+typedef struct nodex {
+  Int32 skip;
+  UChar key;  
+  struct nodex  *down;      // first child
+  struct nodex *right;      // next brother
+} node;
+
+/* ---------------------------------------------------------------------
+   parameters and working state of a suffix sort. Every routine of the
+   algorithm gets the context of the sort it belongs to, so sorts using
+   distinct contexts can run at the same time in distinct threads
+   --------------------------------------------------------------------- */
+#include "ds_ssort.h"
+#ifndef DS_SSORT_DEFAULT  /* algorithm of the new contexts, see ds_ssort.h */
+#define DS_SSORT_DEFAULT DS_SSORT_DEEP_SHALLOW
+#endif
+struct ds_ssort_context {
+  Int32 Algorithm;                // DS_SSORT_DEEP_SHALLOW or DS_SSORT_SAIS
+  // ---- parameters (see set_global_variables() in globals.c)
+  Int32 Anchor_dist;              // distance between anchors
+  Int32 Shallow_limit;            // limit for shallow_sort
+  Int32 Verbose;                  // how verbose it the algorithm?
+  Int32 Word_size;                // # of bytes in word in mkqs
+  Int32 Mk_qs_thresh;             // recursion limit for mk quicksort
+  Int32 Max_pseudo_anchor_offset; // maximum offset considered when 
+                                  // searching a pseudo anchor
+  Int32 B2g_ratio;                // maximum ratio bucket_size/group_size
+                                  // accepted for pseudo anchor_sorting
+  Int32 Update_anchor_ranks;      // if!=0 update anchor ranks when determining
+                                  // rank for pseudo-sorting
+  Int32 Blind_sort_ratio;         // blind sort is used for groups of size 
+                                  // <= Text_size/Blind_sort_ratio
+  Int32 Overshoot;                // extra bytes required after the text
+  // ---- ds.c
+  Int32  Text_size;               // size of input string 
+  UChar  *Text;                   // input string+ overshoot
+  Int32  *Sa;                     // suffix array
+  UChar  *Upper_text_limit;       // Text+Text_size
+  Int32  *Anchor_rank;            // rank of the anchor points (see ds.c)
+  UInt16 *Anchor_offset;          // offset of the suffix whose rank is 
+                                  // in Anchor_rank
+  Int32  Anchor_num;              // number of anchor points
+  Int32  *ftab;                   // table of buckets endpoints (65537)
+  Int32  runningOrder[256];
+  // ---- shallow.c
+  UChar  *Shallow_text_limit;     // Text+Shallow_limit
+  Int32  Cmp_left;
+  int    lcp_aux[1+Max_thresh];
+  // ---- deep2.c
+  Int32  Cmp_done;
+  // ---- helped.c
+  UChar  *bucket_ranked;          // 65536 flags
+  // ---- blind2.c
+  void   **freearr;               // FREESIZE buffers of trie nodes
+  node   *bufn;
+  int    bufn_num, free_num;
+  Int32  *Aux, Aux_written;
+  node   **Stack;
+  int    Stack_size;
+  // ---- counters
+  Int32  Calls_helped_sort;     
+  Int32  Calls_anchor_sort_forw;     
+  Int32  Calls_anchor_sort_backw;    
+  Int32  Calls_pseudo_anchor_sort_forw;      
+  Int32  Calls_deep_sort;     
+};
+
+// ----- prototypes of the routines of the algorithm
+ds_ssort_context *ds_ssort_alloc(void);
+void ds_ssort_workspace(ds_ssort_context *ds);
+int check_context(ds_ssort_context *ds);
+void shallow_sort(ds_ssort_context *ds, Int32 *a, int n, int shallow_limit);
+void helped_sort(ds_ssort_context *ds, Int32 *a, int n, int depth);
+void deep_sort(ds_ssort_context *ds, Int32 *a, Int32 n, Int32 depth);
+void blind_ssort(ds_ssort_context *ds, Int32 *a, Int32 n, Int32 depth);
+void vecswap2(Int32 *a, Int32 *b, int n);
+int integer_cmp(const void *, const void *);
 int scmp3(unsigned char *p, unsigned char *q, int *l, int maxl);
 void pretty_putchar(int c);
-
-
-
-
-
-
-
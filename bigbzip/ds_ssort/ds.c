@@ -8,29 +8,26 @@
    >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */ 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include "common.h"
 
-// ----- external variables ----------
-extern int Anchor_dist;
-extern int Shallow_limit;
-extern int _ds_Verbose; 
-
 // ----- macros and costants --------------
-#define BIGFREQ(b) (ftab[((b)+1) << 8] - ftab[(b) << 8])
+#define BIGFREQ(b) (ds->ftab[((b)+1) << 8] - ds->ftab[(b) << 8])
+
+static void calc_running_order(ds_ssort_context *ds);
 
 
-/* ------ "local" global variables ------- */
-Int32  Text_size;           // size of input string 
-UChar  *Text;               // input string+ overshoot
-Int32  *Sa;                 // suffix array
-UChar  *Upper_text_limit;   // Text+Text_size
-Int32  *Anchor_rank;        // rank (in the sorted suffixes of the  
-                            // anchor points (-1 if rank is unknown))
-UInt16  *Anchor_offset;     // offset (wrt to the anchor) of the suffix
-                            // whose rank is in Anchor_rank. 
-Int32 Anchor_num;           // number of anchor points
-Int32 ftab [65537];      
-Int32 runningOrder[256];
+/* ------ the "local" global variables are in the context: ------- 
+   Text_size           size of input string 
+   Text                input string+ overshoot
+   Sa                  suffix array
+   Upper_text_limit    Text+Text_size
+   Anchor_rank         rank (in the sorted suffixes of the  
+                       anchor points (-1 if rank is unknown))
+   Anchor_offset       offset (wrt to the anchor) of the suffix
+                       whose rank is in Anchor_rank. 
+   Anchor_num          number of anchor points
+   ftab, runningOrder  buckets of the first two chars                 */
 
 
 /* ------------------------------------------------------------------------
@@ -51,14 +48,6 @@ Int32 runningOrder[256];
  
 
   
-// ---------- declare and init counters --------------
-Int32 Calls_helped_sort=0;     
-Int32 Calls_anchor_sort_forw=0;     
-Int32 Calls_anchor_sort_backw=0;    
-Int32 Calls_pseudo_anchor_sort_forw=0;      
-Int32 Calls_deep_sort=0;     
-
-
 /* ************************************************************
    This is the main deep/shallow suffix sorting routines
    It divides the suffixes in buckets according to the 
@@ -67,12 +56,8 @@ Int32 Calls_deep_sort=0;
    sorted, we use this ordering to sort all suffixes in the 
    buckets ya (for any y including y=a).
    ************************************************************* */
-void ds_ssort(UChar *x, Int32 *p, Int32 n)
+void ds_ssort_r(ds_ssort_context *ds, UChar *x, Int32 *p, Int32 n)
 {
-  void shallow_sort(Int32 *, int, int);
-  static void check_ordering(int, int);
-  static void calc_running_order ( void );
-  int compute_overshoot(void), overshoot;
   Int32  i, j, ss, sb, k;
   UChar  c1, c2;
   Bool   bigDone[256];
@@ -80,55 +65,63 @@ void ds_ssort(UChar *x, Int32 *p, Int32 n)
   Int32  copyEnd  [256];
   Int32  numQSorted = 0;
 
-  // ------ set some global variable ------
-  Text=x;
-  Text_size=n;
-  Sa = p;
-  Upper_text_limit = Text + Text_size;
+  if(ds->Algorithm==DS_SSORT_SAIS) {
+    sais(x, p, n);
+    return;
+  }
+  // ------ set the state of this sort
+  if(ds->ftab==NULL) ds_ssort_workspace(ds);
+  ds->Text=x;
+  ds->Text_size=n;
+  ds->Sa = p;
+  ds->Upper_text_limit = ds->Text + ds->Text_size;
+  ds->Calls_helped_sort = ds->Calls_anchor_sort_forw = 0;
+  ds->Calls_anchor_sort_backw = ds->Calls_pseudo_anchor_sort_forw = 0;
+  ds->Calls_deep_sort = 0;
+  for(i=0;i<65536;i++) ds->bucket_ranked[i]=0;
   // ------ fill overshoot area
-  overshoot = compute_overshoot();
-  for(i=n;i<n+overshoot;i++) Text[i]=0; 
+  for(i=n;i<n+ds->Overshoot;i++) ds->Text[i]=0; 
 
   // ------ init array containing positions of anchors
-  if(Anchor_dist==0) {
-    Anchor_num=0; Anchor_rank=NULL; Anchor_offset=NULL;
+  if(ds->Anchor_dist==0) {
+    ds->Anchor_num=0; ds->Anchor_rank=NULL; ds->Anchor_offset=NULL;
   }
   else {
-    Anchor_num = 2 + (n-1)/Anchor_dist;  // see comment for helped_sort() 
-    Anchor_rank = (Int32 *) malloc(Anchor_num*sizeof(Int32));
-    Anchor_offset = (UInt16 *) malloc(Anchor_num*sizeof(UInt16));
-    if(!Anchor_rank || !Anchor_offset) {
+    ds->Anchor_num = 2 + (n-1)/ds->Anchor_dist;  // see comment for helped_sort() 
+    ds->Anchor_rank = (Int32 *) malloc(ds->Anchor_num*sizeof(Int32));
+    ds->Anchor_offset = (UInt16 *) malloc(ds->Anchor_num*sizeof(UInt16));
+    if(!ds->Anchor_rank || !ds->Anchor_offset) {
       fprintf(stderr, "malloc failed (ds_sort)\n");
       exit(1);
     }
-    for(i=0;i<Anchor_num;i++) {
-      Anchor_rank[i]= -1;               // pos of anchors is initially unknown
-      Anchor_offset[i] = Anchor_dist;   // maximum possible value
+    for(i=0;i<ds->Anchor_num;i++) {
+      ds->Anchor_rank[i]= -1;               // pos of anchors is initially unknown
+      ds->Anchor_offset[i] = ds->Anchor_dist;   // maximum possible value
     }
   }
 
   // ---------- init ftab ------------------
-  for (i = 0; i <= 65536; i++) ftab[i] = 0;
-  c1 = Text[0];
-  for (i = 1; i <= Text_size; i++) {
-    c2 = Text[i];
-    ftab[(c1 << 8) + c2]++;
+  for (i = 0; i <= 65536; i++) ds->ftab[i] = 0;
+  c1 = ds->Text[0];
+  for (i = 1; i <= ds->Text_size; i++) {
+    c2 = ds->Text[i];
+    ds->ftab[(c1 << 8) + c2]++;
     c1 = c2;
   }
-  for (i = 1; i <= 65536; i++) ftab[i] += ftab[i-1];
+  for (i = 1; i <= 65536; i++) ds->ftab[i] += ds->ftab[i-1];
 
   // -------- sort suffixes considering only the first two chars 
-  c1 = Text[0];
-  for (i = 0; i < Text_size; i++) {
-    c2 = Text[i+1];
+  c1 = ds->Text[0];
+  for (i = 0; i < ds->Text_size; i++) {
+    c2 = ds->Text[i+1];
     j = (c1 << 8) + c2;
     c1 = c2;
-    ftab[j]--;
-    Sa[ftab[j]] = i;
+    ds->ftab[j]--;
+    ds->Sa[ds->ftab[j]] = i;
   }
 
   /* decide on the running order */
-  calc_running_order();
+  calc_running_order(ds);
   for (i = 0; i < 256; i++) bigDone[i] = False;
 
    /* Really do the suffix sorting */
@@ -137,8 +130,8 @@ void ds_ssort(UChar *x, Int32 *p, Int32 n)
     /*--
       Process big buckets, starting with the least full.
       --*/
-    ss = runningOrder[i];
-    if(_ds_Verbose>2)
+    ss = ds->runningOrder[i];
+    if(ds->Verbose>2)
       fprintf(stderr,"group %3d;  size %d\n",ss,BIGFREQ(ss)&CLEARMASK); 
 
     /*--
@@ -151,69 +144,92 @@ void ds_ssort(UChar *x, Int32 *p, Int32 n)
     for (j = 0; j <= 255; j++) {
       if (j != ss) {
 	sb = (ss << 8) + j;
-	if ( ! (ftab[sb] & SETMASK) ) {
-	  Int32 lo = ftab[sb]   & CLEARMASK;
-	  Int32 hi = (ftab[sb+1] & CLEARMASK) - 1;
+	if ( ! (ds->ftab[sb] & SETMASK) ) {
+	  Int32 lo = ds->ftab[sb]   & CLEARMASK;
+	  Int32 hi = (ds->ftab[sb+1] & CLEARMASK) - 1;
 	  if (hi > lo) {
-	    if (_ds_Verbose>2)
+	    if (ds->Verbose>2)
 	      fprintf(stderr,"sorting [%02x, %02x], done %d "
 			"this %d\n", ss, j, numQSorted, hi - lo + 1 );
-	    shallow_sort(Sa+lo, hi-lo+1,Shallow_limit);
+	    shallow_sort(ds, ds->Sa+lo, hi-lo+1, ds->Shallow_limit);
             #if 0
-	    check_ordering(lo, hi);
+	    check_ordering(ds, lo, hi);
             #endif
 	    numQSorted += ( hi - lo + 1 );
 	  }
 	}
-	ftab[sb] |= SETMASK;
+	ds->ftab[sb] |= SETMASK;
       }
     }
     assert (!bigDone[ss]);
     // ------ now order small buckets of type [xx,ss]  --------
     {
       for (j = 0; j <= 255; j++) {
-	copyStart[j] =  ftab[(j << 8) + ss]     & CLEARMASK;
-	copyEnd  [j] = (ftab[(j << 8) + ss + 1] & CLEARMASK) - 1;
+	copyStart[j] =  ds->ftab[(j << 8) + ss]     & CLEARMASK;
+	copyEnd  [j] = (ds->ftab[(j << 8) + ss + 1] & CLEARMASK) - 1;
       }
       // take care of the virtual -1 char in position Text_size+1
       if(ss==0) {
-	k=Text_size-1;
-	c1 = Text[k];
+	k=ds->Text_size-1;
+	c1 = ds->Text[k];
 	if (!bigDone[c1])
-	  Sa[ copyStart[c1]++ ] = k;
+	  ds->Sa[ copyStart[c1]++ ] = k;
       }
-      for (j = ftab[ss << 8] & CLEARMASK; j < copyStart[ss]; j++) {
-	k = Sa[j]-1; if (k < 0) continue;  
-	c1 = Text[k];
+      for (j = ds->ftab[ss << 8] & CLEARMASK; j < copyStart[ss]; j++) {
+	k = ds->Sa[j]-1; if (k < 0) continue;  
+	c1 = ds->Text[k];
 	if (!bigDone[c1])
-	  Sa[ copyStart[c1]++ ] = k;
+	  ds->Sa[ copyStart[c1]++ ] = k;
       }
-      for (j = (ftab[(ss+1) << 8] & CLEARMASK) - 1; j > copyEnd[ss]; j--) {
-	k = Sa[j]-1; if (k < 0) continue;
-	c1 = Text[k];
+      for (j = (ds->ftab[(ss+1) << 8] & CLEARMASK) - 1; j > copyEnd[ss]; j--) {
+	k = ds->Sa[j]-1; if (k < 0) continue;
+	c1 = ds->Text[k];
 	if (!bigDone[c1]) 
-	  Sa[ copyEnd[c1]-- ] = k;
+	  ds->Sa[ copyEnd[c1]-- ] = k;
       }
     }
     assert (copyStart[ss] - 1 == copyEnd[ss]);
-    for (j = 0; j <= 255; j++) ftab[(j << 8) + ss] |= SETMASK;
+    for (j = 0; j <= 255; j++) ds->ftab[(j << 8) + ss] |= SETMASK;
     bigDone[ss] = True;
   }
-  if (_ds_Verbose) {
+  if (ds->Verbose) {
     fprintf(stderr, "\t %d pointers, %d sorted, %d scanned\n",
-	      Text_size, numQSorted, Text_size - numQSorted );
-    fprintf(stderr, "\t %d calls to helped_sort\n",Calls_helped_sort);      
+	      ds->Text_size, numQSorted, ds->Text_size - numQSorted );
+    fprintf(stderr, "\t %d calls to helped_sort\n",ds->Calls_helped_sort);      
     fprintf(stderr, "\t %d calls to anchor_sort (forward)\n",
-	    Calls_anchor_sort_forw);      
+	    ds->Calls_anchor_sort_forw);      
     fprintf(stderr, "\t %d calls to anchor_sort (backward)\n",
-	    Calls_anchor_sort_backw);      
+	    ds->Calls_anchor_sort_backw);      
     fprintf(stderr, "\t %d calls to pseudo_anchor_sort (forward)\n",
-    	    Calls_pseudo_anchor_sort_forw);      
-    fprintf(stderr, "\t %d calls to deep_sort\n",Calls_deep_sort);      
+    	    ds->Calls_pseudo_anchor_sort_forw);      
+    fprintf(stderr, "\t %d calls to deep_sort\n",ds->Calls_deep_sort);      
   }
   // ---- done! ---------------------------------------- 
-  free(Anchor_offset);
-  free(Anchor_rank);
+  free(ds->Anchor_offset);
+  free(ds->Anchor_rank);
+}
+
+/* ************************************************************
+   as ds_ssort_r() for an array of 64 bit positions. Deep-shallow
+   sorting writes ints in the same array, widened in place from 
+   the last one; only SA-IS sorts texts of 2^31 or more bytes
+   ************************************************************* */
+void ds_ssort_r64(ds_ssort_context *ds, UChar *x, long *p, long n)
+{
+  Int32 *p32 = (Int32 *) p;
+  long i;
+
+  if(ds->Algorithm==DS_SSORT_SAIS) {
+    sais64(x, p, n);
+    return;
+  }
+  if(n>INT_MAX) {
+    fprintf(stderr, "Text too long for deep-shallow sorting (ds_ssort_r64)\n");
+    exit(1);
+  }
+  ds_ssort_r(ds, x, p32, (Int32) n);
+  if(sizeof(long)>sizeof(Int32))
+    for(i=n;i>0;i--) p[i-1] = (long) p32[i-1];
 }
 
 
@@ -224,10 +240,10 @@ void ds_ssort(UChar *x, Int32 *p, Int32 n)
    The sorting is done using shellsort
    **************************************************************** */ 
 static
-void calc_running_order ( void )
+void calc_running_order(ds_ssort_context *ds)
 {
    Int32 i, j;
-   for (i = 0; i <= 255; i++) runningOrder[i] = i;
+   for (i = 0; i <= 255; i++) ds->runningOrder[i] = i;
 
    {
       Int32 vv;
@@ -236,15 +252,15 @@ void calc_running_order ( void )
       do {
          h = h / 3;
          for (i = h; i <= 255; i++) {
-            vv = runningOrder[i];
+            vv = ds->runningOrder[i];
             j = i;
-            while ( BIGFREQ(runningOrder[j-h]) > BIGFREQ(vv) ) {
-               runningOrder[j] = runningOrder[j-h];
+            while ( BIGFREQ(ds->runningOrder[j-h]) > BIGFREQ(vv) ) {
+               ds->runningOrder[j] = ds->runningOrder[j-h];
                j = j - h;
                if (j <= (h - 1)) goto zero;
             }
             zero:
-            runningOrder[j] = vv;
+            ds->runningOrder[j] = vv;
          }
       } while (h != 1);
    }
@@ -257,19 +273,19 @@ void calc_running_order ( void )
    correct order
    ******************************************************** */
 static
-void check_ordering(int lo, int hi)
+void check_ordering(ds_ssort_context *ds, int lo, int hi)
 {
   int j1,jj,error;
 
   error=0;
   for(j1=lo;j1<hi;j1++) {
-    if (scmp3(Text+Sa[j1], Text+Sa[j1+1], &jj, 
-	      MIN(Text_size-Sa[j1],Text_size-Sa[j1+1]))>=0) {
+    if (scmp3(ds->Text+ds->Sa[j1], ds->Text+ds->Sa[j1+1], &jj, 
+	      MIN(ds->Text_size-ds->Sa[j1],ds->Text_size-ds->Sa[j1+1]))>=0) {
       for(jj=0;jj<10;jj++) 
-	pretty_putchar(Text[Sa[j1]+jj]);
+	pretty_putchar(ds->Text[ds->Sa[j1]+jj]);
       printf("\n");
       for(jj=0;jj<10;jj++) 
-	pretty_putchar(Text[Sa[j1+1]+jj]);
+	pretty_putchar(ds->Text[ds->Sa[j1+1]+jj]);
       printf("\n");
       error++;
     }
@@ -278,7 +294,7 @@ void check_ordering(int lo, int hi)
     printf("----------- start ----------\n");
     for(j1=lo;j1<=hi;j1++) {
       for(jj=0;jj<10;jj++) 
-	pretty_putchar(Text[Sa[j1]+jj]);
+	pretty_putchar(ds->Text[ds->Sa[j1]+jj]);
       printf("\n");
     }
     printf("----------- end ------------\n\n");
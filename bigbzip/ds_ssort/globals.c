@@ -5,6 +5,7 @@
    which can be defined by the user + some relate procedures
    ******************************************************************* */
 #include <stdio.h>
+#include <stdlib.h>
 #include "common.h"
 
 
@@ -22,6 +23,7 @@ Int32 Update_anchor_ranks;      // if!=0 update anchor ranks when determining
                                 // rank for pseudo-sorting
 Int32 Blind_sort_ratio;         // blind sort is used for groups of size 
                                 // <= Text_size/Blind_sort_ratio
+int Default_algorithm = DS_SSORT_DEFAULT; // algorithm of the new contexts
 
 
 int check_global_variables(void);
@@ -47,6 +49,115 @@ int init_ds_ssort(int adist, int bs_ratio)
   return compute_overshoot();
 }
 
+/* *******************************************************************
+   sort the suffixes of t[0..n-1] with the parameters stored in the
+   global variables: the sort gets a context of its own
+   ******************************************************************** */
+void ds_ssort(UChar *t, Int32 *sa, Int32 n)
+{
+  ds_ssort_context *ds;
+
+  ds = ds_ssort_alloc();
+  ds->Anchor_dist = Anchor_dist;
+  ds->Shallow_limit = Shallow_limit;
+  ds->Verbose = _ds_Verbose;
+  ds->Word_size = _ds_Word_size;
+  ds->Mk_qs_thresh = Mk_qs_thresh;
+  ds->Max_pseudo_anchor_offset = Max_pseudo_anchor_offset;
+  ds->B2g_ratio = B2g_ratio;
+  ds->Update_anchor_ranks = Update_anchor_ranks;
+  ds->Blind_sort_ratio = Blind_sort_ratio;
+  ds->Overshoot = compute_overshoot();
+  ds_ssort_r(ds, t, sa, n);
+  ds_ssort_free(ds);
+}
+
+/* *******************************************************************
+   allocate a context with the parameters Anchor_dist and 
+   Blind_sort_ratio, the others get their default value.
+   Returns NULL if the parameters are illegal
+   ******************************************************************** */
+ds_ssort_context *ds_ssort_new(int adist, int bs_ratio)
+{
+  ds_ssort_context *ds;
+
+  ds = ds_ssort_alloc();
+  ds->Blind_sort_ratio=bs_ratio;
+  ds->Anchor_dist = adist;
+  ds->Shallow_limit = adist + 50;
+  ds->Verbose = 0;
+  ds->Word_size = 4;
+  ds->Mk_qs_thresh=20; 
+  ds->Max_pseudo_anchor_offset=0;
+  ds->B2g_ratio=1000;
+  ds->Update_anchor_ranks=0;
+  if(check_context(ds)) {
+    ds_ssort_free(ds);
+    return NULL;
+  }
+  ds_ssort_set_algorithm(ds, Default_algorithm);
+  return ds;
+}
+
+// amount of extra space required at the end of the text
+int ds_ssort_overshoot(ds_ssort_context *ds)
+{
+  return ds->Overshoot;
+}
+
+// algorithm of the contexts created by ds_ssort_new() from now on
+void ds_ssort_default(int algorithm)
+{
+  Default_algorithm = algorithm;
+}
+
+// choose the algorithm of a context: SA-IS needs no overshoot
+void ds_ssort_set_algorithm(ds_ssort_context *ds, int algorithm)
+{
+  if(algorithm==DS_SSORT_SAIS) {
+    ds->Algorithm = DS_SSORT_SAIS;
+    ds->Overshoot = 0;
+  }
+  else {
+    ds->Algorithm = DS_SSORT_DEEP_SHALLOW;
+    ds->Overshoot = 9+(ds->Shallow_limit+Cmp_overshoot);
+  }
+}
+
+// allocate a context, parameters are not set and the workspace 
+// is allocated by the first sort (see ds_ssort_workspace)
+ds_ssort_context *ds_ssort_alloc(void)
+{
+  ds_ssort_context *ds;
+
+  ds = (ds_ssort_context *) calloc(1, sizeof(ds_ssort_context));
+  if(!ds) {
+    fprintf(stderr, "malloc failed (ds_ssort_alloc)\n");
+    exit(1);
+  }
+  return ds;
+}
+
+// allocate the workspace of the context, it is kept for the next sorts
+void ds_ssort_workspace(ds_ssort_context *ds)
+{
+  ds->ftab = (Int32 *) malloc(65537*sizeof(Int32));
+  ds->bucket_ranked = (UChar *) malloc(65536*sizeof(UChar));
+  ds->freearr = (void **) malloc(FREESIZE*sizeof(void *));
+  if(!ds->ftab || !ds->bucket_ranked || !ds->freearr) {
+    fprintf(stderr, "malloc failed (ds_ssort_workspace)\n");
+    exit(1);
+  }
+}
+
+void ds_ssort_free(ds_ssort_context *ds)
+{
+  free(ds->ftab);
+  free(ds->bucket_ranked);
+  free(ds->freearr);
+  free(ds);
+}
+
 
 // set default values for the global variables
 void set_global_variables(void)
@@ -66,23 +177,35 @@ void set_global_variables(void)
 // are in the valid range
 int check_global_variables(void)
 {
-  if((Anchor_dist<100) && (Anchor_dist!=0)) {
+  ds_ssort_context ds;
+
+  ds.Anchor_dist = Anchor_dist;
+  ds.Shallow_limit = Shallow_limit;
+  ds.Mk_qs_thresh = Mk_qs_thresh;
+  ds.Blind_sort_ratio = Blind_sort_ratio;
+  return check_context(&ds);
+}
+
+// check if the parameters of the context are in the valid range
+int check_context(ds_ssort_context *ds)
+{
+  if((ds->Anchor_dist<100) && (ds->Anchor_dist!=0)) {
     fprintf(stderr,"Anchor distance must be 0 or greater than 99\n");
     return 1;
   }
-  if(Anchor_dist>65535) {
+  if(ds->Anchor_dist>65535) {
     fprintf(stderr,"Anchor distance must be less than 65536\n");
     return 1;
   }
-  if(Shallow_limit<2) {
+  if(ds->Shallow_limit<2) {
     fprintf(stderr,"Illegal limit for shallow sort\n");
     return 1;
   }
-  if(Mk_qs_thresh<0 || Mk_qs_thresh>Max_thresh) {
+  if(ds->Mk_qs_thresh<0 || ds->Mk_qs_thresh>Max_thresh) {
     fprintf(stderr,"Illegal Mk_qs_thresh parameter!\n");
     return 1;
   }
-  if(Blind_sort_ratio<=0) {
+  if(ds->Blind_sort_ratio<=0) {
     fprintf(stderr,"blind_sort ratio must be greater than 0!\n");
     return 1;
   }
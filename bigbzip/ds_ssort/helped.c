@@ -9,37 +9,23 @@
 #include <limits.h>
 #include "common.h"
 
-// ----------------- external variables ---------------------
-extern Int32 Anchor_dist;       // Distance between anchors
-extern Int32 Anchor_num;        // Number of anchor points
-extern Int32 *Anchor_rank;      // rank (in the sorted suffixes of the  
-                                // anchor points (-1 if rank is unknown)
-extern UInt16 *Anchor_offset;   // offset (wrt to the anchor) of the suffix
-                                // whose rank is in Anchor_rank. 
-
-extern UChar *Text;               // start of input string
-extern Int32 ftab[];              // table of buckets endpoints
-extern Int32 *Sa;                 // suffix array
-extern Int32 Max_pseudo_anchor_offset; // maximum offset considered when 
-                                       // searching a pseudo anchor
-extern Int32 B2g_ratio;           // maximum ratio bucket_size/group_size
-                                  // accepted for pseudo anchor_sorting
-extern Int32 Update_anchor_ranks; // if!=0 update anchor ranks when determining
-                                  // rank for pseudo-sorting
-
-extern Int32 Calls_helped_sort;     
-extern Int32 Calls_anchor_sort_forw;     
-extern Int32 Calls_anchor_sort_backw;     
-extern Int32 Calls_pseudo_anchor_sort_forw;     
-
-// function for deep sorting the suffixes in a[0] .. a[n-1]
-// deep is the length of the prefixes known to be equal in all suffixes
-void deep_sort(Int32 *a, Int32 n, Int32 depth);
+// ----------------- some prototypes ---------------------
+static void general_anchor_sort(ds_ssort_context *ds, Int32 *a, Int32 n,
+                                Int32 pos, Int32 rank, Int32 off);
+static Int32 split_group(ds_ssort_context *ds, Int32 *a, int n, 
+                         int,int,Int32,int *);
+static void update_anchors(ds_ssort_context *ds, Int32 *a, Int32 n);
+static void pseudo_or_deep_sort(ds_ssort_context *ds, 
+                                Int32 *a, Int32 n, Int32 depth);
+static void pseudo_anchor_sort(ds_ssort_context *ds, Int32 *a, Int32 n,
+                               Int32 pseudo_an, Int32 offset);
+Int32 get_rank(ds_ssort_context *ds, Int32 pos);
+Int32 get_rank_update_anchors(ds_ssort_context *ds, Int32 pos);
 
 // macro to compute the bucket for the suffix
 // starting at pos. Note that since pos is evaluated twice
 // it should be an expression without side-effects
-#define Get_small_bucket(pos) ((Text[pos]<<8) + Text[pos+1])
+#define Get_small_bucket(pos) ((ds->Text[pos]<<8) + ds->Text[pos+1])
 
 
 /* *****************************************************************
@@ -55,25 +41,20 @@ void deep_sort(Int32 *a, Int32 n, Int32 depth);
    Anchor_ofset[] and Anchor_rank[] defined in ds_sort()) as
      Anchor_num = 2 + (n-1)/Anchor_dist    
    ***************************************************************** */
-void helped_sort(Int32 *a, int n, int depth)
+void helped_sort(ds_ssort_context *ds, Int32 *a, int n, int depth)
 { 
-  static 
-  void general_anchor_sort(Int32 *a,Int32 n,Int32 pos,Int32 rank,Int32 off);
-  static Int32 split_group(Int32 *a, int n, int,int,Int32,int *);
-  static void update_anchors(Int32 *a, Int32 n);
-  static void pseudo_or_deep_sort(Int32 *a, Int32 n, Int32 depth);
   Int32 i, curr_sb, diff, toffset, aoffset;
   Int32 text_pos, anchor_pos, anchor, anchor_rank;
   Int32 min_forw_offset, min_forw_offset_buc, max_back_offset;
   Int32 best_forw_anchor, best_forw_anchor_buc, best_back_anchor; 
   Int32 forw_anchor_index, forw_anchor_index_buc, back_anchor_index;
 
-  Calls_helped_sort++;          // update count
+  ds->Calls_helped_sort++;          // update count
   if(n==1) goto done_sorting;    // simplest case: only one string
 
   // if there are no anchors use pseudo-anchors or deep_sort
-  if(Anchor_dist==0) {
-    pseudo_or_deep_sort(a, n, depth);
+  if(ds->Anchor_dist==0) {
+    pseudo_or_deep_sort(ds, a, n, depth);
     return;
   }
 
@@ -89,10 +70,10 @@ void helped_sort(Int32 *a, int n, int depth)
   for(i=0;i<n;i++) {
     text_pos = a[i];
     // get anchor preceeding text_pos=a[i]
-    anchor = text_pos/Anchor_dist;
-    toffset = text_pos % Anchor_dist;  // distance of a[i] from anchor
-    aoffset = Anchor_offset[anchor];   // distance of sorted suf from anchor 
-    if(aoffset<Anchor_dist) {          // check if it is a "sorted" anchor
+    anchor = text_pos/ds->Anchor_dist;
+    toffset = text_pos % ds->Anchor_dist;  // distance of a[i] from anchor
+    aoffset = ds->Anchor_offset[anchor];   // distance of sorted suf from anchor 
+    if(aoffset<ds->Anchor_dist) {          // check if it is a "sorted" anchor
       diff = aoffset - toffset;
       assert(diff!=0);
       if(diff>0) {     // anchor <=  a[i] < (sorted suffix)
@@ -118,9 +99,9 @@ void helped_sort(Int32 *a, int n, int depth)
 	  back_anchor_index = i;
 	}
 	// try to find a sorted suffix > a[i] by looking at next anchor
-	aoffset = Anchor_offset[++anchor];
-	if(aoffset<Anchor_dist) {
-	  diff = Anchor_dist + aoffset - toffset;
+	aoffset = ds->Anchor_offset[++anchor];
+	if(aoffset<ds->Anchor_dist) {
+	  diff = ds->Anchor_dist + aoffset - toffset;
 	  assert(diff>0);
 	  if(curr_sb!=Get_small_bucket(text_pos+diff)) {
 	    if(diff<min_forw_offset) {
@@ -141,37 +122,37 @@ void helped_sort(Int32 *a, int n, int depth)
   }
   // ------ if forward anchor_sort is possible, do it! --------	    
   if(best_forw_anchor>=0 && min_forw_offset<depth-1) {
-    Calls_anchor_sort_forw++;
-    assert(min_forw_offset<2*Anchor_dist);
+    ds->Calls_anchor_sort_forw++;
+    assert(min_forw_offset<2*ds->Anchor_dist);
     anchor_pos = a[forw_anchor_index] + min_forw_offset;
-    anchor_rank = Anchor_rank[best_forw_anchor];
-    assert(Sa[anchor_rank]==anchor_pos);
-    general_anchor_sort(a,n,anchor_pos,anchor_rank,min_forw_offset);
+    anchor_rank = ds->Anchor_rank[best_forw_anchor];
+    assert(ds->Sa[anchor_rank]==anchor_pos);
+    general_anchor_sort(ds, a,n,anchor_pos,anchor_rank,min_forw_offset);
     goto done_sorting;
   }
   // ------ if backward anchor_sort is possible do it! ---------
   if(best_back_anchor>=0) {
     UChar *T0, *Ti; int j;
 
-    assert(max_back_offset>-Anchor_dist && max_back_offset<0);
+    assert(max_back_offset>-ds->Anchor_dist && max_back_offset<0);
     // make sure that the offset is legal for all a[i]
     for(i=0;i<n;i++) {
       if(a[i]+max_back_offset<0) 
 	goto fail;                    // illegal offset, give up
     }
     // make sure that a[0] .. a[n-1] are preceded by the same substring
-    T0 = Text + a[0];
+    T0 = ds->Text + a[0];
     for(i=1;i<n;i++) {
-      Ti = Text + a[i];
+      Ti = ds->Text + a[i];
       for(j=max_back_offset; j<= -1; j++)
 	if(T0[j]!=Ti[j]) goto fail;   // mismatch, give up
     }
     // backward anchor sorting is possible
-    Calls_anchor_sort_backw++;
+    ds->Calls_anchor_sort_backw++;
     anchor_pos = a[back_anchor_index] + max_back_offset;
-    anchor_rank = Anchor_rank[best_back_anchor];
-    assert(Sa[anchor_rank]==anchor_pos);
-    general_anchor_sort(a,n,anchor_pos,anchor_rank,max_back_offset);
+    anchor_rank = ds->Anchor_rank[best_back_anchor];
+    assert(ds->Sa[anchor_rank]==anchor_pos);
+    general_anchor_sort(ds, a,n,anchor_pos,anchor_rank,max_back_offset);
     goto done_sorting;
   }
  fail:
@@ -179,17 +160,17 @@ void helped_sort(Int32 *a, int n, int depth)
   if(best_forw_anchor_buc>=0 && min_forw_offset_buc<depth-1) {
     int equal,lower,upper;
 
-    assert(min_forw_offset_buc<2*Anchor_dist);
+    assert(min_forw_offset_buc<2*ds->Anchor_dist);
     anchor_pos = a[forw_anchor_index_buc] + min_forw_offset_buc;
-    anchor_rank = Anchor_rank[best_forw_anchor_buc];
-    assert(Sa[anchor_rank]==anchor_pos);
+    anchor_rank = ds->Anchor_rank[best_forw_anchor_buc];
+    assert(ds->Sa[anchor_rank]==anchor_pos);
 
     // establish how many suffixes can be sorted using anchor_sort()
-    equal=split_group(a,n,depth,min_forw_offset_buc,
+    equal=split_group(ds, a,n,depth,min_forw_offset_buc,
                                 forw_anchor_index_buc,&lower);
     if(equal==n) {
-      Calls_anchor_sort_forw++;
-      general_anchor_sort(a,n,anchor_pos,anchor_rank,min_forw_offset_buc);
+      ds->Calls_anchor_sort_forw++;
+      general_anchor_sort(ds, a,n,anchor_pos,anchor_rank,min_forw_offset_buc);
     }
     else {
       //  -- a[0] ... a[n-1] are split into 3 groups: lower, equal, upper
@@ -197,14 +178,14 @@ void helped_sort(Int32 *a, int n, int depth)
       assert(upper>=0);
       // printf("Warning! lo=%d eq=%d up=%d a=%x\n",lower,equal,upper,(int)a);
       // sort the equal group 
-      Calls_anchor_sort_forw++;
+      ds->Calls_anchor_sort_forw++;
       if(equal>1)
-	general_anchor_sort(a+lower,equal,anchor_pos,anchor_rank,
+	general_anchor_sort(ds, a+lower,equal,anchor_pos,anchor_rank,
 			    min_forw_offset_buc);
 
       // sort upper and lower groups using deep_sort
-      if(lower>1) pseudo_or_deep_sort(a,lower,depth);
-      if(upper>1) pseudo_or_deep_sort(a+lower+equal,upper,depth);
+      if(lower>1) pseudo_or_deep_sort(ds, a,lower,depth);
+      if(upper>1) pseudo_or_deep_sort(ds, a+lower+equal,upper,depth);
     }       // end if(equal==n) ... else
     goto done_sorting;
   }         // end hard case
@@ -213,10 +194,10 @@ void helped_sort(Int32 *a, int n, int depth)
   // If we get here it means that everything failed
   // In this case we simply deep_sort a[0] ... a[n-1]
   // ---------------------------------------------------------------
-  pseudo_or_deep_sort(a, n, depth);
+  pseudo_or_deep_sort(ds, a, n, depth);
  done_sorting:
   // -------- update Anchor_rank[], Anchor_offset[] ------- 
-  if(Anchor_dist>0) update_anchors(a, n);
+  if(ds->Anchor_dist>0) update_anchors(ds, a, n);
 }
   
 
@@ -224,17 +205,15 @@ void helped_sort(Int32 *a, int n, int depth)
 /* *******************************************************************
    try pseudo_anchor sort or deep_sort
    ******************************************************************** */
-static void pseudo_or_deep_sort(Int32 *a, Int32 n, Int32 depth)
+static void pseudo_or_deep_sort(ds_ssort_context *ds, 
+                                Int32 *a, Int32 n, Int32 depth)
 {
-  static 
-  void pseudo_anchor_sort(Int32 *a, Int32 n,Int32 pseudo_an,Int32 offset);
-
   Int32 offset, text_pos, sb, pseudo_anchor_pos, max_offset, size;
  
   // ------- search for a useful pseudo-anchor -------------
-  if(Max_pseudo_anchor_offset>0) {
+  if(ds->Max_pseudo_anchor_offset>0) {
 
-    max_offset = min(depth-1,Max_pseudo_anchor_offset);
+    max_offset = min(depth-1,ds->Max_pseudo_anchor_offset);
     text_pos = a[0];
     for(offset=1;offset<max_offset;offset++) {
       pseudo_anchor_pos = text_pos+offset;
@@ -242,15 +221,15 @@ static void pseudo_or_deep_sort(Int32 *a, Int32 n, Int32 depth)
       // check if pseudo_anchor is in a sorted bucket
       if(IS_SORTED_BUCKET(sb)) {
 	size=BUCKET_SIZE(sb);                     // size of group
-	if(size>B2g_ratio*n) continue;            // discard large groups 
+	if(size>ds->B2g_ratio*n) continue;            // discard large groups 
 	// sort a[0] ... a[n-1] using pseudo_anchor
-	pseudo_anchor_sort(a,n,pseudo_anchor_pos,offset);
-	Calls_pseudo_anchor_sort_forw++;        // update count
+	pseudo_anchor_sort(ds, a,n,pseudo_anchor_pos,offset);
+	ds->Calls_pseudo_anchor_sort_forw++;        // update count
 	return;
       }
     }
   }
-  deep_sort(a,n,depth);
+  deep_sort(ds, a,n,depth);
 }
 
 /* ********************************************************************
@@ -260,23 +239,20 @@ static void pseudo_or_deep_sort(Int32 *a, Int32 n, Int32 depth)
    a pseudo anchor since it is used essentially as an anchor, but
    it is not in an anchor position (=position multiple of Anchor_dist)
    ******************************************************************** */
-static 
-void pseudo_anchor_sort(Int32 *a,Int32 n,Int32 pseudo_anchor_pos, Int32 offset)
+static void pseudo_anchor_sort(ds_ssort_context *ds, 
+                  Int32 *a,Int32 n,Int32 pseudo_anchor_pos, Int32 offset)
 {
-  static void general_anchor_sort(Int32 *a,Int32 n,Int32 pos,Int32 rank,Int32 off);
-  Int32 get_rank(Int32);
-  Int32 get_rank_update_anchors(Int32);
   Int32 pseudo_anchor_rank;
 
   // ---------- compute rank ------------
-  if(Update_anchor_ranks!=0 && Anchor_dist>0)
-    pseudo_anchor_rank = get_rank_update_anchors(pseudo_anchor_pos);
+  if(ds->Update_anchor_ranks!=0 && ds->Anchor_dist>0)
+    pseudo_anchor_rank = get_rank_update_anchors(ds, pseudo_anchor_pos);
   else
-    pseudo_anchor_rank = get_rank(pseudo_anchor_pos);
+    pseudo_anchor_rank = get_rank(ds, pseudo_anchor_pos);
   // ---------- check rank --------------
-  assert(Sa[pseudo_anchor_rank]==pseudo_anchor_pos);
+  assert(ds->Sa[pseudo_anchor_rank]==pseudo_anchor_pos);
   // ---------- do the sorting ----------
-  general_anchor_sort(a,n,pseudo_anchor_pos,pseudo_anchor_rank,offset);
+  general_anchor_sort(ds, a,n,pseudo_anchor_pos,pseudo_anchor_rank,offset);
 }
 
 
@@ -287,11 +263,11 @@ void pseudo_anchor_sort(Int32 *a,Int32 n,Int32 pseudo_anchor_pos, Int32 offset)
    ********************************************************* */
 #define MARKER (1<<31)
 #define MARK(i) {                \
-  assert(( Sa[i]&MARKER) == 0);  \
-  (Sa[i] |= MARKER);             \
+  assert(( ds->Sa[i]&MARKER) == 0);  \
+  (ds->Sa[i] |= MARKER);             \
 }
-#define ISMARKED(i) (Sa[i] & MARKER)
-#define UNMARK(i) (Sa[i] &= ~MARKER)
+#define ISMARKED(i) (ds->Sa[i] & MARKER)
+#define UNMARK(i) (ds->Sa[i] &= ~MARKER)
 
 /* ********************************************************************
    This routines sorts a[0] ... a[n-1] using the fact that
@@ -306,16 +282,15 @@ void pseudo_anchor_sort(Int32 *a,Int32 n,Int32 pseudo_anchor_pos, Int32 offset)
    After that, the ordering of a[0] ... a[n-1] is derived with a sigle
    scan of the marked suffixes.
    ******************************************************************** */
-static void general_anchor_sort(Int32 *a, Int32 n, 
+static void general_anchor_sort(ds_ssort_context *ds, Int32 *a, Int32 n, 
                          Int32 anchor_pos, Int32 anchor_rank, Int32 offset)
 {
-  int integer_cmp(const void *, const void *);
   Int32 sb, lo, hi;
   Int32 curr_lo, curr_hi, to_be_found, i,j;
   Int32 item; 
   void *ris;
 
-  assert(Sa[anchor_rank]==anchor_pos);
+  assert(ds->Sa[anchor_rank]==anchor_pos);
   /* ---------- get bucket of anchor ---------- */
   sb = Get_small_bucket(anchor_pos);
   lo = BUCKET_FIRST(sb);
@@ -343,13 +318,13 @@ static void general_anchor_sort(Int32 *a, Int32 n,
     // invariant: the next positions to check are curr_lo-1 and curr_hi+1
     assert(curr_lo > lo || curr_hi < hi);
     while (curr_lo > lo) {
-      item = Sa[--curr_lo]-offset;
+      item = ds->Sa[--curr_lo]-offset;
       ris = bsearch(&item,a,n,sizeof(Int32), integer_cmp);
       if(ris)	{MARK(curr_lo); to_be_found--;}
       else	break;
     }
     while (curr_hi < hi) {
-      item = Sa[++curr_hi]-offset;
+      item = ds->Sa[++curr_hi]-offset;
       ris = bsearch(&item,a,n,sizeof(Int32), integer_cmp);
       if(ris)	{MARK(curr_hi); to_be_found--;}
       else      break;
@@ -359,7 +334,7 @@ static void general_anchor_sort(Int32 *a, Int32 n,
   for(j=0, i=curr_lo;i<=curr_hi;i++) 
     if(ISMARKED(i)) {
       UNMARK(i);
-      a[j++] = Sa[i] - offset;
+      a[j++] = ds->Sa[i] - offset;
     }
   assert(j==n);  // make sure n items have been sorted
 }
@@ -368,7 +343,7 @@ static void general_anchor_sort(Int32 *a, Int32 n,
    compute the rank of the suffix starting at pos.
    It is required that the suffix is in an already sorted bucket
    ******************************************************************** */
-Int32 get_rank(Int32 pos)
+Int32 get_rank(ds_ssort_context *ds, Int32 pos)
 {
   Int32 sb, lo, hi, j;
 
@@ -380,7 +355,7 @@ Int32 get_rank(Int32 pos)
   lo = BUCKET_FIRST(sb);
   hi = BUCKET_LAST(sb);
   for(j=lo;j<=hi;j++) 
-    if(Sa[j]==pos) return j;
+    if(ds->Sa[j]==pos) return j;
   fprintf(stderr,"Illegal call to get_rank! (get_rank2)\n");
   exit(1);
   return 1;   // so that the compiler does not complain
@@ -392,13 +367,11 @@ Int32 get_rank(Int32 pos)
    can be used to update some entries in Anchor_offset[] and Anchor_rank[]
    It is required that the suffix is in an already sorted bucket   
    ******************************************************************** */
-static UChar bucket_ranked[65536];
-Int32 get_rank_update_anchors(Int32 pos)
+Int32 get_rank_update_anchors(ds_ssort_context *ds, Int32 pos)
 {
-  Int32 get_rank(Int32 pos);
   Int32 sb, lo, hi, j, toffset, aoffset, anchor, rank;
 
-  assert(Anchor_dist>0);
+  assert(ds->Anchor_dist>0);
   // --- get bucket and verify it is a sorted one
   sb = Get_small_bucket(pos);  
   if(!(IS_SORTED_BUCKET(sb))) {
@@ -406,23 +379,23 @@ Int32 get_rank_update_anchors(Int32 pos)
     exit(1);
   }
   // --- if the bucket has been already ranked just compute rank; 
-  if(bucket_ranked[sb]) return get_rank(pos);
+  if(ds->bucket_ranked[sb]) return get_rank(ds, pos);
   // --- rank all the bucket 
-  bucket_ranked[sb]=1;
+  ds->bucket_ranked[sb]=1;
   rank = -1;
   lo = BUCKET_FIRST(sb);
   hi = BUCKET_LAST(sb);
   for(j=lo;j<=hi;j++) {  
     // see if we can update an anchor
-    toffset = Sa[j]%Anchor_dist;
-    anchor  = Sa[j]/Anchor_dist;
-    aoffset = Anchor_offset[anchor];  // dist of sorted suf from anchor 
+    toffset = ds->Sa[j]%ds->Anchor_dist;
+    anchor  = ds->Sa[j]/ds->Anchor_dist;
+    aoffset = ds->Anchor_offset[anchor];  // dist of sorted suf from anchor 
     if(toffset<aoffset) {
-      Anchor_offset[anchor] = toffset;
-      Anchor_rank[anchor] = j;
+      ds->Anchor_offset[anchor] = toffset;
+      ds->Anchor_rank[anchor] = j;
     }
     // see if we have found the rank of pos, if so store it in rank
-    if(Sa[j]==pos) {
+    if(ds->Sa[j]==pos) {
       assert(rank==-1); rank=j;
     }
   }
@@ -445,22 +418,22 @@ int integer_cmp(const void *a, const void *b)
    given a SORTED array of suffixes a[0] .. a[n-1]
    updates Anchor_rank[] and Anchor_offset[]
    **************************************************************** */
-static void update_anchors(Int32 *a, Int32 n)
+static void update_anchors(ds_ssort_context *ds, Int32 *a, Int32 n)
 {
   Int32 i,anchor,toffset,aoffset,text_pos;
 
-  assert(Anchor_dist>0);
+  assert(ds->Anchor_dist>0);
   for(i=0;i<n;i++) {
     text_pos = a[i];
     // get anchor preceeding text_pos=a[i]
-    anchor = text_pos/Anchor_dist;
-    toffset = text_pos % Anchor_dist;     // distance of a[i] from anchor
-    aoffset = Anchor_offset[anchor];  // dist of sorted suf from anchor 
+    anchor = text_pos/ds->Anchor_dist;
+    toffset = text_pos % ds->Anchor_dist;     // distance of a[i] from anchor
+    aoffset = ds->Anchor_offset[anchor];  // dist of sorted suf from anchor 
     if(toffset<aoffset) {
-      Anchor_offset[anchor] = toffset;
-      Anchor_rank[anchor] = (a - Sa) + i;
-      assert(Sa[Anchor_rank[anchor]]==
-	     anchor*Anchor_dist+Anchor_offset[anchor]);
+      ds->Anchor_offset[anchor] = toffset;
+      ds->Anchor_rank[anchor] = (a - ds->Sa) + i;
+      assert(ds->Sa[ds->Anchor_rank[anchor]]==
+	     anchor*ds->Anchor_dist+ds->Anchor_offset[anchor]);
     }
   }
 }
@@ -486,17 +459,16 @@ static void update_anchors(Int32 *a, Int32 n)
    ******************************************************************* */
 #define swap2(a, b) { t = *(a); *(a) = *(b); *(b) = t; }
 #define ptr2char(i) (*(*(i) + text_depth))
-static 
-Int32 split_group(Int32 *a, int n, int depth,int offset,Int32 pivot,int *first)
+static Int32 split_group(ds_ssort_context *ds, Int32 *a, int n, 
+                         int depth,int offset,Int32 pivot,int *first)
 {
-  void vecswap2(Int32 *a, Int32 *b, int n);
   int r, partval;
   Int32 *pa, *pb, *pc, *pd, *pa_old, *pd_old, pivot_pos, t;
   UChar *text_depth,*text_limit;
 
   // --------- initialization ------------------------------------
   pivot_pos = a[pivot];       // starting position in T[] of pivot
-  text_depth = Text+depth;
+  text_depth = ds->Text+depth;
   text_limit = text_depth+offset;
 
   // -------------------------------------------------------------
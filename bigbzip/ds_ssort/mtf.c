@@ -0,0 +1,263 @@
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+   mtf.c
+   move-to-front coding of byte strings, shared by bigbzip and the
+   fm-index. The list of the 256 byte values is kept in vector
+   chunks: the rank of a symbol is found comparing a whole chunk at
+   a time, and moving a symbol to the front shifts by one byte the
+   chunks preceding it. The SSE2 kernels (16 byte chunks) and the
+   AVX2 kernels (32 byte chunks) are chosen at run time according to
+   the cpu; the scalar kernels are used by the other compilers and
+   architectures. All the kernels give the same output
+   >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MTF_X86 1
+#include <immintrin.h>
+#endif
+
+static int Mtf_kernel = -1;     // kernel forced by mtf_select(), -1=best
+
+
+/* ***********************************************************
+   scalar kernels: ranks 0 and 1 (the most frequent ones in
+   the bwt of a text) do not touch the list beyond its first
+   two entries, the others move it with memmove()
+   *********************************************************** */
+static void mtf_encode_scalar(UChar *in, UChar *out, long n)
+{
+  UChar list[256], c;
+  long i;
+  int r;
+
+  for(r=0; r<256; r++) list[r] = (UChar) r;
+  for(i=0; i<n; i++) {
+    c = in[i];
+    if(list[0]==c) r = 0;
+    else if(list[1]==c) {
+      list[1] = list[0]; list[0] = c; r = 1;
+    }
+    else {
+      for(r=2; list[r]!=c; r++) ;
+      memmove(list+1, list, r);
+      list[0] = c;
+    }
+    out[i] = (UChar) r;
+  }
+}
+
+static void mtf_decode_scalar(UChar *in, UChar *out, long n)
+{
+  UChar list[256], c;
+  long i;
+  int r;
+
+  for(r=0; r<256; r++) list[r] = (UChar) r;
+  for(i=0; i<n; i++) {
+    r = in[i];
+    c = list[r];
+    if(r==1) list[1] = list[0];
+    else if(r>1) memmove(list+1, list, r);
+    list[0] = c;
+    out[i] = c;
+  }
+}
+
+
+#ifdef MTF_X86
+/* ***********************************************************
+   SSE2 kernels. mtf_front_sse2() moves c=list[r] to the front:
+   the chunk containing r is shifted up to position r, the
+   chunks before it are shifted entirely; the byte entering
+   each chunk is the last byte of the previous (old) chunk,
+   and c for the first chunk
+   *********************************************************** */
+static inline void mtf_front_sse2(__m128i *list, int r, UChar c)
+{
+  const __m128i idx = _mm_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  __m128i v, prev, sh, mask;
+  int j = r >> 4;
+
+  v = _mm_load_si128(list + j);
+  prev = j ? _mm_load_si128(list + j - 1) : _mm_set1_epi8((char) c);
+  sh = _mm_or_si128(_mm_slli_si128(v, 1), _mm_srli_si128(prev, 15));
+  mask = _mm_cmpgt_epi8(_mm_set1_epi8((char) ((r & 15) + 1)), idx);
+  _mm_store_si128(list + j,
+                  _mm_xor_si128(v, _mm_and_si128(mask, _mm_xor_si128(v, sh))));
+  for(j--; j>=0; j--) {
+    v = prev;
+    prev = j ? _mm_load_si128(list + j - 1) : _mm_set1_epi8((char) c);
+    _mm_store_si128(list + j,
+                    _mm_or_si128(_mm_slli_si128(v, 1), _mm_srli_si128(prev, 15)));
+  }
+}
+
+static void mtf_encode_sse2(UChar *in, UChar *out, long n)
+{
+  __m128i list[16], cv;
+  UChar *l = (UChar *) list, c;
+  long i;
+  int j, m, r;
+
+  for(r=0; r<256; r++) l[r] = (UChar) r;
+  for(i=0; i<n; i++) {
+    c = in[i];
+    if(l[0]==c) r = 0;
+    else {
+      cv = _mm_set1_epi8((char) c);
+      for(j=0; !(m = _mm_movemask_epi8(_mm_cmpeq_epi8(list[j], cv))); j++) ;
+      r = (j << 4) + __builtin_ctz(m);
+      mtf_front_sse2(list, r, c);
+    }
+    out[i] = (UChar) r;
+  }
+}
+
+static void mtf_decode_sse2(UChar *in, UChar *out, long n)
+{
+  __m128i list[16];
+  UChar *l = (UChar *) list, c;
+  long i;
+  int r;
+
+  for(r=0; r<256; r++) l[r] = (UChar) r;
+  for(i=0; i<n; i++) {
+    r = in[i];
+    c = l[r];
+    if(r) mtf_front_sse2(list, r, c);
+    out[i] = c;
+  }
+}
+
+
+/* ***********************************************************
+   AVX2 kernels, as the SSE2 ones with 32 byte chunks. The
+   byte shift of a 32 byte chunk crosses its two lanes:
+   alignr combines each lane with the one preceding it,
+   which permute2x128 takes from the previous chunk
+   *********************************************************** */
+__attribute__((target("avx2")))
+static inline __m256i mtf_shift_avx2(__m256i v, __m256i prev)
+{
+  return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(prev, v, 0x21), 15);
+}
+
+__attribute__((target("avx2")))
+static inline void mtf_front_avx2(__m256i *list, int r, UChar c)
+{
+  const __m256i idx = _mm256_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,
+                                       16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31);
+  __m256i v, prev, mask;
+  int j = r >> 5;
+
+  v = _mm256_load_si256(list + j);
+  prev = j ? _mm256_load_si256(list + j - 1) : _mm256_set1_epi8((char) c);
+  mask = _mm256_cmpgt_epi8(_mm256_set1_epi8((char) ((r & 31) + 1)), idx);
+  _mm256_store_si256(list + j, _mm256_blendv_epi8(v, mtf_shift_avx2(v, prev), mask));
+  for(j--; j>=0; j--) {
+    v = prev;
+    prev = j ? _mm256_load_si256(list + j - 1) : _mm256_set1_epi8((char) c);
+    _mm256_store_si256(list + j, mtf_shift_avx2(v, prev));
+  }
+}
+
+__attribute__((target("avx2")))
+static void mtf_encode_avx2(UChar *in, UChar *out, long n)
+{
+  __m256i list[8], cv;
+  UChar *l = (UChar *) list, c;
+  long i;
+  int j, r;
+  unsigned m;
+
+  for(r=0; r<256; r++) l[r] = (UChar) r;
+  for(i=0; i<n; i++) {
+    c = in[i];
+    if(l[0]==c) r = 0;
+    else {
+      cv = _mm256_set1_epi8((char) c);
+      for(j=0; !(m = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(list[j], cv))); j++) ;
+      r = (j << 5) + __builtin_ctz(m);
+      mtf_front_avx2(list, r, c);
+    }
+    out[i] = (UChar) r;
+  }
+}
+
+__attribute__((target("avx2")))
+static void mtf_decode_avx2(UChar *in, UChar *out, long n)
+{
+  __m256i list[8];
+  UChar *l = (UChar *) list, c;
+  long i;
+  int r;
+
+  for(r=0; r<256; r++) l[r] = (UChar) r;
+  for(i=0; i<n; i++) {
+    r = in[i];
+    c = l[r];
+    if(r) mtf_front_avx2(list, r, c);
+    out[i] = c;
+  }
+}
+#endif
+
+
+/* ***********************************************************
+   the best kernel supported by the cpu, or the one forced by
+   mtf_select() if it is slower
+   *********************************************************** */
+static int mtf_kernel(void)
+{
+  int best = MTF_SCALAR;
+
+#ifdef MTF_X86
+  best = __builtin_cpu_supports("avx2") ? MTF_AVX2 : MTF_SSE2;
+#endif
+  if(Mtf_kernel >= 0 && Mtf_kernel < best) return Mtf_kernel;
+  return best;
+}
+
+/* ***********************************************************
+   force the kernels used by the following calls (-1 restores
+   the best one); returns the kernel actually used, which is
+   not faster than the one supported by the cpu
+   *********************************************************** */
+int mtf_select(int kernel)
+{
+  Mtf_kernel = kernel;
+  return mtf_kernel();
+}
+
+/* ***********************************************************
+   out[i] = rank of in[i] in the mtf list, which is initially
+   0,1,...,255: out can be equal to in
+   *********************************************************** */
+void mtf_encode(UChar *in, UChar *out, long n)
+{
+  switch(mtf_kernel()) {
+#ifdef MTF_X86
+  case MTF_AVX2: mtf_encode_avx2(in, out, n); break;
+  case MTF_SSE2: mtf_encode_sse2(in, out, n); break;
+#endif
+  default: mtf_encode_scalar(in, out, n);
+  }
+}
+
+/* ***********************************************************
+   inverse of mtf_encode(): out can be equal to in
+   *********************************************************** */
+void mtf_decode(UChar *in, UChar *out, long n)
+{
+  switch(mtf_kernel()) {
+#ifdef MTF_X86
+  case MTF_AVX2: mtf_decode_avx2(in, out, n); break;
+  case MTF_SSE2: mtf_decode_sse2(in, out, n); break;
+#endif
+  default: mtf_decode_scalar(in, out, n);
+  }
+}
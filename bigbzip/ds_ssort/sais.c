@@ -0,0 +1,42 @@
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> 
+   sais.c
+   linear time suffix sorting by induced sorting (SA-IS), see
+   G. Nong, S. Zhang, W.H. Chan, "Two efficient algorithms for 
+   linear time suffix array construction", IEEE Trans. Computers 2011.
+   It is the alternative to deep-shallow sorting for the texts with 
+   long repetitions: it needs no overshoot and no parameters, its 
+   workspace is n/4 bytes plus the free space of the suffix array.
+   The routines are compiled for 32 bit (sais) and 64 bit (sais64) 
+   indices from sais_core.h
+   >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */ 
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+
+#define SAIDX Int32
+#define SAIS_FN(name) name##_32
+#include "sais_core.h"
+#undef SAIDX
+#undef SAIS_FN
+
+#define SAIDX long
+#define SAIS_FN(name) name##_64
+#include "sais_core.h"
+#undef SAIDX
+#undef SAIS_FN
+
+
+/* ***********************************************************
+   sort the suffixes of t[0..n-1] writing their starting 
+   positions in sa[0..n-1]. The texts of 2^31 or more bytes
+   need the 64 bit version
+   *********************************************************** */
+void sais(UChar *t, Int32 *sa, Int32 n)
+{
+  sais_main_32(t, sa, n, 256, 1, NULL, 0);
+}
+
+void sais64(UChar *t, long *sa, long n)
+{
+  sais_main_64(t, sa, n, 256, 1, NULL, 0);
+}
@@ -9,43 +9,33 @@
 #include <stdio.h>
 #include "common.h"
 
-// ----- external variables ----------
-extern UChar *Text;                // start of input string
-extern UChar *Upper_text_limit;    // Text+Text_size
-extern Int32 _ds_Word_size;        // # of bytes in a word in mkq
-extern Int32 Mk_qs_thresh;         // recursion limit for mk quicksort: 
-                                   // groups smaller than this are sorted 
-                                   // using insertion sort
-
-// ----- "local" global variables
-Int32 Shallow_limit;               // Max depth for shallow sorting
-UChar *Shallow_text_limit;         // Text+Shallow_limit
-
 #define UNROLL 1                   // if !=0 partially unroll shallow_mkq
 
 // ----- some prototypes -------------
-void helped_sort(Int32 *a, Int32 n, Int32 depth);
-static void shallow_inssort_lcp(Int32 *a, Int32 n, UChar *text_depth);
+static void shallow_inssort_lcp(ds_ssort_context *ds, 
+                                Int32 *a, Int32 n, UChar *text_depth);
+static void shallow_mkq(ds_ssort_context *ds, 
+                        Int32 *a, int n, UChar *text_depth);
+static void shallow_mkq16(ds_ssort_context *ds, 
+                          Int32 *a, int n, UChar *text_depth);
+static void shallow_mkq32(ds_ssort_context *ds, 
+                          Int32 *a, int n, UChar *text_depth);
 
 // ***** entry point for shallow sort routines *****
-void shallow_sort(Int32 *a, int n, int shallow_limit) 
+void shallow_sort(ds_ssort_context *ds, Int32 *a, int n, int shallow_limit) 
 { 
-  static void shallow_mkq(Int32 *a, int n, UChar *text_depth);
-  static void shallow_mkq16(Int32 *a, int n, UChar *text_depth);
-  static void shallow_mkq32(Int32 *a, int n, UChar *text_depth);
-
-  // init global variables
-  Shallow_limit = shallow_limit;        
-  Shallow_text_limit = Text + shallow_limit;
+  // init the limit of the sort
+  ds->Shallow_limit = shallow_limit;        
+  ds->Shallow_text_limit = ds->Text + shallow_limit;
   // call multikey quicksort
   // skip 2 chars since suffixes come from the same bucket 
-  switch(_ds_Word_size) {
-  case(1): shallow_mkq(a, n, Text+2); break;
-  case(2): shallow_mkq16(a, n, Text+2); break;
-  case(4): shallow_mkq32(a, n, Text+2); break;
+  switch(ds->Word_size) {
+  case(1): shallow_mkq(ds, a, n, ds->Text+2); break;
+  case(2): shallow_mkq16(ds, a, n, ds->Text+2); break;
+  case(4): shallow_mkq32(ds, a, n, ds->Text+2); break;
   default:
     fprintf(stderr,
-	    "Invalid word size for mkqs (%d) (shallow_sort)\n",_ds_Word_size);
+	    "Invalid word size for mkqs (%d) (shallow_sort)\n",ds->Word_size);
     exit(1);
   }     
 }
@@ -85,15 +75,15 @@ __inline__ Int32 *med3func(Int32 *a, Int32 *b, Int32 *c, UChar *text_depth)
    that is when we have found that the current set of strings
    have Shallow_limit chars in common
    ******************************************************** */
-static void shallow_mkq(Int32 *a, int n, UChar *text_depth)
+static void shallow_mkq(ds_ssort_context *ds, Int32 *a, int n, UChar *text_depth)
 {
   int d, r, partval;
   Int32 *pa, *pb, *pc, *pd, *pl, *pm, *pn, t;
   UChar *next_depth;
 
   // ---- On small arrays use insertions sort
-  if (n < Mk_qs_thresh) {
-    shallow_inssort_lcp(a, n, text_depth);
+  if (n < ds->Mk_qs_thresh) {
+    shallow_inssort_lcp(ds, a, n, text_depth);
     return;
   }
 
@@ -132,8 +122,8 @@ static void shallow_mkq(Int32 *a, int n, UChar *text_depth)
 #if UNROLL
   if(pa>pd) {
     // all values were equal to partval: make it simpler
-    if( (next_depth = text_depth+1) >= Shallow_text_limit) {
-      helped_sort(a, n, next_depth-Text);
+    if( (next_depth = text_depth+1) >= ds->Shallow_text_limit) {
+      helped_sort(ds, a, n, next_depth-ds->Text);
       return;
     }
     else {
@@ -148,14 +138,14 @@ static void shallow_mkq(Int32 *a, int n, UChar *text_depth)
   r = min(pd-pc, pn-pd-1); vecswap2(pb, pn-r, r);
   // --- sort smaller strings -------
   if ((r = pb-pa) > 1)
-    shallow_mkq(a, r, text_depth);
+    shallow_mkq(ds, a, r, text_depth);
   // --- sort strings starting with partval -----
-  if( (next_depth = text_depth+1) < Shallow_text_limit)
-    shallow_mkq(a + r, pa-pd+n-1, next_depth);
+  if( (next_depth = text_depth+1) < ds->Shallow_text_limit)
+    shallow_mkq(ds, a + r, pa-pd+n-1, next_depth);
   else 
-    helped_sort(a + r, pa-pd+n-1, next_depth-Text);
+    helped_sort(ds, a + r, pa-pd+n-1, next_depth-ds->Text);
   if ((r = pd-pc) > 1)
-    shallow_mkq(a + n-r, r, text_depth);
+    shallow_mkq(ds, a + n-r, r, text_depth);
 }
 
 
@@ -178,15 +168,15 @@ __inline__ Int32 *med3func16(Int32 *a, Int32 *b, Int32 *c, UChar *text_depth)
 #define med3_16(a, b, c) med3func16(a, b, c, text_depth)
 #endif
 
-static void shallow_mkq16(Int32 *a, int n, UChar *text_depth)
+static void shallow_mkq16(ds_ssort_context *ds, Int32 *a, int n, UChar *text_depth)
 {
   int d, r, partval;
   Int32 *pa, *pb, *pc, *pd, *pl, *pm, *pn, t;
   UChar *next_depth;
 
   // ---- On small arrays use insertions sort
-  if (n < Mk_qs_thresh) {
-    shallow_inssort_lcp(a, n, text_depth);
+  if (n < ds->Mk_qs_thresh) {
+    shallow_inssort_lcp(ds, a, n, text_depth);
     return;
   }
 
@@ -224,8 +214,8 @@ static void shallow_mkq16(Int32 *a, int n, UChar *text_depth)
 #if UNROLL
   if(pa>pd) {
     // all values were equal to partval: make it simpler
-    if( (next_depth = text_depth+2) >= Shallow_text_limit) {
-      helped_sort(a, n, next_depth-Text);
+    if( (next_depth = text_depth+2) >= ds->Shallow_text_limit) {
+      helped_sort(ds, a, n, next_depth-ds->Text);
       return;
     }
     else {
@@ -240,14 +230,14 @@ static void shallow_mkq16(Int32 *a, int n, UChar *text_depth)
   r = min(pd-pc, pn-pd-1); vecswap2(pb, pn-r, r);
   // --- sort smaller strings -------
   if ((r = pb-pa) > 1)
-    shallow_mkq16(a, r, text_depth);
+    shallow_mkq16(ds, a, r, text_depth);
   // --- sort strings starting with partval -----
-  if( (next_depth = text_depth+2) < Shallow_text_limit)
-    shallow_mkq16(a + r, pa-pd+n-1, next_depth);
+  if( (next_depth = text_depth+2) < ds->Shallow_text_limit)
+    shallow_mkq16(ds, a + r, pa-pd+n-1, next_depth);
   else 
-    helped_sort(a + r, pa-pd+n-1, next_depth-Text);
+    helped_sort(ds, a + r, pa-pd+n-1, next_depth-ds->Text);
   if ((r = pd-pc) > 1)
-    shallow_mkq16(a + n-r, r, text_depth);
+    shallow_mkq16(ds, a + n-r, r, text_depth);
 }
 
 
@@ -255,15 +245,15 @@ static void shallow_mkq16(Int32 *a, int n, UChar *text_depth)
 #define ptr2char32(i) (getword32(*(i) + text_depth))
 #define getword32(s) ((unsigned)( (*(s) << 24) | ((*((s)+1)) << 16) \
                                   | ((*((s)+2)) << 8) | (*((s)+3)) ))
-static void shallow_mkq32(Int32 *a, int n, UChar *text_depth)
+static void shallow_mkq32(ds_ssort_context *ds, Int32 *a, int n, UChar *text_depth)
 {
   UInt32 partval, val;
   Int32 *pa, *pb, *pc, *pd, *pl, *pm, *pn, t, d, r;
   UChar *next_depth;
 
   // ---- On small arrays use insertions sort
-  if (n < Mk_qs_thresh) {
-    shallow_inssort_lcp(a, n, text_depth);
+  if (n < ds->Mk_qs_thresh) {
+    shallow_inssort_lcp(ds, a, n, text_depth);
     return;
   }
 
@@ -301,8 +291,8 @@ static void shallow_mkq32(Int32 *a, int n, UChar *text_depth)
 #if UNROLL
   if(pa>pd) {
     // all values were equal to partval: make it simpler
-    if( (next_depth = text_depth+4) >= Shallow_text_limit) {
-      helped_sort(a, n, next_depth-Text);
+    if( (next_depth = text_depth+4) >= ds->Shallow_text_limit) {
+      helped_sort(ds, a, n, next_depth-ds->Text);
       return;
     }
     else {
@@ -317,14 +307,14 @@ static void shallow_mkq32(Int32 *a, int n, UChar *text_depth)
   r = min(pd-pc, pn-pd-1); vecswap2(pb, pn-r, r);
   // --- sort smaller strings -------
   if ((r = pb-pa) > 1)
-    shallow_mkq32(a, r, text_depth);
+    shallow_mkq32(ds, a, r, text_depth);
   // --- sort strings starting with partval -----
-  if( (next_depth = text_depth+4) < Shallow_text_limit)
-    shallow_mkq32(a + r, pa-pd+n-1, next_depth);
+  if( (next_depth = text_depth+4) < ds->Shallow_text_limit)
+    shallow_mkq32(ds, a + r, pa-pd+n-1, next_depth);
   else 
-    helped_sort(a + r, pa-pd+n-1, next_depth-Text);
+    helped_sort(ds, a + r, pa-pd+n-1, next_depth-ds->Text);
   if ((r = pd-pc) > 1)
-    shallow_mkq32(a + n-r, r, text_depth);
+    shallow_mkq32(ds, a + n-r, r, text_depth);
 }
 
 
@@ -347,9 +337,8 @@ static void shallow_mkq32(Int32 *a, int n, UChar *text_depth)
    comparisons the algorithm can do before returning 0 (equal strings)
    At exit Cmp_left has been decreased by the # of comparisons done   
    *********************************************************************** */ 
-static Int32 Cmp_left;
 __inline__ 
-Int32 cmp_unrolled_shallow_lcp(UChar *b1, UChar *b2)
+Int32 cmp_unrolled_shallow_lcp(ds_ssort_context *ds, UChar *b1, UChar *b2)
 {
 
   UChar c1, c2;
@@ -366,81 +355,81 @@ Int32 cmp_unrolled_shallow_lcp(UChar *b1, UChar *b2)
     // 2
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  1; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  1; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 3
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  2; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  2; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 4
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  3; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  3; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 5
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  4; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  4; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 6
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  5; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  5; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 7
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  6; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  6; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 8
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  7; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  7; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 9
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  8; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  8; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 10
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -=  9; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -=  9; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 11
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -= 10; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -= 10; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 12
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -= 11; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -= 11; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 13
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -= 12; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -= 12; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 14
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -= 13; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -= 13; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 15
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -= 14; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -= 14; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // 16
     c1 = *b1; c2 = *b2;
     if (c1 != c2) {
-      Cmp_left -= 15; return ((UInt32)c1 - (UInt32)c2); }
+      ds->Cmp_left -= 15; return ((UInt32)c1 - (UInt32)c2); }
     b1++; b2++; 
     // if we have done enough comparisons the strings are considered equal
-    Cmp_left -= 16;
-    if(Cmp_left<=0) return 0;
+    ds->Cmp_left -= 16;
+    if(ds->Cmp_left<=0) return 0;
     // assert( b1<Upper_text_limit && b2<Upper_text_limit);
   } while(1);
   //return (b2-Text) - (b1-Text);   // we have  b2>b1 <=> *b2<*b1
@@ -486,19 +475,19 @@ Int32 cmp_unrolled_shallow_lcp(UChar *b1, UChar *b2)
    lcpi==lcp[j-3] then we must compare suf(ai) with suf(a[j-3])
    but starting with position lcpi
    ***************************************************************** */
-static int lcp_aux[1+Max_thresh];
-static int *lcp=lcp_aux+1; 
-static void shallow_inssort_lcp(Int32 *a, Int32 n, UChar *text_depth)
+static void shallow_inssort_lcp(ds_ssort_context *ds, 
+                                Int32 *a, Int32 n, UChar *text_depth)
 {   
+  int *lcp=ds->lcp_aux+1;         // lcp[-1] is lcp_aux[0]
   Int32 i, j, j1, lcp_new, r, ai,lcpi;
   Int32 cmp_from_limit;
   UChar *text_depth_ai;
 
   // --------- initialize ----------------
-  lcp_aux[0] = -1;               // set lcp[-1] = -1
+  ds->lcp_aux[0] = -1;               // set lcp[-1] = -1
   for(i=0;i<n;i++) lcp[i]=0;     // I think this loop is not necessary
   // cmp_from_limit is # of cmp's to be done to reach Shallow_limit cmp's
-  cmp_from_limit = Shallow_text_limit-text_depth;
+  cmp_from_limit = ds->Shallow_text_limit-text_depth;
 
   // ----- start insertion sort -----------
   for (i = 1; i< n ; i++) {
@@ -508,9 +497,9 @@ static void shallow_inssort_lcp(Int32 *a, Int32 n, UChar *text_depth)
     while(1) {           
 
       // ------ compare ai with a[j-1] --------
-      Cmp_left = cmp_from_limit-lcpi;  
-      r = cmp_unrolled_shallow_lcp(lcpi+a[j1]+text_depth,lcpi+text_depth_ai);
-      lcp_new = cmp_from_limit - Cmp_left;       // lcp between ai and a[j1] 
+      ds->Cmp_left = cmp_from_limit-lcpi;  
+      r = cmp_unrolled_shallow_lcp(ds, lcpi+a[j1]+text_depth,lcpi+text_depth_ai);
+      lcp_new = cmp_from_limit - ds->Cmp_left;       // lcp between ai and a[j1] 
       assert(r!=0 || lcp_new>= cmp_from_limit);
 
       if(r<=0) {         // we have a[j-1] <= ai
@@ -541,7 +530,7 @@ static void shallow_inssort_lcp(Int32 *a, Int32 n, UChar *text_depth)
     for(j=i; j<n ;j++)
       if(lcp[j]<cmp_from_limit) break;
     if(j-i>0) 
-      helped_sort(a+i,j-i+1,Shallow_limit); 
+      helped_sort(ds, a+i,j-i+1,ds->Shallow_limit); 
   }
 }
 
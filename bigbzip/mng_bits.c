@@ -23,127 +23,91 @@
 #include "mytypes.h"
 #include "bigbzip.h"
 
-UChar*  __BufferAddr;     // memory address where to write/read 
-int		__ProcdBytes;    // #bytes read or written 
-int		__BufferSize;    // number of bytes in the buffer
-UInt32  __32BitBuffer;   // 32bit Word to manage bits going in/from buffer
-int		__32BitBufferFill; // Current #bits present in the 32bit Word
-
+/* -----------------------------------------------------------------------------
+   The state of a bit stream lives in a bit_stream_type, which the caller
+   passes to every function: distinct streams can then be read/written 
+   concurrently (e.g. by distinct threads). Bits are accumulated in the top 
+   part of a 64bit word, so that up to 32 bits are read/written in one step. 
+   ----------------------------------------------------------------------------- */
 
 /* To initialize the memory buffer for reading/writing */   
-void init_buffer(UChar *mem, int size) {
+void init_buffer(bit_stream_type *bs, UChar *mem, int size) {
 	void fatal_error(char *s);
 
-	__BufferAddr = mem;
-	__ProcdBytes = 0;
-	__BufferSize = size;
-	__32BitBuffer = 0;
-	__32BitBufferFill = 0;
-	if (!__BufferAddr) 
+	bs->BufferAddr = mem;
+	bs->ProcdBytes = 0;
+	bs->BufferSize = size;
+	bs->Buffer = 0;
+	bs->BufferFill = 0;
+	if (!bs->BufferAddr) 
 		fatal_error("Internal buffer for bit read/write is NULL\n");
 	}
 
-int get_buffer_fill (void)
+int get_buffer_fill (bit_stream_type *bs)
 	{
-	return(__ProcdBytes);
+	return(bs->ProcdBytes);
 	}
 
 
-/* (#bits <=24, integer to encode) */
-#define bit_write24(__n, __vv)  {									\
-	{UInt32 __v = (UInt32) (__vv); 									\
-  	assert(__32BitBufferFill <8); 									\
-	assert(__n>0 && __n<=24);	 									\
-	assert( __v < 1u << __n );										\
-	if(__ProcdBytes + ((__32BitBufferFill + __n)/8) > __BufferSize) \
-	{ fatal_error("Buffer too small!\n");}							\
-	__32BitBufferFill += (__n); 									\
-	__32BitBuffer |= (__v << (32 - __32BitBufferFill));				\
-	while (__32BitBufferFill >= 8) {            					\
-	*__BufferAddr = (__32BitBuffer>>24); 							\
-	__BufferAddr++; 												\
-    	__ProcdBytes++;												\
-		__32BitBuffer <<= 8; 										\
-		__32BitBufferFill -= 8;										\
-		}															\
-	}}
-								   
-/* (#bits <=24, result of reading) */
-#define bit_read24(__n, __r)	{									\
-	{ UInt32 __t,__u;												\
-	assert(__32BitBufferFill<8);									\
-	assert(__n>0 && __n<=24);										\
-	/* --- read 8 bits until size>= n --- */						\
-	while(__32BitBufferFill < __n) {								\
-		__t = (UInt32) *__BufferAddr;								\
-		__BufferAddr++; __ProcdBytes++;								\
-			__32BitBuffer |= (__t << (24-__32BitBufferFill));		\
-			__32BitBufferFill += 8;									\
-		}															\
-			/* ---- write n top bits in u ---- */					\
-		__u = __32BitBuffer >> (32-__n);							\
-		/* ---- update buffer ---- */								\
-		__32BitBuffer <<= __n;										\
-		__32BitBufferFill -= __n;									\
-		__r = ((int)__u);											\
-	} }
-
-
-/* -----------------------------------------------------------------------------
-   Functions to read/write more than 24 bits 
-   ----------------------------------------------------------------------------- */
-
-// ****** Write in 32BitBuffer n bits taken from vv (possibly n > 24) 
-void bbz_bit_write(int n, int vv)
+// ****** Write n bits taken from vv (n <= 32) 
+void bbz_bit_write(bit_stream_type *bs, int n, int vv)
 {  
   void fatal_error(char *s);
   
-  UInt32 v = (UInt32) vv;
-  assert(n <= 32);
-  if (n > 24){
-	  bit_write24((n-24), (v>>24 & 0xffL));
-	  bit_write24(24, (v & 0xffffffL));
-	} else {
-		bit_write24(n,v);
+  UInt64 v = (UInt64) ((UInt32) vv);
+  assert(bs->BufferFill < 8);
+  assert(n >= 0 && n <= 32);
+  assert(n == 32 || v < (((UInt64) 1) << n));
+  if (n == 0) return;
+  if (bs->ProcdBytes + ((bs->BufferFill + n) / 8) > bs->BufferSize)
+	fatal_error("Buffer too small!\n");
+
+  bs->BufferFill += n;
+  bs->Buffer |= v << (64 - bs->BufferFill);
+  while (bs->BufferFill >= 8) {
+	*(bs->BufferAddr++) = (UChar) (bs->Buffer >> 56);
+	bs->ProcdBytes++;
+	bs->Buffer <<= 8;
+	bs->BufferFill -= 8;
 	}
 }
 
-// ****** Read n bits from 32BitBuffer 
-int bbz_bit_read(int n)
+// ****** Read n bits (n <= 32): bytes are fetched only when needed, so that 
+// ****** get_buffer_fill() is the #bytes touched so far
+int bbz_bit_read(bit_stream_type *bs, int n)
 {  
-  void fatal_error(char *s);
-  
-  UInt32 u = 0;
-  int i;
-  assert(n <= 32);
-  if (n > 24){
-	bit_read24((n-24),i);
-    u =  i<<24;
-	bit_read24(24,i);
-    u |= i;
-    return((int)u);
-  } else {
-    bit_read24(n,i);
-	return i;
-  }
+  UInt32 u;
+
+  assert(bs->BufferFill < 8);
+  assert(n >= 0 && n <= 32);
+  if (n == 0) return 0;
+
+  while (bs->BufferFill < n) {
+	bs->Buffer |= ((UInt64) *(bs->BufferAddr++)) << (56 - bs->BufferFill);
+	bs->ProcdBytes++;
+	bs->BufferFill += 8;
+	}
+  u = (UInt32) (bs->Buffer >> (64 - n));
+  bs->Buffer <<= n;
+  bs->BufferFill -= n;
+  return((int)u);
 }
 
 
-// *****  Complete with zeroes the first byte of 32BitBuffer
-// *****  This way, the content of 32BitBuffer is entirely flushed out
+// *****  Complete with zeroes the last byte of the stream
+// *****  This way, the content of the 64bit word is entirely flushed out
 
-void bbz_bit_flush( void )
+void bbz_bit_flush(bit_stream_type *bs)
 {
-  void fatal_error(char *s);
-
-  if(__32BitBufferFill != 0)
-    bit_write24((8 - (__32BitBufferFill % 8)) , 0);  // pad with zero !
+  if(bs->BufferFill != 0)
+    bbz_bit_write(bs, 8 - (bs->BufferFill % 8), 0);  // pad with zero !
 }
 
 // **** Symmetric to the bit_flush() but used in bitread()
-void bbz_byte_align( void )
+void bbz_byte_align(bit_stream_type *bs)
 {
-	__32BitBufferFill = 0;
+	bs->Buffer = 0;
+	bs->BufferFill = 0;
 }
 
 // Compute the logarithm in base 2 of integer u
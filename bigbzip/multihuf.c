@@ -28,16 +28,18 @@
 #define BZ_MAX_CODE_LEN    23
 
 
-/* -------- arrays used by multihuf ------------ */
-UChar huf_len[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];    // coding and decoding
-int huf_code[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];   // coding
-int rfreq[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];      // coding
-int mtf_freq[BZ_MAX_ALPHA_SIZE];                // coding
+/* -------- arrays used by multihuf ------------ 
+   one copy per thread, so that distinct threads can (de)compress 
+   distinct blocks at the same time                               */
+static __thread UChar huf_len[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];    // coding and decoding
+static __thread int huf_code[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];   // coding
+static __thread int rfreq[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];      // coding
+static __thread int mtf_freq[BZ_MAX_ALPHA_SIZE];                // coding
 
-UChar huf_minLens[BZ_N_GROUPS];   // decoding
-int huf_limit[BZ_N_GROUPS][BZ_MAX_CODE_LEN];   // decoding
-int huf_base[BZ_N_GROUPS][BZ_MAX_CODE_LEN];    // decoding
-int huf_perm[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];  // decoding
+static __thread UChar huf_minLens[BZ_N_GROUPS];   // decoding
+static __thread int huf_limit[BZ_N_GROUPS][BZ_MAX_CODE_LEN];   // decoding
+static __thread int huf_base[BZ_N_GROUPS][BZ_MAX_CODE_LEN];    // decoding
+static __thread int huf_perm[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];  // decoding
 
 /* ********************************************************************
    rle+compression of a string using Huffman with multiple tables 
@@ -49,27 +51,40 @@ int huf_perm[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];  // decoding
 	 out_len initially contains the size of out
    ******************************************************************* */
 void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len)
+{
+  void fatal_error(char *s);
+  UInt16* mtfv;
+  UChar *selector;
+
+  mtfv = (UInt16 *) malloc((in_len+1)*sizeof(UInt16));
+  selector = (UChar *) malloc((1+(in_len+1)/BZ_G_SIZE)*sizeof(UChar));
+  if(mtfv==NULL || selector==NULL) fatal_error("multihuf_compr");
+  multihuf_compr_ws(in, in_len, out, out_len, mtfv, selector);
+  free(selector);
+  free(mtfv);
+}
+
+/* ********************************************************************
+   as multihuf_compr(), with the workspace of the caller:
+     UInt16 *mtfv      room for in_len+1 symbols
+     UChar *selector   room for 1+(in_len+1)/BZ_G_SIZE selectors
+   ******************************************************************* */
+void multihuf_compr_ws(UChar in[], int in_len, UChar out[], int *out_len,
+                       UInt16 mtfv[], UChar selector[])
 {
   void hbMakeCodeLengths(UChar *len,int *freq,int alphaSize,int maxLen);
   void hbAssignCodes(int *code,UChar *len,int minL,int maxL,int asize);
-  void bbz_bit_write(int,int);
   void fatal_error(char *s);
-  void init_buffer(UChar mem[], int size);
-  void bbz_bit_flush(void);
-  int get_buffer_fill(void);
+  bit_stream_type bs;
   int v, t, i, j, gs, ge, totc, bt, bc, iter;
   int nSelectors, minLen, maxLen, new_len;
   int nGroups;
   UInt16 cost[BZ_N_GROUPS];
   int  fave[BZ_N_GROUPS];
-  UInt16* mtfv;
-  UChar *selector;
   int alpha_size = 256; // pre-set to 256
 
   // It uses out as a buffer
-   init_buffer(out,*out_len);
-   mtfv = (UInt16 *) malloc((in_len+1)*sizeof(UInt16));
-   if(mtfv==NULL) fatal_error("multiuhf_compr");
+   init_buffer(&bs,out,*out_len);
    
    // encode sequences of 0's using 1-2 coding
    new_len=0;
@@ -111,10 +126,6 @@ void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len)
    for (t = 0; t < BZ_N_GROUPS; t++)
       for (v = 0; v < alpha_size; v++)
          huf_len[t][v] = BZ_GREATER_ICOST;
-   // alloc selector[]
-   selector = (UChar *) malloc((1+new_len/BZ_G_SIZE)*sizeof(UChar));
-   if(selector==NULL) fatal_error("multihuf_compr");
-
    /*--- Decide how many coding tables to use ---*/
    assert(new_len > 0);
    if (new_len < 200)  nGroups = 2; else
@@ -237,14 +248,14 @@ void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len)
 
    // write coding tables (i.e codeword length).
    assert(nGroups<8);
-   bbz_bit_write(3,nGroups);
+   bbz_bit_write(&bs,3,nGroups);
    for (t = 0; t < nGroups; t++) {
       int curr = huf_len[t][0];
-      bbz_bit_write(5, curr);
+      bbz_bit_write(&bs,5, curr);
       for (i = 0; i < alpha_size; i++) {
-         while (curr < huf_len[t][i]) { bbz_bit_write(2,2); curr++; /* 10 */ };
-         while (curr > huf_len[t][i]) { bbz_bit_write(2,3); curr--; /* 11 */ };
-         bbz_bit_write(1, 0 );
+         while (curr < huf_len[t][i]) { bbz_bit_write(&bs,2,2); curr++; /* 10 */ };
+         while (curr > huf_len[t][i]) { bbz_bit_write(&bs,2,3); curr--; /* 11 */ };
+         bbz_bit_write(&bs,1, 0 );
       }
    }
 
@@ -268,11 +279,11 @@ void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len)
 	    tmp2 = tmp; tmp = pos[j]; pos[j] = tmp2;
          };
          pos[0] = tmp;
-         bbz_bit_write(j+1,1);                // write selector mtf rank in unary 
+         bbz_bit_write(&bs,j+1,1);                // write selector mtf rank in unary 
        }
        for (i = gs; i <= ge; i++) {
 	 assert(mtfv[i]<alpha_size);
-         bbz_bit_write(huf_len[selector[sel]][mtfv[i]],
+         bbz_bit_write(&bs,huf_len[selector[sel]][mtfv[i]],
 		   huf_code[selector[sel]][mtfv[i]]);
        }
        gs = ge+1;
@@ -281,10 +292,8 @@ void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len)
      assert( sel == nSelectors);
    }
 
-   bbz_bit_flush();
-   *out_len = get_buffer_fill();
-   free(selector);
-   free(mtfv);
+   bbz_bit_flush(&bs);
+   *out_len = get_buffer_fill(&bs);
 }
 
 
@@ -296,13 +305,12 @@ void multihuf_compr(UChar in[], int in_len, UChar out[], int *out_len)
    001 --> 2  
      etc.
    ********************************************************* */
-static __inline__ int decode_unary(void)
+static __inline__ int decode_unary(bit_stream_type *bs)
 {
-  int bbz_bit_read(int n);
   int t,i=0;
 
   do {
-    t=bbz_bit_read(1);
+    t=bbz_bit_read(bs,1);
     if(t!=0) break;
     i++;
   } while(1);
@@ -319,33 +327,32 @@ void multihuf_decompr(UChar in[], int in_len, UChar out[], int *out_len)
 {
   void hbCreateDecodeTables(int *limit,int *base,int *perm,UChar *length,
                            int minLen, int maxLen, int alphaSize );
-  void init_buffer(UChar mem[], int size);
-  int bbz_bit_read(int n);
   void fatal_error(char *s);
+  bit_stream_type bs;
   int t, i, j, minLen, maxLen, nGroups, max_size;
 
   int alpha_size= 258;  // we temporarily use a larger alphabet
 
  // It uses in[] as an input buffer
-   init_buffer(in,in_len);
+   init_buffer(&bs,in,in_len);
    max_size = *out_len;
    *out_len=0;
 
   // get number of groups
-  nGroups=bbz_bit_read(3);
+  nGroups=bbz_bit_read(&bs,3);
   /*--- get the coding tables ---*/
   {
     int curr,uc;
 
     for (t = 0; t < nGroups; t++) {
-      curr=bbz_bit_read(5);
+      curr=bbz_bit_read(&bs,5);
       for (i = 0; i < alpha_size; i++) {
 	while (True) {
 	  if (curr < 1 || curr > 20) 
 	    fatal_error("multihuf_decompr");
-	  uc=bbz_bit_read(1);
+	  uc=bbz_bit_read(&bs,1);
 	  if (uc == 0) break;
-	  uc=bbz_bit_read(1);
+	  uc=bbz_bit_read(&bs,1);
 	  if (uc == 0) curr++; else curr--;
 	}
         huf_len[t][i] = curr;
@@ -384,7 +391,7 @@ void multihuf_decompr(UChar in[], int in_len, UChar out[], int *out_len)
      while (True) {
        if(to_be_read==0) {
 	 to_be_read = BZ_G_SIZE;                       
-	 rank=decode_unary();    // get mtf rank of new group
+	 rank=decode_unary(&bs);    // get mtf rank of new group
 	 assert(rank<nGroups);
 	 gSel=pos[rank];
 	 for(j=rank;j>0;j--)  pos[j]=pos[j-1];
@@ -398,10 +405,10 @@ void multihuf_decompr(UChar in[], int in_len, UChar out[], int *out_len)
        to_be_read--;
        // get next huffman encoded char
        zn = gMinlen;                  
-       zvec = bbz_bit_read(zn);
+       zvec = bbz_bit_read(&bs,zn);
        while (zvec > gLimit[zn]) {                    
 	 zn++;                                    
-	 zj=bbz_bit_read(1);
+	 zj=bbz_bit_read(&bs,1);
 	 zvec = (zvec << 1) | zj;                    
        };                                             
        next = gPerm[zvec - gBase[zn]];                
@@ -12,6 +12,7 @@
 #include <sys/mman.h>
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 
 /* ---------- types and costants ----------- */
 typedef int          Int32;
@@ -1,95 +1,126 @@
-
 //------------------------------------------------------
 //
 // This is a wrapper that allows to easily change the 
 // kth order entropy compressor used in each Pcdata block or
 // on the overall Salpha.
 //
+// The PPMd coder of ppmdi-source/ is linked in (ppmdi.a) and
+// works directly on the given buffers.
+//
+// PPMd takes int lengths, hence a string longer than
+// DATA_CHUNK_SIZE is coded as a sequence of chunks:
+// the mark "XBZC", the number of chunks (4 bytes), and then for
+// each chunk its PPMd length (8 bytes) followed by the PPMd data.
+// The two lengths are big-endian, as in the XBWT prologue.
+// Shorter strings are plain PPMd data, starting with "xppm".
+//
+// With DATA_CODER == DATA_BIGBZIP (option -z) a string is coded by 
+// bigbzip instead: the mark "XBBZ" followed by a bigbzip stream, in 
+// blocks of DATA_BLOCK_LEN bytes (de)compressed by NUM_THREADS threads
+// if it is longer, otherwise as a single BWT block. Strings longer 
+// than BIGBZIP_MAX_LEN (about 1.8Gb), or empty, are still coded by PPMd.
+//
 //------------------------------------------------------
 
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/times.h>
-#include <sys/resource.h>
+#include "xbzip.h"
+#include "ppmdi.h"
 
-void data_compress(unsigned char *s, int slen, unsigned char **t, int *tlen)
+void data_compress(unsigned char *s, TextInt slen, unsigned char **t, TextInt *tlen)
 {
+  unsigned char *c;
+  int clen, num, k;
+  TextInt pos, len;
+  UInt64 chunk_len;
+  bit_stream_type bs;
 
-  FILE *Outfile; 
-  FILE *Infile;  
-  int i;
+  if ((DATA_CODER == DATA_BIGBZIP) && (slen > 0) && ((UInt64) slen <= BIGBZIP_MAX_LEN)) {
+    bigbzip_compress_blocks(s, (int) slen, DATA_BLOCK_LEN, NUM_THREADS, &c, &clen);
+    *t = (unsigned char *) malloc(4 + clen);
+    if (! *t) fatal_error("Error in allocating the bigbzip data! (DataCompress)\n");
+    memcpy(*t, "XBBZ", 4);
+    memcpy(*t + 4, c, clen);
+    *tlen = 4 + clen;
+    free(c);
+    return;
+  }
 
-  system("rm -f FileXbzipTmp.*");
-  Outfile = fopen( "FileXbzipTmp.dat", "wb");
-  if (!Outfile){
-    printf("Error in opening Outfile! (DataCompress)");
-	exit(-1);
-	}
-  fwrite(s, sizeof(unsigned char), slen, Outfile);
-  fclose(Outfile);
-  system("./ppmd.exe e -m100 -o10 FileXbzipTmp.dat");
+  if (slen <= DATA_CHUNK_SIZE) {
+    if (ppmd_mem_compress(s, (int) slen, t, &clen, PPMD_DEFAULT_LEVEL) != 0){
+      printf("Error in PPMd compression! (DataCompress)");
+	  exit(-1);
+	  }
+    *tlen = clen;
+    return;
+  }
 
-  Infile=fopen("FileXbzipTmp.pmd", "rb"); 
-  if (!Infile){
-    printf("Error in opening Infile! (DataCompress)");
-	exit(-1);
-	}
-  if(fseek(Infile,0,SEEK_END)!=0) exit(-1);
-  *tlen=ftell(Infile);
-  *t=malloc(*tlen);   
-  if (!(*t)){
-    printf("Error in Malloc! (DataCompress)");
-	exit(-1);
-	}
-  rewind(Infile); 
-  i=fread(*t, (size_t) 1, (size_t) *tlen, Infile);
-  if (i != *tlen){
-    printf("Incorrect fread! (DataCompress)");
-	exit(-1);
-	}
-  fclose(Infile);
-  system("rm -f FileXbzipTmp.*");
+  num = (int) ((slen + DATA_CHUNK_SIZE - 1) / DATA_CHUNK_SIZE);
+  *t = (unsigned char *) malloc(8);
+  if (! *t) fatal_error("Error in allocating the chunked data! (DataCompress)\n");
+  memcpy(*t, "XBZC", 4);
+  init_buffer(&bs, *t + 4, 4);
+  bbz_bit_write(&bs, 32, num);
+  for(k=0, pos=0, *tlen=8; k < num; k++, pos += len){
+    len = min(DATA_CHUNK_SIZE, slen - pos);
+    if (ppmd_mem_compress(s + pos, (int) len, &c, &clen, PPMD_DEFAULT_LEVEL) != 0){
+      printf("Error in PPMd compression! (DataCompress)");
+	  exit(-1);
+	  }
+    *t = (unsigned char *) realloc(*t, *tlen + 8 + clen);
+    if (! *t) fatal_error("Error in allocating the chunked data! (DataCompress)\n");
+    chunk_len = clen;
+    init_buffer(&bs, *t + *tlen, 8);
+    bbz_bit_write(&bs, 32, (UInt32) (chunk_len >> 32));
+    bbz_bit_write(&bs, 32, (UInt32) chunk_len);
+    memcpy(*t + *tlen + 8, c, clen);
+    *tlen += 8 + clen;
+    free(c);
+  }
 }
 
-void data_decompress(unsigned char *s, int slen, unsigned char **t, int *tlen)
+void data_decompress(unsigned char *s, TextInt slen, unsigned char **t, TextInt *tlen)
 {
+  unsigned char *d;
+  int dlen;
+  UInt32 num, k;
+  TextInt pos;
+  UInt64 len;
+  bit_stream_type bs;
 
-  FILE *Outfile;   
-  FILE *Infile;    
-  int i;
-
-
-  system("rm -f FileXbzipTmp.*");
-  Outfile = fopen( "FileXbzipTmp.pmd", "wb"); 
-  if (!Outfile){
-    printf("Error in opening Outfile! (DataDeCompress)");
-	exit(-1);
-	}
-  fwrite(s, sizeof(unsigned char), slen, Outfile);
-  fclose(Outfile);
+  if ((slen > 4) && (memcmp(s, "XBBZ", 4) == 0)) {
+    if ((UInt64) slen - 4 > 0x7FFFFFFF) fatal_error("Corrupted bigbzip data! (DataDeCompress)\n");
+    bigbzip_decompress_blocks(s + 4, (int) (slen - 4), NUM_THREADS, t, &dlen);
+    *tlen = dlen;
+    return;
+  }
 
-  system("./ppmd.exe d FileXbzipTmp.pmd");
+  if ((slen < 8) || memcmp(s, "XBZC", 4)) {
+    if ((slen > 0x7FFFFFFF) || (ppmd_mem_decompress(s, (int) slen, t, &dlen) != 0)){
+      printf("Error in PPMd decompression! (DataDeCompress)");
+	  exit(-1);
+	  }
+    *tlen = dlen;
+    return;
+  }
 
-  Infile=fopen("FileXbzipTmp.dat", "rb"); 
-  if (!Infile){
-    printf("Error in opening Infile! (DataDeCompress)");
-	exit(-1);
-	}
-  if(fseek(Infile,0,SEEK_END)!=0) exit(-1);
-  *tlen=ftell(Infile);
-  *t=malloc(*tlen);   
-  if (!(*t)){
-    printf("Error in Malloc! (DataDeCompress)");
-	exit(-1);
-	}
-  rewind(Infile); 
-  i=fread(*t, (size_t) 1, (size_t) *tlen, Infile);
-  if (i != *tlen){
-    printf("Incorrect fread! (DataDeCompress)");
-	exit(-1);
-	}
-  fclose(Infile);
-  system("rm -f FileXbzipTmp.*");
+  // here slen >= 8: every chunk takes at least its 8 byte length
+  init_buffer(&bs, s + 4, 4);
+  num = (UInt32) bbz_bit_read(&bs, 32);
+  if (num > (UInt64) (slen - 8) / 8) fatal_error("Corrupted chunked data! (DataDeCompress)\n");
+  *t = NULL;
+  for(k=0, pos=8, *tlen=0; k < num; k++, pos += 8 + len){
+    if (pos + 8 > slen) fatal_error("Corrupted chunked data! (DataDeCompress)\n");
+    init_buffer(&bs, s + pos, 8);
+    len = ((UInt64) ((UInt32) bbz_bit_read(&bs, 32))) << 32;
+    len |= (UInt32) bbz_bit_read(&bs, 32);
+    if ((len > 0x7FFFFFFF) || (pos + 8 + (TextInt) len > slen) ||
+        (ppmd_mem_decompress(s + pos + 8, (int) len, &d, &dlen) != 0)){
+      printf("Error in PPMd decompression! (DataDeCompress)");
+	  exit(-1);
+	  }
+    *t = (unsigned char *) realloc(*t, *tlen + dlen);
+    if (! *t) fatal_error("Error in allocating the chunked data! (DataDeCompress)\n");
+    memcpy(*t + *tlen, d, dlen);
+    *tlen += dlen;
+    free(d);
+  }
 }
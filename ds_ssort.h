@@ -3,3 +3,42 @@
    >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */ 
 void ds_ssort(unsigned char *t, int *sa, int n);
 int init_ds_ssort(int adist, int bs_ratio);
+
+/* ---- reentrant interface: each context has its own parameters and
+   workspace, and sorts using distinct contexts can run concurrently.
+   ds_ssort_new() returns NULL if the parameters are illegal;
+   ds_ssort_overshoot() is the amount of extra space required at the
+   end of the array containing the text ---- */
+typedef struct ds_ssort_context ds_ssort_context;
+ds_ssort_context *ds_ssort_new(int adist, int bs_ratio);
+int ds_ssort_overshoot(ds_ssort_context *ds);
+void ds_ssort_r(ds_ssort_context *ds, unsigned char *t, int *sa, int n);
+void ds_ssort_free(ds_ssort_context *ds);
+
+/* ---- choice of the algorithm: deep-shallow sorting, or SA-IS which
+   sorts in linear time also the texts with long repetitions and needs
+   no overshoot. ds_ssort_default() sets the algorithm of the contexts
+   created afterwards (the default is chosen at compile time with
+   -DDS_SSORT_DEFAULT), ds_ssort_set_algorithm() changes the one of a 
+   context: ask for the overshoot after choosing it. ds_ssort_r64() 
+   writes 64 bit positions (only SA-IS sorts texts of 2^31 or more 
+   bytes); sais() and sais64() can be called directly ---- */
+#define DS_SSORT_DEEP_SHALLOW 0
+#define DS_SSORT_SAIS 1
+void ds_ssort_default(int algorithm);
+void ds_ssort_set_algorithm(ds_ssort_context *ds, int algorithm);
+void ds_ssort_r64(ds_ssort_context *ds, unsigned char *t, long *sa, long n);
+void sais(unsigned char *t, int *sa, int n);
+void sais64(unsigned char *t, long *sa, long n);
+
+/* ---- move-to-front coding of byte strings (mtf.c), shared by
+   bigbzip and the fm-index: the list is initially 0,1,...,255 and
+   out can be equal to in. The kernels (SSE2 or AVX2 on x86, scalar
+   elsewhere) are chosen at run time; mtf_select() forces slower 
+   ones, for testing, and returns the kernel actually used ---- */
+#define MTF_SCALAR 0
+#define MTF_SSE2 1
+#define MTF_AVX2 2
+void mtf_encode(unsigned char *in, unsigned char *out, long n);
+void mtf_decode(unsigned char *in, unsigned char *out, long n);
+int mtf_select(int kernel);
@@ -23,42 +23,25 @@
    to get the correct ordering
    =================================================================== */
 
-/* ------ external global variables ------- */
-extern UChar  *Text;                   // input string+ overshoot
-extern Int32  Text_size;               // size of input string
-extern UChar  *Upper_text_limit;       // Text+Text_size
-
-/* ------- node of blind trie -------- */ 
-typedef struct nodex {
-  Int32 skip;
-  UChar key;  
-  struct nodex  *down;      // first child
-  struct nodex *right;      // next brother
-} node;
-
-
-// -------- local global variables -------------------
-#define BUFSIZE 1000
-#define FREESIZE 5000
-void *freearr[FREESIZE];
-static node *bufn;
-static int bufn_num=0, free_num=0;
-static Int32 *Aux, Aux_written;
-node **Stack;
-int Stack_size;
+// -------- prototypes -------------------
+// the node type, the buffers of nodes (BUFSIZE, FREESIZE) and 
+// the "local" global variables are in common.h
+static int neg_integer_cmp(const void *, const void *);
+static node *find_companion(ds_ssort_context *ds, node *head, UChar *s);
+static node *get_leaf(node *head);
+static void insert_suffix(ds_ssort_context *ds, 
+                          node *h, Int32 suf, int n, UChar mmchar);
+static void traverse_trie(ds_ssort_context *ds, node *h);
+static Int32 compare_suffixes(ds_ssort_context *ds, 
+                              Int32 suf1, Int32 suf2, Int32 depth);
+static void free_node_mem(ds_ssort_context *ds);
 
 /* ****************************************************************
    routine for deep-sorting the suffixes a[0] ... a[n-1]
    knowing that they have a common prefix of length "depth"
   **************************************************************** */   
-void blind_ssort(Int32 *a, Int32 n, Int32 depth)
+void blind_ssort(ds_ssort_context *ds, Int32 *a, Int32 n, Int32 depth)
 {
-   int neg_integer_cmp(const void *, const void *);
-   node *find_companion(node *head, UChar *s);
-   void insert_suffix(node *h, Int32 suf, int n, UChar mmchar);
-   void traverse_trie(node *h);
-   Int32 compare_suffixes(Int32 suf1, Int32 suf2, Int32 depth);
-   void free_node_mem();
   Int32 i,j,aj,lcp;
   node nh, *root, *h;
 
@@ -67,13 +50,13 @@ void blind_ssort(Int32 *a, Int32 n, Int32 depth)
 
   // --- skip suffixes which have already reached the end-of-text
   for(j=0;j<n;j++)
-    if(a[j]+depth < Text_size)
+    if(a[j]+depth < ds->Text_size)
       break;
   if(j>=n-1) return;  // everything is already sorted!
 
   // ------ init stack -------
-  Stack = (node **) malloc(n*sizeof(node *));
-  if(Stack==NULL) {
+  ds->Stack = (node **) malloc(n*sizeof(node *));
+  if(ds->Stack==NULL) {
     fprintf(stderr,"Out of memory! (blind_ssort)\n");
     exit(1);
   }
@@ -84,40 +67,39 @@ void blind_ssort(Int32 *a, Int32 n, Int32 depth)
 
   // ------- insert suffixes a[j+1] ... a[n-1]
   for(i=j+1;i<n;i++) {
-    h=find_companion(root, Text+a[i]);
+    h=find_companion(ds, root, ds->Text+a[i]);
     assert(h->skip==-1);
-    assert(Stack_size<=i-j);
+    assert(ds->Stack_size<=i-j);
     aj=(Int32) h->down;
     assert(aj>a[i]);
-    lcp = compare_suffixes(aj,a[i],depth);
-    insert_suffix(root, a[i], lcp, Text[aj+lcp]);
+    lcp = compare_suffixes(ds, aj,a[i],depth);
+    insert_suffix(ds, root, a[i], lcp, ds->Text[aj+lcp]);
   }
 
   // ---- traverse the trie and get suffixes in lexicographic order  
-  Aux=a;  Aux_written = j;
-  traverse_trie(root);
-  assert(Aux_written==n);
+  ds->Aux=a;  ds->Aux_written = j;
+  traverse_trie(ds, root);
+  assert(ds->Aux_written==n);
  
-  free_node_mem();
-  free(Stack);
+  free_node_mem(ds);
+  free(ds->Stack);
 }
 
 /* ***********************************************************************
    this function traverses the trie rooted at head following the string s. 
    Returns the leaf "corresponding" to the string s
    *********************************************************************** */
- node *find_companion(node *head, UChar *s)
+static node *find_companion(ds_ssort_context *ds, node *head, UChar *s)
 {
-   node *get_leaf(node *head);
   UChar c;
   node *p;
   int t;
 
-  Stack_size = 0;                // init stack
+  ds->Stack_size = 0;                // init stack
   while(head->skip >= 0) {
-    Stack[Stack_size++] = head;
+    ds->Stack[ds->Stack_size++] = head;
     t = head->skip;
-    if(s+t>=Upper_text_limit)    // s[t] does not exist: mismatch 
+    if(s+t>=ds->Upper_text_limit)    // s[t] does not exist: mismatch 
       return get_leaf(head);
     c = s[t]; p = head->down;
   repeat:
@@ -131,14 +113,14 @@ void blind_ssort(Int32 *a, Int32 n, Int32 depth)
       return get_leaf(head);
     goto repeat;                 // look at next branch
   }
-  Stack[Stack_size++] = head;
+  ds->Stack[ds->Stack_size++] = head;
   return head;
 }
 
 
 // this function returns a leaf below "head". 
 // any leaf will do for the algorithm: we take the easiest to reach
- node *get_leaf(node *head)
+static node *get_leaf(node *head)
 {
   assert(head->skip>=0);
 
@@ -150,18 +132,18 @@ void blind_ssort(Int32 *a, Int32 n, Int32 depth)
 
 
 
-__inline__ node *new_node__blind_ssort(void)
+__inline__ node *new_node__blind_ssort(ds_ssort_context *ds)
 {
-  if(bufn_num-- == 0) {
-    bufn = (node *) malloc(BUFSIZE * sizeof(node));
-    if(bufn==NULL) {
+  if(ds->bufn_num-- == 0) {
+    ds->bufn = (node *) malloc(BUFSIZE * sizeof(node));
+    if(ds->bufn==NULL) {
       fprintf(stderr,"Out of mem (new_node1)\n"); exit(1);}
-    freearr[free_num++] = (void *) bufn; 
-    if(free_num>=FREESIZE) {
+    ds->freearr[ds->free_num++] = (void *) ds->bufn; 
+    if(ds->free_num>=FREESIZE) {
       fprintf(stderr,"Out of mem (new_node2)\n"); exit(1);}
-   bufn_num = BUFSIZE-1;
+   ds->bufn_num = BUFSIZE-1;
   }
-  return bufn++;
+  return ds->bufn++;
 }
 
 
@@ -170,13 +152,14 @@ __inline__ node *new_node__blind_ssort(void)
    we know that the trie already contains a string
    which share the first n chars with suf
    ***************************************************** */
- void insert_suffix(node *h, Int32 suf, int n, UChar mmchar)
+static void insert_suffix(ds_ssort_context *ds, 
+                          node *h, Int32 suf, int n, UChar mmchar)
 {
   Int32 t;
   UChar c, *s;
   node *p, **pp;
 
-  s = Text + suf;
+  s = ds->Text + suf;
 
 #if 0
   // ---------- find the insertion point
@@ -198,8 +181,8 @@ __inline__ node *new_node__blind_ssort(void)
     exit(1);
   }
 #else
-  for(t=0;t<Stack_size;t++) {
-    h=Stack[t];
+  for(t=0;t<ds->Stack_size;t++) {
+    h=ds->Stack[t];
     if(h->skip<0 || h->skip>=n) break;
   }  
 #endif
@@ -208,7 +191,7 @@ __inline__ node *new_node__blind_ssort(void)
 
   // --------- insert a new node before node *h if necessary
   if(h->skip!=n) {
-    p = new_node__blind_ssort();     // create and init new node
+    p = new_node__blind_ssort(ds);     // create and init new node
     p->key = mmchar;
     p->skip = h->skip;  // p inherits skip and children of *h
     p->down = h->down;   
@@ -226,7 +209,7 @@ __inline__ node *new_node__blind_ssort(void)
     pp = &((*pp)->right);
   }
   // ------- insert new node containing suf
-  p = new_node__blind_ssort();
+  p = new_node__blind_ssort(ds);
   p->skip = -1;
   p->key = c; 
   p->right = *pp; *pp = p;
@@ -239,12 +222,12 @@ __inline__ node *new_node__blind_ssort(void)
    so that the suffixes (stored in the leaf) are recovered
    in lexicographic order
    ************************************************************ */
- void traverse_trie(node *h)
+static void traverse_trie(ds_ssort_context *ds, node *h)
 {
   node *p, *nextp;
 
   if(h->skip<0)
-    Aux[Aux_written++] = (Int32) h->down;
+    ds->Aux[ds->Aux_written++] = (Int32) h->down;
   else {
     p = h->down;
     assert(p!=NULL);
@@ -255,13 +238,13 @@ __inline__ node *new_node__blind_ssort(void)
 	// if there are 2 nodes with equal keys 
 	// they must be considered in inverted order
 	if(nextp->key==p->key) {
-	  traverse_trie(nextp);
-	  traverse_trie(p);
+	  traverse_trie(ds, nextp);
+	  traverse_trie(ds, p);
 	  p = nextp->right;
 	  continue;
 	}
       }
-      traverse_trie(p);
+      traverse_trie(ds, p);
       p=nextp;
     } while(p!=NULL);
   }
@@ -278,7 +261,7 @@ __inline__ node *new_node__blind_ssort(void)
    the function return the result of the comparison (+ or -) and writes 
    in Cmp_done the number of comparisons done
    *********************************************************************** */ 
- __inline__
+static __inline__
 Int32 get_lcp_unrolled(UChar *b1, UChar *b2, Int32 cmp_limit)
 {
   Int32 cmp2do; 
@@ -390,15 +373,16 @@ Int32 get_lcp_unrolled(UChar *b1, UChar *b2, Int32 cmp_limit)
    in this case the function returns n=length(suf1)-1. So in this case 
    suf1[n]==suf2[n] (and suf1[n+1] does not exists). 
    ************************************************************************ */
- Int32 compare_suffixes(Int32 suf1, Int32 suf2, Int32 depth)
+static Int32 compare_suffixes(ds_ssort_context *ds, 
+                              Int32 suf1, Int32 suf2, Int32 depth)
 {
   int limit;
   UChar *s1, *s2;
 
   assert(suf1>suf2);
-  s1  = Text + depth +suf1;
-  s2  = Text + depth +suf2;
-  limit = Text_size - suf1 - depth;
+  s1  = ds->Text + depth +suf1;
+  s2  = ds->Text + depth +suf2;
+  limit = ds->Text_size - suf1 - depth;
   return depth + get_lcp_unrolled(s1 ,s2, limit);
 }
 
@@ -409,23 +393,23 @@ Int32 get_lcp_unrolled(UChar *b1, UChar *b2, Int32 cmp_limit)
    increasing length. Since suffixes are represented by their offset
    in the array, we sort these offsets in order of decreasing length.
    ****************************************************************** */
- int neg_integer_cmp(const void *a, const void *b)
+static int neg_integer_cmp(const void *a, const void *b)
 {
   return *((Int32 *) b) -  *((Int32 *) a); 
 }
 
 
 // free memory used for trie nodes
- void free_node_mem()
+static void free_node_mem(ds_ssort_context *ds)
 {
   int i;
 
-  for(i=free_num-1;i>=0;i--) {
-    assert(freearr[i]!=NULL);
-    free(freearr[i]);
+  for(i=ds->free_num-1;i>=0;i--) {
+    assert(ds->freearr[i]!=NULL);
+    free(ds->freearr[i]);
   }
   // clear counters
-  bufn_num=free_num=0;
+  ds->bufn_num=ds->free_num=0;
 }
 
 
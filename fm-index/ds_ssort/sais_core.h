@@ -0,0 +1,157 @@
+/* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> 
+   sais_core.h
+   the SA-IS routines, included by sais.c once for each type of 
+   index: SAIDX is the type of the indices and SAIS_FN(name) gives the 
+   name of a routine for that type.
+   Types and chars of the string s[0..n-1] are accessed with the macros
+   below: at the top level s is the text (cs==1), in the recursion it 
+   is an array of SAIDX names (cs==0). The sentinel following s[n-1]
+   is virtual: it is smaller than any char and it is not stored.
+   >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */ 
+#define chr(i) (cs ? (SAIDX) ((UChar *) s)[i] : ((SAIDX *) s)[i])
+#define tget(i) ((tb[(i)>>3] >> ((i)&7)) & 1)
+#define tset(i, b) (tb[(i)>>3] = (UChar) ((b) ? (tb[(i)>>3] | (1<<((i)&7))) \
+                                             : (tb[(i)>>3] & ~(1<<((i)&7)))))
+#define isLMS(i) ((i)>0 && tget(i) && !tget((i)-1))
+
+
+/* ***********************************************************
+   compute in bkt[0..k-1] the starting (end==0) or ending
+   (end!=0) position of the bucket of each char of s
+   *********************************************************** */
+static void SAIS_FN(get_buckets)(void *s, SAIDX *bkt, SAIDX n, 
+                                 SAIDX k, int cs, int end)
+{
+  SAIDX i, sum=0;
+
+  for(i=0;i<k;i++) bkt[i]=0;
+  for(i=0;i<n;i++) bkt[chr(i)]++;
+  for(i=0;i<k;i++) {
+    sum += bkt[i];
+    bkt[i] = end ? sum : sum-bkt[i];
+  }
+}
+
+/* ***********************************************************
+   induce the order of the L-type suffixes from the LMS
+   suffixes in SA. The suffix s[n-1..] is L-type and follows
+   the sentinel, so it is the first one to be placed
+   *********************************************************** */
+static void SAIS_FN(induce_L)(UChar *tb, SAIDX *SA, void *s, SAIDX *bkt,
+                              SAIDX n, SAIDX k, int cs)
+{
+  SAIDX i, j;
+
+  SAIS_FN(get_buckets)(s, bkt, n, k, cs, 0);
+  SA[bkt[chr(n-1)]++] = n-1;
+  for(i=0;i<n;i++) {
+    j = SA[i]-1;
+    if(j>=0 && !tget(j)) SA[bkt[chr(j)]++] = j;
+  }
+}
+
+/* ***********************************************************
+   induce the order of the S-type suffixes from the L-type ones
+   *********************************************************** */
+static void SAIS_FN(induce_S)(UChar *tb, SAIDX *SA, void *s, SAIDX *bkt,
+                              SAIDX n, SAIDX k, int cs)
+{
+  SAIDX i, j;
+
+  SAIS_FN(get_buckets)(s, bkt, n, k, cs, 1);
+  for(i=n-1;i>=0;i--) {
+    j = SA[i]-1;
+    if(j>=0 && tget(j)) SA[--bkt[chr(j)]] = j;
+  }
+}
+
+/* ***********************************************************
+   sort the suffixes of s[0..n-1], whose chars are in [0,k).
+   The k entries of the bucket array are taken from the free
+   space fs[0..fsn-1] when it is large enough.
+   *********************************************************** */
+static void SAIS_FN(sais_main)(void *s, SAIDX *SA, SAIDX n, SAIDX k, 
+                               int cs, SAIDX *fs, SAIDX fsn)
+{
+  UChar *tb;
+  SAIDX *bkt, *s1, i, j, n1, name, prev, pos, d;
+  int diff;
+
+  if(n<=1) {
+    if(n==1) SA[0]=0;
+    return;
+  }
+  tb = (UChar *) calloc(n/8+1, 1);
+  bkt = (k<=fsn) ? fs : (SAIDX *) malloc(k*sizeof(SAIDX));
+  if(!tb || !bkt) {
+    fprintf(stderr, "malloc failed (sais)\n");
+    exit(1);
+  }
+
+  // ------ classify the suffixes: S-type (1) or L-type (0)
+  tset(n-1, 0);
+  for(i=n-2;i>=0;i--)
+    tset(i, chr(i)<chr(i+1) || (chr(i)==chr(i+1) && tget(i+1)));
+
+  // ------ stage 1: sort the LMS-substrings by induced sorting
+  SAIS_FN(get_buckets)(s, bkt, n, k, cs, 1);
+  for(i=0;i<n;i++) SA[i] = -1;
+  for(i=1;i<n;i++)
+    if(isLMS(i)) SA[--bkt[chr(i)]] = i;
+  SAIS_FN(induce_L)(tb, SA, s, bkt, n, k, cs);
+  SAIS_FN(induce_S)(tb, SA, s, bkt, n, k, cs);
+
+  // ------ move the sorted LMS-substrings to SA[0..n1-1]
+  for(i=0,n1=0;i<n;i++)
+    if(isLMS(SA[i])) SA[n1++] = SA[i];
+
+  // ------ name them: equal substrings get the same name. Since
+  // ------ two LMS positions are at distance >= 2, the name of 
+  // ------ the substring at pos goes in SA[n1+pos/2]
+  for(i=n1;i<n;i++) SA[i] = -1;
+  for(i=0,name=0,prev=-1;i<n1;i++) {
+    pos = SA[i]; diff = 0;
+    for(d=0;;d++) {
+      if(prev==-1 || pos+d==n || prev+d==n || 
+         chr(pos+d)!=chr(prev+d) || tget(pos+d)!=tget(prev+d)) {
+        diff = 1; break;
+      }
+      if(d>0 && (isLMS(pos+d) || isLMS(prev+d))) break;
+    }
+    if(diff) { name++; prev=pos; }
+    SA[n1+pos/2] = name-1;
+  }
+  for(i=n-1,j=n-1;i>=n1;i--)
+    if(SA[i]>=0) SA[j--] = SA[i];
+
+  // ------ stage 2: sort the reduced string s1, recursing if the 
+  // ------ names are not distinct. The recursion gets the space
+  // ------ between SA[0..n1-1] and s1 for its buckets
+  s1 = SA+n-n1;
+  if(name<n1)
+    SAIS_FN(sais_main)(s1, SA, n1, name, 0, SA+n1, n-2*n1);
+  else
+    for(i=0;i<n1;i++) SA[s1[i]] = i;
+
+  // ------ stage 3: induce the suffix array of s from the 
+  // ------ sorted LMS suffixes
+  for(i=1,j=0;i<n;i++)
+    if(isLMS(i)) s1[j++] = i;           // s1 now holds the LMS positions
+  for(i=0;i<n1;i++) SA[i] = s1[SA[i]];
+  for(i=n1;i<n;i++) SA[i] = -1;
+  SAIS_FN(get_buckets)(s, bkt, n, k, cs, 1);
+  for(i=n1-1;i>=0;i--) {
+    j = SA[i]; SA[i] = -1;
+    SA[--bkt[chr(j)]] = j;
+  }
+  SAIS_FN(induce_L)(tb, SA, s, bkt, n, k, cs);
+  SAIS_FN(induce_S)(tb, SA, s, bkt, n, k, cs);
+
+  if(bkt!=fs) free(bkt);
+  free(tb);
+}
+
+#undef chr
+#undef tget
+#undef tset
+#undef isLMS
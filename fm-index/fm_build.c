@@ -184,7 +184,12 @@ int fm_build(fm_index *index, uchar *text, ulong length) {
 	if(index->owner != 0) {
 		int overshoot; 
 		if(index->text_size < SMALLSMALLFILESIZE) overshoot = 0;
-			else overshoot = init_ds_ssort(500, 2000);
+			else {
+				ds_ssort_context *ds = ds_ssort_new(500, 2000);
+				if (ds == NULL) return FM_GENERR;
+				overshoot = ds_ssort_overshoot(ds);
+				ds_ssort_free(ds);
+			}
 				
 		uchar * texts = malloc(sizeof(uchar)*(index->text_size+overshoot));
 		if ( texts == NULL) return FM_OUTMEM;
@@ -533,12 +538,19 @@ static int select_subchar(fm_index *s) {
 
 int build_sa(fm_index *s) { 
 	
+  ds_ssort_context *ds;
+
   s->lf = malloc(s->text_size * sizeof(ulong));
   if (s->lf == NULL) 
 	  	return FM_OUTMEM;
 
-  /* compute Suffix Array with library */  
-  ds_ssort(s->text, (int*) s->lf, s->text_size);
+  /* compute Suffix Array with library: the sort has its own context, 
+     so that indexes can be built concurrently */  
+  ds = ds_ssort_new(500, 2000);
+  if (ds == NULL) 
+	  	return FM_GENERR;
+  ds_ssort_r64(ds, s->text, (long *) s->lf, s->text_size);
+  ds_ssort_free(ds);
   return FM_OK;
 
 }
@@ -1120,9 +1132,15 @@ int save_index_mem(void *indexe, uchar *compress){
 int fm_read_file(char *filename, uchar **textt, ulong *length) {
 
   uchar *text;
-  unsigned long t, overshoot = (ulong) init_ds_ssort(500, 2000); 
+  unsigned long t, overshoot; 
   FILE *infile;
+  ds_ssort_context *ds;
   
+  ds = ds_ssort_new(500, 2000);
+  if(ds == NULL) return FM_GENERR;
+  overshoot = (ulong) ds_ssort_overshoot(ds);
+  ds_ssort_free(ds);
+
   infile = fopen(filename, "rb"); // b is for binary: required by DOS
   if(infile == NULL) return FM_FILEERR;
   
@@ -9,6 +9,8 @@
 #include "fm_occurences.h"
 #include <string.h> /* memcpy */
 #define VICINA (2) 
+#define FM_CHAINS (16)          /* max #chains of the inverse bwt */
+#define FM_CHAIN_MIN (1 << 16)  /* min text size to use more than one */
 
 
 /*
@@ -563,9 +565,6 @@ int uncompress_superbucket(fm_index *s, ulong numsb, uchar *out)
     switch (s->type_compression) 
 	{
       case MULTIH: /* Bzip compression of mtf-ranks */
-    	/* Initialize Mtf start */
-		for (i = 0; i < s->alpha_size_b; i++)
-			s->mtf[i] = i;
 		if(is_odd)
 			temp_len = 0;
 		else 
@@ -635,38 +634,107 @@ int fm_compute_lf(fm_index * s)
      s->bwt, s->bwt_eof_pos, s->text_size, s->lf
    Output
      s->text
+
+   The text is decoded backwards by up to FM_CHAINS chains, walked
+   interleaved so that their cache misses overlap: the first starts 
+   from the EOF row, the others from marked rows (whose positions are 
+   in the index, see extract) spread over the text. Each entry of lf
+   is packed with the char of its row, so that a step of a chain reads 
+   one entry: s->bwt is freed before the walk.
 */    
 int fm_invert_bwt(fm_index *s)
 {
-  ulong j, i;
+  ulong j, i, n, x, packed, marked, occ_char_inf, width;
+  ulong row[FM_CHAINS], pos[FM_CHAINS];  /* start of the chains */
+  ulong cur[FM_CHAINS], left[FM_CHAINS]; /* current row, chars to decode */
+  ulong stop[FM_CHAINS];                 /* row expected at the end */
+  uchar *dest[FM_CHAINS];
+  int c, k, chains;
     
   /* alloc memory */
   s->text = (uchar *) malloc(s->text_size*sizeof(uchar));
   if(s->text == NULL)
     return FM_OUTMEM;
 
-  for(j=0,i=s->text_size-1;i>0;i--) {
-    s->text[i] = s->bwt[j];
-    j = s->lf[j];              // No account for EOF
-
-    assert(j<s->text_size);
+  /* pick the marked row nearest to the start of each slice of the text */
+  for(c=0; c<FM_CHAINS; c++) pos[c] = 0;
+  if((s->skip > 1) && (s->text_size >= FM_CHAIN_MIN)) {
+    occ_char_inf = s->bwt_occ[s->specialchar];
+    if(s->specialchar == s->alpha_size-1) 
+      marked = s->text_size - occ_char_inf; 
+    else 
+      marked = s->bwt_occ[s->specialchar+1] - occ_char_inf;
+    width = s->text_size / FM_CHAINS + 1;
+    fm_init_bit_reader(s->start_prologue_occ);
+    for(j=0; j<marked; j++) {
+      x = fm_bit_read(s->log2textsize);
+      c = x / width;
+      if((c > 0) && ((pos[c] == 0) || (x < pos[c]))) {
+        pos[c] = x;
+        row[c] = occ_char_inf + j;
+      }
+    }
+  }
 
-    if(j<s->bwt_eof_pos) j++; // EOF is not accounted in c[] and thus lf[]
-                              // reflects the matrix without the first row.
-                              // Since EOF is not coded, the lf[] is correct
-                              // after bwt_eof_pos but it is -1 before.
-                              // The ++ takes care of this situation.
+  /* chain 0 ends the text from the EOF row, chain k decodes the chars
+     before the position of its marked row down to the next one */
+  cur[0] = 0; dest[0] = s->text + s->text_size - 1; 
+  for(chains=1, c=FM_CHAINS-1; c>0; c--) {
+    if(pos[c] == 0) continue;
+    left[chains-1] = (dest[chains-1] - s->text) + 1 - pos[c];
+    stop[chains-1] = (row[c] < s->bwt_eof_pos) ? row[c]+1 : row[c];
+    cur[chains] = stop[chains-1];
+    dest[chains] = s->text + pos[c] - 1;
+    chains++;
+  }
+  left[chains-1] = (dest[chains-1] - s->text) + 1;
+  stop[chains-1] = s->bwt_eof_pos;
+
+  /* lf[j] becomes (next row << 8) | char of row j, if it fits */
+  packed = (s->text_size <= (((ulong) -1) >> 8));
+  if(packed) {
+    for(j=0; j<s->text_size; j++) {
+      n = s->lf[j];            // No account for EOF
+      if(n<s->bwt_eof_pos) n++; // EOF is not accounted in c[] and thus lf[]
+                                // reflects the matrix without the first row.
+                                // The ++ takes care of this situation.
+      s->lf[j] = (n << 8) | s->bwt[j];
+    }
+    free(s->bwt); s->bwt = NULL;
+  }
 
+  /* walk the chains together until the shortest ends, then drop it */
+  while(chains > 0) {
+    for(n=left[0], c=1; c<chains; c++) 
+      if(left[c] < n) n = left[c];
+    for(i=0; i<n; i++) 
+      for(c=0; c<chains; c++) {
+        j = cur[c];
+        assert(j<s->text_size);
+        if(packed) {
+          x = s->lf[j];
+          *(dest[c]--) = (uchar) x;
+          cur[c] = x >> 8;
+        } else {
+          *(dest[c]--) = s->bwt[j];
+          j = s->lf[j];
+          cur[c] = (j<s->bwt_eof_pos) ? j+1 : j;
+        }
+      }
+    for(c=0, k=0; c<chains; c++) {
+      left[c] -= n;
+      if(left[c] > 0) {
+        cur[k] = cur[c]; dest[k] = dest[c]; left[k] = left[c]; stop[k] = stop[c];
+        k++;
+      } else if(cur[c] != stop[c]) 
+        return FM_GENERR;
+    }
+    chains = k;
   }
-  /* i == 0 */
-  s->text[i] = s->bwt[j];
-  assert(j<s->text_size);
-  j = s->lf[j];              // No account for EOF
-  if(j<s->bwt_eof_pos) j++;
-	  
-  assert(j==s->bwt_eof_pos);
+
   free(s->lf); s->lf = NULL;
-  free(s->bwt); s->bwt = NULL;
+  if(s->bwt) free(s->bwt); 
+  s->bwt = NULL;
   return FM_OK;
 }
 
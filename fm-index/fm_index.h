@@ -96,7 +96,6 @@ typedef struct {
   uchar inv_map_b[ALPHASIZE];		/* inverse map for the current superbucket */
   suint alpha_size_b;     					/* actual size of alphabet in bucket */
   
-  uchar mtf[ALPHASIZE];  		/* stores MTF-picture of bucket to be decompressed */
   uchar *mtf_seq;				/* store bucket decompressed */
   ulong occ_bucket[ALPHASIZE];  /* number chars occurences in the actual bucket needed by Mtf2 */
   suint int_dec_bits; 			/* log2(log2(text_size)) */
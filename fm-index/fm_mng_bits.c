@@ -1,5 +1,11 @@
 #include "fm_mng_bits.h"
 
+__thread ulong * __Num_Bytes;
+__thread uchar * __MemAddress;
+__thread int __Bit_buffer_size;
+__thread ulong __pos_read;
+__thread unsigned int __Bit_buffer;
+
 /*
  * Funzioni per la scrittura di bit in memoria 
  */
@@ -1,13 +1,14 @@
 #include "fm_index.h"
 
 /* Variabili sono qui solo per poter usare bit_read24 
-   e bit_write24 come macro */ 
-
-ulong * __Num_Bytes;      /* numero byte letti/scritti */
-uchar * __MemAddress;   /* indirizzo della memoria dove scrivere */
-int __Bit_buffer_size;  /* number of unread/unwritten bits in Bit_buffer */
-ulong __pos_read;
-ulong __Bit_buffer;    
+   e bit_write24 come macro (defined in fm_mng_bits.c, one copy 
+   per thread: distinct threads can read/write distinct indexes) */ 
+
+extern __thread ulong * __Num_Bytes;      /* numero byte letti/scritti */
+extern __thread uchar * __MemAddress;   /* indirizzo della memoria dove scrivere */
+extern __thread int __Bit_buffer_size;  /* number of unread/unwritten bits in Bit_buffer */
+extern __thread ulong __pos_read;
+extern __thread unsigned int __Bit_buffer;	/* 32 bits, as the shifts below assume */
 
 
 
@@ -15,6 +15,7 @@
 #include "fm_common.h"
 #include <stdlib.h>
 #include "fm_mng_bits.h"
+#include "ds_ssort.h"	// mtf_decode
 	
 
 #define BZ_RUNA 0
@@ -36,17 +37,19 @@ typedef unsigned short uint16;
 
 	/*
 	 * -------- arrays used by multihuf ------------ 
+	 * one copy per thread, so that distinct threads can build 
+	 * distinct indexes at the same time
 	 */ 
-	uchar huf_len[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// coding and
+	static __thread uchar huf_len[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// coding and
 							// decoding
-int huf_code[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// coding
-int rfreq[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// coding
-int mtf_freq[BZ_MAX_ALPHA_SIZE];	// coding
+static __thread int huf_code[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// coding
+static __thread int rfreq[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// coding
+static __thread int mtf_freq[BZ_MAX_ALPHA_SIZE];	// coding
 
-uchar huf_minLens[BZ_N_GROUPS];	// decoding
-int huf_limit[BZ_N_GROUPS][BZ_MAX_CODE_LEN];	// decoding
-int huf_base[BZ_N_GROUPS][BZ_MAX_CODE_LEN];	// decoding
-int huf_perm[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// decoding
+static __thread uchar huf_minLens[BZ_N_GROUPS];	// decoding
+static __thread int huf_limit[BZ_N_GROUPS][BZ_MAX_CODE_LEN];	// decoding
+static __thread int huf_base[BZ_N_GROUPS][BZ_MAX_CODE_LEN];	// decoding
+static __thread int huf_perm[BZ_N_GROUPS][BZ_MAX_ALPHA_SIZE];	// decoding
 
 	/*
 	 ********************************************************************
@@ -858,9 +861,9 @@ fm_uncompress_bucket_multihuf (uchar * dest, int len, int alpha_size)
 
 int fm_multihuf_decompr (uchar *, int, int);
 	
-int k, j, i, aux_len, rank, local_alpha_size, next;
+int k, i, aux_len, local_alpha_size;
 	
-uchar mtf[256], inv_local_map[256];
+uchar inv_local_map[256];
 	
 
 		/*
@@ -884,17 +887,6 @@ if (local_alpha_size == 1)
 		
 return FM_OK;
 	
-}
-	
-
-		/*
-		 * Set initial MTF 
-		 */ 
-		for (k = 0; k < local_alpha_size; k++)
-	{
-		
-mtf[k] = k;
-	
 }
 	
 
@@ -911,20 +903,15 @@ return FM_DECERR;
 		/*
 		 * ------ decode *inplace* mtf_seq -------------------- 
 		 */ 
-		for (j = 0; j < len; j++)
+		mtf_decode (dest, dest, len);
+	
+for (i = 0; i < len; i++)
 	{
 		
-rank = dest[j];
-		
-assert (rank < local_alpha_size);
-		
-next = mtf[rank];	// decode mtf rank 
-		for (i = rank; i > 0; i--)	// update mtf list
-			mtf[i] = mtf[i - 1];
+assert (dest[i] < local_alpha_size);
 		
-mtf[0] = next;	// update mtf[0]
-		dest[j] = inv_local_map[next];	// apply invamp
-		assert (dest[j] < alpha_size);
+dest[i] = inv_local_map[dest[i]];	// apply invamp
+		assert (dest[i] < alpha_size);
 	
 }
 	
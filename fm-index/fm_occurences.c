@@ -9,6 +9,7 @@
 #include "fm_extract.h"
 #include "fm_mng_bits.h"
 #include "fm_occurences.h"
+#include "ds_ssort.h" // mtf_encode, mtf_decode
 #include <string.h> // per memcpy
 
 static inline void unmtf_unmap (uchar * mtf_seq, int len_mtf, fm_index * s);
@@ -383,10 +384,6 @@ get_b_multihuf(ulong k, ulong * occ, fm_index * s, int is_odd)
 		return char_returned;
 	}
 
-	/* Initialize Mtf start */
-	for (i = 0; i < s->alpha_size_b; i++)
-			s->mtf[i] = i;
-	
 	mtf_seq_len =
 			fm_multihuf_decompr (s->mtf_seq, s->alpha_size_b, bpos+1);
 	
@@ -418,7 +415,7 @@ get_b_multihuf(ulong k, ulong * occ, fm_index * s, int is_odd)
 /*
  * Receives in input a bucket in the MTF form, having length len_mtf;
  * returns the original bucket where MTF-ranks have been explicitely
- * resolved. The characters obtained from s->mtf[] are UNmapped according
+ * resolved. The characters obtained from the MTF list are UNmapped according
  * to the ones which actually occur into the superbucket. Therefore, the
  * array s->inv_map_b[] is necessary to unmap those chars from
  * s->alpha_size_b to s->alpha_size_sb. 
@@ -426,21 +423,15 @@ get_b_multihuf(ulong k, ulong * occ, fm_index * s, int is_odd)
 static inline void
 unmtf_unmap (uchar * mtf_seq, int len_mtf, fm_index * s)
 {
-	int i, j, rank;
-	uchar next;
+	int j;
 
 	/* decode "inplace" mtf_seq */
+	mtf_decode(mtf_seq, mtf_seq, len_mtf);
 	for (j = 0; j < len_mtf; j++, mtf_seq++)
 	{
-		rank = *mtf_seq;
-		assert (rank < s->alpha_size_b);
-		next = s->mtf[rank];			/* decode mtf rank */
-		*mtf_seq = s->inv_map_b[next];	/* apply invamp	*/
+		assert (*mtf_seq < s->alpha_size_b);
+		*mtf_seq = s->inv_map_b[*mtf_seq];	/* apply invamp	*/
 	    assert(*mtf_seq < s->alpha_size_sb);
-	
-		for (i = rank; i > 0; i--)		/* update mtf list */
-			s->mtf[i] = s->mtf[i - 1];
-		s->mtf[0] = next;				/* update mtf[0] */
 	}
 }
 
@@ -508,29 +499,13 @@ int compress_bucket(fm_index *s, uchar *in, ulong len, suint alphasize) {
 /* Compute Move to Front for string */
 void mtf_string(uchar *in, uchar *out, ulong len, suint mtflen){
 	
-  ulong i,o,m;
-  suint j,h;
-  uchar c, mtf_start[mtflen];
+#ifndef NDEBUG
+  ulong i;
 
-  for(j=0; j<mtflen; j++) 
-	  mtf_start[j] = j;
-  
-  m = mtflen;   // # of chars in the mtf list
-  o = 0;   // # of char in the output string
-
-  for(i=0; i<len; i++) {
-    c = in[i];
-    /* search c in mtf */
-  	for(h=0; h<m; h++)
-       	if(mtf_start[h]==c) break;
-	  
-    /* c found in mtf[h] */
-    out[o++] = (uchar) h;   
-    for(j=h; j>0; j--)   // update mtf[]
-      	 mtf_start[j] = mtf_start[j-1];
-    mtf_start[0] = c;
-  }
-  assert(o<=2*len);
+  for(i=0; i<len; i++) 
+	  assert(in[i] < mtflen);	// the ranks are those of the list 0..mtflen-1
+#endif
+  mtf_encode(in, out, len);
 }
 
 int fm_bwt_compress(fm_index * index) {
@@ -574,18 +549,7 @@ int fm_bwt_compress(fm_index * index) {
 
 void fm_unmtf(uchar *in, uchar *out, int length)
 {
-  int i,k, pos;
-  uchar mtf_list[256];
-
-  for (i=0; i<256; i++)  // Initialize the MTF list
-    mtf_list[i]= (uchar) i;
-  for (i=0; i < length; i++) {
-	pos = (int) in[i];
-	out[i] = mtf_list[pos]; // MTF unencode the next symbol
-	for (k=pos; k>0; k--) // move-to-front bwt[i]
-		mtf_list[k]=mtf_list[k-1];
-	mtf_list[0]=out[i];
-  }
+  mtf_decode(in, out, length);
 }
 
 int fm_bwt_uncompress(fm_index * index) {
@@ -494,6 +494,10 @@ int fm_boyermoore(fm_index *s, uchar * pattern, ulong length, ulong ** occ, ulon
    int i, bmGs[length], bmBc[ALPHASIZE];
    ulong alloc = 10;
    *numocc = 0;
+   if (length > s->text_size) { /* no occurrence, j would underflow below */
+	*occ = NULL;
+	return FM_OK;
+   }
    *occ = malloc(sizeof(ulong)*alloc);
    if(*occ == NULL) 
 	return FM_OUTMEM;   
@@ -520,7 +524,7 @@ int fm_boyermoore(fm_index *s, uchar * pattern, ulong length, ulong ** occ, ulon
       else
          j += MAX((ulong) bmGs[i], bmBc[s->text[i + j]] - length + 1 + i);
    }
-   if(*numocc>0) occ = realloc(*occ, sizeof(ulong)*(*numocc));
-   else occ = NULL;
+   if(*numocc>0) *occ = realloc(*occ, sizeof(ulong)*(*numocc));
+   else { free(*occ); *occ = NULL; }
    return FM_OK;
 }
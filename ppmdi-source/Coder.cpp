@@ -29,8 +29,28 @@ jcheney@cs.cornell.edu
 
 #include "Coder.h"
 
-SUBRANGE SubRange;
-DWORD low, code, range;
+#include <stdlib.h>
+
+ARI_THREAD SUBRANGE SubRange;
+ARI_THREAD DWORD low, code, range;
+
+int
+ariPutc (int c, MEM_STREAM * stream)
+{
+  if (stream->Pos == stream->Size)
+    {
+      BYTE *p;
+      DWORD NewSize = (stream->Size) ? 2 * stream->Size : 4096;
+      if ((p = (BYTE *) realloc (stream->Buf, NewSize)) == NULL)
+	{
+	  fprintf (stderr, "Out of memory!\n");
+	  exit (-1);
+	}
+      stream->Buf = p;
+      stream->Size = NewSize;
+    }
+  return (stream->Buf[stream->Pos++] = (BYTE) c);
+}
 
 void
 ariInitEncoder (FILE * stream)
@@ -41,16 +41,41 @@ jcheney@cs.cornell.edu
 struct SUBRANGE {
     DWORD LowCount, HighCount, scale;
 };
-extern SUBRANGE SubRange;
+/* The rangecoder state is kept per thread: each thread can then run its
+ * own PPM_MODEL through the library interface (see ppmdi.h).
+ */
+#ifdef _MSC_VER
+#define ARI_THREAD __declspec(thread)
+#else
+#define ARI_THREAD __thread
+#endif
+
+extern ARI_THREAD SUBRANGE SubRange;
 const DWORD TOP=1 << 24, BOT=1 << 15;
-extern DWORD low, code, range;
+extern ARI_THREAD DWORD low, code, range;
+
+/* In-memory byte stream, used by the library interface (ppmdi.h) in
+ * place of a FILE*: the encoder appends to Buf (growing it as needed),
+ * the decoder reads from Buf up to Size.
+ */
+struct MEM_STREAM {
+    BYTE* Buf;
+    DWORD Size, Pos;
+};
+
+inline int ariPutc(int c, FILE* stream) { return putc(c,stream); }
+inline int ariGetc(FILE* stream) { return getc(stream); }
+int ariPutc(int c, MEM_STREAM* stream);
+inline int ariGetc(MEM_STREAM* stream) {
+    return (stream->Pos < stream->Size) ? stream->Buf[stream->Pos++] : EOF;
+}
 
 void ariInitEncoder(FILE* stream);
 
 #define ARI_ENC_NORMALIZE(stream) {                                         \
     while ((low ^ (low+range)) < TOP || range < BOT &&                      \
             ((range= -low & (BOT-1)),1)) {                                  \
-        putc(low >> 24,stream);                                             \
+        ariPutc(low >> 24,stream);                                          \
         range <<= 8;                                                        \
         low <<= 8;                                                          \
     }                                                                       \
@@ -61,7 +86,7 @@ void ariShiftEncodeSymbol(UINT SHIFT);
 
 #define ARI_FLUSH_ENCODER(stream) {                                         \
     for (int i=0;i < 4;i++) {                                               \
-        putc(low >> 24,stream);                                             \
+        ariPutc(low >> 24,stream);                                          \
         low <<= 8;                                                          \
     }                                                                       \
 }
@@ -69,12 +94,12 @@ void ariShiftEncodeSymbol(UINT SHIFT);
     low=code=0;                                                             \
     range=DWORD(-1);                                                        \
     for (int i=0;i < 4;i++)                                                 \
-      code=(code << 8) | getc(stream);                                      \
+      code=(code << 8) | ariGetc(stream);                                   \
 }
 #define ARI_DEC_NORMALIZE(stream) {                                         \
     while ((low ^ (low+range)) < TOP || range < BOT &&                      \
             ((range= -low & (BOT-1)),1)) {                                  \
-        code=(code << 8) | getc(stream);                                    \
+        code=(code << 8) | ariGetc(stream);                                 \
         range <<= 8;                                                        \
         low <<= 8;                                                          \
     }                                                                       \
@@ -733,8 +733,7 @@ NO_LOOP:
       PPM_CONTEXT *pc1 = (PPM_CONTEXT *) sa->AllocContext ();
       if (!pc1)
 	return NULL;
-      ((DWORD *) pc1)[0] = ((DWORD *) & ct)[0];
-      ((DWORD *) pc1)[1] = ((DWORD *) & ct)[1];
+      memcpy (pc1, &ct, 2 + sizeof (STATE));	// NumStats, Flags, OneState
       pc1->Suffix = pc;
       (*--pps)->Successor = pc = pc1;
     }
@@ -865,7 +864,8 @@ PPM_MODEL::ClearMask ()
   memset (CharMask, 0, sizeof (CharMask));
 }
 
-void PPM_MODEL::EncodeChar(FILE * EncodedFile, 
+template <class STREAM>
+void PPM_MODEL::EncodeChar(STREAM * EncodedFile, 
 				    int c) 
 {
   PPM_CONTEXT* MinContext;
@@ -941,7 +941,8 @@ void PPM_MODEL::PreloadChar(int c)
     }
 }
 
-int PPM_MODEL::DecodeChar(FILE * EncodedFile) 
+template <class STREAM>
+int PPM_MODEL::DecodeChar(STREAM * EncodedFile) 
 {
   PPM_CONTEXT *MinContext = MaxContext;
   BYTE ns = MinContext->NumStats;
@@ -976,3 +977,10 @@ int PPM_MODEL::DecodeChar(FILE * EncodedFile)
   return c;
 }
 
+/* the coder is driven either by a FILE (ppmdi/unppmdi) or by a
+ * memory buffer (the library interface in ppmdi.h)
+ */
+template void PPM_MODEL::EncodeChar<FILE> (FILE *, int);
+template void PPM_MODEL::EncodeChar<MEM_STREAM> (MEM_STREAM *, int);
+template int PPM_MODEL::DecodeChar<FILE> (FILE *);
+template int PPM_MODEL::DecodeChar<MEM_STREAM> (MEM_STREAM *);
@@ -101,6 +101,7 @@ struct PPM_CONTEXT
   PPM_CONTEXT *Suffix;		//   BCD    suffix
 }
 _PACK_ATTR;
+#pragma pack()
 
 
 struct PPM_MODEL
@@ -127,10 +128,11 @@ struct PPM_MODEL
 			     PPM_CONTEXT * pc);
   void UpdateModel (PPM_CONTEXT * MinContext);
   void ClearMask ();
-  void EncodeChar (FILE * EncodedFile,
+  // STREAM is either FILE or MEM_STREAM (see Coder.h)
+  template <class STREAM> void EncodeChar (STREAM * EncodedFile,
 			    int c);
   void PreloadChar (int c);
-  int DecodeChar (FILE * EncodedFile);
+  template <class STREAM> int DecodeChar (STREAM * EncodedFile);
 
   inline void encodeBinSymbol (PPM_CONTEXT * ctxt, int symbol);	//   BCDE   successor
   inline void encodeSymbol1 (PPM_CONTEXT * ctxt, int symbol);	// other orders:
@@ -146,8 +148,7 @@ struct PPM_MODEL
   PPM_CONTEXT *cutOff (PPM_CONTEXT * ctxt, int Order);
   PPM_CONTEXT *removeBinConts (PPM_CONTEXT * ctxt, int Order);
 
-}
-_PACK_ATTR;
+};
 
 struct PPM_ENCODER : PPM_MODEL {
   FILE* outfile;
@@ -43,7 +43,7 @@ typedef int BOOL;
 #define TRUE  1
 typedef unsigned char BYTE;
 typedef unsigned short WORD;
-typedef unsigned long DWORD;
+typedef unsigned int DWORD;	/* 32 bits: required by the rangecoder */
 typedef unsigned int UINT;
 
 const DWORD PPMdSignature = 0x84ACAF8F, Variant = 'I';
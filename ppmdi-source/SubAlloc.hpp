@@ -34,7 +34,9 @@ jcheney@cs.cornell.edu
 #ifndef __SUBALLOC_HPP__
 #define __SUBALLOC_HPP__
 
-const unsigned int UNIT_SIZE = 12;
+/* a unit holds either a PPM_CONTEXT or two STATEs: 12 bytes with 32-bit
+ * pointers, 20 bytes with 64-bit pointers */
+const unsigned int UNIT_SIZE = 4 + 2 * sizeof (void *);
 const unsigned int N1 = 4;
 const unsigned int N2 = 4;
 const unsigned int N3 = 4;
@@ -86,7 +88,7 @@ BLK_NODE::insert (void *pv, int NU)
 {
   MEM_BLK *p = (MEM_BLK *) pv;
   link (p);
-  p->Stamp = ~0UL;
+  p->Stamp = ~0U;
   p->NU = NU;
   Stamp++;
 }
@@ -94,7 +96,14 @@ BLK_NODE::insert (void *pv, int NU)
 inline UINT
 U2B (UINT NU)
 {
-  return 8 * NU + 4 * NU;
+  return UNIT_SIZE * NU;
+}
+
+/* MEM_BLK may be smaller than a unit, hence blocks are stepped in bytes */
+inline MEM_BLK *
+NextBlk (MEM_BLK * p, UINT NU)
+{
+  return (MEM_BLK *) ((BYTE *) p + U2B (NU));
 }
 
 
@@ -193,7 +202,7 @@ struct SubAlloc {
 	  p = (MEM_BLK *) BList[i].remove ();
 	  if (!p->NU)
 	    continue;
-	  while ((p1 = p + p->NU)->Stamp == ~0UL)
+	  while ((p1 = NextBlk (p, p->NU))->Stamp == ~0U)
 	    {
 	      p->NU += p1->NU;
 	      p1->NU = 0;
@@ -207,12 +216,12 @@ struct SubAlloc {
 	sz = p->NU;
 	if (!sz)
 	  continue;
-	for (; sz > 128; sz -= 128, p += 128)
+	for (; sz > 128; sz -= 128, p = NextBlk (p, 128))
 	  BList[N_INDEXES - 1].insert (p, 128);
 	if (Indx2Units[i = Units2Indx[sz - 1]] != sz)
 	  {
 	    k = sz - Indx2Units[--i];
-	    BList[k - 1].insert (p + (sz - k), k);
+	    BList[k - 1].insert (NextBlk (p, sz - k), k);
 	  }
 	BList[i].insert (p, Indx2Units[i]);
       }
@@ -268,16 +277,7 @@ struct SubAlloc {
   inline void
   UnitsCpy (void *Dest, void *Src, UINT NU)
   {
-    DWORD *p1 = (DWORD *) Dest, *p2 = (DWORD *) Src;
-    do
-      {
-	p1[0] = p2[0];
-	p1[1] = p2[1];
-	p1[2] = p2[2];
-	p1 += 3;
-	p2 += 3;
-      }
-    while (--NU);
+    memcpy (Dest, Src, U2B (NU));
   }
   inline void *
   ExpandUnits (void *OldPtr, UINT OldNU)
@@ -325,7 +325,7 @@ struct SubAlloc {
       BList->insert (ptr, 1);
     else
       {
-	*(DWORD *) ptr = ~0UL;
+	*(DWORD *) ptr = ~0U;
 	UnitsStart += UNIT_SIZE;
       }
   }
@@ -351,10 +351,10 @@ struct SubAlloc {
     BLK_NODE *p;
     UINT Count[N_INDEXES];
     memset (Count, 0, sizeof (Count));
-    while ((p = (BLK_NODE *) UnitsStart)->Stamp == ~0UL)
+    while ((p = (BLK_NODE *) UnitsStart)->Stamp == ~0U)
       {
 	MEM_BLK *pm = (MEM_BLK *) p;
-	UnitsStart = (BYTE *) (pm + pm->NU);
+	UnitsStart = (BYTE *) NextBlk (pm, pm->NU);
 	Count[Units2Indx[pm->NU - 1]]++;
 	pm->Stamp = 0;
       }
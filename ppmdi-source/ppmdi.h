@@ -0,0 +1,26 @@
+/* ppmdi.h: memory-to-memory interface to the PPMd coder of XMLPPM.
+ *
+ * The compressed buffer has the same layout as a file written by ppmdi
+ * (xppm header followed by the rangecoder output), so data compressed by
+ * either of them can be decompressed by both ppmd_mem_decompress and
+ * unppmdi. Both functions allocate *t with malloc, and return 0 on
+ * success, -1 on failure. They can be called concurrently by distinct
+ * threads, each call using its own model.
+ */
+#ifndef __PPMDI_H__
+#define __PPMDI_H__
+
+#define PPMD_DEFAULT_LEVEL 6	/* as for ppmdi without -l */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int ppmd_mem_compress(unsigned char *s, int slen, unsigned char **t, int *tlen, int level);
+int ppmd_mem_decompress(unsigned char *s, int slen, unsigned char **t, int *tlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/* ppmdi_mem.cpp: memory-to-memory PPMd compressor, the library
+ * counterpart of xmlppm.cpp and xmlunppm.cpp (see ppmdi.h)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Args.h"
+#include "Model.h"
+#include "Version.h"
+#include "ppmdi.h"
+
+#define HEADER_SIZE (4 + 1 + sizeof(unsigned) + 3 + 1)
+
+int
+ppmd_mem_compress (unsigned char *s, int slen, unsigned char **t, int *tlen,
+		   int level)
+{
+  MEM_STREAM out;
+  unsigned size = (unsigned) slen;
+  int i;
+
+  if (slen < 0 || level < 0 || level > 9)
+    return -1;
+  struct level_settings ls = settings[level];
+
+  out.Size = HEADER_SIZE + slen / 2 + 16;
+  out.Pos = 0;
+  if ((out.Buf = (BYTE *) malloc (out.Size)) == NULL)
+    return -1;
+
+  /* same header as writeHeader(), with no file name */
+  memcpy (out.Buf, xmlppm_magic, 4);
+  out.Buf[4] = 0;		/* spacer */
+  memcpy (out.Buf + 5, &size, sizeof (unsigned));
+  out.Pos = 5 + sizeof (unsigned);
+  out.Buf[out.Pos++] = 0;	/* standalone */
+  out.Buf[out.Pos++] = xmlppm_version;
+  out.Buf[out.Pos++] = level;
+  out.Buf[out.Pos++] = 0;	/* empty file name */
+
+  PPM_MODEL *model = new PPM_MODEL (ls.chr.size, ls.chr.order);
+  ariInitEncoder (NULL);
+  for (i = 0; i < slen; i++)
+    model->EncodeChar (&out, s[i]);
+  ARI_FLUSH_ENCODER (&out);
+  delete model;
+
+  *t = out.Buf;
+  *tlen = out.Pos;
+  return 0;
+}
+
+int
+ppmd_mem_decompress (unsigned char *s, int slen, unsigned char **t,
+		     int *tlen)
+{
+  MEM_STREAM in;
+  unsigned size;
+  int level;
+  DWORD i;
+
+  if (slen < (int) HEADER_SIZE || memcmp (s, xmlppm_magic, 4) != 0)
+    return -1;
+  memcpy (&size, s + 5, sizeof (unsigned));
+  i = 5 + sizeof (unsigned);
+  i++;				/* standalone */
+  if (s[i++] != xmlppm_version)
+    return -1;
+  level = s[i++];
+  if (level > 9)
+    return -1;
+  while (i < (DWORD) slen && s[i] != 0)	/* skip the file name, if any */
+    i++;
+  if (i == (DWORD) slen)
+    return -1;
+  struct level_settings ls = settings[level];
+
+  in.Buf = s;
+  in.Size = slen;
+  in.Pos = i + 1;
+
+  if ((*t = (unsigned char *) malloc (size ? size : 1)) == NULL)
+    return -1;
+  PPM_MODEL *model = new PPM_MODEL (ls.chr.size, ls.chr.order);
+  ARI_INIT_DECODER (&in);
+  for (i = 0; i < size; i++)
+    (*t)[i] = model->DecodeChar (&in);
+  delete model;
+
+  *tlen = size;
+  return 0;
+}
@@ -29,6 +29,12 @@
 #include "xbzip.h"  
 int BLOCK_ALPHA_LEN  = 8000;	// default value, in #symbols
 int NUM1_IN_BLOCK    = 1000;	// default value, in #1
+int BLOCK_CACHE_SIZE = 32;		// default value, in #blocks
+int NUM_THREADS = 1;			// default value, the pieces are (de)compressed in turn
+int DATA_CODER = DATA_PPMD;		// default coder of the pieces
+int DATA_BLOCK_LEN = 0;			// bigbzip block of the pieces, 0 = a single block
+int LAST_TYPE = LAST_COMPRESSED;	// default representation of Slast
+int ALPHA_TYPE = ALPHA_COMPRESSED;	// default representation of Salpha
 int Verbose=0;
 
 // For search statistics
@@ -38,6 +44,12 @@ int Last_Block_Counter=0;
 int Last_Byte_Counter=0;
 int Pcdata_Block_Counter=0;
 int Pcdata_Byte_Counter=0;
+int Last_Cache_Hits=0;
+int Last_Cache_Misses=0;
+int Alpha_Cache_Hits=0;
+int Alpha_Cache_Misses=0;
+int Pcdata_Cache_Hits=0;
+int Pcdata_Cache_Misses=0;
 //--------------------------------------------------------
 
 
@@ -53,12 +65,14 @@ int main(int argc, char **argv) {
   int fd = -1;
   FILE *outfile; 
   UChar *ctext, *text, *tmp, *path_string, **path, *snippet, cc;
-  UInt32 text_len, ctext_len;
+  TextInt text_len = 0, ctext_len = 0;	// reported at the end
+  int index_len;
   int visualize, decompress, compress, compr_type, indexing, extracting, searching, printing;
   int first_row, last_row, i, j, path_len, num_occ, path_occ, startc, row2text, snippetLength;
-  int printedRow, navigating, *navigate_array;
+  int printedRow, navigating, *navigate_array, locating, *located_rows, num_located, sais_sorting;
   char c, *infile_name, *outfile_name;
   xbwt_index_type index;
+  xbzip_sink_type sink;
 
  if (argc<2) {
     printf("\n_______________________________________________________________________\n\n");
@@ -72,7 +86,7 @@ int main(int argc, char **argv) {
 	printf("    IEEE Symposium on the Foundations of Computer Science, 2005.\n");
     printf("_________________________________________________________________________\n\n");
 	printf("\n--- Usage as a compressor:\n\n");
-    printf("xbzip [-c TYPE][-d TYPE] [-o outFileName] inFileName\n\n");
+    printf("xbzip [-c TYPE][-d TYPE] [-j NUMT] [-z MB] [-u] [-o outFileName] inFileName\n\n");
     printf("\t-c to compress, TYPE is \n");
 	printf("\t\t 0 Kth order Compressor over two pieces: Last fused with Salpha, and Pcdata\n");
 	printf("\t\t 1 fuse Last with Salpha and then concatenate with Pcdata (plain)\n");
@@ -80,22 +94,36 @@ int main(int argc, char **argv) {
 	printf("\t\t 3 Kth order Compressor over Last, over Pcdata, and Salpha with Mtf+MultiHuff\n");
 	printf("\t\t 4 Kth order Compressor over each of the three distinct pieces\n");
     printf("\t-d to decompress, TYPE is as for -c\n");
+    printf("\t-j NUMT is the #threads (de)compressing the pieces of TYPE 2, 3, 4 (default is 1)\n");
+    printf("\t-z MB compresses the pieces with bigbzip instead of the Kth order Compressor:\n");
+    printf("\t    a piece longer than MB Mb is split into blocks of MB Mb, (de)compressed\n");
+    printf("\t    in parallel by the -j threads; -z 0 keeps each piece a single block\n");
+    printf("\t-u suffix sorting with SA-IS, linear time also on long repetitions\n");
     printf("\t-o name of the compressed file \n");
 	printf("\t-v verbose mode\n\n");
 	printf("inFileName must have extension .xml with -c, and .xbz with -d.\n");
+	printf("With -c, inFileName may be - to read the XML document from stdin (-o needed),\n");
+	printf("and it may be a pipe or a socket: the document is then parsed as it is read.\n");
 	printf("Option -c (and not -o) generates a file with name inFileName_TYPE.xbz.\n");
 	printf("Option -o must specify a file name ending with .xbz.\n");
 	printf("Option -d needs a file name ending with .xbz.\n\n\n");
 	printf("--- Usage as a compressed indexer:\n\n");
-    printf("xbzip [ -i [-l NUM1][-a NUMS] ] [-e] [-p row] [-s \"PATH\" [-w]] [-o outFileName] inFileName \n\n");
+    printf("xbzip [ -i [-l NUM1][-a NUMS][-b][-m][-j NUMT][-u] ] [-e] [-p row] [-s \"PATH\" [-w][-r]] [-k NUMB] [-o outFileName] inFileName \n\n");
 	printf("\t-i to index\n");
 	printf("\t    -l NUM1 is the #1s in a Last's block (default is 1000)\n");
 	printf("\t    -a NUMS is the #symbols in an Alpha's block (default is 8000)\n");
+	printf("\t    -b stores Last as an uncompressed bitvector (constant time rank/select)\n");
+	printf("\t    -m stores Alpha as a wavelet matrix of symbol codes (no block decoding)\n");
+	printf("\t    -j NUMT is the #threads compressing the blocks of the index (default is 1)\n");
+	printf("\t    -u suffix sorting with SA-IS, linear time also on long repetitions\n");
 	printf("\t-s PATH searches for PATH in the document (see below)\n");
 	printf("\t-t test navigation speed\n");
 	printf("\t-w visualize the snippet of Pcdata where the searched path occurs\n");
+	printf("\t-r list the rows of the elements matching the searched =substring\n");
 	printf("\t-e extracting the whole indexed document\n");
 	printf("\t-p ROW well-formed print of the subtree descending from the input ROW [0 = whole doc]\n");
+	printf("\t-k NUMB is the #decompressed blocks kept in cache by -s, -p, -t (default is 32),\n");
+	printf("\t    as the #loaded Pcdata FM-indexes (up to %d Mb)\n", PC_CACHE_MEM >> 20);
 	printf("\t-v verbose mode (-v -v for detailed printing)\n\n");
 	printf("inFileName must have extension .xml with -i, and .xbzi with -e or -s.\n");
 	printf("Option -i generates a file with name inFileName.xbzi if [-o] is not included.\n\n");
@@ -116,9 +144,9 @@ int main(int argc, char **argv) {
  
   decompress=0; compress=0; indexing=0; extracting = 0; searching = 0; compr_type=0;
   visualize = 0; infile_name=NULL;outfile_name=NULL; printing = 0; row2text = 0;
-  opterr=0; navigating = 0;
+  opterr=0; navigating = 0; locating = 0; sais_sorting = 0;
   path_string=NULL;
-  while ((c=getopt(argc, argv, "tvwl:a:ip:es:c:d:o:")) != -1) {
+  while ((c=getopt(argc, argv, "tvwrul:a:k:j:z:bmip:es:c:d:o:")) != -1) {
     switch (c)
       {
         case 'v':
@@ -127,6 +155,9 @@ int main(int argc, char **argv) {
         case 'w':
           visualize++;  
 		  break;
+        case 'r':
+          locating = 1;  
+		  break;
         case 't':
           navigating++;  
 		  break;
@@ -150,6 +181,26 @@ int main(int argc, char **argv) {
         case 'a':
           BLOCK_ALPHA_LEN = atoi(optarg);  
 		  break;
+        case 'k':
+          BLOCK_CACHE_SIZE = atoi(optarg);  
+		  break;
+        case 'j':
+          NUM_THREADS = atoi(optarg);  
+		  break;
+        case 'z':
+          DATA_CODER = DATA_BIGBZIP;  
+		  DATA_BLOCK_LEN = atoi(optarg);
+		  break;
+        case 'b':
+          LAST_TYPE = LAST_BITVECTOR;  
+		  break;
+        case 'm':
+          ALPHA_TYPE = ALPHA_WAVELET;  
+		  break;
+        case 'u':
+          ds_ssort_default(DS_SSORT_SAIS);  
+		  sais_sorting = 1;
+		  break;
          case 'o':
           outfile_name = optarg;  
 		  break;
@@ -170,9 +221,19 @@ int main(int argc, char **argv) {
   if (visualize && (!searching))
 	  fatal_error("Use -w together with -s!\n");
 
-  if ( (NUM1_IN_BLOCK <= 0) || (BLOCK_ALPHA_LEN <= 0) )
+  if (locating && (!searching))
+	  fatal_error("Use -r together with -s!\n");
+
+  if ( (NUM1_IN_BLOCK <= 0) || (BLOCK_ALPHA_LEN <= 0) || (BLOCK_CACHE_SIZE <= 0) )
 	  fatal_error("The size of the block features must be grater than 0! (MAIN)\n");
 
+  if (NUM_THREADS <= 0)
+	  fatal_error("The number of threads must be grater than 0! (MAIN)\n");
+
+  if ( (DATA_BLOCK_LEN < 0) || (DATA_BLOCK_LEN > 2047) )
+	  fatal_error("The bigbzip blocks must be of 0..2047 Mb! (MAIN)\n");
+  DATA_BLOCK_LEN <<= 20;
+
   if ( (decompress + navigating + compress + extracting + indexing + searching + printing == 0) )
 	  fatal_error("You must specify either (de)comression or (de)indexing or searching!\n");
 
@@ -185,21 +246,40 @@ int main(int argc, char **argv) {
   printf("We use the following settings:\n");
   printf("\t#1 in a Last-block          = %d\n",NUM1_IN_BLOCK);
   printf("\tByte-size of a Salpha-block = %d\n",BLOCK_ALPHA_LEN);
+  printf("\t#blocks in the block cache  = %d\n",BLOCK_CACHE_SIZE);
+  if (compress || decompress)
+	  printf("\t#threads for the pieces      = %d\n",NUM_THREADS);
+  if (compress && (DATA_CODER == DATA_BIGBZIP) && DATA_BLOCK_LEN)
+	  printf("\tPieces in bigbzip blocks of %d Mb\n",DATA_BLOCK_LEN >> 20);
+  if (compress && (DATA_CODER == DATA_BIGBZIP) && !DATA_BLOCK_LEN)
+	  printf("\tPieces in a single bigbzip block\n");
+  if (indexing)
+	  printf("\t#threads for the blocks      = %d\n",NUM_THREADS);
+  if (indexing && (LAST_TYPE == LAST_BITVECTOR))
+	  printf("\tLast stored as a plain bitvector\n");
+  if (indexing && (ALPHA_TYPE == ALPHA_WAVELET))
+	  printf("\tAlpha stored as a wavelet matrix\n");
+  if ((compress || indexing) && sais_sorting)
+	  printf("\tSuffix sorting with SA-IS\n");
 
   // Manage the input file
 
   if (optind<argc){
     infile_name=argv[optind];
+	if (compress && (strcmp(infile_name,"-") == 0) && (outfile_name == NULL))
+		fatal_error("Reading from stdin needs option -o!\n");
 	tmp = infile_name + strlen(infile_name) - 4;
 	if (decompress && strcmp(tmp,".xbz"))
 		fatal_error("File to decompress must end with .xbz!\n");
-	if ((compress || indexing) && strcmp(tmp,".xml"))
+	if ((compress || indexing) && strcmp(tmp,".xml") && strcmp(infile_name,"-"))
 		fatal_error("File to compress must end with .xml!\n");
 	if ((extracting || searching || printing || navigating) && strcmp(tmp,"xbzi"))
 		fatal_error("File to extract must end with .xbzi!\n");
   }
 
-  if ((fd = open(infile_name, O_RDONLY)) < 0)
+  if (compress && infile_name && (strcmp(infile_name,"-") == 0))
+	  fd = 0;  // stdin
+  else if ((fd = open(infile_name, O_RDONLY)) < 0)
    	  fatal_error("Cannot open the input file for reading\n");
 
   // Manage the output file
@@ -248,46 +328,56 @@ int main(int argc, char **argv) {
 
 		// MMAPping the input compressed text to an internal memory array
 		stat(infile_name, &info); 
-  		ctext_len = (UInt32) info.st_size;
+		if ((UInt64) info.st_size > TEXTINT_MAX)
+			fatal_error("Files larger than 2Gb need the 64-bit build (-DXBZIP_64)! (MAIN)\n");
+  		ctext_len = (TextInt) info.st_size;
 		ctext = (UChar *) mmap(0, ctext_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!ctext) fatal_error("MMAPping the input compressed text failed\n");
 
-		// decompress the XBWT data
-		xbzip_decompress(ctext, ctext_len, &text, &text_len, compr_type);
-
-		// Writing the uncompressed text to disk
-		fwrite(text, sizeof(UChar), text_len, outfile);
+		// decompress the XBWT data, the text is written to disk as it is rebuilt
+		text_len = xbzip_decompress_fd(ctext, ctext_len, fileno(outfile), compr_type);
 		
-		free(text); munmap(ctext,ctext_len);		
+		munmap(ctext,ctext_len);		
 
   } 
 
   if( compress ) {
 
-		// MMAPping the input text to an internal memory array
-		stat(infile_name, &info); 
-  		text_len = (UInt32) info.st_size;
-		text = (UChar *) mmap(0, text_len, PROT_READ, MAP_SHARED, fd, 0) ;
-		if (!text) fatal_error("Failed MMAPping the input file!\n");
-	
-		// Compressing the XML doc
-		xbzip_compress(text,text_len,&ctext,&ctext_len, compr_type);
+		fstat(fd, &info);
+		if (S_ISREG(info.st_mode)) {
+			// MMAPping the input text to an internal memory array
+			if ((UInt64) info.st_size > TEXTINT_MAX)
+				fatal_error("Files larger than 2Gb need the 64-bit build (-DXBZIP_64)! (MAIN)\n");
+			text_len = (TextInt) info.st_size;
+			text = (UChar *) mmap(0, text_len, PROT_READ, MAP_SHARED, fd, 0) ;
+			if (!text) fatal_error("Failed MMAPping the input file!\n");
+
+			// Compressing the XML doc
+			xbzip_compress(text,text_len,&ctext,&ctext_len, compr_type);
+			munmap(text,text_len);
+		} else {
+			// A pipe or a socket (or stdin) is parsed as it is read
+			xbzip_compress_fd(fd, &ctext, &ctext_len, compr_type);
+			}
 
 		// Write to disk and free the memory
 		fwrite(ctext, sizeof(UChar), ctext_len, outfile);
-		free(ctext); munmap(text,text_len);
+		free(ctext);
   }	
 
   if( indexing ) {
 
 		// MMAPping the input text to an internal memory array
 		stat(infile_name, &info); 
-  		text_len = (UInt32) info.st_size;
+		if ((UInt64) info.st_size > 0x7FFFFFFF)
+			fatal_error("The index supports files up to 2Gb, use the compression! (MAIN)\n");
+  		text_len = (TextInt) info.st_size;
 		text = (UChar *) mmap(0, text_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!text) fatal_error("Failed MMAPping the input file!\n");
 	
 		// Compressing the XML doc
-		xbzip_index(text,text_len,&ctext,&ctext_len);
+		xbzip_index(text,text_len,&ctext,&index_len);
+		ctext_len = index_len;
 
 		// Write to disk and free the memory
 		fwrite(ctext, sizeof(UChar), ctext_len, outfile);
@@ -298,23 +388,24 @@ int main(int argc, char **argv) {
 
 		// MMAPping the input text to an internal memory array
 		stat(infile_name, &info); 
-  		ctext_len = (UInt32) info.st_size;
+		if ((UInt64) info.st_size > 0x7FFFFFFF)
+			fatal_error("The index supports files up to 2Gb! (MAIN)\n");
+  		ctext_len = (TextInt) info.st_size;
 		ctext = (UChar *) mmap(0, ctext_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!ctext) fatal_error("Failed MMAPping the input file!\n");
 	
-		// Decompressing the XML doc
-		xbzip_deindex(ctext,ctext_len,&text,&text_len);
-
-		// Write to disk and free the memory
-		fwrite(text, sizeof(UChar), text_len, outfile);
-		free(text); munmap(ctext,ctext_len);
+		// Decompressing the XML doc, the text is written to disk as it is rebuilt
+		sink_init_fd(&sink, fileno(outfile));
+		text_len = xbzip_deindex_sink(ctext,ctext_len,&sink);
+		sink_close(&sink);
+		munmap(ctext,ctext_len);
   }	
 
   if( searching ) {
 
 		// MMAPping the input text to an internal memory array
 		stat(infile_name, &info); 
-  		ctext_len = (UInt32) info.st_size;
+  		ctext_len = (TextInt) info.st_size;
 		ctext = (UChar *) mmap(0, ctext_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!ctext) fatal_error("Failed MMAPping the input file!\n");
 
@@ -364,13 +455,33 @@ int main(int argc, char **argv) {
 		__END_TIMER__;
 		printf("...overall searching took %.4f seconds\n\n", tot_partial_timer);
 
+		// Locating the elements (to be printed with -p)
+		if (locating) {
+			if (path[path_len-1][0] != '=')
+				fatal_error("Use -r with a PATH ending with =substring!\n");
+			printf("index locating...\n");
+			__START_TIMER__;
+			num_located = xbzip_locate(&index, path, path_len, &located_rows);
+			__END_TIMER__;
+			printf("...overall locating took %.4f seconds\n\n", tot_partial_timer);
+			printf("The Query-Path matches %d elements, at rows:", num_located);
+			for(i=0; i < num_located; i++)
+				printf("%s%d", (i % 10) ? " " : "\n    ", located_rows[i]);
+			printf("\n\n");
+			free(located_rows);
+			}
+
 		printf("-------- Search Statistics for Path Search---------------\n\n");
 		printf("We accessed:\n");
 		printf("%5d compressed blocks in Last:        %6d bytes.\n",	Last_Block_Counter,Last_Byte_Counter);
 		printf("%5d compressed blocks in Alpha:       %6d bytes.\n",	Alpha_Block_Counter,Alpha_Byte_Counter);
 		printf("%5d compressed indexes in Pcdata over %6d bytes.\n\n",Pcdata_Block_Counter,Pcdata_Byte_Counter);
+		printf("Block cache: Last %d hits %d misses, Alpha %d hits %d misses.\n",
+				Last_Cache_Hits,Last_Cache_Misses,Alpha_Cache_Hits,Alpha_Cache_Misses);
+		printf("FM-index cache: Pcdata %d hits %d misses.\n\n", Pcdata_Cache_Hits, Pcdata_Cache_Misses);
 		printf("---------------------------------------------------------\n\n");
 
+		free_block_cache(&index);
 		munmap(ctext,ctext_len);
   }	
 
@@ -378,7 +489,7 @@ int main(int argc, char **argv) {
 		
 		// MMAPping the input text to an internal memory array
 		stat(infile_name, &info); 
-  		ctext_len = (UInt32) info.st_size;
+  		ctext_len = (TextInt) info.st_size;
 		ctext = (UChar *) mmap(0, ctext_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!ctext) fatal_error("Failed MMAPping the input file!\n");
 		
@@ -410,8 +521,12 @@ int main(int argc, char **argv) {
 		printf("%5d compressed blocks in Last:   %6d bytes.\n",	Last_Block_Counter,Last_Byte_Counter);
 		printf("%5d compressed blocks in Alpha:  %6d bytes.\n",	Alpha_Block_Counter,Alpha_Byte_Counter);
 		printf("%5d compressed blocks in Pcdata: %6d bytes.\n\n",Pcdata_Block_Counter,Pcdata_Byte_Counter);
+		printf("Block cache: Last %d hits %d misses, Alpha %d hits %d misses.\n",
+				Last_Cache_Hits,Last_Cache_Misses,Alpha_Cache_Hits,Alpha_Cache_Misses);
+		printf("FM-index cache: Pcdata %d hits %d misses.\n\n", Pcdata_Cache_Hits, Pcdata_Cache_Misses);
 		printf("---------------------------------------------------------\n\n");
 
+		free_block_cache(&index);
 		munmap(ctext,ctext_len);
   }	
 
@@ -419,7 +534,7 @@ int main(int argc, char **argv) {
 
 		// MMAPping the input text to an internal memory array
 		stat(infile_name, &info); 
-  		ctext_len = (UInt32) info.st_size;
+  		ctext_len = (TextInt) info.st_size;
 		ctext = (UChar *) mmap(0, ctext_len, PROT_READ, MAP_SHARED, fd, 0) ;
 		if (!ctext) fatal_error("Failed MMAPping the input file!\n");
 
@@ -460,7 +575,12 @@ int main(int argc, char **argv) {
 			get_children(&index, navigate_array[i], &first_row, &last_row);
 		__END_TIMER__;
 		printf("...each child-group computation took %.4f seconds\n\n", tot_partial_timer / 1000.0);
+		printf("Block cache: Last %d hits %d misses, Alpha %d hits %d misses.\n",
+				Last_Cache_Hits,Last_Cache_Misses,Alpha_Cache_Hits,Alpha_Cache_Misses);
+		printf("FM-index cache: Pcdata %d hits %d misses.\n\n", Pcdata_Cache_Hits, Pcdata_Cache_Misses);
 
+		free(navigate_array);
+		free_block_cache(&index);
 		munmap(ctext,ctext_len);
   }	
 
@@ -474,16 +594,16 @@ int main(int argc, char **argv) {
 	printf("\n\n--------------- PERFORMANCE INFOS ---------------\n\n");
 	if(decompress || extracting){
 	printf("Input file name: %s\n",infile_name);
-	printf("Input file size: %d bytes\n",ctext_len);
+	printf("Input file size: %lld bytes\n",(long long) ctext_len);
 	printf("Output file name: %s\n",outfile_name);	  
-	printf("Output file size %d bytes\n\n",text_len);	  
+	printf("Output file size %lld bytes\n\n",(long long) text_len);	  
 	printf("Compression ratio: %.2f %%\n", 100 * ((double) ctext_len)/text_len);
 	printf("Decompression time:  %.4f seconds\n", tot_timer);
 	} else {
 	printf("Input file name: %s\n",infile_name);
-	printf("Input file size: %d bytes\n",text_len);
+	printf("Input file size: %lld bytes\n",(long long) text_len);
 	printf("Output file name: %s\n",outfile_name);	  
-	printf("Output file size %d bytes\n\n",ctext_len);	  
+	printf("Output file size %lld bytes\n\n",(long long) ctext_len);	  
 	printf("Compression ratio: %.2f %%\n", 100 * ((double) ctext_len)/text_len);
 	printf("Compression time:  %.4f seconds\n\n", tot_timer);
 	}
@@ -27,6 +27,9 @@
 // ------------- To use BigBzip ---------- 
 #include "bigbzip.h"
 
+// ------------- To choose the suffix sorting (BigBzip and FM-index) ---------- 
+#include "ds_ssort.h"
+
 // ------------- To use Zlib ---------- 
 #include "zlib.h"
 
@@ -68,32 +71,78 @@
 // the output array and set its length properly
 // -------------------------------------------------------------------------
 
-void xbzip_compress(UChar text[], int text_len, UChar *ctext[], int *ctext_len, UChar flag);
-void xbzip_decompress(UChar ctext[], int ctext_len, UChar *text[], int *text_len, UChar flag);
+void xbzip_compress(UChar text[], TextInt text_len, UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_compress_fd(int fd, UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_decompress(UChar ctext[], TextInt ctext_len, UChar *text[], TextInt *text_len, UChar flag);
+
+// The same, the working memory being taken from a context which is
+// reused by all the documents (see xbzip_arena.c)
+void xbzip_compress_ctx(xbzip_context_type *ctx, UChar text[], TextInt text_len, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_compress_fd_ctx(xbzip_context_type *ctx, int fd, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_decompress_ctx(xbzip_context_type *ctx, UChar ctext[], TextInt ctext_len, 
+					UChar *text[], TextInt *text_len, UChar flag);
+
+// The decompression writing the text to a file descriptor, or to a sink 
+// (see xbzip_sink.c), while it is reconstructed: xbzip_decompress_fd() and
+// xbzip_deindex_sink() return the number of bytes written
+TextInt xbzip_decompress_fd(UChar ctext[], TextInt ctext_len, int fd, UChar flag);
+void xbzip_decompress_sink(UChar ctext[], TextInt ctext_len, xbzip_sink_type *sink, UChar flag);
+void xbzip_decompress_sink_ctx(xbzip_context_type *ctx, UChar ctext[], TextInt ctext_len, 
+					xbzip_sink_type *sink, UChar flag);
 
 void xbzip_index(UChar text[], int text_len, UChar *disk[], int *disk_len);
 void xbzip_deindex(UChar disk[], int disk_len, UChar *text[], int *text_len);
+TextInt xbzip_deindex_sink(UChar disk[], int disk_len, xbzip_sink_type *sink);
 
 void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen, 
 				 int *first, int *last, int *pathocc, int *occ, int flag);
+int xbzip_locate(xbwt_index_type *index, UChar **path, int pathlen, int **rows);
 
 
 
 // -----------------------------------------------------------
 // You find the functions below in xbzip_fnct_compr.c 
 // -----------------------------------------------------------
-void xbzip_compress(UChar text[], int text_len, UChar *ctext[], int *ctext_len, UChar flag);
-void xbzip_decompress(UChar ctext[], int ctext_len, UChar *text[], int *text_len, UChar flag);
-
-void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt);
-void xbwt_unbuilder(xbwt_type *xbwt, UChar **text, int *text_len);
+void xbzip_compress(UChar text[], TextInt text_len, UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_compress_fd(int fd, UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_decompress(UChar ctext[], TextInt ctext_len, UChar *text[], TextInt *text_len, UChar flag);
+void xbzip_compress_ctx(xbzip_context_type *ctx, UChar text[], TextInt text_len, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_compress_fd_ctx(xbzip_context_type *ctx, int fd, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbzip_decompress_ctx(xbzip_context_type *ctx, UChar ctext[], TextInt ctext_len, 
+					UChar *text[], TextInt *text_len, UChar flag);
+TextInt xbzip_decompress_fd(UChar ctext[], TextInt ctext_len, int fd, UChar flag);
+void xbzip_decompress_sink(UChar ctext[], TextInt ctext_len, xbzip_sink_type *sink, UChar flag);
+void xbzip_decompress_sink_ctx(xbzip_context_type *ctx, UChar ctext[], TextInt ctext_len, 
+					xbzip_sink_type *sink, UChar flag);
+
+void xbwt_builder(xbzip_context_type *ctx, UChar *text, TextInt text_len, xbwt_type *xbwt);
+void xbwt_builder_fd(xbzip_context_type *ctx, int fd, xbwt_type *xbwt);
+void tree2xbwt(xbzip_context_type *ctx, Tree_node *root, TextInt TreeSize, xbwt_type *xbwt);
+void xbwt2compr(xbwt_type *xbwt, UChar *ctext[], TextInt *ctext_len, UChar flag);
+void xbwt_unbuilder(xbzip_context_type *ctx, xbwt_type *xbwt, xbzip_sink_type *sink);
 void xbwt2xbwtstr(xbwt_type *xbwt, xbwt_string_type *xbwtstr);
-void xbwtstr2xbwt(xbwt_string_type *xbwtstr, xbwt_type *xbwt);
-void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UChar flag);
-void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UChar flag);
-void unfuse_alpha_last(UChar *fused, int fused_len, UChar *alpha[], UChar *last[], 
-					   int *alphalen, int *lastlen);
-void fuse_alpha_last(xbwt_string_type *xbwtstr, UChar *fused[], int *fused_len);
+void xbwtstr2xbwt(xbzip_context_type *ctx, xbwt_string_type *xbwtstr, xbwt_type *xbwt);
+void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], TextInt *ctext_len, UChar flag);
+void compr2xbwtstr(UChar ctext[], TextInt ctext_len, xbwt_string_type *xbwtstr, UChar flag);
+int xbwt_prologue_len(TextInt text_len);
+void xbwt_write_prologue(UChar *ctext, xbwt_string_type *xbwtstr, 
+					TextInt len1, TextInt len2, TextInt len3);
+int xbwt_read_prologue(UChar *ctext, TextInt ctext_len, xbwt_string_type *xbwtstr, 
+				  TextInt *len1, TextInt *len2, TextInt *len3);
+void unfuse_alpha_last(UChar *fused, TextInt fused_len, UChar *alpha[], UChar *last[], 
+					   TextInt *alphalen, TextInt *lastlen);
+void fuse_alpha_last(xbwt_string_type *xbwtstr, UChar *fused[], TextInt *fused_len);
+
+// Concurrent (de)compression of the XBWT streams
+void init_data_jobs(data_jobs_type *jobs);
+void add_data_job(data_jobs_type *jobs, UChar *src, TextInt srcLen, UChar **dest, TextInt *destLen, int decompress);
+void run_data_job(bbz_worker_type *w, int i);
+void start_data_jobs(data_jobs_type *jobs);
+void wait_data_jobs(data_jobs_type *jobs);
 
 
 // ----------------------------------------------------------
@@ -103,10 +152,17 @@ void fuse_alpha_last(xbwt_string_type *xbwtstr, UChar *fused[], int *fused_len);
 // Main indexing, searching and printing functions
 void xbzip_index(UChar text[], int text_len, UChar *disk[], int *disk_len);
 void xbzip_deindex(UChar disk[], int disk_len, UChar *text[], int *text_len);
+TextInt xbzip_deindex_sink(UChar disk[], int disk_len, xbzip_sink_type *sink);
 void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen, 
 				 int *first, int *last, int *pathocc, int *occ, int flag);
+int search_path_rows(xbwt_index_type *index, UChar **path, int pathlen, int *first, int *last);
+int xbzip_locate(xbwt_index_type *index, UChar **path, int pathlen, int **rows);
+int locate_pc_items(xbwt_index_type *index, UChar *pattern, int firstItem, int lastItem, int **items);
+int pc_item_of_pos(xbwt_index_type *index, pc_cache_entry *e, int samp, int nsamp, 
+				   int pos, int *hintPos, int *hintRank);
 void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, 
 				  UChar **snippet, int *snippetLength);
+void Subtree2Sink(xbwt_index_type *index, int row, int *printed_row, xbzip_sink_type *sink);
 
 // Tree navigation functions
 UChar get_node_type(xbwt_index_type *index, int row);
@@ -115,6 +171,7 @@ int get_children(xbwt_index_type *index, int row, int *first, int *last);
 int get_parent(xbwt_index_type *index, int row);
 int get_ith_symb_child(xbwt_index_type *index, int row, int rank, UChar *c);
 int get_text_content(xbwt_index_type *index, int row, int *cLen, UChar **c);
+void get_pc_item(void *fmindex, int from, int skip, int *cLen, UChar **c);
 
 // Basic functions for indexing the compressed data
 int rank1_last(xbwt_index_type *index, int pos);
@@ -122,41 +179,68 @@ int select1_last(xbwt_index_type *index, int pos);
 int selectSymb_alpha(xbwt_index_type *index, UChar *q, int rank);
 int rankSymb_alpha(xbwt_index_type *index, UChar *q, int pos);
 int get_symbol_code(xbwt_index_type *index, UChar *q);
-void compress_block(uchar *source, int sourceLen, uchar **dest, int *destLen);
-void decompress_block(uchar *source, int sourceLen, uchar **dest, int *destLen);
+void set_alphabet_start(xbwt_index_type *index);
+void compress_block(bigbzip_ctx *bbz, uchar *source, int sourceLen, uchar **dest, int *destLen);
+void decompress_block(bigbzip_ctx *bbz, uchar *source, int sourceLen, 
+					  uchar **dest, int *destSize, int *destLen);
+
+// Concurrent compression of the blocks of the index
+void init_index_jobs(index_jobs_type *jobs, int size);
+void add_index_job(index_jobs_type *jobs, UChar *src, int srcLen, int type);
+void run_index_job(bbz_worker_type *w, int i);
+void run_index_jobs(index_jobs_type *jobs);
+int layout_index_jobs(index_jobs_type *jobs, UChar **area, int *offsets);
+void free_index_jobs(index_jobs_type *jobs);
+
+// LRU cache of the decompressed Last/Alpha blocks
+void init_block_cache(xbwt_index_type *index, int size);
+void free_block_cache(xbwt_index_type *index);
+UChar *get_cached_block(xbwt_index_type *index, int stream, int block, int *blockLen);
+void init_pc_cache(xbwt_index_type *index, int size, int maxmem);
+void free_pc_cache(xbwt_index_type *index);
+void evict_pc_cache_entry(xbwt_index_type *index, pc_cache_entry *e);
+pc_cache_entry *get_cached_fmindex(xbwt_index_type *index, int block, int withText);
 
 
 // Basic functions for data-structure (de)coding
 void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr);
 void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index);
 void index2disk(xbwt_index_type *index, UChar **ctext, int *ctext_len);
-void disk2index(UChar *ctext, int ctext_len, xbwt_index_type *index);
+void disk2index(UChar *ctext, TextInt ctext_len, xbwt_index_type *index);
+void disk2index_v1(UChar *ctext, int ctext_len, xbwt_index_type *index);
+void disk2index_v2(UChar *ctext, int ctext_len, xbwt_index_type *index);
+void attach_disk_bitvector(bitvector_type *bv, int len, void **field[], xbzi_section *table, int n);
+int check_disk_offsets(int *offset, int num, int max);
+int index_sections(xbwt_index_type *index, void **field[], int len[]);
+int bitvector_sections(bitvector_type *bv, int on, void **field[], int len[], int n);
 
 
 // TO BE DELETED
 void dummy_block_search(UChar *block, int blocklen, UChar *pattern, int **occArray, int *occNum);
-void xbwt_partition(UChar *text, int text_len);
 
 
 // ------------------------------------------------------
 // You find the functions below in data_compressor.c 
 // ------------------------------------------------------
-void data_compress(unsigned char *s, int slen, unsigned char **t, int *tlen);
-void data_decompress(unsigned char *s, int slen, unsigned char **t, int *tlen);
+void data_compress(unsigned char *s, TextInt slen, unsigned char **t, TextInt *tlen);
+void data_decompress(unsigned char *s, TextInt slen, unsigned char **t, TextInt *tlen);
 
 
 
 // ------------------------------------------------------
 // You find the functions below in xbzip_aux.c 
 // ------------------------------------------------------
-int PI_cmp(const void *a, const void *b);
+int PItoken_cmp(const void *a, const void *b);
 int S_cmp(const void *a, const void *b);
+int Sref_cmp(const void *a, const void *b);
+int Int_cmp(const void *a, const void *b);
+int Pos_cmp(const void *a, const void *b);
+void S_lexcodes(UChar **S, int card, int *code);
 void print_pretty(char c);
 void print_pretty_len(char *s, int len);
-void print_nodes_array(Tree_node **x, int size);
+void print_nodes_array(Tree_node **x, TextInt size);
 void print_xbwt(xbwt_type *x);
 void print_index(xbwt_index_type *x);
-void free_tree(Tree_node *u);
 int log2int(int u);
 double getTime ( void );
 
@@ -168,17 +252,68 @@ void default_hndl(void *data, const char *s, int len);
 void start_hndl(void *data, const char *el, const char **attr);
 void end_hndl(void *data, const char *el); 
 void char_hndl(void *data, const char *s, int len);
-Tree_node *xml2tree(UChar *text, int text_len, int *treesize);
-void tree2nodearray(Tree_node *u, Tree_node *array[], int *cursor);
+char *event_text(user_data *ud);
+void append_text(user_data *ud, char *s, int slen);
+Tree_node *xml2tree_init(user_data *ud, arena_type *arena, UChar *text);
+Tree_node *xml2tree(arena_type *arena, UChar *text, TextInt text_len, TextInt *treesize);
+Tree_node *xml2tree_fd(arena_type *arena, int fd, TextInt *text_len, TextInt *treesize);
+void tree2nodearray(Tree_node *u, Tree_node *array[], TextInt *cursor);
+void sort_nodearray(Tree_node *array[], TextInt n, TextInt *PIrank);
+
+// ------------------------------------------------------
+// You find the functions below in xbzip_bitvector.c 
+// ------------------------------------------------------
+int bitcount32(UInt32 w);
+void bitvector_init(bitvector_type *bv, int len);
+void bitvector_build(bitvector_type *bv);
+void bitvector_free(bitvector_type *bv);
+void bitvector_sizes(bitvector_type *bv, int size[]);
+void bitvector_attach(bitvector_type *bv, int len);
+int bitvector_rank1(bitvector_type *bv, int i);
+int bitvector_select(bitvector_type *bv, int k, int bit);
+void wavelet_build(wavelet_type *wm, int *codes, int n, int sigma);
+void wavelet_free(wavelet_type *wm);
+int wavelet_access(wavelet_type *wm, int i);
+int wavelet_rank(wavelet_type *wm, int code, int i);
+int wavelet_select(wavelet_type *wm, int code, int k);
+
+// ------------------------------------------------------
+// You find the functions below in xbzip_arena.c 
+// ------------------------------------------------------
+void arena_init(arena_type *a);
+void *arena_alloc(arena_type *a, size_t n);
+char *arena_strndup(arena_type *a, const char *s, int n);
+void arena_reset(arena_type *a);
+void arena_free(arena_type *a);
+void xbzip_context_init(xbzip_context_type *ctx);
+void xbzip_context_reset(xbzip_context_type *ctx);
+void xbzip_context_free(xbzip_context_type *ctx);
+
+// ------------------------------------------------------
+// You find the functions below in xbzip_sink.c 
+// ------------------------------------------------------
+void sink_init(xbzip_sink_type *sink, sink_write_type write, void *handle);
+void sink_init_fd(xbzip_sink_type *sink, int fd);
+void sink_init_mem(xbzip_sink_type *sink, TextInt size);
+void sink_put(xbzip_sink_type *sink, UChar *s, int len);
+void sink_flush(xbzip_sink_type *sink);
+void sink_reserve(xbzip_sink_type *sink, TextInt size);
+void sink_close(xbzip_sink_type *sink);
+void sink_take_mem(xbzip_sink_type *sink, UChar *text[], TextInt *text_len);
+void sink_write_fd(void *handle, UChar *buf, int len);
+void sink_write_mem(void *handle, UChar *buf, int len);
 
 // ------------------------------------------------------
 // You find the functions below in xbzip_hash.c 
 // ------------------------------------------------------
 
-void HHashtable_init(HHash_table *ht, int n);
+void HHashtable_init(HHash_table *ht, TextInt n);
 void HHashtable_print(HHash_table *ht);
-int HHashtable_func(char *s, int len, HHash_table *ht);
+unsigned int HHashtable_func(char *s, int len);
+Hash_slot *HHashtable_probe(char *s, int slen, unsigned int h, HHash_table *ht);
+void HHashtable_grow(HHash_table *ht);
 Hash_node *HHashtable_search(char *s, int slen, HHash_table *ht);
+int HHashtable_intern(char *s, int slen, HHash_table *ht);
 int HHashtable_insert(char *s, int slen, int code, HHash_table *ht); 
 void HHashtable_clear(HHash_table *ht);
 
@@ -0,0 +1,150 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Paolo Ferragina, Universit di Pisa             *
+ *   Contact address: ferragina@di.unipi.it								   *
+ *                                                                         *
+ *   Description. Arena allocator and the context of the xbzip jobs       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "xbzip.h"
+
+// The data of a block follow its header, rounded up to ARENA_ALIGN bytes
+#define ARENA_HEADER	((sizeof(arena_block) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+#define ARENA_DATA(_b_)	((char *) (_b_) + ARENA_HEADER)
+
+/* ----------------------------------------------------------------------------
+	Initializes an empty arena: no memory is taken until the first request
+	--------------------------------------------------------------------------- */
+void arena_init(arena_type *a)
+{
+	a->first = NULL;
+	a->current = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns n bytes aligned to ARENA_ALIGN. The blocks following the current
+	one (left by arena_reset) are reused before new ones are allocated.
+	--------------------------------------------------------------------------- */
+void *arena_alloc(arena_type *a, size_t n)
+{
+	arena_block *b, *prev;
+	size_t size;
+
+	n = (n + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+	if (a->current && (a->current->fill + n <= a->current->size)) {
+		a->current->fill += n;
+		return ARENA_DATA(a->current) + a->current->fill - n;
+		}
+
+	// The next free block, if large enough
+	b = a->current ? a->current->next : a->first;
+	if (b && (n <= b->size)) {
+		b->fill = n;
+		a->current = b;
+		return ARENA_DATA(b);
+		}
+
+	// A new block, linked after the current one 
+	size = (n > ARENA_BLOCK_SIZE) ? n : ARENA_BLOCK_SIZE;
+	b = (arena_block *) malloc(ARENA_HEADER + size);
+	if (!b) fatal_error("Error in allocating an arena block! (ARENA_ALLOC)\n");
+	b->size = size;
+	b->fill = n;
+	prev = a->current;
+	if (prev) { b->next = prev->next; prev->next = b; }
+	else { b->next = a->first; a->first = b; }
+	a->current = b;
+	return ARENA_DATA(b);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Copies the n bytes of s into the arena, followed by '\0'
+	--------------------------------------------------------------------------- */
+char *arena_strndup(arena_type *a, const char *s, int n)
+{
+	char *t;
+
+	t = (char *) arena_alloc(a, n + 1);
+	memcpy(t, s, n);
+	t[n] = '\0';
+	return t;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Empties the arena in one go: the blocks of ARENA_BLOCK_SIZE bytes are kept
+	for the next allocations, the larger ones are given back to the system.
+	Thus a process handling many documents does not grow beyond its 
+	largest one.
+	--------------------------------------------------------------------------- */
+void arena_reset(arena_type *a)
+{
+	arena_block *b, *next, **link;
+
+	for(link = &(a->first), b = a->first; b; b = next){
+		next = b->next;
+		if (b->size > ARENA_BLOCK_SIZE) {
+			*link = next;
+			free(b);
+		} else {
+			b->fill = 0;
+			link = &(b->next);
+			}
+		}
+	a->current = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Gives all the memory of the arena back to the system
+	--------------------------------------------------------------------------- */
+void arena_free(arena_type *a)
+{
+	arena_block *b, *next;
+
+	for(b = a->first; b; b = next){
+		next = b->next;
+		free(b);
+		}
+	a->first = NULL;
+	a->current = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Context of the xbzip jobs: xbzip_context_init() before the first job,
+	and xbzip_context_free() after the last one. Each job empties the arena 
+	of the context when it ends (xbzip_context_reset).
+	--------------------------------------------------------------------------- */
+void xbzip_context_init(xbzip_context_type *ctx)
+{
+	arena_init(&(ctx->Arena));
+}
+
+void xbzip_context_reset(xbzip_context_type *ctx)
+{
+	arena_reset(&(ctx->Arena));
+}
+
+void xbzip_context_free(xbzip_context_type *ctx)
+{
+	arena_free(&(ctx->Arena));
+}
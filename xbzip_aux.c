@@ -25,20 +25,26 @@
 extern int Verbose;
 
 /* ****************************************************************** 
-   comparison function used to sort the PI-components
+   comparison function used to sort the tokens of the PI-components.
+   The token of a TAG-ATTR node is its label followed by the first
+   char of its parent label ('<', or '\0' for the root): comparing
+   two PI-components token by token gives the same order as strcmp
+   on the concatenation of their labels (see sort_nodearray)
    ****************************************************************** */
-int PI_cmp(const void *a, const void *b)
+int PItoken_cmp(const void *a, const void *b)
 {
-	register int aa;
+	register int i, cx, cy;
 	register Tree_node *x = *( (Tree_node **) a);
 	register Tree_node *y = *( (Tree_node **) b);
 	
-	// Comparison is done on the PI-component
-	if (! (x->upward_path)) return -1; 
-	if (! (y->upward_path)) return +1; 
-	aa = strcmp(x->upward_path,y->upward_path);
-	if (!aa) return (( x->position <= y->position ) ? -1 : +1); 
-	return aa; 
+	for(i=0; (i <= x->len_str) && (i <= y->len_str); i++){
+		cx = (i < x->len_str) ? (UChar) x->str[i] : 
+			 ((x->parent) ? (UChar) x->parent->str[0] : 0);
+		cy = (i < y->len_str) ? (UChar) y->str[i] : 
+			 ((y->parent) ? (UChar) y->parent->str[0] : 0);
+		if (cx != cy) return cx - cy;
+	}
+	return x->len_str - y->len_str; 
 }
 
 /* ************************************************************************* 
@@ -49,6 +55,52 @@ int S_cmp(const void *a, const void *b)
 	return strcmp( *((UChar **) a), *((UChar **) b) );
 }
 
+/* ************************************************************************* 
+   as S_cmp, for an array of references to the TagAttr strings
+   ************************************************************************* */
+int Sref_cmp(const void *a, const void *b)
+{
+	return strcmp( (char *) **((UChar ***) a), (char *) **((UChar ***) b) );
+}
+
+/* ************************************************************************* 
+   comparison functions used to sort rows (ints) and text positions (ulongs)
+   ************************************************************************* */
+int Int_cmp(const void *a, const void *b)
+{
+	int x = *((int *) a), y = *((int *) b);
+
+	return (x > y) - (x < y);
+}
+
+int Pos_cmp(const void *a, const void *b)
+{
+	unsigned long x = *((unsigned long *) a), y = *((unsigned long *) b);
+
+	return (x > y) - (x < y);
+}
+
+/* ************************************************************************* 
+   Lexicographic encoding of the card (distinct) strings in S, which are 
+   left in their order: code[i] is the rank of S[i] among the TagAttr 
+   strings, the symbol = (if any) is not ranked and gets -1
+   ************************************************************************* */
+void S_lexcodes(UChar **S, int card, int *code)
+{
+	UChar ***P;
+	int i, r;
+
+	P = (UChar ***) malloc(sizeof(UChar **) * (card + 1));
+	if (!P) fatal_error("Error in allocating the P array! (S_lexcodes)\n");
+
+	for(i=0; i<card; i++) P[i] = S + i;
+	qsort(P, card, sizeof(UChar **), Sref_cmp);
+
+	for(i=0, r=0; i<card; i++)
+		code[P[i] - S] = (strcmp((char *) *P[i], "=") == 0) ? -1 : r++;
+	free(P);
+}
+
 
 /* ****************************************************************** 
    A user-friendly printing function
@@ -82,14 +134,14 @@ for(;len>0; s++,len--)
 /* ****************************************************************** 
    Printing the nodes array
    ****************************************************************** */
-void print_nodes_array(Tree_node **x, int size)
+void print_nodes_array(Tree_node **x, TextInt size)
 {
-	int i;
+	TextInt i;
 	Tree_node *u;
 	
 	printf("\n---------- NODES ARRAY ---------------\n");
 	for(i=0; i<size; i++){
-		printf("%d --LAST: %d  ---ALPHA: ", i, (x[i]->next_sibling==NULL) );
+		printf("%lld --LAST: %d  ---ALPHA: ", (long long) i, (x[i]->next_sibling==NULL) );
 		print_pretty_len( x[i]->str, x[i]->len_str );
 		printf("    ");
 		u = x[i]->parent;
@@ -153,6 +205,8 @@ void print_index(xbwt_index_type *x)
 	printf("\n");
 
 	printf("\n----------- Last index information\n"); 
+	if (x->LastType == LAST_BITVECTOR)
+		printf("Last bitvector = %d bits, %d ones\n",x->LastBV.Len,x->LastBV.Ones); 
 	printf("Last index length = %d bytes\n",x->LastIndexLen); 
 	printf("Last Num blocks = %d (the last one is dummy)\n",x->LastNumBlocks); 
 
@@ -160,6 +214,8 @@ void print_index(xbwt_index_type *x)
 		printf("block #%d: offset %d pos in Last %d\n",i,x->LastOffsetBlocks[i],x->LastPosBlocks[i]);	
 
 	printf("\n----------- Alpha index information\n"); 
+	if (x->AlphaType == ALPHA_WAVELET)
+		printf("Alpha wavelet matrix = %d levels of %d bits\n",x->AlphaWM.Levels,x->AlphaWM.Len); 
 	printf("Alpha index length = %d bytes\n",x->AlphaIndexLen); 
 	printf("Alpha Num blocks = %d (the last one is dummy)\n",x->AlphaNumBlocks); 
 
@@ -199,17 +255,6 @@ void print_index(xbwt_index_type *x)
 
 }
 
-//**************************************************************************
-// Free the memory occupied by the DOM tree
-//**************************************************************************
-void free_tree(Tree_node *u)
-{
-	if(!u) {return;}
-	free_tree(u->leftmost_child);
-	free_tree(u->next_sibling);
-	free(u);
-}
-
 //**************************************************************************
 // Free the memory occupied by the DOM tree
 //**************************************************************************
@@ -0,0 +1,329 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Paolo Ferragina, Universit di Pisa             *
+ *   Contact address: ferragina@di.unipi.it								   *
+ *                                                                         *
+ *   Description. Bitvectors with rank/select, and wavelet matrices        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "xbzip.h"
+
+
+/* ----------------------------------------------------------------------------
+	Number of 1-bits in a 32-bit word
+	--------------------------------------------------------------------------- */
+int bitcount32(UInt32 w)
+{
+	w = w - ((w >> 1) & 0x55555555);
+	w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+	w = (w + (w >> 4)) & 0x0f0f0f0f;
+	return (int) ((w * 0x01010101) >> 24);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Allocates a bitvector of 'len' bits, all set to 0.
+	Bits are then set via BV_SET, and bitvector_build() must be called
+	before any rank/select.
+	--------------------------------------------------------------------------- */
+void bitvector_init(bitvector_type *bv, int len)
+{
+	bv->Len = len;
+	bv->Ones = 0;
+	bv->Bits = (UInt32 *) calloc(len / 32 + 2, sizeof(UInt32));
+	if (!bv->Bits)
+		fatal_error("Error in allocating a bitvector! (BITVECTOR_INIT)\n");
+	bv->RankSuper = NULL;
+	bv->Select1Samples = NULL;
+	bv->Select0Samples = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Computes the rank/select directories of the bitvector:
+		RankSuper[s] = #1s before the s-th superblock of BV_SUPER_BITS bits
+		Select1Samples[k] = superblock of the (k * BV_SELECT_SAMPLE + 1)-th 1
+		Select0Samples[k] = the same for the 0s
+	Each of them takes about 1/16 of the bitvector space
+	--------------------------------------------------------------------------- */
+void bitvector_build(bitvector_type *bv)
+{
+	int i, s, words, supers, wps, ones, zeros;
+
+	wps = BV_SUPER_BITS / 32;
+	words = (bv->Len + 31) / 32;
+	supers = (words + wps - 1) / wps;
+
+	bv->RankSuper = (int *) malloc(sizeof(int) * (supers + 1));
+	if (!bv->RankSuper)
+		fatal_error("Error in allocating the rank directory! (BITVECTOR_BUILD)\n");
+
+	for(s=0, ones=0; s < supers; s++){
+		bv->RankSuper[s] = ones;
+		for(i = s * wps; (i < (s + 1) * wps) && (i < words); i++)
+			ones += bitcount32(bv->Bits[i]);
+		}
+	bv->RankSuper[supers] = ones;
+	bv->Ones = ones;
+
+	// The padding bits of the last superblock count as 0s, but they follow
+	// all the real 0s and thus are never selected
+	bv->Select1Samples = (int *) malloc(sizeof(int) * (ones / BV_SELECT_SAMPLE + 2));
+	bv->Select0Samples = (int *) malloc(sizeof(int) *
+						((supers * BV_SUPER_BITS - ones) / BV_SELECT_SAMPLE + 2));
+	if ((!bv->Select1Samples) || (!bv->Select0Samples))
+		fatal_error("Error in allocating the select samples! (BITVECTOR_BUILD)\n");
+
+	for(s=0, i=0; s < supers; s++)
+		while ((i * BV_SELECT_SAMPLE < bv->RankSuper[s+1]) &&
+			   (i * BV_SELECT_SAMPLE >= bv->RankSuper[s]))
+			bv->Select1Samples[i++] = s;
+	bv->Select1Samples[i] = supers; // sentinel
+
+	for(s=0, i=0; s < supers; s++){
+		zeros = (s + 1) * BV_SUPER_BITS - bv->RankSuper[s+1];
+		while ((i * BV_SELECT_SAMPLE < zeros) &&
+			   (i * BV_SELECT_SAMPLE >= s * BV_SUPER_BITS - bv->RankSuper[s]))
+			bv->Select0Samples[i++] = s;
+		}
+	bv->Select0Samples[i] = supers; // sentinel
+}
+
+
+/* ----------------------------------------------------------------------------
+	Frees the memory of the bitvector
+	--------------------------------------------------------------------------- */
+void bitvector_free(bitvector_type *bv)
+{
+	free(bv->Bits);
+	free(bv->RankSuper);
+	free(bv->Select1Samples);
+	free(bv->Select0Samples);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Byte sizes of the four arrays of a built bitvector, in the order
+		Bits, RankSuper, Select1Samples, Select0Samples
+	--------------------------------------------------------------------------- */
+void bitvector_sizes(bitvector_type *bv, int size[])
+{
+	int supers;
+
+	supers = ((bv->Len + 31) / 32 + BV_SUPER_BITS / 32 - 1) / (BV_SUPER_BITS / 32);
+	size[0] = sizeof(UInt32) * (bv->Len / 32 + 2);
+	size[1] = sizeof(int) * (supers + 1);
+	size[2] = sizeof(int) * (bv->Ones / BV_SELECT_SAMPLE + 2);
+	size[3] = sizeof(int) * ((supers * BV_SUPER_BITS - bv->Ones) / BV_SELECT_SAMPLE + 2);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Completes a bitvector of 'len' bits whose arrays have been set to point
+		into a loaded index (see disk2index): nothing is copied or rebuilt
+	--------------------------------------------------------------------------- */
+void bitvector_attach(bitvector_type *bv, int len)
+{
+	int supers;
+
+	bv->Len = len;
+	supers = ((len + 31) / 32 + BV_SUPER_BITS / 32 - 1) / (BV_SUPER_BITS / 32);
+	bv->Ones = bv->RankSuper[supers];
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns the number of 1s in B[0, i-1], for 0 <= i <= Len: one superblock
+		lookup plus at most BV_SUPER_BITS/32 word popcounts
+	--------------------------------------------------------------------------- */
+int bitvector_rank1(bitvector_type *bv, int i)
+{
+	int w, last_word, rank;
+
+	w = (i / BV_SUPER_BITS) * (BV_SUPER_BITS / 32);
+	last_word = i >> 5;
+	rank = bv->RankSuper[i / BV_SUPER_BITS];
+
+	for(; w < last_word; w++)
+		rank += bitcount32(bv->Bits[w]);
+
+	return rank + bitcount32(bv->Bits[last_word] & ((((UInt32) 1) << (i & 31)) - 1));
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns the position of the k-th bit equal to 'bit' (k >= 1): the select
+		sample delimits the superblocks to be (binary) searched, then the word
+		is found by popcounts
+	--------------------------------------------------------------------------- */
+int bitvector_select(bitvector_type *bv, int k, int bit)
+{
+	int lo, hi, mid, w, b, c, *samples;
+	UInt32 word;
+
+	if( (k <= 0) || (k > (bit ? bv->Ones : bv->Len - bv->Ones)) )
+		fatal_error("Out-of-bound select required on a bitvector! (BITVECTOR_SELECT)\n");
+
+	// Last superblock having less than k such bits before it
+	samples = bit ? bv->Select1Samples : bv->Select0Samples;
+	lo = samples[(k - 1) / BV_SELECT_SAMPLE];
+	hi = samples[(k - 1) / BV_SELECT_SAMPLE + 1];
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		c = bit ? bv->RankSuper[mid] : mid * BV_SUPER_BITS - bv->RankSuper[mid];
+		if (c < k) lo = mid; else hi = mid - 1;
+		}
+
+	// Scan the words of the superblock, then the bits of the word
+	k -= bit ? bv->RankSuper[lo] : lo * BV_SUPER_BITS - bv->RankSuper[lo];
+	w = lo * (BV_SUPER_BITS / 32);
+	while (1) {
+		word = bit ? bv->Bits[w] : ~(bv->Bits[w]);
+		if ((c = bitcount32(word)) >= k) break;
+		k -= c;
+		w++;
+		}
+	for(b = 0; ; b++)
+		if (((word >> b) & 1) && (--k == 0)) break;
+
+	return (w << 5) + b;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Builds the wavelet matrix of the 'n' codes in [0, sigma-1];
+		'codes' is left unchanged
+	--------------------------------------------------------------------------- */
+void wavelet_build(wavelet_type *wm, int *codes, int n, int sigma)
+{
+	int l, i, z, o, bit, *cur, *next, *tmp;
+
+	wm->Len = n;
+	for(wm->Levels = 1; (1 << wm->Levels) < sigma; wm->Levels++) ;
+
+	wm->Zeros = (int *) malloc(sizeof(int) * wm->Levels);
+	wm->Level = (bitvector_type *) malloc(sizeof(bitvector_type) * wm->Levels);
+	cur = (int *) malloc(sizeof(int) * (n + 1));
+	next = (int *) malloc(sizeof(int) * (n + 1));
+	if ((!wm->Zeros) || (!wm->Level) || (!cur) || (!next))
+		fatal_error("Error in allocating the wavelet matrix! (WAVELET_BUILD)\n");
+	memcpy(cur, codes, sizeof(int) * n);
+
+	// Each level is followed by a stable partition: 0s first, then 1s
+	for(l=0; l < wm->Levels; l++){
+		bit = wm->Levels - 1 - l;
+		bitvector_init(&wm->Level[l], n);
+		for(i=0, z=0; i < n; i++)
+			if ((cur[i] >> bit) & 1) BV_SET(&wm->Level[l], i);
+			else z++;
+		bitvector_build(&wm->Level[l]);
+		wm->Zeros[l] = z;
+
+		for(i=0, o=z, z=0; i < n; i++)
+			if ((cur[i] >> bit) & 1) next[o++] = cur[i];
+			else next[z++] = cur[i];
+		tmp = cur; cur = next; next = tmp;
+		}
+
+	free(cur);
+	free(next);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Frees the memory of the wavelet matrix
+	--------------------------------------------------------------------------- */
+void wavelet_free(wavelet_type *wm)
+{
+	int l;
+
+	for(l=0; l < wm->Levels; l++)
+		bitvector_free(&wm->Level[l]);
+	free(wm->Level);
+	free(wm->Zeros);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns the code in position i
+	--------------------------------------------------------------------------- */
+int wavelet_access(wavelet_type *wm, int i)
+{
+	int l, code;
+
+	for(l=0, code=0; l < wm->Levels; l++){
+		if (BV_GET(&wm->Level[l], i)) {
+			code = (code << 1) | 1;
+			i = wm->Zeros[l] + bitvector_rank1(&wm->Level[l], i);
+		} else {
+			code = code << 1;
+			i = i - bitvector_rank1(&wm->Level[l], i);
+			}
+		}
+	return code;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns the number of occurrences of 'code' in positions [0, i-1]
+	--------------------------------------------------------------------------- */
+int wavelet_rank(wavelet_type *wm, int code, int i)
+{
+	int l, s, r1s, r1i;
+
+	// [s, i) is the range of the codes sharing the bits examined so far
+	for(l=0, s=0; l < wm->Levels; l++){
+		r1s = bitvector_rank1(&wm->Level[l], s);
+		r1i = bitvector_rank1(&wm->Level[l], i);
+		if ((code >> (wm->Levels - 1 - l)) & 1) {
+			s = wm->Zeros[l] + r1s;
+			i = wm->Zeros[l] + r1i;
+		} else {
+			s = s - r1s;
+			i = i - r1i;
+			}
+		}
+	return i - s;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns the position of the k-th occurrence of 'code' (k >= 1)
+	--------------------------------------------------------------------------- */
+int wavelet_select(wavelet_type *wm, int code, int k)
+{
+	int l, pos;
+
+	// Starting position of the codes equal to 'code' in the last level
+	for(l=0, pos=0; l < wm->Levels; l++){
+		if ((code >> (wm->Levels - 1 - l)) & 1)
+			pos = wm->Zeros[l] + bitvector_rank1(&wm->Level[l], pos);
+		else
+			pos = pos - bitvector_rank1(&wm->Level[l], pos);
+		}
+	pos += k - 1;
+
+	// Go back up to the first level
+	for(l = wm->Levels - 1; l >= 0; l--){
+		if ((code >> (wm->Levels - 1 - l)) & 1)
+			pos = bitvector_select(&wm->Level[l], pos - wm->Zeros[l] + 1, 1);
+		else
+			pos = bitvector_select(&wm->Level[l], pos + 1, 0);
+		}
+	return pos;
+}
@@ -70,23 +70,84 @@ extern int Verbose;
 
 	The space for the compressed text and its length is allocated here.
 	---------------------------------------------------------------------------- */
-void xbzip_compress(UChar text[], int text_len, 
-					UChar *ctext[], int *ctext_len, UChar flag)
+void xbzip_compress(UChar text[], TextInt text_len, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag)
+{
+	xbzip_context_type ctx;
+
+	xbzip_context_init(&ctx);
+	xbzip_compress_ctx(&ctx, text, text_len, ctext, ctext_len, flag);
+	xbzip_context_free(&ctx);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Procedure xbzip_compress_ctx()
+
+	As xbzip_compress(), the working memory being taken from the arena of 
+	ctx, which is emptied at the end: a process compressing many documents
+	should init ctx once and pass it to all of them.
+	---------------------------------------------------------------------------- */
+void xbzip_compress_ctx(xbzip_context_type *ctx, UChar text[], TextInt text_len, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag)
 {
-	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
 	xbwt_type xbwt;
-	xbwt_string_type xbwtstr;
 
 	printf("\n\n------- TIMINGS ----------\n");
 
 	// Compute the XBWT
 	printf("xbwt building\n");
-	xbwt_builder(text, text_len, &xbwt);
+	xbwt_builder(ctx, text, text_len, &xbwt);
+
+	xbwt2compr(&xbwt, ctext, ctext_len, flag);
+	xbzip_context_reset(ctx);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Procedure xbzip_compress_fd()
+
+	As xbzip_compress(), but the XML text is read from the file descriptor
+	fd (a file, a pipe or a socket) up to its end, without being kept 
+	in memory: only its tokens are, in the DOM tree.
+	---------------------------------------------------------------------------- */
+void xbzip_compress_fd(int fd, UChar *ctext[], TextInt *ctext_len, UChar flag)
+{
+	xbzip_context_type ctx;
+
+	xbzip_context_init(&ctx);
+	xbzip_compress_fd_ctx(&ctx, fd, ctext, ctext_len, flag);
+	xbzip_context_free(&ctx);
+}
+
+void xbzip_compress_fd_ctx(xbzip_context_type *ctx, int fd, 
+					UChar *ctext[], TextInt *ctext_len, UChar flag)
+{
+	xbwt_type xbwt;
+
+	printf("\n\n------- TIMINGS ----------\n");
+
+	// Compute the XBWT
+	printf("xbwt building\n");
+	xbwt_builder_fd(ctx, fd, &xbwt);
+
+	xbwt2compr(&xbwt, ctext, ctext_len, flag);
+	xbzip_context_reset(ctx);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Serializes and compresses the XBWT, then prints some statistics
+	--------------------------------------------------------------------------- */
+void xbwt2compr(xbwt_type *xbwt, UChar *ctext[], TextInt *ctext_len, UChar flag)
+{
+	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
+	xbwt_string_type xbwtstr;
 
 	// Serialize the XBWT data into three strings and some infos
 	// The strings are: Slast, Salpha, and the Pcdata
 	__START_TIMER__;
-	xbwt2xbwtstr(&xbwt, &xbwtstr);
+	xbwt2xbwtstr(xbwt, &xbwtstr);
 	__END_TIMER__;
 	printf("xbwt serialization %.4f seconds\n\n", tot_partial_timer);
 
@@ -97,25 +158,28 @@ void xbzip_compress(UChar text[], int text_len,
 	printf("xbwt compression %.4f seconds\n", tot_partial_timer);
 	
 	printf("\n\n--------------- XBWT INFOS ---------------\n\n");
-	printf("Text of total length %d bytes\n\n",xbwt.TextLength);
-	printf("XML tree consists of %d nodes and leaves\n\n", xbwt.SItemsNum);
+	printf("Text of total length %lld bytes\n\n",(long long) xbwt->TextLength);
+	printf("XML tree consists of %lld nodes and leaves\n\n", (long long) xbwt->SItemsNum);
 	printf("TAG and ATTR names:\n");
-	printf("\tnumber %15d\n",xbwt.TagAttrItemsTot);
-	printf("\tdistinct %13d\n",xbwt.TagAttrItemsCard);
-	printf("\tlength %15d bytes\n\n",xbwt.SalphaTotLen);
+	printf("\tnumber %15lld\n",(long long) xbwt->TagAttrItemsTot);
+	printf("\tdistinct %13d\n",xbwt->TagAttrItemsCard);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt->SalphaTotLen);
 	printf("PCDATA entries:\n");
-	printf("\tnumber %15d\n",xbwt.PcdataItems);
-	printf("\tlength %15d bytes\n\n",xbwt.PcdataTotLen);
+	printf("\tnumber %15lld\n",(long long) xbwt->PcdataItems);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt->PcdataTotLen);
 	printf("STRING lengths (uncompressed):\n");
-	printf("\tPrologue: %12d bytes\n", 6*4);
-	printf("\tSlast: %15d bytes\n", xbwtstr.lastLen);
-	printf("\tSalpha: %14d bytes\n", xbwtstr.alphaLen);
-	printf("\tPcdata: %14d bytes\n\n", xbwtstr.pcdataLen);
-	printf("The total compressed size is of %d bytes\n\n", *ctext_len);
+	printf("\tPrologue: %12d bytes\n", xbwt_prologue_len(xbwt->TextLength));
+	printf("\tSlast: %15lld bytes\n", (long long) xbwtstr.lastLen);
+	printf("\tSalpha: %14lld bytes\n", (long long) xbwtstr.alphaLen);
+	printf("\tPcdata: %14lld bytes\n\n", (long long) xbwtstr.pcdataLen);
+	printf("The total compressed size is of %lld bytes\n\n", (long long) *ctext_len);
 
+	free(xbwtstr.alphaStr); free(xbwtstr.pcdataStr);
 }
 
 
+
+
 /* ----------------------------------------------------------------------
 	Procedure xbzip_decompress()
 
@@ -127,8 +191,79 @@ void xbzip_compress(UChar text[], int text_len,
 
 	The space for the output text and its length is allocated here.
 	---------------------------------------------------------------------- */
-void xbzip_decompress(UChar ctext[], int ctext_len, 
-					  UChar *text[], int *text_len, UChar flag)
+void xbzip_decompress(UChar ctext[], TextInt ctext_len, 
+					  UChar *text[], TextInt *text_len, UChar flag)
+{
+	xbzip_context_type ctx;
+
+	xbzip_context_init(&ctx);
+	xbzip_decompress_ctx(&ctx, ctext, ctext_len, text, text_len, flag);
+	xbzip_context_free(&ctx);
+}
+
+
+/* ----------------------------------------------------------------------
+	Procedure xbzip_decompress_ctx()
+
+	As xbzip_decompress(), the working memory being taken from the arena 
+	of ctx, which is emptied at the end.
+	---------------------------------------------------------------------- */
+void xbzip_decompress_ctx(xbzip_context_type *ctx, UChar ctext[], TextInt ctext_len, 
+					  UChar *text[], TextInt *text_len, UChar flag)
+{
+	xbzip_sink_type sink;
+
+	sink_init_mem(&sink, 0); // sized by xbwt_unbuilder
+	xbzip_decompress_sink_ctx(ctx, ctext, ctext_len, &sink, flag);
+	sink_close(&sink);
+	sink_take_mem(&sink, text, text_len);
+}
+
+
+/* ----------------------------------------------------------------------
+	Procedure xbzip_decompress_fd()
+
+	As xbzip_decompress(), the text being written to the file descriptor
+	fd while it is reconstructed, instead of being returned in memory.
+	Returns the length of the text written.
+	---------------------------------------------------------------------- */
+TextInt xbzip_decompress_fd(UChar ctext[], TextInt ctext_len, int fd, UChar flag)
+{
+	xbzip_sink_type sink;
+
+	sink_init_fd(&sink, fd);
+	xbzip_decompress_sink(ctext, ctext_len, &sink, flag);
+	sink_close(&sink);
+	return sink.Written;
+}
+
+
+/* ----------------------------------------------------------------------
+	Procedure xbzip_decompress_sink()
+
+	As xbzip_decompress(), the text being given to the sink (see 
+	xbzip_sink.c) while it is reconstructed. The sink is flushed,
+	not closed.
+	---------------------------------------------------------------------- */
+void xbzip_decompress_sink(UChar ctext[], TextInt ctext_len, 
+					  xbzip_sink_type *sink, UChar flag)
+{
+	xbzip_context_type ctx;
+
+	xbzip_context_init(&ctx);
+	xbzip_decompress_sink_ctx(&ctx, ctext, ctext_len, sink, flag);
+	xbzip_context_free(&ctx);
+}
+
+
+/* ----------------------------------------------------------------------
+	Procedure xbzip_decompress_sink_ctx()
+
+	As xbzip_decompress_sink(), the working memory being taken from the 
+	arena of ctx, which is emptied at the end.
+	---------------------------------------------------------------------- */
+void xbzip_decompress_sink_ctx(xbzip_context_type *ctx, UChar ctext[], TextInt ctext_len, 
+					  xbzip_sink_type *sink, UChar flag)
 {
 	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
 	xbwt_type xbwt;
@@ -143,58 +278,95 @@ void xbzip_decompress(UChar ctext[], int ctext_len,
 
 	// Deserialize the XBWT data		
 	__START_TIMER__;
-	xbwtstr2xbwt(&xbwtstr, &xbwt);
+	xbwtstr2xbwt(ctx, &xbwtstr, &xbwt);
 	__END_TIMER__;
 	printf("\nxbwt deserialize %.4f seconds\n", tot_partial_timer);
 
 	// Reconstruct the XML text
 	printf("\nxbwt unbuilding\n");
 	__START_TIMER__;
-	xbwt_unbuilder(&xbwt, text, text_len);
+	xbwt_unbuilder(ctx, &xbwt, sink);
 	__END_TIMER__;
 
 	printf("\n\n--------------- XBWT INFOS ---------------\n\n");
-	printf("Text of total length %d bytes\n\n",xbwt.TextLength);
-	printf("XML tree consists of %d nodes and leaves\n\n", xbwt.SItemsNum);
+	printf("Text of total length %lld bytes\n\n",(long long) xbwt.TextLength);
+	printf("XML tree consists of %lld nodes and leaves\n\n", (long long) xbwt.SItemsNum);
 	printf("TAG and ATTR names:\n");
-	printf("\tnumber %15d\n",xbwt.TagAttrItemsTot);
+	printf("\tnumber %15lld\n",(long long) xbwt.TagAttrItemsTot);
 	printf("\tdistinct %13d\n",xbwt.TagAttrItemsCard);
-	printf("\tlength %15d bytes\n\n",xbwt.SalphaTotLen);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt.SalphaTotLen);
 	printf("PCDATA entries:\n");
-	printf("\tnumber %15d\n",xbwt.PcdataItems);
-	printf("\tlength %15d bytes\n\n",xbwt.PcdataTotLen);
+	printf("\tnumber %15lld\n",(long long) xbwt.PcdataItems);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt.PcdataTotLen);
 	printf("STRING lengths (uncompressed):\n");
-	printf("\tPrologue: %12d bytes\n", 6*4);
-	printf("\tSlast: %15d bytes\n", xbwtstr.lastLen);
-	printf("\tSalpha: %14d bytes\n", xbwtstr.alphaLen);
-	printf("\tPcdata: %14d bytes\n\n", xbwtstr.pcdataLen);
-	printf("The total compressed size is of %d bytes\n\n", ctext_len);
+	printf("\tPrologue: %12d bytes\n", xbwt_prologue_len(xbwt.TextLength));
+	printf("\tSlast: %15lld bytes\n", (long long) xbwtstr.lastLen);
+	printf("\tSalpha: %14lld bytes\n", (long long) xbwtstr.alphaLen);
+	printf("\tPcdata: %14lld bytes\n\n", (long long) xbwtstr.pcdataLen);
+	printf("The total compressed size is of %lld bytes\n\n", (long long) ctext_len);
+
+	// Pcdata of PLAIN is a piece of ctext
+	free(xbwtstr.lastStr); free(xbwtstr.alphaStr); free(xbwtstr.alphaCodes);
+	if (flag != PLAIN) free(xbwtstr.pcdataStr);
+	xbzip_context_reset(ctx);
 }
 
 
 /* ----------------------------------------------------------------------------
-	Building the XBW transform given the DOM tree of the XML document
-	This procedure allocates the space for the XBWT datatype
+	Building the XBW transform of the XML document
+	This procedure allocates the space for the XBWT datatype in the arena
+	of ctx, as the DOM tree to which it refers
 	--------------------------------------------------------------------------- */
-void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt)
+void xbwt_builder(xbzip_context_type *ctx, UChar *text, TextInt text_len, xbwt_type *xbwt)
 {
 	Tree_node *root;
-	Tree_node **nodes_array;
 	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
-	int i, cursor, TreeSize;
-	HHash_table ht;
-
+	TextInt TreeSize;
 
 	__START_TIMER__;
 	// Build the DOM tree for the XML document
-	root = xml2tree(text, text_len, &TreeSize);
-	xbwt->SItemsNum = TreeSize;
+	root = xml2tree(&(ctx->Arena), text, text_len, &TreeSize);
 	xbwt->TextLength = text_len;
 
 	//------------ stop measuring time
 	__END_TIMER__;
 	printf("  xml2tree %.4f seconds\n", tot_partial_timer);
 
+	tree2xbwt(ctx, root, TreeSize, xbwt);
+}
+
+/* ----------------------------------------------------------------------------
+	As xbwt_builder(), the XML document being read from the file descriptor fd
+	--------------------------------------------------------------------------- */
+void xbwt_builder_fd(xbzip_context_type *ctx, int fd, xbwt_type *xbwt)
+{
+	Tree_node *root;
+	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
+	TextInt TreeSize;
+
+	__START_TIMER__;
+	// Build the DOM tree while reading the XML document
+	root = xml2tree_fd(&(ctx->Arena), fd, &(xbwt->TextLength), &TreeSize);
+
+	//------------ stop measuring time
+	__END_TIMER__;
+	printf("  xml2tree (streamed) %.4f seconds\n", tot_partial_timer);
+
+	tree2xbwt(ctx, root, TreeSize, xbwt);
+}
+
+/* ----------------------------------------------------------------------------
+	Building the XBW transform given the DOM tree of the XML document,
+	consisting of TreeSize nodes and leaves. xbwt->TextLength must be set.
+	--------------------------------------------------------------------------- */
+void tree2xbwt(xbzip_context_type *ctx, Tree_node *root, TextInt TreeSize, xbwt_type *xbwt)
+{
+	Tree_node **nodes_array;
+	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
+	TextInt i, cursor, *PIrank, prevtext;
+	HHash_table ht;
+
+	xbwt->SItemsNum = TreeSize;
 
 	// Serializes the DOM tree into a DOM array
 	__START_TIMER__;
@@ -209,24 +381,21 @@ void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt)
 	
 	// Sorts the DOM array according to the PI-component
 	__START_TIMER__;
-	qsort(nodes_array, xbwt->SItemsNum, sizeof(Tree_node *), PI_cmp);
+	PIrank = (TextInt *) malloc(sizeof(TextInt) * xbwt->SItemsNum);
+	if (!PIrank) fatal_error("Error in allocating PIrank! (xbwt builder)");
+	sort_nodearray(nodes_array, xbwt->SItemsNum, PIrank);
 	__END_TIMER__;
-	printf("  qsort %.4f seconds\n", tot_partial_timer);
+	printf("  PI-sort %.4f seconds\n", tot_partial_timer);
 
 	if(Verbose)	
 		print_nodes_array(nodes_array,cursor);
 
-	// Memory Allocation 
-	xbwt->Slast = (UChar *) malloc( sizeof(UChar) * xbwt->SItemsNum );
-	if ( !xbwt->Slast ) fatal_error("Error in allocating space for Slast! (XBWT builder)\n");
-
-	xbwt->Stype = (UChar *) malloc( sizeof(UChar) * xbwt->SItemsNum );
-	if ( !xbwt->Stype ) fatal_error("Error in allocating space for Stype! (XBWT builder)\n");
-
-	xbwt->Salpha = (UChar **) malloc( sizeof(UChar *) * xbwt->SItemsNum );
-	xbwt->LenSalpha = (int *) malloc( sizeof(int) * xbwt->SItemsNum );
-	if ( !xbwt->Salpha || !xbwt->LenSalpha) 
-		fatal_error("Error in allocating space for Salpha or LenSalpha! (XBWT builder)\n");
+	// Memory Allocation (arena_alloc never fails)
+	xbwt->Slast = (UChar *) arena_alloc(&(ctx->Arena), sizeof(UChar) * xbwt->SItemsNum );
+	xbwt->Stype = (UChar *) arena_alloc(&(ctx->Arena), sizeof(UChar) * xbwt->SItemsNum );
+	xbwt->Salpha = (UChar **) arena_alloc(&(ctx->Arena), sizeof(UChar *) * xbwt->SItemsNum );
+	xbwt->LenSalpha = (int *) arena_alloc(&(ctx->Arena), sizeof(int) * xbwt->SItemsNum );
+	xbwt->Scode = NULL;		// needed only to rebuild the text
 
 	// Statistics and storage
 	// 	xbwt->SItemsNum contains size of S array
@@ -238,6 +407,9 @@ void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt)
 	xbwt->PcdataItems=0;
 	xbwt->TagAttrItemsTot=0;
 	xbwt->TagAttrItemsCard=0;
+	xbwt->PartitionCount=0;
+	prevtext=0;
+	xbwt->PartitionArray = (TextInt *) arena_alloc(&(ctx->Arena), sizeof(TextInt) * xbwt->SItemsNum );
 	HHashtable_init(&ht, 2 * xbwt->SItemsNum);
 
 	for(i=0; i < xbwt->SItemsNum; i++){ 
@@ -250,9 +422,15 @@ void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt)
 		switch (nodes_array[i]->type) {
 
 			// This is Pcdata or Attribute value
+			// Consecutive items with the same upward path form a group 
+			// of the Pcdata partition (the first one follows the root)
 			case TEXT: 
 				xbwt->PcdataItems++;
 				xbwt->PcdataTotLen += xbwt->LenSalpha[i];
+				if (PIrank[i] != PIrank[prevtext])
+					xbwt->PartitionArray[xbwt->PartitionCount++] = 0;
+				xbwt->PartitionArray[xbwt->PartitionCount-1]++;
+				prevtext = i;
 				break;
 						
 			// This is a tag or attribute name
@@ -267,6 +445,10 @@ void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt)
 		}
 	}
 
+	HHashtable_clear(&ht);
+	free(PIrank);
+	free(nodes_array);
+
 	__END_TIMER__;
 	printf("  xbwt data-type build %.4f seconds\n", tot_partial_timer);
 
@@ -276,58 +458,35 @@ void xbwt_builder(UChar *text, int text_len, xbwt_type *xbwt)
 /* ----------------------------------------------------------------------------
 	Recovers the original XML document from the XBWT
 	We assume that all fields of xbwt_type are initialized.
-	This procedure allocates the space for the text and returns its length
+	The text is written to the sink as it is rebuilt, hence no text-sized 
+	buffer is needed (except by a memory sink)
 	--------------------------------------------------------------------------- */
-void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
+void xbwt_unbuilder(xbzip_context_type *ctx, xbwt_type *xbwt, xbzip_sink_type *sink)
 {
-	char *strndup(const char *s, size_t n);
 	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
-	int i, j, k, skip;
-	int InAngleBrackets, cursor, top_stack, PosSalpha, starting_tag, *Stack;
-	int *C, *F, *J; 
-	UChar **S;
-	HHash_table ht;
-	Hash_node *hn;
+	TextInt i, j, k, skip;
+	TextInt InAngleBrackets, top_stack, PosSalpha, starting_tag, *Stack;
+	TextInt *C, *F, *J; 
 
 	assert(xbwt->TagAttrItemsCard <= xbwt->TagAttrItemsTot);
+	if (!xbwt->Scode)
+		fatal_error("\nThe TAG-ATTR names are not encoded! (xbwt unbuilder)\n");
 
 	__START_TIMER__;
 
-	// Lexicographic encode the TAG and ATTR names
-	// TagAttrCard = # distinct TAG-ATTRS names (plain letters terminated by \0)
-	S = (UChar **) malloc(sizeof(UChar *) * xbwt->TagAttrItemsCard);
-	if (!S)	fatal_error("\nError in allocating the S array! (xbwt unbuilder)\n");
-
-	HHashtable_init(&ht, 2 * xbwt->TagAttrItemsCard);
-	for(i=0,k=0; i<xbwt->SItemsNum; i++){
-		if(xbwt->Stype[i] != TEXT){
-			if (HHashtable_insert(xbwt->Salpha[i], xbwt->LenSalpha[i], 0, &ht))
-				S[k++] = strndup(xbwt->Salpha[i], xbwt->LenSalpha[i]);	
-		}
-	}
-
-	assert(xbwt->TagAttrItemsCard == k);
-
-	// Sort lexicoraphically the TAG and ATTR names
-	qsort(S, xbwt->TagAttrItemsCard, sizeof(UChar *), S_cmp);
-
-	// Compute the lexicographic code
-	for(i=0; i<xbwt->TagAttrItemsCard; i++){
-		hn = HHashtable_search(S[i], strlen(S[i]), &ht);
-		hn -> code = i;
-		}
-
+	// The TAG and ATTR names are encoded in lexicographic order by 
+	// xbwtstr2xbwt, hence F and J are computed over integers only
 	// BuildF 
 	// F[i]=j iff the first PI-component prefixed by "i" is in row "j"
-	C = (int *) malloc(sizeof(int) * xbwt->TagAttrItemsCard);
-	F = (int *) malloc(sizeof(int) * xbwt->TagAttrItemsCard);
+	// The arrays live in the arena of the job (arena_alloc never fails)
+	C = (TextInt *) arena_alloc(&(ctx->Arena), sizeof(TextInt) * xbwt->TagAttrItemsCard);
+	F = (TextInt *) arena_alloc(&(ctx->Arena), sizeof(TextInt) * xbwt->TagAttrItemsCard);
+	J = (TextInt *) arena_alloc(&(ctx->Arena), sizeof(TextInt) * xbwt->SItemsNum);
 	
 	for(i=0; i < xbwt->TagAttrItemsCard; i++) C[i]=0;
 	for(i=0; i < xbwt->SItemsNum; i++)
-		if(xbwt->Stype[i] != TEXT){
-			hn=HHashtable_search(xbwt->Salpha[i], xbwt->LenSalpha[i], &ht);
-			C[hn->code]++;  
-			}
+		if(xbwt->Stype[i] != TEXT)
+			C[xbwt->Scode[i]]++;  
 
 	// First PI-string is empty, first TAG-ATTR encoded with 0
 	F[0]=1;						
@@ -342,16 +501,15 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 	// BuildJ
 	// J[i]=j iff Salpha[j] is the first child of Salpha[i]
 	// J[i]=-1 iff Salpha[i] is a leaf
-	J = (int *) malloc(sizeof(int) * xbwt->SItemsNum);
 	for(i=0; i < xbwt->SItemsNum; i++) { 
 		if (xbwt->Stype[i] == TEXT) 
 			{ J[i] = -1; }
 		else {
-			hn=HHashtable_search(xbwt->Salpha[i], xbwt->LenSalpha[i], &ht); 
-			J[i]=F[hn->code];
+			k=xbwt->Scode[i];
+			J[i]=F[k];
 			j=J[i];
 			while (xbwt->Slast[j] != 1) j++;
-			F[hn->code] = j+1; // we jump to the next child and skip the 1
+			F[k] = j+1; // we jump to the next child and skip the 1
 			}
 		}
 
@@ -361,16 +519,10 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 	__START_TIMER__;
 
 	// Rebuild the source document
-	Stack = (int *) malloc(sizeof(int) * xbwt->SItemsNum);
-	if (!Stack) fatal_error("Error in allocating Stack! (xbwt unbuilder)");
-
-	*text_len = xbwt->TextLength; 
-	*text = (UChar *) malloc(sizeof(UChar) * ((*text_len) + 2) );
-	if( !(*text) ) fatal_error("\nError in allocating the text space! (xbwt_unbuilder)\n");
-	(*text)[*text_len] = '\0'; // handling string end
+	Stack = (TextInt *) arena_alloc(&(ctx->Arena), sizeof(TextInt) * xbwt->SItemsNum);
+	sink_reserve(sink, xbwt->TextLength);
 
 	InAngleBrackets=0;	// flags if we are within <....>	
-	cursor=0;			// moves over the text under construction
 	top_stack=-1;		// points to the top of Stack
 	starting_tag = 1;	// flag for managing <xml_xbwtroot>
 
@@ -385,13 +537,12 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 		if(PosSalpha < 0){
 			if (InAngleBrackets != 0)
 				fatal_error("InAngleBrackets is not 0 and PosAlpha is negative ! (xbwt_unbuilder)\n");
-			(*text)[cursor++] = '<';
-			(*text)[cursor++] = '/';
+			SINK_PUTC(sink, '<');
+			SINK_PUTC(sink, '/');
 			// Cancel the <
-			memcpy(*text+cursor,xbwt->Salpha[-PosSalpha]+1,xbwt->LenSalpha[-PosSalpha]-1);
-			cursor += xbwt->LenSalpha[-PosSalpha]-1;			
+			sink_put(sink, xbwt->Salpha[-PosSalpha]+1, xbwt->LenSalpha[-PosSalpha]-1);
 			// Append the >
-			(*text)[cursor++] = '>';
+			SINK_PUTC(sink, '>');
 			continue; // back to Pop from Stack
 		} 
 		
@@ -404,7 +555,7 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 				InAngleBrackets=0;
 				Stack[++top_stack]=PosSalpha; // re-insert (push) into the stack
 				if(!starting_tag) // not closing the dummy tag <xml_xbwtroot>
-					(*text)[cursor++] = '>';
+					SINK_PUTC(sink, '>');
 				starting_tag=0; // No longer meet the dummy tag
 				continue; // back to Pop from Stack
 			} 
@@ -412,16 +563,14 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 			// We extracted some attribute inside <....>
 			assert( (xbwt->Stype[PosSalpha] == TAGATTR) && (xbwt->Salpha[PosSalpha][0] == '@') ); 
 
-			(*text)[cursor++] = ' ';
-			memcpy(*text+cursor,xbwt->Salpha[PosSalpha]+1,xbwt->LenSalpha[PosSalpha]-1); // avoid @
-			cursor += xbwt->LenSalpha[PosSalpha]-1;
+			SINK_PUTC(sink, ' ');
+			sink_put(sink, xbwt->Salpha[PosSalpha]+1, xbwt->LenSalpha[PosSalpha]-1); // avoid @
 
 			// Create the attribute string
-			(*text)[cursor++] = '='; (*text)[cursor++] = '\"';
+			SINK_PUTC(sink, '='); SINK_PUTC(sink, '\"');
 			assert(xbwt->Stype[J[PosSalpha]] == TEXT);
-			memcpy(*text+cursor,xbwt->Salpha[J[PosSalpha]],xbwt->LenSalpha[J[PosSalpha]]);
-			cursor += xbwt->LenSalpha[J[PosSalpha]];
-			(*text)[cursor++] = '"';
+			sink_put(sink, xbwt->Salpha[J[PosSalpha]], xbwt->LenSalpha[J[PosSalpha]]);
+			SINK_PUTC(sink, '"');
 
 			// No pushing in the stack since we completed the attribute
 			continue; // back to pop from Stack
@@ -434,10 +583,7 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 		// Manage the texts
 		if (xbwt->Stype[PosSalpha] == TEXT) { 
 			if (xbwt->Salpha[PosSalpha][0] != (UChar) 255) // not dummy filler for empty tag
-				{
-				memcpy(*text+cursor,xbwt->Salpha[PosSalpha],xbwt->LenSalpha[PosSalpha]);
-				cursor += xbwt->LenSalpha[PosSalpha];
-				}
+				sink_put(sink, xbwt->Salpha[PosSalpha], xbwt->LenSalpha[PosSalpha]);
 			continue; // back to pop from Stack
 		}
 
@@ -446,10 +592,7 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 		if (xbwt->Stype[PosSalpha] == TAGATTR) { 
 			InAngleBrackets=1; 
 			if(!starting_tag) // write if not the dummy root
-			{
-				memcpy(*text+cursor,xbwt->Salpha[PosSalpha],xbwt->LenSalpha[PosSalpha]);
-				cursor += xbwt->LenSalpha[PosSalpha];
-			} 
+				sink_put(sink, xbwt->Salpha[PosSalpha], xbwt->LenSalpha[PosSalpha]);
 
 		// Insert in the stack the children of the current node
 		// J[]>0 ensures the node is not a leaf
@@ -463,13 +606,9 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 			}
 		}
 	}
+	sink_flush(sink);
 	__END_TIMER__;
 	printf("  reconstruct the text %.4f seconds\n", tot_partial_timer);
-
-	// To avoid some spurious chars after the last tag
-	*text_len = cursor;
-	 
-	free(F); free(J); free(S); free(C);
 }
 
 
@@ -481,13 +620,16 @@ void xbwt_unbuilder(xbwt_type *xbwt, UChar *text[], int *text_len)
 
 void xbwt2xbwtstr(xbwt_type *xbwt, xbwt_string_type *xbwtstr)
 {
-	int i, alphaOff, PcdataOff;
+	TextInt i, alphaOff, PcdataOff;
 
 
 	xbwtstr->TextLength=xbwt->TextLength;		// Reserved to store the TextLength
 	xbwtstr->SItemsNum=xbwt->SItemsNum;			// Reserved to store the SItemsNum
 	xbwtstr->TagAttrItemsCard=xbwt->TagAttrItemsCard;	// Reserved to store TagAttrItemsCard (costly to be derived)
 	xbwtstr->PcdataItems=xbwt->PcdataItems;		// Reserved to store # of Pcdata items (costly to be derived)
+	xbwtstr->PartitionArray=xbwt->PartitionArray;	// Groups of Pcdata items (for indexing)
+	xbwtstr->PartitionCount=xbwt->PartitionCount;
+	xbwtstr->alphaCodes=NULL;
 
 
 	// Serializing (copying) Slast
@@ -537,11 +679,17 @@ void xbwt2xbwtstr(xbwt_type *xbwt, xbwt_string_type *xbwtstr)
 	Deserializes the XBWT_STRING data type into the XBWT data type 
 	Salpha consists of <tag, @attr, = (for Pcdata)
 	Pcdata (text and attr value) is ordered according to Salpha, prefixed by \0
-	This procedure allocates the space for the XBWT data type
+	The TAG-ATTR names get their lexicographic code (Scode), which is taken 
+	from xbwtstr->alphaCodes if the decompressor knows it, otherwise each 
+	name is hashed once and only the distinct ones are sorted
+	This procedure allocates the space for the XBWT data type in the arena of ctx
 	--------------------------------------------------------------------------- */
-void xbwtstr2xbwt(xbwt_string_type *xbwtstr, xbwt_type *xbwt)
+void xbwtstr2xbwt(xbzip_context_type *ctx, xbwt_string_type *xbwtstr, xbwt_type *xbwt)
 {
-	int i,alphaOff,pcdataOff;
+	TextInt i,alphaOff,pcdataOff;
+	int k, *lex;
+	UChar **S;
+	HHash_table ht;
 
 	// Set the common fields
 	xbwt->TextLength = xbwtstr->TextLength;
@@ -551,22 +699,30 @@ void xbwtstr2xbwt(xbwt_string_type *xbwtstr, xbwt_type *xbwt)
 	xbwt->PcdataTotLen = 0;
 	xbwt->SalphaTotLen = 0; 
 	xbwt->TagAttrItemsTot = 0;
+	xbwt->PartitionArray = NULL; // not stored in the compressed formats
+	xbwt->PartitionCount = 0;
 
 	// Load Slast
 	xbwt->Slast = xbwtstr->lastStr;
 
 	// Load Stype, Salpha, and LenSalpha
-	xbwt->Stype = (UChar *) malloc((xbwt->SItemsNum) * sizeof(UChar));
-	if (! (xbwt->Stype) ) fatal_error("Failed allocating the STYPE array! (STR2XBWT)\n");
-
-	xbwt->Salpha = (UChar **) malloc((xbwt->SItemsNum) * sizeof(UChar *));
-	if (! (xbwt->Salpha) ) fatal_error("Failed allocating the SALPHA array! (STR2XBWT)\n");
-
-	xbwt->LenSalpha = (int *) malloc((xbwt->SItemsNum) * sizeof(int));
-	if (! (xbwt->LenSalpha) ) fatal_error("Failed allocating the LENSALPHA array! (STR2XBWT)\n");
+	xbwt->Stype = (UChar *) arena_alloc(&(ctx->Arena), (xbwt->SItemsNum) * sizeof(UChar));
+	xbwt->Salpha = (UChar **) arena_alloc(&(ctx->Arena), (xbwt->SItemsNum) * sizeof(UChar *));
+	xbwt->LenSalpha = (int *) arena_alloc(&(ctx->Arena), (xbwt->SItemsNum) * sizeof(int));
+
+	// Scode keeps the ids given by the hash table, until they are sorted
+	S = NULL;
+	if (xbwtstr->alphaCodes) 
+		xbwt->Scode = xbwtstr->alphaCodes;
+	else {
+		xbwt->Scode = (int *) arena_alloc(&(ctx->Arena), (xbwt->SItemsNum) * sizeof(int));
+		S = (UChar **) malloc(sizeof(UChar *) * (xbwt->TagAttrItemsCard + 1));
+		if (!S) fatal_error("Error in allocating the S array! (STR2XBWT)\n");
+		HHashtable_init(&ht, 2 * xbwt->TagAttrItemsCard);
+		}
 
 	alphaOff=0; pcdataOff=0;
-	for (i=0; i < xbwt->SItemsNum; i++) {
+	for (i=0, k=0; i < xbwt->SItemsNum; i++) {
 
 		if ( xbwtstr->alphaStr[alphaOff] != '=' ) // This is a TAG-ATTR name
 			{ 
@@ -576,15 +732,23 @@ void xbwtstr2xbwt(xbwt_string_type *xbwtstr, xbwt_type *xbwt)
 			  // skip the starting char < or @
 			  xbwt->LenSalpha[i]=1; alphaOff++; 
 			  // Search for the end of the tag-attr name
-			  while ( (xbwtstr->alphaStr[alphaOff] != '=') &&
+			  while ( (alphaOff < xbwtstr->alphaLen) &&
+					  (xbwtstr->alphaStr[alphaOff] != '=') &&
 					  (xbwtstr->alphaStr[alphaOff] != '<')  &&
-					  (xbwtstr->alphaStr[alphaOff] != '@')  &&
-					  (alphaOff < xbwtstr->alphaLen)
+					  (xbwtstr->alphaStr[alphaOff] != '@')
 					  ) { 
 						  alphaOff++; 
 						  xbwt->LenSalpha[i]++; 
 						}
 		  	  xbwt->SalphaTotLen += xbwt->LenSalpha[i]; 
+			  if (S) {
+				  xbwt->Scode[i] = HHashtable_intern((char *) xbwt->Salpha[i], xbwt->LenSalpha[i], &ht);
+				  if (xbwt->Scode[i] == k) { // new name
+					  if (k == xbwt->TagAttrItemsCard)
+						  fatal_error("Too many distinct TAG-ATTR names! (STR2XBWT)\n");
+					  S[k++] = (UChar *) arena_strndup(&(ctx->Arena), (char *) xbwt->Salpha[i], xbwt->LenSalpha[i]);
+					  }
+				  }
 			} 
 		else // This is a TEXT field (Pcdata is prefixed by \0)
 			{ 
@@ -592,11 +756,12 @@ void xbwtstr2xbwt(xbwt_string_type *xbwtstr, xbwt_type *xbwt)
 			  xbwt->PcdataItems++;
 			  xbwt->Stype[i] = TEXT;
 			  pcdataOff++; // skip the prefix \0
+			  if (S) xbwt->Scode[i] = -1;
 			  xbwt->Salpha[i] = xbwtstr->pcdataStr+pcdataOff; 
 			  xbwt->LenSalpha[i]=0;
   			  // Search for the end of the pcdata
-			  while ( (xbwtstr->pcdataStr[pcdataOff] != '\0') && 
-				       (pcdataOff < xbwtstr->pcdataLen) 
+			  while ( (pcdataOff < xbwtstr->pcdataLen) &&
+					   (xbwtstr->pcdataStr[pcdataOff] != '\0')
 					) { 
 						  pcdataOff++; 
 						  xbwt->LenSalpha[i]++; 
@@ -605,15 +770,29 @@ void xbwtstr2xbwt(xbwt_string_type *xbwtstr, xbwt_type *xbwt)
 			}
 
 	}
+
+	if (!S) return;
+
+	// Sort lexicographically the distinct names, then recode the items
+	if (k != xbwt->TagAttrItemsCard)
+		fatal_error("Error in counting the distinct TAG-ATTR names! (STR2XBWT)\n");
+	HHashtable_clear(&ht);
+	lex = (int *) malloc(sizeof(int) * (k + 1));
+	if (!lex) fatal_error("Error in allocating the lex array! (STR2XBWT)\n");
+	S_lexcodes(S, k, lex);
+	for (i=0; i < xbwt->SItemsNum; i++)
+		if (xbwt->Scode[i] >= 0)
+			xbwt->Scode[i] = lex[xbwt->Scode[i]];
+	free(lex); free(S);
 }
 
 /* ----------------------------------------------------------------------------
 	Fuse Salpha with Slast: </ ends any group of children, = stands for Pcdata 
 	--------------------------------------------------------------------------- */
-void fuse_alpha_last(xbwt_string_type *xbwtstr, UChar *fused[], int *fused_len)
+void fuse_alpha_last(xbwt_string_type *xbwtstr, UChar *fused[], TextInt *fused_len)
 {
 	UChar *stemp;
-	int stemp_len, i, j, k;
+	TextInt stemp_len, i, j, k;
 
 	// Oversize in case of short texts which do expand !
 	stemp_len = max(xbwtstr->TextLength + 4*xbwtstr->lastLen, 100000); 
@@ -646,18 +825,18 @@ void fuse_alpha_last(xbwt_string_type *xbwtstr, UChar *fused[], int *fused_len)
 	if( i > stemp_len )
 		fatal_error("Out of bounds for i! (FUSE)\n");
 	
-	realloc(stemp,i);
+	stemp = realloc(stemp,i);
 	*fused = stemp; *fused_len = i;
 }
 
 /* ----------------------------------------------------------------------------
 	Unfuse Salpha from Slast: </ ends any group of children, = stands for Pcdata 
 	--------------------------------------------------------------------------- */
-void unfuse_alpha_last(UChar *fused, int fused_len, 
+void unfuse_alpha_last(UChar *fused, TextInt fused_len, 
 					   UChar *alpha[], UChar *last[], 
-					   int *alphalen, int *lastlen)
+					   TextInt *alphalen, TextInt *lastlen)
 {
-	int i,j,k;	
+	TextInt i,j,k;	
 
 	// Loading Slast and Salpha, oversized
 	*alpha  = (UChar *) malloc(sizeof(UChar) * fused_len );
@@ -686,35 +865,166 @@ void unfuse_alpha_last(UChar *fused, int fused_len,
 	if( (k >fused_len) || (j > fused_len) )
 		fatal_error("Error in Defusing Salpha and Slast! (UNFUSE)\n");
 
-	*alphalen=k; realloc(*alpha,*alphalen);
-	*lastlen=j; realloc(*last,*lastlen);
+	*alphalen=k; *alpha = realloc(*alpha,*alphalen);
+	*lastlen=j; *last = realloc(*last,*lastlen);
 
 }
 
+/* ----------------------------------------------------------------------------
+	The streams Last, Salpha and Pcdata are (de)compressed independently:
+		the jobs added to 'jobs' are run by a pool of up to NUM_THREADS 
+		threads (the calling one included) between start_data_jobs() and
+		wait_data_jobs(), so that in the meantime the caller can work on
+		another stream. With NUM_THREADS = 1 the jobs are run one after 
+		the other, in order of insertion, by wait_data_jobs().
+	--------------------------------------------------------------------------- */
+void init_data_jobs(data_jobs_type *jobs)
+{
+	jobs->num = 0;
+	jobs->pool = NULL;
+}
+
+void add_data_job(data_jobs_type *jobs, UChar *src, TextInt srcLen, 
+				  UChar **dest, TextInt *destLen, int decompress)
+{
+	data_job_type *job;
+
+	if (jobs->num == MAX_DATA_JOBS)
+		fatal_error("Too many (de)compression jobs! (ADD_DATA_JOB)\n");
+
+	job = &jobs->job[jobs->num++];
+	job->src = src;
+	job->srcLen = srcLen;
+	job->dest = dest;
+	job->destLen = destLen;
+	job->decompress = decompress;
+}
+
+/* ----------------------------------------------------------------------------
+	Task of the pool: (de)compresses the i-th stream
+	--------------------------------------------------------------------------- */
+void run_data_job(bbz_worker_type *w, int i)
+{
+	data_job_type *job = &((data_jobs_type *) w->arg)->job[i];
+
+	if (job->decompress)
+		data_decompress(job->src, job->srcLen, job->dest, job->destLen);
+	else
+		data_compress(job->src, job->srcLen, job->dest, job->destLen);
+}
+
+void start_data_jobs(data_jobs_type *jobs)
+{
+	jobs->pool = (bbz_pool_type *) malloc(sizeof(bbz_pool_type));
+	if (!jobs->pool)
+		fatal_error("Error in allocating the (de)compression threads! (START_DATA_JOBS)\n");
+	bbz_pool_start(jobs->pool, jobs->num, NUM_THREADS, run_data_job, jobs);
+}
+
+void wait_data_jobs(data_jobs_type *jobs)
+{
+	bbz_pool_wait(jobs->pool);
+	free(jobs->pool);
+	jobs->pool = NULL;
+}
+
+/* ----------------------------------------------------------------------------
+	The prologue of the compressed string consists of PROLOGUE_ITEMS numbers:
+		TextLength, SItemsNum, TagAttrItemsCard, PcdataItems and three lengths
+		whose semantic depends on the type of compression. They take 4 bytes
+		each, unless the text is longer than 2Gb (64-bit build only): then
+		the word WIDE_PROLOGUE is followed by the numbers on 8 bytes each.
+		A 32-bit build decodes a wide prologue if its numbers fit an int.
+	--------------------------------------------------------------------------- */
+int xbwt_prologue_len(TextInt text_len)
+{
+	return ((UInt64) text_len > 0x7FFFFFFF) ? 4 + 8 * PROLOGUE_ITEMS : 4 * PROLOGUE_ITEMS;
+}
+
+void xbwt_write_prologue(UChar *ctext, xbwt_string_type *xbwtstr, 
+					TextInt len1, TextInt len2, TextInt len3)
+{
+	bit_stream_type bs;
+	TextInt v[PROLOGUE_ITEMS];
+	int k, wide;
+
+	v[0] = xbwtstr->TextLength;
+	v[1] = xbwtstr->SItemsNum;
+	v[2] = xbwtstr->TagAttrItemsCard;
+	v[3] = xbwtstr->PcdataItems;
+	v[4] = len1; v[5] = len2; v[6] = len3;
+
+	wide = (xbwt_prologue_len(xbwtstr->TextLength) != 4 * PROLOGUE_ITEMS);
+	init_buffer(&bs, ctext, xbwt_prologue_len(xbwtstr->TextLength));
+	if (wide) 
+		bbz_bit_write(&bs, 32, WIDE_PROLOGUE);
+	for(k=0; k < PROLOGUE_ITEMS; k++){
+		if (wide) 
+			bbz_bit_write(&bs, 32, (UInt32) (((UInt64) v[k]) >> 32));
+		else if ((UInt64) v[k] > 0x7FFFFFFF)
+			fatal_error("A length does not fit the prologue! (XBWT_WRITE_PROLOGUE)\n");
+		bbz_bit_write(&bs, 32, (UInt32) v[k]);
+		}
+}
+
+int xbwt_read_prologue(UChar *ctext, TextInt ctext_len, xbwt_string_type *xbwtstr, 
+				  TextInt *len1, TextInt *len2, TextInt *len3)
+{
+	bit_stream_type bs;
+	TextInt v[PROLOGUE_ITEMS];
+	UInt64 x;
+	int k, wide;
+
+	if (ctext_len < 4 * PROLOGUE_ITEMS)
+		fatal_error("The compressed file is too short! (XBWT_READ_PROLOGUE)\n");
+
+	init_buffer(&bs, ctext, 4 + 8 * PROLOGUE_ITEMS);
+	wide = ((UInt32) bbz_bit_read(&bs, 32) == WIDE_PROLOGUE);
+	if (! wide)
+		init_buffer(&bs, ctext, 4 * PROLOGUE_ITEMS);
+	for(k=0; k < PROLOGUE_ITEMS; k++){
+		x = (wide) ? ((UInt64) ((UInt32) bbz_bit_read(&bs, 32))) << 32 : 0;
+		x |= (UInt32) bbz_bit_read(&bs, 32);
+		if (x > TEXTINT_MAX)
+			fatal_error("The file needs the 64-bit build of xbzip (-DXBZIP_64)! (XBWT_READ_PROLOGUE)\n");
+		v[k] = (TextInt) x;
+		}
+
+	xbwtstr->TextLength = v[0];
+	xbwtstr->SItemsNum = v[1];
+	xbwtstr->TagAttrItemsCard = v[2];
+	xbwtstr->PcdataItems = v[3];
+	*len1 = v[4]; *len2 = v[5]; *len3 = v[6];
+	return (wide) ? 4 + 8 * PROLOGUE_ITEMS : 4 * PROLOGUE_ITEMS;
+}
+
 /* ----------------------------------------------------------------------------
 	Compresses the XBWT_STRING data type 
 		This procedure allocates the space for the compressed text
 		The compressed string is generated by catenating:
-		- Prologue: 6 numbers of 4 bytes each
+		- Prologue: PROLOGUE_ITEMS numbers (see xbwt_write_prologue)
 		- Salpha fused with Slast: </ ends any group of children, = stands for Pcdata 
 		- Pcdata: each entry is prefixed by \0
 	
 	The semantic of the numbers depends on the type of chosen compression
 	--------------------------------------------------------------------------- */
-void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UChar flag)
+void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], TextInt *ctext_len, UChar flag)
 {
 	UChar *fused, *cfused, *cpc, *calpha, *cpcdata, *clast, *Ualpha, *mtfc;
-	int i, j, fused_len, cfused_len, cpc_len, gap, gaplen, loggaplen;
-	int nbits_min, clastlen, calphalen, cpcdatalen;
-	int k,pos,code,AlfLen,rest,startb;
+	TextInt i, j, fused_len, cfused_len, cpc_len, nbits_min;
+	TextInt clastlen, calphalen, cpcdatalen;
+	int gap, gaplen, loggaplen, plen;
+	int k,pos,code,id,AlfLen,rest,startb;
 	HHash_table ht;
-	Hash_node *hn;
+	bit_stream_type bs;
+	data_jobs_type jobs;
 
 
 	// Oversize in case of short texts which may expand !
 	*ctext_len = max(xbwtstr->TextLength + 5*xbwtstr->lastLen, 100000); 
 	*ctext = (UChar *) malloc(sizeof(UChar) * (*ctext_len) );
 	if( !(*ctext) ) fatal_error("\nError in allocating the CTEXT string! (STR2COMPR)\n");
+	plen = xbwt_prologue_len(xbwtstr->TextLength);
 
 	switch (flag) {
 
@@ -723,16 +1033,9 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 			// Fuse the two arrays into one: </ per group of children
 			fuse_alpha_last(xbwtstr, &fused, &fused_len);
 	
-			// Prologue
-			init_buffer(*ctext,50);
-			bbz_bit_write(32,xbwtstr->TextLength);
-			bbz_bit_write(32,xbwtstr->SItemsNum);
-			bbz_bit_write(32,xbwtstr->TagAttrItemsCard);
-			bbz_bit_write(32,xbwtstr->PcdataItems);
-			bbz_bit_write(32,xbwtstr->lastLen);		// Store the (un)compressed length 
-			bbz_bit_write(32,fused_len);			// Store the FUSED length 
-			bbz_bit_write(32,xbwtstr->pcdataLen);	// Store the (un)compressed length
-			i = 7 * 4; // 7 numbers on 4 bytes each
+			// Prologue: the (un)compressed lengths of Slast, FUSED and Pcdata
+			xbwt_write_prologue(*ctext, xbwtstr, xbwtstr->lastLen, fused_len, xbwtstr->pcdataLen);
+			i = plen;
 
 			// Write fused 
 			memcpy((*ctext)+i, fused, fused_len);
@@ -746,7 +1049,8 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 				fatal_error("Overflow in writing the PLAIN file! (STR2COMPR)\n");
 
 			*ctext_len = i;
-			realloc(*ctext, *ctext_len);
+			*ctext = realloc(*ctext, *ctext_len);
+			free(fused);
 			break;
 
 		case BIGBZIP: // Fuse Last and Salpha
@@ -756,17 +1060,11 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 			data_compress(fused, fused_len, &cfused, &cfused_len);
 			data_compress(xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpc, &cpc_len);
 
-			// Prologue
-			init_buffer(*ctext,50);
-			bbz_bit_write(32,xbwtstr->TextLength);
-			bbz_bit_write(32,xbwtstr->SItemsNum);
-			bbz_bit_write(32,xbwtstr->TagAttrItemsCard);
-			bbz_bit_write(32,xbwtstr->PcdataItems);
-			bbz_bit_write(32,xbwtstr->lastLen);		// Store the uncompressed length (unused)
-			bbz_bit_write(32,cfused_len);			// Store the compressed length of FUSED
-			bbz_bit_write(32,cpc_len);				// Store the compressed length of PCDATA
+			// Prologue: the uncompressed length of Slast (unused), 
+			// and the compressed lengths of FUSED and PCDATA
+			xbwt_write_prologue(*ctext, xbwtstr, xbwtstr->lastLen, cfused_len, cpc_len);
 			
-			i = 7 * 4; // 7 numbers on 4 bytes each in the prologue
+			i = plen;
 			memcpy((*ctext) + i, cfused, cfused_len); // Copy the compressed FUSED
 			i += cfused_len;
 			memcpy((*ctext) + i, cpc, cpc_len); // Copy the compressed PCDATA
@@ -775,83 +1073,79 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 				fatal_error("Overflow in writing the BIGBZIP file! (STR2COMPR)\n");
 
 			*ctext_len = i;
-			realloc(*ctext, *ctext_len);
+			*ctext = realloc(*ctext, *ctext_len);
+			free(fused); free(cfused); free(cpc);
 
 			printf("\n\nCompression ratio over single pieces:\n");
-			printf("  Salpha+Last bigbzip-compressed = %8d bytes\n",cfused_len);
-			printf("  Pcdata bigbzip-compressed      = %8d bytes\n\n",cpc_len);
+			printf("  Salpha+Last bigbzip-compressed = %8lld bytes\n",(long long) cfused_len);
+			printf("  Pcdata bigbzip-compressed      = %8lld bytes\n\n",(long long) cpc_len);
 			break;
 
 		case LAST: // Last is compressed alone
 
-			// Prologue with dummy values for 6 integers on 4 bytes
-			init_buffer(*ctext, 7 * 4 + 10 * xbwtstr->lastLen);
-			for (i=0; i < 7; i++)
-				bbz_bit_write(32,0);
+			// Salpha and Pcdata are compressed by the jobs, while Last is encoded here
+			init_data_jobs(&jobs);
+			add_data_job(&jobs, xbwtstr->alphaStr, xbwtstr->alphaLen, &calpha, &calphalen, 0);
+			add_data_job(&jobs, xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpcdata, &cpcdatalen, 0);
+			start_data_jobs(&jobs);
 
-			// Encoding Slast by DELTA-code
+			// Encoding Slast by DELTA-code, after the space of the prologue
+			init_buffer(&bs,*ctext + plen, (int) min(*ctext_len - plen, 0x7FFFFFFF));
 			nbits_min = 0;
 			for(j=-1; j<xbwtstr->lastLen-1; ){
 			for(gap=1; (j+gap < xbwtstr->lastLen) && (xbwtstr->lastStr[j+gap] == 0); gap++) ;
 				gaplen = log2int(gap)+1;
 				loggaplen = log2int(gaplen)+1;
 				if(loggaplen > 1)
-					bbz_bit_write(loggaplen-1,0);
-				bbz_bit_write(loggaplen,gaplen);
-				bbz_bit_write(gaplen,gap);
+					bbz_bit_write(&bs,loggaplen-1,0);
+				bbz_bit_write(&bs,loggaplen,gaplen);
+				bbz_bit_write(&bs,gaplen,gap);
 				j += gap;
 				nbits_min += gaplen;
 			}
-			bbz_bit_flush();
+			bbz_bit_flush(&bs);
 
-			i = 7 * 4;
-			clastlen = get_buffer_fill() - i;
+			i = plen;
+			clastlen = get_buffer_fill(&bs);
 			i += clastlen;
 
-			// Encoding Salpha
-			data_compress(xbwtstr->alphaStr, xbwtstr->alphaLen, &calpha, &calphalen);	
+			wait_data_jobs(&jobs);
+
+			// Appending Salpha
 			memcpy(*ctext + i, calpha, calphalen);
 			i += calphalen;
+			free(calpha);
 
-			// Encoding Pcdata
-			data_compress(xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpcdata, &cpcdatalen);
+			// Appending Pcdata
 			memcpy(*ctext + i, cpcdata, cpcdatalen);
 			i += cpcdatalen;
+			free(cpcdata);
 
 			// Write Prologue with correct values
-			init_buffer(*ctext,50);
-			bbz_bit_write(32,xbwtstr->TextLength);
-			bbz_bit_write(32,xbwtstr->SItemsNum);
-			bbz_bit_write(32,xbwtstr->TagAttrItemsCard);
-			bbz_bit_write(32,xbwtstr->PcdataItems);
-			bbz_bit_write(32,clastlen);		
-			bbz_bit_write(32,calphalen);	
-			bbz_bit_write(32,cpcdatalen);	
+			xbwt_write_prologue(*ctext, xbwtstr, clastlen, calphalen, cpcdatalen);
 
 
 			*ctext_len = i;
-			realloc(*ctext, *ctext_len);
+			*ctext = realloc(*ctext, *ctext_len);
 
 			printf("\n\nCompression ratio over single pieces:\n");
-			printf("  Last   delta-compressed   = %8d bytes\n",clastlen);
-			printf("  Salpha bigbzip-compressed = %8d bytes\n",calphalen);
-			printf("  Pcdata bigbzip-compressed = %8d bytes\n\n",cpcdatalen);
+			printf("  Last   delta-compressed   = %8lld bytes\n",(long long) clastlen);
+			printf("  Salpha bigbzip-compressed = %8lld bytes\n",(long long) calphalen);
+			printf("  Pcdata bigbzip-compressed = %8lld bytes\n\n",(long long) cpcdatalen);
 			break;
 
 		case MTFMHUFF:  // We use MTF+MULTIHUFF (has RLE inside) over Salpha
 
 			if (xbwtstr->TagAttrItemsCard > 256)
 				fatal_error("Current version does not support #tag-attrs > 256. Sorry!");
+			if ((UInt64) xbwtstr->alphaLen * 2 > 0x7FFFFFFF)
+				fatal_error("MTFMHUFF supports Salpha up to 1Gb, choose another compression! (STR2COMPR)\n");
 
-			// Prologue with dummy values for 6 integers on 4 bytes
-			init_buffer(*ctext, 7 * 4 + 10 * xbwtstr->lastLen);
-			for (i=0; i < 7; i++)
-				bbz_bit_write(32,0);
-			i = 7 * 4;
-
-			data_compress(xbwtstr->lastStr, xbwtstr->lastLen, &clast, &clastlen);
-			memcpy(*ctext + i, clast, clastlen);
-			i += clastlen;
+			// Last and Pcdata are compressed by the jobs, while Salpha is encoded here
+			init_data_jobs(&jobs);
+			add_data_job(&jobs, xbwtstr->lastStr, xbwtstr->lastLen, &clast, &clastlen, 0);
+			add_data_job(&jobs, xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpcdata, &cpcdatalen, 0);
+			start_data_jobs(&jobs);
 
 			// Encoding Salpha
 			Ualpha  = (UChar *) malloc(sizeof(UChar) * xbwtstr->SItemsNum );
@@ -874,15 +1168,15 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 						(xbwtstr->alphaStr[k] != '=')) {
 							k++;
 						}
-				hn = HHashtable_search(xbwtstr->alphaStr + startb, k - startb, &ht);
-				if(!hn){
-					HHashtable_insert(xbwtstr->alphaStr + startb, k - startb, code++, &ht);
-					hn = HHashtable_search(xbwtstr->alphaStr + startb, k - startb, &ht);
+				// The codes are given by order of appearance, as the ids
+				id = HHashtable_intern((char *) xbwtstr->alphaStr + startb, k - startb, &ht);
+				if(id == code){
+					code++;
 					memcpy(calpha+AlfLen,xbwtstr->alphaStr + startb, k - startb);
 					AlfLen += k - startb;
 					} 
 
-				Ualpha[pos++]= (UChar) hn->code; //Salpha mapped to integer codes			
+				Ualpha[pos++]= (UChar) id; //Salpha mapped to integer codes			
 				}
 			calpha[AlfLen++] = '>';
 			if(pos != xbwtstr->SItemsNum)
@@ -893,75 +1187,72 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 			multihuf_compr(mtfc,xbwtstr->SItemsNum, calpha+AlfLen, &rest);
 
 			calphalen = rest+AlfLen;
+			HHashtable_clear(&ht);
+			free(Ualpha); free(mtfc);
+
+			wait_data_jobs(&jobs);
+
+			// Appending Last, Salpha and Pcdata
+			i = plen;
+			memcpy(*ctext + i, clast, clastlen);
+			i += clastlen;
+			free(clast);
+
 			memcpy(*ctext + i, calpha, calphalen);
 			i += calphalen;
+			free(calpha);
 
-			// Encoding Pcdata
-			data_compress(xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpcdata, &cpcdatalen);
 			memcpy(*ctext + i, cpcdata, cpcdatalen);
 			i += cpcdatalen;
+			free(cpcdata);
 
 			// Write Prologue with correct values
-			init_buffer(*ctext,50);
-			bbz_bit_write(32,xbwtstr->TextLength);
-			bbz_bit_write(32,xbwtstr->SItemsNum);
-			bbz_bit_write(32,xbwtstr->TagAttrItemsCard);
-			bbz_bit_write(32,xbwtstr->PcdataItems);
-			bbz_bit_write(32,clastlen);		
-			bbz_bit_write(32,calphalen);	
-			bbz_bit_write(32,cpcdatalen);	
+			xbwt_write_prologue(*ctext, xbwtstr, clastlen, calphalen, cpcdatalen);
 
 
 			*ctext_len = i;
-			realloc(*ctext, *ctext_len);
+			*ctext = realloc(*ctext, *ctext_len);
 
 			printf("\n\nCompression ratio over single pieces:\n");
-			printf("  Last bigbzip-compressed     = %8d bytes\n",clastlen);
-			printf("  Salpha MultiHuff-compressed = %8d bytes\n",calphalen);
-			printf("  Pcdata bigbzip-compressed   = %8d bytes\n\n",cpcdatalen);
+			printf("  Last bigbzip-compressed     = %8lld bytes\n",(long long) clastlen);
+			printf("  Salpha MultiHuff-compressed = %8lld bytes\n",(long long) calphalen);
+			printf("  Pcdata bigbzip-compressed   = %8lld bytes\n\n",(long long) cpcdatalen);
 			break;
 
 		case DISTINCT: // Last is compressed alone
 
-			// Prologue with dummy values for 7 integers on 4 bytes
-			init_buffer(*ctext, 7 * 4 + 10 * xbwtstr->lastLen);
-			for (i=0; i < 7; i++)
-				bbz_bit_write(32,0);
-
-			i = 7*4;
+			// Encoding Last, Salpha and Pcdata
+			init_data_jobs(&jobs);
+			add_data_job(&jobs, xbwtstr->lastStr, xbwtstr->lastLen, &clast, &clastlen, 0);
+			add_data_job(&jobs, xbwtstr->alphaStr, xbwtstr->alphaLen, &calpha, &calphalen, 0);
+			add_data_job(&jobs, xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpcdata, &cpcdatalen, 0);
+			start_data_jobs(&jobs);
+			wait_data_jobs(&jobs);
 
-			data_compress(xbwtstr->lastStr, xbwtstr->lastLen, &clast, &clastlen);	
+			i = plen;
 			memcpy(*ctext + i, clast, clastlen);
 			i += clastlen;
+			free(clast);
 
-			// Encoding Salpha
-			data_compress(xbwtstr->alphaStr, xbwtstr->alphaLen, &calpha, &calphalen);	
 			memcpy(*ctext + i, calpha, calphalen);
 			i += calphalen;
+			free(calpha);
 
-			// Encoding Pcdata
-			data_compress(xbwtstr->pcdataStr, xbwtstr->pcdataLen, &cpcdata, &cpcdatalen);
 			memcpy(*ctext + i, cpcdata, cpcdatalen);
 			i += cpcdatalen;
+			free(cpcdata);
 
 			// Write Prologue with correct values
-			init_buffer(*ctext,50);
-			bbz_bit_write(32,xbwtstr->TextLength);
-			bbz_bit_write(32,xbwtstr->SItemsNum);
-			bbz_bit_write(32,xbwtstr->TagAttrItemsCard);
-			bbz_bit_write(32,xbwtstr->PcdataItems);
-			bbz_bit_write(32,clastlen);		
-			bbz_bit_write(32,calphalen);	
-			bbz_bit_write(32,cpcdatalen);	
+			xbwt_write_prologue(*ctext, xbwtstr, clastlen, calphalen, cpcdatalen);
 
 
 			*ctext_len = i;
-			realloc(*ctext, *ctext_len);
+			*ctext = realloc(*ctext, *ctext_len);
 
 			printf("\n\nCompression ratio over single pieces:\n");
-			printf("  Last bigbzip-compressed   = %8d bytes\n",clastlen);
-			printf("  Salpha bigbzip-compressed = %8d bytes\n",calphalen);
-			printf("  Pcdata bigbzip-compressed = %8d bytes\n\n",cpcdatalen);
+			printf("  Last bigbzip-compressed   = %8lld bytes\n",(long long) clastlen);
+			printf("  Salpha bigbzip-compressed = %8lld bytes\n",(long long) calphalen);
+			printf("  Pcdata bigbzip-compressed = %8lld bytes\n\n",(long long) cpcdatalen);
 			break;
 	}
 
@@ -972,29 +1263,34 @@ void xbwtstr2compr(xbwt_string_type *xbwtstr, UChar *ctext[], int *ctext_len, UC
 		This procedure allocates the space for the XBWT_STRING data type
 	The semantic of the numbers depends on the type of chosen compression
 	--------------------------------------------------------------------------- */
-void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UChar flag)
+void compr2xbwtstr(UChar ctext[], TextInt ctext_len, xbwt_string_type *xbwtstr, UChar flag)
 {
 	char *strndup(const char *s, size_t n);
 	UChar *fused, *calpha, *Ualpha, *mtfc, **S;
-	int i, fused_len, cfused_len, cpc_len, mtfc_len;
-	int clastlen, calphalen, cpcdatalen, loggaplen, gaplen, gap;
-	int k, startb, code, rest;
+	TextInt i, fused_len, cfused_len, cpc_len;
+	TextInt clastlen, calphalen, cpcdatalen;
+	int loggaplen, gaplen, gap, plen, mtfc_len;
+	int k, startb, code, rest, len, *lex;
+	bit_stream_type bs;
+	data_jobs_type jobs;
+
+
+	xbwtstr->PartitionArray = NULL; // not stored in the compressed formats
+	xbwtstr->PartitionCount = 0;
+	xbwtstr->alphaCodes = NULL;		// only MTFMHUFF knows them
 
+	// The three lengths depend on the type of compression
+	plen = xbwt_read_prologue(ctext, ctext_len, xbwtstr, &clastlen, &calphalen, &cpcdatalen);
 
 	switch (flag) {
 
 		case PLAIN:
 
 			// Prologue
-			init_buffer(ctext,50);
-			xbwtstr->TextLength			= bbz_bit_read(32);
-			xbwtstr->SItemsNum			= bbz_bit_read(32);
-			xbwtstr->TagAttrItemsCard	= bbz_bit_read(32);
-			xbwtstr->PcdataItems		= bbz_bit_read(32);
-			xbwtstr->lastLen			= bbz_bit_read(32);		 
-			fused_len					= bbz_bit_read(32); // length of fused Salpha and Slast
-			xbwtstr->pcdataLen			= bbz_bit_read(32);	// correct uncompressed length	 	
-			i = 7 * 4; // 7 numbers on 4 bytes each
+			xbwtstr->lastLen			= clastlen;		 
+			fused_len					= calphalen;	// length of fused Salpha and Slast
+			xbwtstr->pcdataLen			= cpcdatalen;	// correct uncompressed length	 	
+			i = plen;
 			
 			// Allocate the space for the output arrays
 			unfuse_alpha_last(ctext+i, fused_len, 
@@ -1014,16 +1310,11 @@ void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UCha
 
 		case BIGBZIP:
 
-			init_buffer(ctext,50);
-			xbwtstr->TextLength			= bbz_bit_read(32);
-			xbwtstr->SItemsNum			= bbz_bit_read(32);
-			xbwtstr->TagAttrItemsCard	= bbz_bit_read(32);
-			xbwtstr->PcdataItems		= bbz_bit_read(32);
-			xbwtstr->lastLen			= bbz_bit_read(32); // UNcompressed length		 
-			cfused_len					= bbz_bit_read(32); // compressed length of fused	 
-			cpc_len						= bbz_bit_read(32);	// compressed length of Pcdata	 	
+			xbwtstr->lastLen			= clastlen;		// UNcompressed length		 
+			cfused_len					= calphalen;	// compressed length of fused	 
+			cpc_len						= cpcdatalen;	// compressed length of Pcdata	 	
 
-			i = 7 * 4;							// 7 numbers on 4 bytes each
+			i = plen;
 
 			// Decompress the fused arrays
 			data_decompress(ctext+i, cfused_len, &fused, &fused_len);
@@ -1032,6 +1323,7 @@ void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UCha
 			unfuse_alpha_last(fused, fused_len, 
 							&(xbwtstr->alphaStr), &(xbwtstr->lastStr), 
 							&(xbwtstr->alphaLen), &(xbwtstr->lastLen));
+			free(fused);
 
 			// Decompress Pcdata
 			i += cfused_len; 
@@ -1040,43 +1332,38 @@ void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UCha
 
 		case LAST: // Last is compressed alone
 
-			// Read the Prologue 
-			init_buffer(ctext,50);
-			xbwtstr->TextLength			= bbz_bit_read(32);
-			xbwtstr->SItemsNum			= bbz_bit_read(32);
-			xbwtstr->TagAttrItemsCard	= bbz_bit_read(32);
-			xbwtstr->PcdataItems		= bbz_bit_read(32);
-			clastlen					= bbz_bit_read(32);		
-			calphalen					= bbz_bit_read(32);	
-			cpcdatalen					= bbz_bit_read(32);	
+			// Salpha and Pcdata are decompressed by the jobs, while Last is decoded here
+			i = plen + clastlen;
+			init_data_jobs(&jobs);
+			add_data_job(&jobs, ctext + i, calphalen, &(xbwtstr->alphaStr), &(xbwtstr->alphaLen), 1);
+			add_data_job(&jobs, ctext + i + calphalen, cpcdatalen, &(xbwtstr->pcdataStr), &(xbwtstr->pcdataLen), 1);
+			start_data_jobs(&jobs);
 
 			// Decoding Slast by DELTA-code
+			init_buffer(&bs, ctext + plen, (int) min(clastlen, 0x7FFFFFFF));
 			xbwtstr->lastLen = xbwtstr->SItemsNum;
 			xbwtstr->lastStr = (UChar *) malloc(sizeof(UChar) * xbwtstr->lastLen);
 			if( !xbwtstr->lastStr ) 
 				fatal_error("\nError in allocating the Slast array! (COMPR2STR)\n");
 
 			for(i=0; i<xbwtstr->lastLen; ){
-				for(loggaplen=1; bbz_bit_read(1) == 0; loggaplen++) ;
+				for(loggaplen=1; bbz_bit_read(&bs,1) == 0; loggaplen++) ;
 				gaplen = (1<< (loggaplen - 1));
 				if (loggaplen>1)
-					gaplen += bbz_bit_read(loggaplen-1); 
-				gap = bbz_bit_read(gaplen);
+					gaplen += bbz_bit_read(&bs,loggaplen-1); 
+				gap = bbz_bit_read(&bs,gaplen);
 				for(; gap>1; gap--) xbwtstr->lastStr[i++]=0;
 				xbwtstr->lastStr[i++]=1;
 			} 			
-			bbz_byte_align();
+			bbz_byte_align(&bs);
 
-			i = get_buffer_fill();
+			i = plen + get_buffer_fill(&bs);
 
-			if (7 * 4 + clastlen != i)
+			if (plen + clastlen != i)
 				fatal_error("Error in reading the compressed last! (COMPR2STR)\n");
 
-			data_decompress(ctext + i, calphalen, &(xbwtstr->alphaStr), &(xbwtstr->alphaLen));
-			i += calphalen;
-			
-			data_decompress(ctext + i, cpcdatalen, &(xbwtstr->pcdataStr), &(xbwtstr->pcdataLen));
-			i += cpcdatalen;
+			wait_data_jobs(&jobs);
+			i += calphalen + cpcdatalen;
 
 			if(i != ctext_len)
 				fatal_error("Error in decompressing! (COMPR2STR)\n");
@@ -1085,20 +1372,15 @@ void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UCha
 
 		case MTFMHUFF:
 
-			// Read the Prologue 
-			init_buffer(ctext,50);
-			xbwtstr->TextLength			= bbz_bit_read(32);
-			xbwtstr->SItemsNum			= bbz_bit_read(32);
-			xbwtstr->TagAttrItemsCard	= bbz_bit_read(32);
-			xbwtstr->PcdataItems		= bbz_bit_read(32);
-			clastlen					= bbz_bit_read(32);		
-			calphalen					= bbz_bit_read(32);	
-			cpcdatalen					= bbz_bit_read(32);	
-
-			// Decompressing Slast
+			// Last and Pcdata are decompressed by the jobs, while Salpha is decoded here
+			if ((UInt64) xbwtstr->SItemsNum * 2 > 0x7FFFFFFF)
+				fatal_error("Too many items for MTFMHUFF! (COMPR2STR)\n");
 			xbwtstr->lastLen = xbwtstr->SItemsNum;
-			i = 7 * 4;
-			data_decompress(ctext + i, clastlen, &(xbwtstr->lastStr), &(xbwtstr->lastLen));
+			i = plen;
+			init_data_jobs(&jobs);
+			add_data_job(&jobs, ctext + i, clastlen, &(xbwtstr->lastStr), &(xbwtstr->lastLen), 1);
+			add_data_job(&jobs, ctext + i + clastlen + calphalen, cpcdatalen, &(xbwtstr->pcdataStr), &(xbwtstr->pcdataLen), 1);
+			start_data_jobs(&jobs);
 			i += clastlen;
 
 			// Decompressing Salpha
@@ -1145,18 +1427,32 @@ void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UCha
 			// oversized
 			xbwtstr->alphaStr  = (UChar *) malloc(sizeof(UChar) * xbwtstr->TextLength );
 			if( !xbwtstr->alphaStr ) fatal_error("\nError in creating Salpha! (compr2xbwt)\n");
+			xbwtstr->alphaCodes  = (int *) malloc(sizeof(int) * xbwtstr->SItemsNum );
+			lex  = (int *) malloc(sizeof(int) * (code + 1));
+			if( (!xbwtstr->alphaCodes) || (!lex) ) 
+				fatal_error("\nError in creating the Salpha codes! (compr2xbwt)\n");
+
+			// The codes of Ualpha are in order of appearance: 
+			// lex[] maps them to the lexicographic ones used by xbwt_unbuilder
+			S_lexcodes(S, code, lex);
 
 			// Create Salpha from Ualpha
 			for(k=0, startb=0; k < xbwtstr->SItemsNum; k++){
-				memcpy(xbwtstr->alphaStr + startb, S[(int)Ualpha[k]], strlen(S[(int)Ualpha[k]]));
-				startb += strlen(S[Ualpha[k]]);
+				if (Ualpha[k] >= code) 
+					fatal_error("Wrong code in Ualpha! (compr2xbwt)\n");
+				len = strlen((char *) S[Ualpha[k]]);
+				memcpy(xbwtstr->alphaStr + startb, S[Ualpha[k]], len);
+				startb += len;
+				xbwtstr->alphaCodes[k] = lex[Ualpha[k]];
 				}
 			xbwtstr->alphaLen = startb;
-			realloc(xbwtstr->alphaStr,xbwtstr->alphaLen);
+			xbwtstr->alphaStr = realloc(xbwtstr->alphaStr,xbwtstr->alphaLen);
 			i += calphalen;
 
-			// decompressing the Pcdata
-			data_decompress(ctext + i, cpcdatalen, &(xbwtstr->pcdataStr), &(xbwtstr->pcdataLen));
+			for(k=0; k < code; k++) free(S[k]);
+			free(S); free(Ualpha); free(mtfc); free(lex);
+
+			wait_data_jobs(&jobs);
 			i += cpcdatalen;
 
 			if(i != ctext_len)
@@ -1165,29 +1461,16 @@ void compr2xbwtstr(UChar ctext[], int ctext_len, xbwt_string_type *xbwtstr, UCha
 
 		case DISTINCT:
 
-			// Read the Prologue 
-			init_buffer(ctext,50);
-			xbwtstr->TextLength			= bbz_bit_read(32);
-			xbwtstr->SItemsNum			= bbz_bit_read(32);
-			xbwtstr->TagAttrItemsCard	= bbz_bit_read(32);
-			xbwtstr->PcdataItems		= bbz_bit_read(32);
-			clastlen					= bbz_bit_read(32);		
-			calphalen					= bbz_bit_read(32);	
-			cpcdatalen					= bbz_bit_read(32);	
-
-			// Decompressing Slast
+			// Decompressing Slast, Salpha and Pcdata
 			xbwtstr->lastLen = xbwtstr->SItemsNum;
-			i = 7 * 4;
-			data_decompress(ctext + i, clastlen, &(xbwtstr->lastStr), &(xbwtstr->lastLen));
-			i += clastlen;
-
-			// Decompressing Salpha
-			data_decompress(ctext + i, calphalen, &(xbwtstr->alphaStr), &(xbwtstr->alphaLen));
-			i += calphalen;
-
-			// decompressing the Pcdata
-			data_decompress(ctext + i, cpcdatalen, &(xbwtstr->pcdataStr), &(xbwtstr->pcdataLen));
-			i += cpcdatalen;
+			i = plen;
+			init_data_jobs(&jobs);
+			add_data_job(&jobs, ctext + i, clastlen, &(xbwtstr->lastStr), &(xbwtstr->lastLen), 1);
+			add_data_job(&jobs, ctext + i + clastlen, calphalen, &(xbwtstr->alphaStr), &(xbwtstr->alphaLen), 1);
+			add_data_job(&jobs, ctext + i + clastlen + calphalen, cpcdatalen, &(xbwtstr->pcdataStr), &(xbwtstr->pcdataLen), 1);
+			start_data_jobs(&jobs);
+			wait_data_jobs(&jobs);
+			i += clastlen + calphalen + cpcdatalen;
 
 			if(i != ctext_len)
 				fatal_error("Error in decompressing! (COMPR2STR)\n");
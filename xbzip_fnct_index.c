@@ -48,9 +48,6 @@ The index is subdivided into three main components:
 /* ------------- To manage includes and data-type definitions ---------- */
 #include "xbzip.h"
 
-// Brute-force solution to compute the partition of the PCitem array
-int *PartitionArray, PartitionCount; 
-
 
 /* ----------------------------------------------------------------------------
 	Procedure xbzip_index()
@@ -68,24 +65,19 @@ void xbzip_index(UChar text[], int text_len, UChar *disk[], int *disk_len)
 	xbwt_type xbwt;
 	xbwt_string_type xbwtstr;
 	xbwt_index_type index;
+	xbzip_context_type ctx;
 	int t;
 
 	printf("\n\n------- TIMINGS ----------\n");
+	xbzip_context_init(&ctx);
 
-	// Compute the XBWT
+	// Compute the XBWT, together with the partition of the Pcdata items
 	printf("xbwt building\n");
 	__START_TIMER__;
-	xbwt_builder(text, text_len, &xbwt);
+	xbwt_builder(&ctx, text, text_len, &xbwt);
 	__END_TIMER__;
 	printf("...overall building took %.4f seconds\n\n", tot_partial_timer);
 
-	// Compute the Partition of the PI-array
-	printf("xbwt partitioning (starting from scratch...bad!!)\n");
-	__START_TIMER__;
-	xbwt_partition(text, text_len);
-	__END_TIMER__;
-	printf("...overall partitioning took %.4f seconds\n\n", tot_partial_timer);
-
 	// Serialize the XBWT data into three strings and some infos
 	// The strings are: Slast, Salpha, and the Pcdata
 	printf("xbwt serialization\n");
@@ -110,26 +102,37 @@ void xbzip_index(UChar text[], int text_len, UChar *disk[], int *disk_len)
 	if (Verbose) print_index(&index);
 
 	printf("\n\n--------------- XBWT INFOS ---------------\n\n");
-	printf("Text of total length %d bytes\n\n",xbwt.TextLength);
-	printf("XML tree consists of %d nodes and leaves\n\n", xbwt.SItemsNum);
+	printf("Text of total length %lld bytes\n\n",(long long) xbwt.TextLength);
+	printf("XML tree consists of %lld nodes and leaves\n\n", (long long) xbwt.SItemsNum);
 	printf("TAG and ATTR names:\n");
-	printf("\tnumber %15d\n",xbwt.TagAttrItemsTot);
+	printf("\tnumber %15lld\n",(long long) xbwt.TagAttrItemsTot);
 	printf("\tdistinct %13d\n",xbwt.TagAttrItemsCard);
-	printf("\tlength %15d bytes\n\n",xbwt.SalphaTotLen);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt.SalphaTotLen);
 	printf("PCDATA entries:\n");
-	printf("\tnumber %15d\n",xbwt.PcdataItems);
-	printf("\tblocks %15d\n",PartitionCount);
-	printf("\tlength %15d bytes\n\n",xbwt.PcdataTotLen);
+	printf("\tnumber %15lld\n",(long long) xbwt.PcdataItems);
+	printf("\tblocks %15lld\n",(long long) xbwt.PartitionCount);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt.PcdataTotLen);
 	printf("INDEX information:\n"); 
-	printf("\tLast index   = %9d bytes, #blocks = %6d\n", index.LastIndexLen, index.LastNumBlocks); 
-	printf("\tAlpha index  = %9d bytes, #blocks = %6d\n", index.AlphaIndexLen, index.AlphaNumBlocks); 
+	if (index.LastType == LAST_BITVECTOR)
+		printf("\tLast index   = %9d bytes, bitvector\n", 4 * ((index.SItemsNum + 31) / 32)); 
+	else
+		printf("\tLast index   = %9d bytes, #blocks = %6d\n", index.LastIndexLen, index.LastNumBlocks); 
+	if (index.AlphaType == ALPHA_WAVELET)
+		printf("\tAlpha index  = %9d bytes, wavelet matrix with %d levels\n", 
+				4 * index.AlphaWM.Levels * ((index.SItemsNum + 31) / 32), index.AlphaWM.Levels); 
+	else
+		printf("\tAlpha index  = %9d bytes, #blocks = %6d\n", index.AlphaIndexLen, index.AlphaNumBlocks); 
 	printf("\tPcdata index = %9d bytes, #blocks = %6d\n", index.PcdataIndexLen, index.PcNumBlocks); 
 	printf("\tF index      = %9d bytes, #items  = %6d\n", sizeof(int) * index.AlphabetCard, index.AlphabetCard); 
 	printf("\tAlphabet     = %9d bytes, #items  = %6d\n", index.AlphabetLen, index.AlphabetCard);
 
-	// Taken from index2disk()
-	t = 11 + 2*(index.LastNumBlocks+index.PcNumBlocks) + index.AlphaNumBlocks + index.AlphabetCard*(index.AlphaNumBlocks+1);
-	printf("..plus a set of %d integers over 4 bytes (offsets and positions).\n\n",t); 
+	// The rest of the file written by index2disk()
+	t = *disk_len - index.PcdataIndexLen - sizeof(int) * index.AlphabetCard - index.AlphabetLen;
+	t -= (index.LastType == LAST_BITVECTOR) ? 4 * ((index.SItemsNum + 31) / 32) : index.LastIndexLen;
+	t -= (index.AlphaType == ALPHA_WAVELET) ? 4 * index.AlphaWM.Levels * ((index.SItemsNum + 31) / 32) : index.AlphaIndexLen;
+	printf("..plus %d bytes of header, offsets, counts, directories and padding.\n\n",t); 
+
+	xbzip_context_free(&ctx);
 }
 
 
@@ -145,12 +148,35 @@ void xbzip_index(UChar text[], int text_len, UChar *disk[], int *disk_len)
 	---------------------------------------------------------------------- */
 void xbzip_deindex(UChar *disk, int disk_len, UChar *text[], int *text_len)
 {
+	xbzip_sink_type sink;
+	TextInt len;
+
+	sink_init_mem(&sink, 0); // sized by xbwt_unbuilder
+	xbzip_deindex_sink(disk, disk_len, &sink);
+	sink_close(&sink);
+	sink_take_mem(&sink, text, &len);
+	*text_len = len;	// the index is limited to int lengths
+}
+
+
+/* ----------------------------------------------------------------------
+	Procedure xbzip_deindex_sink()
+
+	As xbzip_deindex(), the text being given to the sink (see 
+	xbzip_sink.c) while it is reconstructed. The sink is flushed,
+	not closed. Returns the length of the text given to the sink.
+	---------------------------------------------------------------------- */
+TextInt xbzip_deindex_sink(UChar *disk, int disk_len, xbzip_sink_type *sink)
+{
+	TextInt start = sink->Written + sink->Fill;	// the sink may be in use
 	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
 	xbwt_type xbwt;
 	xbwt_string_type xbwtstr;
 	xbwt_index_type index;
+	xbzip_context_type ctx;
 
 	printf("\n\n------- TIMINGS ----------\n");
+	xbzip_context_init(&ctx);
 
 	// Loading the serialized index into its proper data type
 	printf("\nindex loading\n");
@@ -165,18 +191,19 @@ void xbzip_deindex(UChar *disk, int disk_len, UChar *text[], int *text_len)
 	index2xbwtstr(&index, &xbwtstr);
 	__END_TIMER__;
 	printf("...overall deserialization took %.4f seconds\n\n", tot_partial_timer);
+	free_block_cache(&index);
 
 	// Deserialize the XBWT data		
 	printf("xbwt building\n");
 	__START_TIMER__;
-	xbwtstr2xbwt(&xbwtstr, &xbwt);
+	xbwtstr2xbwt(&ctx, &xbwtstr, &xbwt);
 	__END_TIMER__;
 	printf("...overall xbwt-building took %.4f seconds\n\n", tot_partial_timer);
 
 	// Reconstruct the XML text
 	printf("\ntext reconstruction\n");
 	__START_TIMER__;
-	xbwt_unbuilder(&xbwt, text, text_len);
+	xbwt_unbuilder(&ctx, &xbwt, sink);
 	__END_TIMER__;
 	printf("...overall reconstruction took %.4f seconds\n\n", tot_partial_timer);
 
@@ -185,20 +212,31 @@ void xbzip_deindex(UChar *disk, int disk_len, UChar *text[], int *text_len)
 	if (Verbose) print_index(&index);
 
 	printf("\n\n--------------- XBWT INFOS ---------------\n\n");
-	printf("Text of total length %d bytes\n\n",xbwt.TextLength);
-	printf("XML tree consists of %d nodes and leaves\n\n", xbwt.SItemsNum);
+	printf("Text of total length %lld bytes\n\n",(long long) xbwt.TextLength);
+	printf("XML tree consists of %lld nodes and leaves\n\n", (long long) xbwt.SItemsNum);
 	printf("TAG and ATTR names:\n");
-	printf("\tnumber %15d\n",xbwt.TagAttrItemsTot);
+	printf("\tnumber %15lld\n",(long long) xbwt.TagAttrItemsTot);
 	printf("\tdistinct %13d\n",xbwt.TagAttrItemsCard);
-	printf("\tlength %15d bytes\n\n",xbwt.SalphaTotLen);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt.SalphaTotLen);
 	printf("PCDATA entries:\n");
-	printf("\tnumber %15d\n",xbwt.PcdataItems);
-	printf("\tlength %15d bytes\n\n",xbwt.PcdataTotLen);
+	printf("\tnumber %15lld\n",(long long) xbwt.PcdataItems);
+	printf("\tlength %15lld bytes\n\n",(long long) xbwt.PcdataTotLen);
 	printf("INDEX information:\n"); 
-	printf("\tLast index   = %9d bytes, #blocks = %6d\n", index.LastIndexLen, index.LastNumBlocks); 
-	printf("\tAlpha index  = %9d bytes, #blocks = %6d\n", index.AlphaIndexLen, index.AlphaNumBlocks); 
+	if (index.LastType == LAST_BITVECTOR)
+		printf("\tLast index   = %9d bytes, bitvector\n", 4 * ((index.SItemsNum + 31) / 32)); 
+	else
+		printf("\tLast index   = %9d bytes, #blocks = %6d\n", index.LastIndexLen, index.LastNumBlocks); 
+	if (index.AlphaType == ALPHA_WAVELET)
+		printf("\tAlpha index  = %9d bytes, wavelet matrix with %d levels\n", 
+				4 * index.AlphaWM.Levels * ((index.SItemsNum + 31) / 32), index.AlphaWM.Levels); 
+	else
+		printf("\tAlpha index  = %9d bytes, #blocks = %6d\n", index.AlphaIndexLen, index.AlphaNumBlocks); 
 	printf("\tPcdata index = %9d bytes, #blocks = %6d\n", index.PcdataIndexLen, index.PcNumBlocks); 
 	printf("\tF index      = %9d bytes, #items  = %6d\n", sizeof(int) * index.AlphabetCard, index.AlphabetCard); 
+
+	free(xbwtstr.lastStr); free(xbwtstr.alphaStr); free(xbwtstr.pcdataStr); free(xbwtstr.alphaCodes);
+	xbzip_context_free(&ctx);
+	return sink->Written + sink->Fill - start;
 }
 
 
@@ -210,15 +248,14 @@ void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index)
 {
 	char *strndup(const char *s, size_t n);	
 	double end_partial_timer, start_partial_timer, tot_partial_timer; // time usage
-	int count_ones, i, j, clastlen, aa, error;
-	int k, tot_symb_len, startb, start_alpha_byte, index_offset, calphalen;
-	int start_last_index, start_last_byte;
-	UChar **S, *calpha, *clast;
+	int count_ones, i, j, aa, samp;
+	int k, tot_symb_len, startb, start_alpha_byte;
+	int start_last_byte;
+	UChar **S;
 	HHash_table ht;
 	Hash_node *hn;
-	int *GlobalPrefixCounts, current_block, skip, textcode;	
-	ulong fmindex_len; // for the FM-index
-	void *fmindex;     // for the FM-index
+	int *GlobalPrefixCounts, current_block, skip, textcode, *codes;	
+	index_jobs_type jobs;	// the blocks to be compressed, possibly by many threads
 
 
 	// Copy these two fields
@@ -226,68 +263,77 @@ void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index)
 	index->SItemsNum = xbwtstr->SItemsNum;
 	index->PcdataNum = xbwtstr->PcdataItems;
 
-	// Oversize the LastIndex data structures, then we will resize it
-	index->LastNumBlocks = floor(xbwtstr->SItemsNum / NUM1_IN_BLOCK) + 3;
-	index->LastIndexLen = max(100000, 2 * xbwtstr->SItemsNum);
-	index->LastIndex = (UChar *) malloc(sizeof(UChar) * index->LastIndexLen);
-	index->LastOffsetBlocks = (int *) malloc(sizeof(int) * index->LastNumBlocks);
-	index->LastPosBlocks = (int *) malloc(sizeof(int) * index->LastNumBlocks);
-
-	// Prepare for writing
-	__START_TIMER__;
-
-	// Encoding Slast by DELTA-code in blocks containing NUM1_IN_BLOCK 1s
-	// LastPosBlocks[] is the starting position of each block
-	// The last block is empty and its first position delimits Last (useful for scanning)
-	current_block=0;
-	count_ones = 1;
-	start_last_byte = 0;
-	start_last_index = 0;
-
-	// -1 to ensure a non-empty last block
-	for(j=0; j < xbwtstr->lastLen - 1; ){
-
-		// Set the block infos, j points to Last[pos]=1 finishing the block
-		if ((count_ones % NUM1_IN_BLOCK == 0) && ( j!=0 )){
-
-			compress_block(xbwtstr->lastStr + start_last_byte, j - start_last_byte + 1, &clast, &clastlen);
-			memcpy(index->LastIndex + start_last_index, clast, clastlen);
-			free(clast);
-
-			index->LastPosBlocks[current_block] = start_last_byte; // first position in Last of the block 
-			index->LastOffsetBlocks[current_block] = start_last_index; // first byte position of the compr-block
+	// Slast is either a plain bitvector or a sequence of compressed blocks
+	index->LastType = LAST_TYPE;
+	if (index->LastType == LAST_BITVECTOR) {
+		__START_TIMER__;
+		bitvector_init(&index->LastBV, xbwtstr->lastLen);
+		for(j=0; j < xbwtstr->lastLen; j++)
+			if (xbwtstr->lastStr[j] != 0) BV_SET(&index->LastBV, j);
+		bitvector_build(&index->LastBV);
+
+		// No compressed blocks in this representation
+		index->LastIndex = NULL;
+		index->LastIndexLen = 0;
+		index->LastOffsetBlocks = NULL;
+		index->LastPosBlocks = NULL;
+		index->LastNumBlocks = 0;
+		__END_TIMER__;
+		printf("  built the Last bitvector in %.4f seconds\n", tot_partial_timer);
+	} else {
+		// Oversize the LastIndex data structures
+		index->LastNumBlocks = floor(xbwtstr->SItemsNum / NUM1_IN_BLOCK) + 3;
+		index->LastOffsetBlocks = (int *) malloc(sizeof(int) * index->LastNumBlocks);
+		index->LastPosBlocks = (int *) malloc(sizeof(int) * index->LastNumBlocks);
+
+		// Prepare for writing
+		__START_TIMER__;
+
+		// Encoding Slast by DELTA-code in blocks containing NUM1_IN_BLOCK 1s
+		// LastPosBlocks[] is the starting position of each block
+		// The last block is empty and its first position delimits Last (useful for scanning)
+		current_block=0;
+		count_ones = 1;
+		start_last_byte = 0;
+		init_index_jobs(&jobs, index->LastNumBlocks);
+
+		// -1 to ensure a non-empty last block
+		for(j=0; j < xbwtstr->lastLen - 1; ){
+
+			// Set the block infos, j points to Last[pos]=1 finishing the block
+			if ((count_ones % NUM1_IN_BLOCK == 0) && ( j!=0 )){
+
+				add_index_job(&jobs, xbwtstr->lastStr + start_last_byte, j - start_last_byte + 1, INDEX_JOB_BLOCK);
+				index->LastPosBlocks[current_block] = start_last_byte; // first position in Last of the block 
+
+				current_block++;
+				start_last_byte = j+1; // points to the first char of the next block
+				}
 
-			current_block++;
-			start_last_byte = j+1; // points to the first char of the next block
-			start_last_index += clastlen;
+			// find a sequence (0^*)1, increment 'count_ones'
+			j++; // move to the next run
+			for(; (j < xbwtstr->lastLen) && (xbwtstr->lastStr[j] == 0); j++) ;
+			count_ones++;
 			}
 
-		// find a sequence (0^*)1, increment 'count_ones'
-		j++; // move to the next run
-		for(; (j < xbwtstr->lastLen) && (xbwtstr->lastStr[j] == 0); j++) ;
-		count_ones++;
-		}
-
-	// We set the ending block, it is guaranteed to be not empty 
-	compress_block(xbwtstr->lastStr + start_last_byte, j - start_last_byte + 1, &clast, &clastlen);
-	memcpy(index->LastIndex + start_last_index, clast, clastlen);
-	free(clast);
+		// We set the ending block, it is guaranteed to be not empty 
+		add_index_job(&jobs, xbwtstr->lastStr + start_last_byte, j - start_last_byte + 1, INDEX_JOB_BLOCK);
+		index->LastPosBlocks[current_block] = start_last_byte; // first position in Last of this block 
+		current_block++;
 
-	index->LastPosBlocks[current_block] = start_last_byte; // first position in Last of this block 
-	index->LastOffsetBlocks[current_block] = start_last_index; // first byte position of the compr-block
-	start_last_index += clastlen;
-	current_block++;
+		// Compress the blocks, then LastOffsetBlocks[] is the first byte of each compr-block
+		run_index_jobs(&jobs);
+		index->LastIndexLen = layout_index_jobs(&jobs, &index->LastIndex, index->LastOffsetBlocks);
+		free_index_jobs(&jobs);
 
-	// We set a dummy block 
-	index->LastIndexLen = start_last_index;
-	index->LastNumBlocks = current_block+1; // correct value (last is empty)
-	index->LastPosBlocks[current_block] = index->SItemsNum; // out of Last
-	index->LastOffsetBlocks[current_block] = index->LastIndexLen; // dummy first byte position 
+		// We set a dummy block 
+		index->LastNumBlocks = current_block+1; // correct value (last is empty)
+		index->LastPosBlocks[current_block] = index->SItemsNum; // out of Last
+		index->LastOffsetBlocks[current_block] = index->LastIndexLen; // dummy first byte position 
 
-	realloc(index->LastIndex,index->LastIndexLen);
-
-	__END_TIMER__;
-	printf("  compressed the Last index in %.4f seconds\n", tot_partial_timer);
+		__END_TIMER__;
+		printf("  compressed the Last index in %.4f seconds\n", tot_partial_timer);
+	}
 
 	// Lexicographic encode the TAG and ATTR names, and the symbol =
 	// TagAttrCard = # distinct TAG-ATTRS names (plain letters terminated by \0)
@@ -338,105 +384,134 @@ void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index)
 	__END_TIMER__;
 	printf("  compressed the Alphabet in %.4f seconds\n", tot_partial_timer);
 
-	// Compute the index infos for the Alpha array
-	// everything is ovsersized, then we resize them correctly
-	// NOTE: The last compressed block of Alpha is empty, only OffsetBlocks is initialized
-	__START_TIMER__;
-	index->AlphaNumBlocks = floor(xbwtstr->SItemsNum / BLOCK_ALPHA_LEN) + 3;
-	index->AlphaPrefixCounts = (int *) malloc(sizeof(int) * (index->AlphaNumBlocks * index->AlphabetCard));
-	index->AlphaOffsetBlocks = (int *) malloc(sizeof(int) * index->AlphaNumBlocks);
-	index->AlphaIndexLen = max(xbwtstr->TextLength,10000); 
-	index->AlphaIndex = (UChar *) malloc(sizeof(UChar) * (index->AlphaIndexLen) );
-
-
-	// We estimate the PrefixCounts counting at the **END** of each block
+	// GlobalPrefixCounts[c] counts the occurrences of c in Salpha (used for F)
 	GlobalPrefixCounts = (int *) malloc(sizeof(int) * index->AlphabetCard);
 	for(i=0; i < index->AlphabetCard; i++)
 		GlobalPrefixCounts[i] = 0;
 
-	current_block = 0;
-	start_alpha_byte = 0;
-	index_offset = 0;
-
-	// REMIND: Our PrefixCounts count till the **END** of each block
-	// k moves over the bytes in Salpha
-	// j moves over the items in Salpha
-	// startb is the starting byte of an item in Salpha
-	for(startb=0,j=0; startb < xbwtstr->alphaLen; ){
-		k=startb+1; // next byte of an item
-		while ( (k < xbwtstr->alphaLen) && (xbwtstr->alphaStr[k] != '@') &&
-				(xbwtstr->alphaStr[k] != '<') && (xbwtstr->alphaStr[k] != '=')) {
-					k++;
+	// Salpha is either a wavelet matrix of the symbol codes or a sequence of compressed blocks
+	index->AlphaType = ALPHA_TYPE;
+	if (index->AlphaType == ALPHA_WAVELET) {
+		__START_TIMER__;
+		codes = (int *) malloc(sizeof(int) * xbwtstr->SItemsNum);
+		if (!codes) fatal_error("Error in allocating the Alpha codes! (XBWTSTR2INDEX)\n");
+
+		for(startb=0,j=0; startb < xbwtstr->alphaLen; j++){
+			k=startb+1; // next byte of an item
+			while ( (k < xbwtstr->alphaLen) && (xbwtstr->alphaStr[k] != '@') &&
+					(xbwtstr->alphaStr[k] != '<') && (xbwtstr->alphaStr[k] != '=')) {
+						k++;
+					}
+			hn=HHashtable_search((char *) xbwtstr->alphaStr + startb, k - startb, &ht);
+			GlobalPrefixCounts[hn->code]++;
+			codes[j] = hn->code;
+			startb = k;
+		}
+		if (j != xbwtstr->SItemsNum)
+			fatal_error("Error in counting the Alpha items! (XBWTSTR2INDEX)\n");
+
+		wavelet_build(&index->AlphaWM, codes, j, index->AlphabetCard);
+		free(codes);
+		set_alphabet_start(index);
+
+		// No compressed blocks in this representation
+		index->AlphaIndex = NULL;
+		index->AlphaIndexLen = 0;
+		index->AlphaOffsetBlocks = NULL;
+		index->AlphaPrefixCounts = NULL;
+		index->AlphaNumBlocks = 0;
+		__END_TIMER__;
+		printf("  built the Alpha wavelet matrix in %.4f seconds\n", tot_partial_timer);
+	} else {
+		set_alphabet_start(index);
+
+		// Compute the index infos for the Alpha array
+		// everything is ovsersized, then we resize them correctly
+		// NOTE: The last compressed block of Alpha is empty, only OffsetBlocks is initialized
+		__START_TIMER__;
+		index->AlphaNumBlocks = floor(xbwtstr->SItemsNum / BLOCK_ALPHA_LEN) + 3;
+		index->AlphaPrefixCounts = (int *) malloc(sizeof(int) * (index->AlphaNumBlocks * index->AlphabetCard));
+		index->AlphaOffsetBlocks = (int *) malloc(sizeof(int) * index->AlphaNumBlocks);
+
+
+		current_block = 0;
+		start_alpha_byte = 0;
+		init_index_jobs(&jobs, index->AlphaNumBlocks);
+
+		// REMIND: Our PrefixCounts count till the **END** of each block
+		// k moves over the bytes in Salpha
+		// j moves over the items in Salpha
+		// startb is the starting byte of an item in Salpha
+		for(startb=0,j=0; startb < xbwtstr->alphaLen; ){
+			k=startb+1; // next byte of an item
+			while ( (k < xbwtstr->alphaLen) && (xbwtstr->alphaStr[k] != '@') &&
+					(xbwtstr->alphaStr[k] != '<') && (xbwtstr->alphaStr[k] != '=')) {
+						k++;
+					}
+			hn=HHashtable_search((char *) xbwtstr->alphaStr + startb, k - startb, &ht);
+			GlobalPrefixCounts[hn->code]++; // increase the prefix counting of this item  
+			j++;							// new item
+
+			if (j % BLOCK_ALPHA_LEN == 0){
+				for(i=0; i < index->AlphabetCard; i++)
+					index->AlphaPrefixCounts[current_block * index->AlphabetCard + i] = GlobalPrefixCounts[i];
+
+				// Compress the block via a stream compressor
+				add_index_job(&jobs, xbwtstr->alphaStr + start_alpha_byte, k - start_alpha_byte, INDEX_JOB_BLOCK);
+				start_alpha_byte = k;
+				current_block++;
 				}
-		hn=HHashtable_search(xbwtstr->alphaStr + startb, k - startb, &ht);
-		GlobalPrefixCounts[hn->code]++; // increase the prefix counting of this item  
-		j++;							// new item
 
-		if (j % BLOCK_ALPHA_LEN == 0){
+			startb = k;							// stating position of the next item (if any)
+		}
+
+		// Constructing the last block of Salpha 
+		if(start_alpha_byte != k) {	// if symbols are pending
 			for(i=0; i < index->AlphabetCard; i++)
 				index->AlphaPrefixCounts[current_block * index->AlphabetCard + i] = GlobalPrefixCounts[i];
 
 			// Compress the block via a stream compressor
-			compress_block(xbwtstr->alphaStr + start_alpha_byte, k - start_alpha_byte, 
-				&calpha, &calphalen);
-			if (index_offset + calphalen > index->AlphaIndexLen)
-				fatal_error("Index size for Salpha is too small! (XBWTSTR2INDEX)\n");
-
-			memcpy(index->AlphaIndex + index_offset, calpha, calphalen);
-			free(calpha);
-
-			index->AlphaOffsetBlocks[current_block] = index_offset;
-			index_offset += calphalen;
-			start_alpha_byte = k;
+			add_index_job(&jobs, xbwtstr->alphaStr + start_alpha_byte, k - start_alpha_byte, INDEX_JOB_BLOCK);
 			current_block++;
-			}
+		}
 
-		startb = k;							// stating position of the next item (if any)
-	}
+		if (index->AlphaNumBlocks <= current_block)
+			fatal_error("Out of bounds in the alpha index creation! (XBWTSTR2INDEX)\n");
 
-	// Constructing the last block of Salpha 
-	if(start_alpha_byte != k) {	// if symbols are pending
+		// Compress the blocks, AlphaOffsetBlocks[] is the first byte of each one
+		run_index_jobs(&jobs);
+		index->AlphaIndexLen = layout_index_jobs(&jobs, &index->AlphaIndex, index->AlphaOffsetBlocks);
+		free_index_jobs(&jobs);
+
+		// Append a dummy (empty) block to facilitate the scanning ops,
+		// its prefix counts are set too: the index is then fully determined
 		for(i=0; i < index->AlphabetCard; i++)
 			index->AlphaPrefixCounts[current_block * index->AlphabetCard + i] = GlobalPrefixCounts[i];
-
-		// Compress the block via a stream compressor
-		compress_block(xbwtstr->alphaStr + start_alpha_byte, k - start_alpha_byte, 
-			&calpha, &calphalen);	
-		memcpy(index->AlphaIndex + index_offset, calpha, calphalen);
-		free(calpha);
-
-		index->AlphaOffsetBlocks[current_block++] = index_offset;
-		index_offset += calphalen;
+		index->AlphaOffsetBlocks[current_block++] = index->AlphaIndexLen;
+		index->AlphaNumBlocks = current_block; // +1 of correct value
+
+		// Resize the data structure for the Alpha array
+		index->AlphaOffsetBlocks = realloc(index->AlphaOffsetBlocks, sizeof(int) * index->AlphaNumBlocks);
+		index->AlphaPrefixCounts = realloc(index->AlphaPrefixCounts, sizeof(int) * index->AlphaNumBlocks * index->AlphabetCard);
+		__END_TIMER__;
+		printf("  compressed the Alpha index in %.4f seconds\n", tot_partial_timer);
 	}
 
-	// Append a dummy (empty) block to facilitate the scanning ops
-	index->AlphaOffsetBlocks[current_block++] = index_offset;
-
-
-	if( (index->AlphaNumBlocks < current_block) || (index->AlphaIndexLen < index_offset))
-		fatal_error("Out of bounds in the alpha index creation! (XBWTSTR2INDEX)\n");
-
-	index->AlphaNumBlocks = current_block; // +1 of correct value
-	index->AlphaIndexLen = index_offset;
-
-	// Resize the data structure for the Alpha array
-	realloc(index->AlphaIndex,index->AlphaIndexLen);
-	realloc(index->AlphaOffsetBlocks, sizeof(int) * index->AlphaNumBlocks);
-	realloc(index->AlphaPrefixCounts, sizeof(int) * index->AlphaNumBlocks * index->AlphabetCard);
-	__END_TIMER__;
-	printf("  compressed the Alpha index in %.4f seconds\n", tot_partial_timer);
-
 
 	// Pcdata (one index per block of Pcdata items)
 	__START_TIMER__;
-	index->PcNumBlocks = PartitionCount; // from procedure xbwt_partition() 
+	index->PcNumBlocks = xbwtstr->PartitionCount; // from procedure xbwt_builder() 
 	index->PcOffsetBlocks = (int *) malloc(sizeof(int) * (index->PcNumBlocks) );
 	index->PcBlockItems = (int *) malloc(sizeof(int) * (index->PcNumBlocks) );
 
+	// Every PcSampleRate-th item of a block has its starting byte sampled,
+	// but the first one which starts at byte 1 (the block starts with \0)
+	index->PcSampleRate = PC_ITEM_SAMPLE_RATE;
+	index->PcItemSamples = (int *) malloc(sizeof(int) * 
+		(xbwtstr->PcdataItems / index->PcSampleRate + index->PcNumBlocks + 1) );
+	if ((!index->PcOffsetBlocks) || (!index->PcBlockItems) || (!index->PcItemSamples))
+		fatal_error("Error in allocating the Pcdata blocks! (XBWTSTR2INDEX)\n");
 
-	// Oversized, then we resize it
-	index->PcdataIndexLen = max(xbwtstr->TextLength, 10000); 
-	index->PcdataIndex = (UChar *) malloc(sizeof(UChar) * (index->PcdataIndexLen) );
 
 	// Recall that Pcdata is prefixed by \0
 	// startb is the starting byte of an item in Pcdata
@@ -444,49 +519,42 @@ void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index)
 	// k moves over the single Pcdata item	
 
 	// Check the partition	
-	for(i=0,aa=0; i < PartitionCount; i++)
-		aa += PartitionArray[i];
+	for(i=0,aa=0; i < xbwtstr->PartitionCount; i++)
+		aa += xbwtstr->PartitionArray[i];
 	if(aa != xbwtstr->PcdataItems){
-		printf("#partitioned = %d, #items = %d\n",aa,xbwtstr->PcdataItems);
-		fatal_error("Error in the partitioning! (xbwt_partition)\n");
+		printf("#partitioned = %d, #items = %lld\n",aa,(long long) xbwtstr->PcdataItems);
+		fatal_error("Error in the partitioning! (XBWTSTR2INDEX)\n");
 		}
-	for(startb=0, j=0, index_offset=0; startb < xbwtstr->pcdataLen; j++){
-		index->PcOffsetBlocks[j] = index_offset; 
-		index->PcBlockItems[j] = PartitionArray[j];  
+	init_index_jobs(&jobs, index->PcNumBlocks);
+	for(startb=0, j=0, samp=0; startb < xbwtstr->pcdataLen; j++){
+		index->PcBlockItems[j] = xbwtstr->PartitionArray[j];  
 
 		// Identify the set of Pcdata items to index-compress together
 		for(i=0, k=startb; i < index->PcBlockItems[j]; i++) {
+			if ((i > 0) && (i % index->PcSampleRate == 0))
+				index->PcItemSamples[samp++] = k + 1 - startb;
 			k++; // first byte is \0
 			while ( (k < xbwtstr->pcdataLen) && (xbwtstr->pcdataStr[k] != '\0') ) k++;
 		}
 
 		// (Index and) compress together, k lies over a \0
-		// -a 2 -f 0 -b 1024
-		error = build_index(xbwtstr->pcdataStr+startb, (ulong)(k - startb), "-a 2 -f 0.005 -b 2048 -B 32", &fmindex);
-		IFERROR(error);
-		error=index_size(fmindex, &fmindex_len);
-		IFERROR(error);
-		error = save_index_mem(fmindex, index->PcdataIndex + index_offset); 
-		IFERROR(error);
-		error = free_index(fmindex);
-		IFERROR(error);
-
-		index_offset += (int)fmindex_len;
-		if (index_offset > index->PcdataIndexLen)
-			fatal_error("Writing the Pcdata index out of bounds!\n");
+		add_index_job(&jobs, xbwtstr->pcdataStr+startb, k - startb, INDEX_JOB_FMINDEX);
 
 		startb = k;
 	}
 	    printf("hereMM\n");
-	// Set the correct byte length of the compressed blocks
-	index->PcdataIndexLen = index_offset;
 
 	// Set the correct number of Pcdata blocks
-	if (j != PartitionCount) 
+	if (j != xbwtstr->PartitionCount) 
 		fatal_error("Error in compressing the Pcdata blocks! (XBWTSTR2INDEX)\n");
 
-	// Resize the overestimated memory
-	realloc(index->PcdataIndex, index->PcdataIndexLen );
+	// Build the FM-indexes, PcOffsetBlocks[] is the first byte of each one
+	run_index_jobs(&jobs);
+	index->PcdataIndexLen = layout_index_jobs(&jobs, &index->PcdataIndex, index->PcOffsetBlocks);
+	free_index_jobs(&jobs);
+
+	index->PcSamplesNum = samp;
+	index->PcItemSamples = realloc(index->PcItemSamples, sizeof(int) * (samp + 1));
 
 	__END_TIMER__;
 	printf("  compressed the Pcdata index in %.4f seconds\n", tot_partial_timer);
@@ -519,6 +587,7 @@ void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index)
 	__END_TIMER__;
 	printf("  created the F index %.4f seconds\n\n", tot_partial_timer);
 
+	init_block_cache(index, BLOCK_CACHE_SIZE);
 }
 
 
@@ -527,10 +596,11 @@ void xbwtstr2index(xbwt_string_type *xbwtstr, xbwt_index_type *index)
 	--------------------------------------------------------------------------- */
 void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 {
-	int i, j, cursor, error;
-	UChar *alphablock, *pcdata, *lastblock;
-	int alphablocklen, startb, lastblocklen;
+	int i, j, cursor, error, eq, c;
+	UChar *block, *pcdata, *symb;
+	int alphablocklen, startb, blocklen, blocksize;
 	unsigned long pcdatalen;
+	bigbzip_ctx bbz;   // the blocks are decoded into 'block'
 	ulong block_len; 
 	void *fmindex;     // for the FM-index
 
@@ -538,6 +608,9 @@ void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 	xbwtstr->TextLength = index->TextLength;
 	xbwtstr->SItemsNum = index->SItemsNum;
 	xbwtstr->TagAttrItemsCard = index->AlphabetCard -1; // minus symbol =
+	xbwtstr->PartitionArray = NULL; // the blocks are in index->PcBlockItems
+	xbwtstr->PartitionCount = 0;
+	xbwtstr->alphaCodes = NULL;		// only the wavelet matrix stores them
 
 	// Reconstruct Last array
 	xbwtstr->lastLen = xbwtstr->SItemsNum;
@@ -545,16 +618,23 @@ void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 	if (!xbwtstr->lastStr)
 		fatal_error("Error in allocating Last array! (INDEX2STR)\n");
 
-	// The last one is dummy
+	// Plain bitvector
+	if (index->LastType == LAST_BITVECTOR)
+		for(i=0; i < xbwtstr->lastLen; i++)
+			xbwtstr->lastStr[i] = BV_GET(&index->LastBV, i);
+
+	// The last one is dummy (no blocks for the bitvector)
+	bigbzip_ctx_init(&bbz);
+	block = NULL;
+	blocksize = 0;
 	for(i=0; i < index->LastNumBlocks - 1; i++) {
-		decompress_block(index->LastIndex + index->LastOffsetBlocks[i],
+		decompress_block(&bbz, index->LastIndex + index->LastOffsetBlocks[i],
 			index->LastOffsetBlocks[i+1]-index->LastOffsetBlocks[i], 
-			&lastblock, &lastblocklen);
-		memcpy(xbwtstr->lastStr + index->LastPosBlocks[i], lastblock, lastblocklen);
-		free(lastblock);
-
-		if (index->LastPosBlocks[i+1] - index->LastPosBlocks[i] != lastblocklen)
+			&block, &blocksize, &blocklen);
+		if (index->LastPosBlocks[i+1] - index->LastPosBlocks[i] != blocklen)
 			fatal_error("Error in decompressing a block of Last! (INDEX2XBWTSTR)\n");
+
+		memcpy(xbwtstr->lastStr + index->LastPosBlocks[i], block, blocklen);
 		}
 
 	// Alpha array: oversized, then we will resize it
@@ -573,18 +653,42 @@ void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 		startb = index->AlphaOffsetBlocks[i]; 
 
 		// We use a generic stream compressor for compression
-		decompress_block(index->AlphaIndex+startb, 
+		decompress_block(&bbz, index->AlphaIndex+startb, 
 			index->AlphaOffsetBlocks[i+1] - index->AlphaOffsetBlocks[i],
-			&alphablock, &alphablocklen);
-		memcpy(xbwtstr->alphaStr+cursor,alphablock,alphablocklen);
-		free(alphablock);
+			&block, &blocksize, &alphablocklen);
+		if (alphablocklen > xbwtstr->alphaLen - cursor)
+			fatal_error("Error in decompressing a block of Alpha! (INDEX2XBWTSTR)\n");
+		memcpy(xbwtstr->alphaStr+cursor,block,alphablocklen);
 
 		cursor += alphablocklen;
 	}
+	if (block) free(block);
+	bigbzip_ctx_free(&bbz);
+
+	// Wavelet matrix: one symbol per row (no blocks), its code is
+	// lexicographic in the Alphabet which includes the symbol =
+	if (index->AlphaType == ALPHA_WAVELET) {
+		xbwtstr->alphaCodes = (int *) malloc(sizeof(int) * index->SItemsNum);
+		if (!xbwtstr->alphaCodes)
+			fatal_error("Error in allocating the Alpha codes! (INDEX2STR)\n");
+		for(eq=0; (eq < index->AlphabetCard) && 
+				  (index->Alphabet[index->AlphabetStart[eq]] != '='); eq++) ;
+		for(i=0; i < index->SItemsNum; i++){
+			c = wavelet_access(&index->AlphaWM, i);
+			if ((c < 0) || (c >= index->AlphabetCard))
+				fatal_error("Error in decoding the wavelet matrix! (INDEX2XBWTSTR)\n");
+			symb = index->Alphabet + index->AlphabetStart[c];
+			if ((int) strlen((char *) symb) > xbwtstr->alphaLen - cursor)
+				fatal_error("Error in decoding the wavelet matrix! (INDEX2XBWTSTR)\n");
+			memcpy(xbwtstr->alphaStr + cursor, symb, strlen((char *) symb));
+			cursor += strlen((char *) symb);
+			xbwtstr->alphaCodes[i] = (c < eq) ? c : ((c == eq) ? -1 : c - 1);
+			}
+		}
 
 	// Reset the infos and resize the data structure
 	xbwtstr->alphaLen = cursor;
-	realloc(xbwtstr->alphaStr,	xbwtstr->alphaLen);
+	xbwtstr->alphaStr = realloc(xbwtstr->alphaStr,	xbwtstr->alphaLen);
 
 	// Pcdata: indexing and compression per group of items having same S_pi
 	xbwtstr->PcdataItems = index->PcdataNum; 
@@ -606,7 +710,7 @@ void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 		IFERROR(error);
 		error = extract(fmindex, 0, block_len-1, &pcdata, &pcdatalen);		
 		IFERROR(error);
-		if (block_len != pcdatalen)
+		if ((block_len != pcdatalen) || (pcdatalen > (unsigned long) (xbwtstr->pcdataLen - i)))
 			fatal_error("Error in decompressing the FM-indexed block!");
 		error = free_index(fmindex);
 		IFERROR(error);		
@@ -626,7 +730,7 @@ void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 	IFERROR(error);
 	error = extract(fmindex, 0, block_len-1, &pcdata, &pcdatalen);		
 	IFERROR(error);
-	if (block_len != pcdatalen)
+	if ((block_len != pcdatalen) || (pcdatalen > (unsigned long) (xbwtstr->pcdataLen - i)))
 		fatal_error("Error in decompressing the FM-indexed block!");
 	error = free_index(fmindex);
 	IFERROR(error);		
@@ -645,24 +749,24 @@ void index2xbwtstr(xbwt_index_type *index, xbwt_string_type *xbwtstr)
 	--------------------------------------------------------------------------- */
 int rank1_last(xbwt_index_type *index, int pos)
 {
-	int start, blockNum, blockLen, diff, rank;
+	int blockNum, blockLen, diff, rank;
 	UChar *blockStr;
 
 	if( (pos < 0) || (pos >= index->SItemsNum) )
 		fatal_error("Out-of-bound rank required on Last array! (RANK1)\n");
 
+	if (index->LastType == LAST_BITVECTOR)
+		return bitvector_rank1(&index->LastBV, pos + 1);
+
 	// Compute the block of the input position
 	for(blockNum=0; index->LastPosBlocks[blockNum+1] <= pos; blockNum++) ;
 
-	// Prepare for decoding the block
-	start = index->LastOffsetBlocks[blockNum]; 
-	decompress_block(index->LastIndex+start, 
-		index->LastOffsetBlocks[blockNum+1] - index->LastOffsetBlocks[blockNum], 
-		&blockStr, &blockLen);
+	// Fetch the decoded block (possibly from the cache)
+	blockStr = get_cached_block(index, LAST_STREAM, blockNum, &blockLen);
 
 	// Relative 'pos' within the current block	
 	diff = pos - index->LastPosBlocks[blockNum];
-	if(diff > blockLen)
+	if(diff >= blockLen)
 		fatal_error("Error in accessing a Last block for Rank1!\n");
 
 	// Decoding the Last block containing the 'pos'
@@ -676,7 +780,6 @@ int rank1_last(xbwt_index_type *index, int pos)
 	Last_Block_Counter++;
 	Last_Byte_Counter += index->LastPosBlocks[blockNum+1] - index->LastPosBlocks[blockNum] + 1;
 
-	free(blockStr);
 	return rank;
 }
 
@@ -687,9 +790,12 @@ int rank1_last(xbwt_index_type *index, int pos)
 	--------------------------------------------------------------------------- */
 int select1_last(xbwt_index_type *index, int rank)
 {
-	int start, blockNum, diffrank, pos, blockLen;
+	int blockNum, diffrank, pos, blockLen;
 	UChar *blockStr;
 
+	if (index->LastType == LAST_BITVECTOR)
+		return bitvector_select(&index->LastBV, rank, 1);
+
 	// Compute the block of the input rank, and the relative rank
 	blockNum = floor((rank - 1) / NUM1_IN_BLOCK);
 	diffrank = ((rank-1) % NUM1_IN_BLOCK) + 1;
@@ -697,11 +803,8 @@ int select1_last(xbwt_index_type *index, int rank)
 	if( (rank <= 0) || (blockNum >= index->LastNumBlocks-1) )
 		fatal_error("Out-of-bound select required on Last array! (SELECT1)\n");
 
-	// Prepare for decoding the block
-	start = index->LastOffsetBlocks[blockNum]; 
-	decompress_block(index->LastIndex+start, 
-		index->LastOffsetBlocks[blockNum+1] - index->LastOffsetBlocks[blockNum], 
-		&blockStr, &blockLen);
+	// Fetch the decoded block (possibly from the cache)
+	blockStr = get_cached_block(index, LAST_STREAM, blockNum, &blockLen);
 
 	// Initial position of the block
 	pos = -1;
@@ -717,8 +820,6 @@ int select1_last(xbwt_index_type *index, int rank)
 	Last_Block_Counter++;
 	Last_Byte_Counter += index->LastPosBlocks[blockNum+1] - index->LastPosBlocks[blockNum] + 1;
 
-	free(blockStr);
-
 	// pos is relative to the blockNum-th block of Last
 	return (pos + index->LastPosBlocks[blockNum]); 
 }
@@ -740,19 +841,23 @@ int selectSymb_alpha(xbwt_index_type *index, UChar *q, int rank)
 	// Rank within the sorted alphabet string
 	symb_code = get_symbol_code(index,q);
 
+	if (index->AlphaType == ALPHA_WAVELET) {
+		if (rank > wavelet_rank(&index->AlphaWM, symb_code, index->SItemsNum))
+			fatal_error("Out-of-bound select required on Alpha array! (SELECT_ALPHA)\n");
+		return wavelet_select(&index->AlphaWM, symb_code, rank);
+		}
+
 	// Compute the block containing the searched symbol
-	// Remind that AlphaPrefixCounts[] counts till the block's end
-	for(block=0; (block < index->AlphaNumBlocks) && 
+	// Remind that AlphaPrefixCounts[] counts till the block's end (the last is dummy)
+	for(block=0; (block < index->AlphaNumBlocks - 1) && 
 				 (rank > index->AlphaPrefixCounts[block * index->AlphabetCard + symb_code]); 
 		block++) ;
 
-	if( (block < 0) || (block >= index->AlphaNumBlocks) ) 
+	if( (block < 0) || (block >= index->AlphaNumBlocks - 1) ) 
 		fatal_error("Out-of-bound select required on Alpha array! (SELECT_ALPHA)\n");
 
-	// Decode the Alpha's block
-	start = index->AlphaOffsetBlocks[block]; 
-	decompress_block(index->AlphaIndex+start, 
-			index->AlphaOffsetBlocks[block+1] - index->AlphaOffsetBlocks[block], &alphablock, &alphablocklen);
+	// Fetch the decoded Alpha's block (possibly from the cache)
+	alphablock = get_cached_block(index, ALPHA_STREAM, block, &alphablocklen);
 
 	// Statistics
 	Alpha_Block_Counter++;
@@ -795,7 +900,6 @@ int selectSymb_alpha(xbwt_index_type *index, UChar *q, int rank)
 			fatal_error("Error in determining the pos! (SELECT_ALPHA)\n");
 	}
 
-	free(alphablock);
 	return -1;
 }
 
@@ -817,6 +921,9 @@ int rankSymb_alpha(xbwt_index_type *index, UChar *q, int pos)
 	// Rank within the sorted alphabet string
 	symb_code = get_symbol_code(index,q);
 
+	if (index->AlphaType == ALPHA_WAVELET)
+		return wavelet_rank(&index->AlphaWM, symb_code, pos + 1);
+
 	// Compute the block containing the searched position
 	block = floor(pos / BLOCK_ALPHA_LEN);
 	diffpos = pos % BLOCK_ALPHA_LEN;
@@ -826,10 +933,8 @@ int rankSymb_alpha(xbwt_index_type *index, UChar *q, int pos)
 	if (block > 0)
 		rank += index->AlphaPrefixCounts[(block-1) * index->AlphabetCard + symb_code]; 
 
-	// Decoding the block
-	start = index->AlphaOffsetBlocks[block]; 
-	decompress_block(index->AlphaIndex+start, index->AlphaOffsetBlocks[block+1] - index->AlphaOffsetBlocks[block],
-						&alphablock, &alphablocklen);
+	// Fetch the decoded block (possibly from the cache)
+	alphablock = get_cached_block(index, ALPHA_STREAM, block, &alphablocklen);
 
 	// Statistics
 	Alpha_Block_Counter++;
@@ -858,168 +963,432 @@ int rankSymb_alpha(xbwt_index_type *index, UChar *q, int pos)
 		diffpos--;
 	}	
 
-	free(alphablock);
-
 	return rank;
 }
 
 
 /* --------------------------------------------------------------------------------
 	Returns the code of the symbol q within the sorted Alphabet		
-		Alphabet is lexicographically sorted with terminating \0 per each string
+		Alphabet is lexicographically sorted with terminating \0 per each string,
+		hence q is binary searched through the offsets in AlphabetStart
 	------------------------------------------------------------------------------- */
 
 int get_symbol_code(xbwt_index_type *index, UChar *q)
 {
-	int len,k,start;
+	int low, high, k, cmp;
 
-	for(k=0,start=0; k < index->AlphabetCard; k++){
-
-		// Computes the length of the next symbol
-		len = strlen(index->Alphabet+start);
+	for(low=0, high=index->AlphabetCard-1; low <= high; ){
+		k = (low + high) / 2;
 
-		// Compare it against the input 'q'
-		if ( !(strcmp(q, index->Alphabet+start)) )
+		// Compare the k-th symbol against the input 'q' (as S_cmp does)
+		cmp = strcmp((char *) q, (char *) index->Alphabet + index->AlphabetStart[k]);
+		if (cmp == 0)
 			return k;
 
-		// Sets the starting byte of the next symbol
-		start += len+1;
+		if (cmp < 0) high = k - 1;
+		else low = k + 1;
 		}
 
 	fatal_error("Symbol not found in alphabet! (SELECT_ALPHA)\n");
 	return -1;
 }
 
+/* --------------------------------------------------------------------------------
+	Computes the starting byte in Alphabet of each symbol code		
+	------------------------------------------------------------------------------- */
+void set_alphabet_start(xbwt_index_type *index)
+{
+	int k,start;
+
+	index->AlphabetStart = (int *) malloc(sizeof(int) * index->AlphabetCard);
+	if (!index->AlphabetStart)
+		fatal_error("Error in allocating the alphabet offsets! (SET_ALPHABET_START)\n");
+
+	for(k=0,start=0; k < index->AlphabetCard; k++){
+		index->AlphabetStart[k] = start;
+		start += strlen((char *) index->Alphabet+start) + 1;
+		}
+}
+
 /* ----------------------------------------------------------------------------
-	Serialization of the index data type 
+	Lists the arrays of the index in the order of the sections of an index
+		file: field[s] is the address of the pointer to the s-th array and
+		len[s] its length in bytes, which is computed only if len != NULL
+		(i.e. when the index is complete). Arrays not used by the current
+		representation of Last/Alpha are listed with length 0.
+		Returns the number of sections.
+	--------------------------------------------------------------------------- */
+#define ADD_SECTION(p,bytes)	{ field[n] = (void **) &(p); if (len) len[n] = (bytes); n++; }
+
+int index_sections(xbwt_index_type *index, void **field[], int len[])
+{
+	int n, l, bv, wm;
+
+	n = 0;
+	bv = (index->LastType == LAST_BITVECTOR);
+	wm = (index->AlphaType == ALPHA_WAVELET);
+
+	ADD_SECTION(index->LastOffsetBlocks, sizeof(int) * index->LastNumBlocks);
+	ADD_SECTION(index->LastPosBlocks, sizeof(int) * index->LastNumBlocks);
+	n = bitvector_sections(&index->LastBV, bv, field, len, n);
+
+	ADD_SECTION(index->AlphaOffsetBlocks, sizeof(int) * index->AlphaNumBlocks);
+	ADD_SECTION(index->AlphaPrefixCounts, sizeof(int) * index->AlphaNumBlocks * index->AlphabetCard);
+	ADD_SECTION(index->AlphaWM.Zeros, wm ? sizeof(int) * index->AlphaWM.Levels : 0);
+	if (wm)
+		for(l=0; l < index->AlphaWM.Levels; l++)
+			n = bitvector_sections(&index->AlphaWM.Level[l], 1, field, len, n);
+
+	ADD_SECTION(index->PcOffsetBlocks, sizeof(int) * index->PcNumBlocks);
+	ADD_SECTION(index->PcBlockItems, sizeof(int) * index->PcNumBlocks);
+	ADD_SECTION(index->F, sizeof(int) * index->AlphabetCard);
+	ADD_SECTION(index->AlphabetStart, wm ? sizeof(int) * index->AlphabetCard : 0);
+
+	ADD_SECTION(index->LastIndex, index->LastIndexLen);
+	ADD_SECTION(index->AlphaIndex, index->AlphaIndexLen);
+	ADD_SECTION(index->PcdataIndex, index->PcdataIndexLen);
+	ADD_SECTION(index->Alphabet, index->AlphabetLen);
+	ADD_SECTION(index->PcItemSamples, sizeof(int) * index->PcSamplesNum);
+
+	return n;
+}
+
+/* ----------------------------------------------------------------------------
+	Appends to the list of index_sections() the four arrays of a bitvector,
+		the directories included, with length 0 if the bitvector is unused
+	--------------------------------------------------------------------------- */
+int bitvector_sections(bitvector_type *bv, int on, void **field[], int len[], int n)
+{
+	int size[4] = {0, 0, 0, 0};
+
+	if (len && on)
+		bitvector_sizes(bv, size);
+
+	ADD_SECTION(bv->Bits, size[0]);
+	ADD_SECTION(bv->RankSuper, size[1]);
+	ADD_SECTION(bv->Select1Samples, size[2]);
+	ADD_SECTION(bv->Select0Samples, size[3]);
+
+	return n;
+}
+
+#undef ADD_SECTION
+
+/* ----------------------------------------------------------------------------
+	Serialization of the index data type: the header, the section table,
+		and then each array of the index at an 8-byte aligned offset
 	--------------------------------------------------------------------------- */
 void index2disk(xbwt_index_type *index, UChar *disk[], int *disk_len)
 {
-	int cursor, i, j;
+	void **field[XBZI_MAX_SECTIONS];
+	int len[XBZI_MAX_SECTIONS];
+	int n, s, cursor;
+	xbzi_header header;
+	xbzi_section *table;
+
+	n = index_sections(index, field, len);
+
+	cursor = XBZI_ALIGN(sizeof(xbzi_header) + n * sizeof(xbzi_section));
+	for(s=0; s < n; s++)
+		cursor = XBZI_ALIGN(cursor + len[s]);
+	*disk_len = cursor;
 
-	*disk_len = (7 + 2 * index->LastNumBlocks + 2 + index->AlphaNumBlocks + (index->AlphabetCard) * (index->AlphaNumBlocks) +
-		2 + 2 * index->PcNumBlocks + index->AlphabetCard ) * sizeof(int) + index->LastIndexLen + 
-		index->AlphaIndexLen + index->AlphabetLen + index->PcdataIndexLen;
-	*disk = (UChar *) malloc(sizeof(UChar) * (*disk_len) );
+	// The padding bytes are zeroed
+	*disk = (UChar *) calloc(*disk_len, sizeof(UChar));
 	if (! (*disk) )
 		fatal_error("Error in serializing the index! (INDEX2DISK)\n");
 
+	memset(&header, 0, sizeof(xbzi_header));
+	memcpy(header.Magic, XBZI_MAGIC, 4);
+	header.Version = XBZI_VERSION;
+	header.ByteOrder = XBZI_BYTE_ORDER;
+	header.TextLength = index->TextLength;
+	header.SItemsNum = index->SItemsNum;
+	header.PcdataNum = index->PcdataNum;
+	header.AlphabetLen = index->AlphabetLen;
+	header.AlphabetCard = index->AlphabetCard;
+	header.LastType = index->LastType;
+	header.LastIndexLen = index->LastIndexLen;
+	header.LastNumBlocks = index->LastNumBlocks;
+	header.AlphaType = index->AlphaType;
+	header.AlphaIndexLen = index->AlphaIndexLen;
+	header.AlphaNumBlocks = index->AlphaNumBlocks;
+	header.AlphaLevels = (index->AlphaType == ALPHA_WAVELET) ? index->AlphaWM.Levels : 0;
+	header.PcdataIndexLen = index->PcdataIndexLen;
+	header.PcNumBlocks = index->PcNumBlocks;
+	header.SectionsNum = n;
+	header.PcSampleRate = index->PcSampleRate;
+	header.PcSamplesNum = index->PcSamplesNum;
+	header.LastBlockOnes = NUM1_IN_BLOCK;
+	header.AlphaBlockLen = BLOCK_ALPHA_LEN;
+	memcpy(*disk, &header, sizeof(xbzi_header));
 
 	// Variable 'cursor' is used for checking and correct byte offsets
-	init_buffer(*disk,*disk_len); 	cursor = 0;
+	table = (xbzi_section *) (*disk + sizeof(xbzi_header));
+	cursor = XBZI_ALIGN(sizeof(xbzi_header) + n * sizeof(xbzi_section));
+	for(s=0; s < n; s++){
+		table[s].Offset = cursor;
+		table[s].Length = len[s];
+		if (len[s] > 0)
+			memcpy(*disk + cursor, *field[s], len[s]);
+		cursor = XBZI_ALIGN(cursor + len[s]);
+		}
 
-	bbz_bit_write(32,index->TextLength); cursor += sizeof(int);
-	bbz_bit_write(32,index->SItemsNum); cursor += sizeof(int);
-	bbz_bit_write(32,index->PcdataNum); cursor += sizeof(int);
-	bbz_bit_write(32,index->AlphabetLen); cursor += sizeof(int);
-	bbz_bit_write(32,index->AlphabetCard); cursor += sizeof(int);
+	if( cursor != *disk_len)
+		fatal_error("Error in writing the index on disk! (INDEX2DISK)\n");
 
-	// Write the infos about Last
-	bbz_bit_write(32,index->LastIndexLen); cursor += sizeof(int);
-	bbz_bit_write(32,index->LastNumBlocks); cursor += sizeof(int);
+}
 
-	for(i=0; i < index->LastNumBlocks; i++){
-		bbz_bit_write(32,index->LastOffsetBlocks[i]);
-		cursor += sizeof(int);
-		}
-	for(i=0; i < index->LastNumBlocks; i++){
-		bbz_bit_write(32,index->LastPosBlocks[i]);	
-		cursor += sizeof(int);
-		}
 
-	if( cursor > *disk_len)
-		fatal_error("Error *LAST* in writing the index on disk! (INDEX2DISK)\n");
+/* ----------------------------------------------------------------------------
+	Deserialization of the index data type: files in the current layout
+		are used in place, the old ones are decoded. Index files are 
+		limited to 2Gb
+	--------------------------------------------------------------------------- */
+void disk2index(UChar *disk, TextInt disk_len, xbwt_index_type *index)
+{
+
+	if ((disk_len < 0) || ((UInt64) disk_len > 0x7FFFFFFF))
+		fatal_error("The index supports files up to 2Gb! (DISK2INDEX)\n");
 
-	// Write the infos about Alpha
-	bbz_bit_write(32,index->AlphaNumBlocks); cursor += sizeof(int);
-	bbz_bit_write(32,index->AlphaIndexLen); cursor += sizeof(int);
+	if (((UInt64) disk_len >= XBZI_HEADER_V2_LEN) && (memcmp(disk, XBZI_MAGIC, 4) == 0))
+		disk2index_v2(disk, (int) disk_len, index);
+	else
+		disk2index_v1(disk, (int) disk_len, index);
 
-	for(i=0; i < index->AlphaNumBlocks; i++){
-		bbz_bit_write(32,index->AlphaOffsetBlocks[i]);
-		cursor += sizeof(int);
+	// The offsets of the symbols are stored with the wavelet matrix only
+	if (!index->AlphabetStart)
+		set_alphabet_start(index);
+
+	init_block_cache(index, BLOCK_CACHE_SIZE);
+
+}
+
+
+/* ----------------------------------------------------------------------------
+	Loads an index file of version 2 in constant time: the arrays of the
+		index point into 'disk', which must stay available (and 8-byte
+		aligned, as mmap() returns it) while the index is in use.
+		Only the small array of the levels of a wavelet matrix is allocated.
+	--------------------------------------------------------------------------- */
+void disk2index_v2(UChar *disk, int disk_len, xbwt_index_type *index)
+{
+	void **field[XBZI_MAX_SECTIONS];
+	int len[XBZI_MAX_SECTIONS];
+	int n, s, l, header_len;
+	xbzi_header *header;
+	xbzi_section *table;
+
+	if (((size_t) disk) % 8)
+		fatal_error("The index must be loaded at an 8-byte aligned address! (DISK2INDEX)\n");
+	if (disk_len < 0)
+		fatal_error("Error in reading the index from disk! (DISK2INDEX)\n");
+
+	header = (xbzi_header *) disk;
+	if ((header->Version < 2) || (header->Version > XBZI_VERSION))
+		fatal_error("Unsupported version of the index file! (DISK2INDEX)\n");
+	if (header->ByteOrder != XBZI_BYTE_ORDER)
+		fatal_error("The index file was written on a machine of different endianness! (DISK2INDEX)\n");
+
+	if (header->Version == 2) header_len = XBZI_HEADER_V2_LEN;
+	else if (header->Version == 3) header_len = XBZI_HEADER_V3_LEN;
+	else header_len = sizeof(xbzi_header);
+	if ((UInt64) disk_len < (UInt64) header_len)
+		fatal_error("Error in reading the index from disk! (DISK2INDEX)\n");
+
+	index->TextLength = header->TextLength;
+	index->SItemsNum = header->SItemsNum;
+	index->PcdataNum = header->PcdataNum;
+	index->AlphabetLen = header->AlphabetLen;
+	index->AlphabetCard = header->AlphabetCard;
+	index->LastType = header->LastType;
+	index->LastIndexLen = header->LastIndexLen;
+	index->LastNumBlocks = header->LastNumBlocks;
+	index->AlphaType = header->AlphaType;
+	index->AlphaIndexLen = header->AlphaIndexLen;
+	index->AlphaNumBlocks = header->AlphaNumBlocks;
+	index->PcdataIndexLen = header->PcdataIndexLen;
+	index->PcNumBlocks = header->PcNumBlocks;
+
+	// Files of version 2 have no samples of the Pcdata items
+	if (header->Version == 2) {
+		index->PcSampleRate = 0;
+		index->PcSamplesNum = 0;
+	} else {
+		index->PcSampleRate = header->PcSampleRate;
+		index->PcSamplesNum = header->PcSamplesNum;
+		if (index->PcSampleRate <= 0)
+			fatal_error("Error *PC* in reading the index from disk! (DISK2INDEX)\n");
 		}
-	for(i=0; i < index->AlphaNumBlocks; i++){
-		for(j=0; j < index->AlphabetCard; j++){
-			bbz_bit_write(32,index->AlphaPrefixCounts[i*index->AlphabetCard+j]);  
-			cursor += sizeof(int);
-			}
+
+	if ((index->LastType != LAST_COMPRESSED) && (index->LastType != LAST_BITVECTOR))
+		fatal_error("Unknown representation of Last in the index! (DISK2INDEX)\n");
+	if ((index->AlphaType != ALPHA_COMPRESSED) && (index->AlphaType != ALPHA_WAVELET))
+		fatal_error("Unknown representation of Alpha in the index! (DISK2INDEX)\n");
+
+	// The compressed blocks are decoded with the parameters of the build
+	if (header->Version >= 4) {
+		if ((index->LastType == LAST_COMPRESSED) && (header->LastBlockOnes != NUM1_IN_BLOCK))
+			fatal_error("The index was built with another #1 in a Last-block (option -l)! (DISK2INDEX)\n");
+		if ((index->AlphaType == ALPHA_COMPRESSED) && (header->AlphaBlockLen != BLOCK_ALPHA_LEN))
+			fatal_error("The index was built with another Salpha-block size (option -a)! (DISK2INDEX)\n");
 		}
 
-	if( cursor > *disk_len)
-		fatal_error("Error *ALPHA* in writing the index on disk! (INDEX2DISK)\n");
+	// The counts bound the size of the sections (checked below), so the 
+	// products computed by index_sections() cannot overflow
+	if ((index->TextLength < 0) || (index->SItemsNum <= 0) || (index->SItemsNum > 0x7FFFFFE0) ||
+		(index->PcdataNum < 0) || (index->AlphabetLen <= 0) || (index->AlphabetCard <= 0) ||
+		(index->LastIndexLen < 0) || (index->LastNumBlocks < 0) || 
+		(index->AlphaIndexLen < 0) || (index->AlphaNumBlocks < 0) ||
+		(index->PcdataIndexLen < 0) || (index->PcNumBlocks <= 0) || (index->PcSamplesNum < 0) ||
+		((UInt64) index->LastNumBlocks * sizeof(int) > (UInt64) disk_len) ||
+		((UInt64) index->AlphaNumBlocks * index->AlphabetCard * sizeof(int) > (UInt64) disk_len) ||
+		((UInt64) index->PcNumBlocks * sizeof(int) > (UInt64) disk_len) ||
+		((UInt64) index->AlphabetCard * sizeof(int) > (UInt64) disk_len) ||
+		((UInt64) index->PcSamplesNum * sizeof(int) > (UInt64) disk_len))
+		fatal_error("Error in the header of the index! (DISK2INDEX)\n");
+
+	if (index->AlphaType == ALPHA_WAVELET) {
+		index->AlphaWM.Len = index->SItemsNum;
+		index->AlphaWM.Levels = header->AlphaLevels;
+		if ((index->AlphaWM.Levels <= 0) || (index->AlphaWM.Levels > 31))
+			fatal_error("Error *ALPHA* in reading the index from disk! (DISK2INDEX)\n");
+		index->AlphaWM.Level = (bitvector_type *) malloc(sizeof(bitvector_type) * index->AlphaWM.Levels);
+		if (!index->AlphaWM.Level)
+			fatal_error("Error in allocating the wavelet matrix! (DISK2INDEX)\n");
+		}
 
-	// Write the infos about Pcdata
-	bbz_bit_write(32,index->PcdataIndexLen); cursor += sizeof(int);
-	bbz_bit_write(32,index->PcNumBlocks); cursor += sizeof(int);
-	for(i=0; i < index->PcNumBlocks; i++){
-		bbz_bit_write(32,index->PcOffsetBlocks[i]);
-		cursor += sizeof(int);
+	// Points every array into its section (the last one is missing in version 2)
+	n = index_sections(index, field, NULL);
+	index->PcItemSamples = NULL;
+	if (header->Version == 2) n--;
+	if ((n != header->SectionsNum) || 
+		((UInt64) header_len + (UInt64) n * sizeof(xbzi_section) > (UInt64) disk_len))
+		fatal_error("Error in the section table of the index! (DISK2INDEX)\n");
+
+	table = (xbzi_section *) (disk + header_len);
+	for(s=0; s < n; s++){
+		if ((table[s].Offset % 8) || (table[s].Offset > (UInt64) disk_len) || 
+			(table[s].Length > (UInt64) disk_len - table[s].Offset))
+			fatal_error("Error in reading the index from disk! (DISK2INDEX)\n");
+		*field[s] = (table[s].Length > 0) ? (void *) (disk + table[s].Offset) : NULL;
 		}
-	for(i=0; i < index->PcNumBlocks; i++){
-		bbz_bit_write(32,index->PcBlockItems[i]);
-		cursor += sizeof(int);
+
+	if (index->LastType == LAST_BITVECTOR)
+		attach_disk_bitvector(&index->LastBV, index->SItemsNum, field, table, n);
+	if (index->AlphaType == ALPHA_WAVELET)
+		for(l=0; l < index->AlphaWM.Levels; l++)
+			attach_disk_bitvector(&index->AlphaWM.Level[l], index->SItemsNum, field, table, n);
+
+	// Every section must have the length implied by the header
+	if (index_sections(index, field, len) - (header->Version == 2) != n)
+		fatal_error("Error in the section table of the index! (DISK2INDEX)\n");
+	for(s=0; s < n; s++)
+		if (table[s].Length != (UInt64) len[s])
+			fatal_error("Error in the section lengths of the index! (DISK2INDEX)\n");
+
+	// The block directories must delimit blocks within the streams
+	if (index->LastType == LAST_COMPRESSED) {
+		if ((index->LastNumBlocks < 2) || (index->LastPosBlocks[0] != 0) ||
+			(index->LastPosBlocks[index->LastNumBlocks-1] != index->SItemsNum) ||
+			!check_disk_offsets(index->LastPosBlocks, index->LastNumBlocks, index->SItemsNum) ||
+			!check_disk_offsets(index->LastOffsetBlocks, index->LastNumBlocks, index->LastIndexLen))
+			fatal_error("Error *LAST* in reading the index from disk! (DISK2INDEX)\n");
+		}
+	if (index->AlphaType == ALPHA_COMPRESSED) {
+		if ((index->AlphaNumBlocks != (index->SItemsNum - 1) / BLOCK_ALPHA_LEN + 2) ||
+			!check_disk_offsets(index->AlphaOffsetBlocks, index->AlphaNumBlocks, index->AlphaIndexLen))
+			fatal_error("Error *ALPHA* in reading the index from disk! (DISK2INDEX)\n");
 		}
+	if (!check_disk_offsets(index->PcOffsetBlocks, index->PcNumBlocks, index->PcdataIndexLen))
+		fatal_error("Error *PC* in reading the index from disk! (DISK2INDEX)\n");
 
-	if( cursor > *disk_len)
-		fatal_error("Error *PC* in writing the index on disk! (INDEX2DISK)\n");
+	// The alphabet is made of AlphabetCard '\0'-terminated symbols
+	for(s=0, l=0; s < index->AlphabetLen; s++)
+		if (index->Alphabet[s] == '\0') l++;
+	if ((l != index->AlphabetCard) || (index->Alphabet[index->AlphabetLen-1] != '\0') ||
+		((index->AlphaType == ALPHA_WAVELET) && 
+		 !check_disk_offsets(index->AlphabetStart, index->AlphabetCard, index->AlphabetLen - 1)))
+		fatal_error("Error *ALPHABET* in reading the index from disk! (DISK2INDEX)\n");
 
-	// Write the infos about F
-	for(i=0; i < index->AlphabetCard; i++){
-		bbz_bit_write(32,index->F[i]);
-		cursor += sizeof(int);
-		}
+}
 
-	if( cursor > *disk_len)
-		fatal_error("Error *SIGMA* in writing the index on disk! (INDEX2DISK)\n");
 
-	// Write the index by exploiting the variable 'cursor'
-	memcpy(*disk + cursor, index->LastIndex, index->LastIndexLen);
-	cursor += index->LastIndexLen;
+/* ----------------------------------------------------------------------------
+	Completes a bitvector of a loaded index, once checked that its
+		directory is long enough for bitvector_attach()
+	--------------------------------------------------------------------------- */
+void attach_disk_bitvector(bitvector_type *bv, int len, void **field[], xbzi_section *table, int n)
+{
+	int s, size[4];
 
-	memcpy(*disk + cursor, index->AlphaIndex, index->AlphaIndexLen);
-	cursor += index->AlphaIndexLen;
+	for(s=0; (s < n) && (field[s] != (void **) &bv->Bits); s++) ;
 
-	memcpy(*disk + cursor, index->PcdataIndex, index->PcdataIndexLen);
-	cursor += index->PcdataIndexLen;
+	bv->Len = len;
+	bv->Ones = 0;
+	bitvector_sizes(bv, size);
+	if ((s + 3 >= n) || (table[s].Length != (UInt64) size[0]) || (table[s+1].Length != (UInt64) size[1]))
+		fatal_error("Error *BV* in reading the index from disk! (DISK2INDEX)\n");
 
-	memcpy(*disk + cursor, index->Alphabet, index->AlphabetLen);
-	cursor += index->AlphabetLen;
+	bitvector_attach(bv, len);
+	if ((bv->Ones < 0) || (bv->Ones > len))
+		fatal_error("Error *BV* in reading the index from disk! (DISK2INDEX)\n");
+}
 
-	if( cursor != *disk_len)
-		fatal_error("Error in writing the index on disk! (INDEX2DISK)\n");
 
+/* ----------------------------------------------------------------------------
+	Returns 1 if the first 'num' entries of the directory 'offset' are
+		non decreasing within [0, max], 0 otherwise
+	--------------------------------------------------------------------------- */
+int check_disk_offsets(int *offset, int num, int max)
+{
+	int i;
+
+	for(i=0; i < num; i++)
+		if ((offset[i] < 0) || (offset[i] > max) || ((i > 0) && (offset[i] < offset[i-1])))
+			return 0;
+
+	return 1;
 }
 
 
 /* ----------------------------------------------------------------------------
-	Deserialization of the index data type 
+	Deserialization of an index file in the old layout (no header,
+		big-endian integers, compressed Last and Alpha only)
 	--------------------------------------------------------------------------- */
-void disk2index(UChar *disk, int disk_len, xbwt_index_type *index)
+void disk2index_v1(UChar *disk, int disk_len, xbwt_index_type *index)
 {
  	int cursor, i, j;
+	bit_stream_type bs;
 
 
 	// Variable 'cursor' is used for checking and correct offset setting
-	init_buffer(disk,disk_len); cursor = 0;
-
-	index->TextLength=bbz_bit_read(32); cursor += sizeof(int);
-	index->SItemsNum=bbz_bit_read(32); cursor += sizeof(int);
-	index->PcdataNum=bbz_bit_read(32); cursor += sizeof(int);
-	index->AlphabetLen=bbz_bit_read(32); cursor += sizeof(int);
-	index->AlphabetCard=bbz_bit_read(32); cursor += sizeof(int);
+	init_buffer(&bs,disk,disk_len); cursor = 0;
+
+	index->TextLength=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->SItemsNum=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->PcdataNum=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->AlphabetLen=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->AlphabetCard=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->LastType = LAST_COMPRESSED;
+	index->AlphaType = ALPHA_COMPRESSED;
+	index->AlphabetStart = NULL;
+	index->PcItemSamples = NULL;
+	index->PcSampleRate = 0;
+	index->PcSamplesNum = 0;
 
 	// Read the infos about Last
-	index->LastIndexLen=bbz_bit_read(32); cursor += sizeof(int);
-	index->LastNumBlocks=bbz_bit_read(32); cursor += sizeof(int);
+	index->LastIndexLen=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->LastNumBlocks=bbz_bit_read(&bs,32); cursor += sizeof(int);
 	index->LastOffsetBlocks = (int *) malloc(sizeof(int) * index->LastNumBlocks);
 	index->LastPosBlocks = (int *) malloc(sizeof(int) * index->LastNumBlocks);
 
 	for(i=0; i < index->LastNumBlocks; i++){
-		index->LastOffsetBlocks[i]=bbz_bit_read(32);
+		index->LastOffsetBlocks[i]=bbz_bit_read(&bs,32);
 		cursor += sizeof(int);
 		}
 	for(i=0; i < index->LastNumBlocks; i++){
-		index->LastPosBlocks[i]=bbz_bit_read(32);	
+		index->LastPosBlocks[i]=bbz_bit_read(&bs,32);
 		cursor += sizeof(int);
 		}
 
@@ -1027,17 +1396,17 @@ void disk2index(UChar *disk, int disk_len, xbwt_index_type *index)
 		fatal_error("Error *LAST* in reading the index from disk! (INDEX2DISK)\n");
 
 	// Read the infos about Alpha
-	index->AlphaNumBlocks=bbz_bit_read(32); cursor += sizeof(int);
-	index->AlphaIndexLen=bbz_bit_read(32); cursor += sizeof(int);
+	index->AlphaNumBlocks=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->AlphaIndexLen=bbz_bit_read(&bs,32); cursor += sizeof(int);
 	index->AlphaPrefixCounts = (int *) malloc(sizeof(int) * (index->AlphaNumBlocks * index->AlphabetCard));
 	index->AlphaOffsetBlocks = (int *) malloc(sizeof(int) * index->AlphaNumBlocks);
 	for(i=0; i < index->AlphaNumBlocks; i++){
-		index->AlphaOffsetBlocks[i]=bbz_bit_read(32);
+		index->AlphaOffsetBlocks[i]=bbz_bit_read(&bs,32);
 		cursor += sizeof(int);
 		}
 	for(i=0; i < index->AlphaNumBlocks; i++){
 		for(j=0; j < index->AlphabetCard; j++){
-			index->AlphaPrefixCounts[i*index->AlphabetCard+j]=bbz_bit_read(32);  
+			index->AlphaPrefixCounts[i*index->AlphabetCard+j]=bbz_bit_read(&bs,32);
 			cursor += sizeof(int);
 			}
 		}
@@ -1046,16 +1415,16 @@ void disk2index(UChar *disk, int disk_len, xbwt_index_type *index)
 		fatal_error("Error *ALPHA* in reading the index from disk! (DISK2INDEX)\n");
 
 	// Read the infos about Pcdata
-	index->PcdataIndexLen=bbz_bit_read(32); cursor += sizeof(int);
-	index->PcNumBlocks=bbz_bit_read(32); cursor += sizeof(int);
+	index->PcdataIndexLen=bbz_bit_read(&bs,32); cursor += sizeof(int);
+	index->PcNumBlocks=bbz_bit_read(&bs,32); cursor += sizeof(int);
 	index->PcOffsetBlocks = (int *) malloc(sizeof(int) * index->PcNumBlocks);
 	index->PcBlockItems = (int *) malloc(sizeof(int) * index->PcNumBlocks);
 	for(i=0; i < index->PcNumBlocks; i++){
-		index->PcOffsetBlocks[i]=bbz_bit_read(32);
+		index->PcOffsetBlocks[i]=bbz_bit_read(&bs,32);
 		cursor += sizeof(int);
 		}
 	for(i=0; i < index->PcNumBlocks; i++){
-		index->PcBlockItems[i]=bbz_bit_read(32);
+		index->PcBlockItems[i]=bbz_bit_read(&bs,32);
 		cursor += sizeof(int);
 		}
 
@@ -1065,7 +1434,7 @@ void disk2index(UChar *disk, int disk_len, xbwt_index_type *index)
 	// Read the infos about F
 	index->F = (int *) malloc(sizeof(int) * index->AlphabetCard);
 	for(i=0; i < index->AlphabetCard; i++){
-		index->F[i]=bbz_bit_read(32);
+		index->F[i]=bbz_bit_read(&bs,32);
 		cursor += sizeof(int);
 		}
 
@@ -1091,22 +1460,15 @@ void disk2index(UChar *disk, int disk_len, xbwt_index_type *index)
 }
 
 /* ----------------------------------------------------------------------------
-	Search for a path of 'pathlen' symbols stored in the array of pointers 'path'
-		the procedure returns various infos as (reference) parameters.
-	In the case of path search, then *pathocc = *occ
-	In case of content search, then maybe *pathocc != *occ
+	Computes the rows [*firstRow, *lastRow] prefixed by the Tag-Attr part of 
+		the path of 'pathlen' symbols stored in the array of pointers 'path'.
+		Returns 1 if the scan reached the (ending) =substring of a content 
+		query, 0 otherwise
 	--------------------------------------------------------------------------- */
-void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen, 
-				  int *firstRow, int *lastRow, int *pathocc, int *occ, int visualize)
+int search_path_rows(xbwt_index_type *index, UChar **path, int pathlen, int *firstRow, int *lastRow)
 {
-	int z, k1, k2, j, i, sum, error;
-	int symb_code, symb_forbidden, blockStart, blockStartNext;
-	int pcfirst_item, pclast_item, pcfirst_block, pclast_block; 
-	UChar *pattern, *snippet_text_array;
-	unsigned long occNum, *snippet_length_array, uncomprBlockLen; 
-	void *fmindex;
-
-//	UChar *snippet_text; unsigned long snippet_len, *occArray; // for the Location
+	int z, k1, k2, j, i;
+	int symb_code, symb_forbidden;
 
 	i=0;
 
@@ -1133,10 +1495,8 @@ void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen,
 			fatal_error("Error in composing the Path Query! (XBZIP_SEARCH)\n");
 
 		// Actually it plays a role only for i = 0
-		if(path[i][0] == '='){ // Content search
-			printf("\nThis is a content query!\n\n");
-			break;	
-			}
+		if(path[i][0] == '=') // Content search
+			return 1;
 
 		symb_code = get_symbol_code(index,path[i]);
 
@@ -1151,6 +1511,29 @@ void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen,
 		k2=rankSymb_alpha(index,path[i], *lastRow);
 		*lastRow = select1_last(index,z+k2);
 	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+	Search for a path of 'pathlen' symbols stored in the array of pointers 'path'
+		the procedure returns various infos as (reference) parameters.
+	In the case of path search, then *pathocc = *occ
+	In case of content search, then maybe *pathocc != *occ
+	--------------------------------------------------------------------------- */
+void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen, 
+				  int *firstRow, int *lastRow, int *pathocc, int *occ, int visualize)
+{
+	int j, i, sum, error;
+	int blockStart, blockStartNext;
+	int pcfirst_item, pclast_item, pcfirst_block, pclast_block; 
+	UChar *pattern, *snippet_text_array;
+	unsigned long occNum, *snippet_length_array, uncomprBlockLen; 
+	void *fmindex;
+
+//	UChar *snippet_text; unsigned long snippet_len, *occArray; // for the Location
+
+	if (search_path_rows(index, path, pathlen, firstRow, lastRow))
+		printf("\nThis is a content query!\n\n");
 
 
 	printf("\n\nRows in [%d,%d] are prefixed by the Tag-Attr part of the Query\n",
@@ -1177,8 +1560,8 @@ void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen,
 	}
 
 	// Otheriwse, we manage the content queries
-	pcfirst_item = rankSymb_alpha(index, "=", *firstRow - 1);
-	pclast_item = rankSymb_alpha(index, "=", *lastRow) - 1;
+	pcfirst_item = rankSymb_alpha(index, (UChar *) "=", *firstRow - 1);
+	pclast_item = rankSymb_alpha(index, (UChar *) "=", *lastRow) - 1;
 	printf("Content search within the interval [%d,%d] of PcdataItems.\n",pcfirst_item,pclast_item);
 
 	// We search for the first block containing an occurrence
@@ -1213,8 +1596,8 @@ void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen,
 		pattern = path[pathlen-1] + 1; // discard the leading '='
 
 
-		error = load_index_mem(&fmindex, index->PcdataIndex + blockStart, blockStartNext - blockStart); 
-		IFERROR(error);
+		// The FM-index of the block is loaded once and kept in the cache
+		fmindex = get_cached_fmindex(index, j, 0)->fmindex;
 		error = get_length(fmindex, &uncomprBlockLen);
 		IFERROR(error);
 
@@ -1255,7 +1638,6 @@ void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen,
 			printf("\n\n\n");
 			}
 
-	error = free_index(fmindex); IFERROR(error);					
 	*occ += occNum;
 	}
 	printf("\n\nIn summary:\n");
@@ -1265,59 +1647,165 @@ void xbzip_search(xbwt_index_type *index, UChar **path, int pathlen,
 
 
 /* ----------------------------------------------------------------------------
-	Groups the Pcdata items according to their leading path. 
-	It must be equal.
+	Locates the elements matching a content query, namely a path of 'pathlen'
+		symbols ending with =substring: *rows gets the (sorted, distinct) rows 
+		of the elements whose text, or value of the queried attribute, contains 
+		the substring. Returns their number, *rows is malloc'ed.
 	--------------------------------------------------------------------------- */
-void xbwt_partition(UChar *text, int text_len)
+int xbzip_locate(xbwt_index_type *index, UChar **path, int pathlen, int **rows)
 {
-	Tree_node **nodes_array, *root, *x, *y;
-	int TreeSize,cursor,i,aa;
-	int prev,curr;
-
-	root = xml2tree(text, text_len, &TreeSize);
-	nodes_array = (Tree_node **) malloc(sizeof(Tree_node *) * TreeSize);
-	if (!nodes_array) fatal_error("Error in allocating nodes_array! (XBWT_PART)");
-	cursor=0;
-	tree2nodearray(root, nodes_array, &cursor);
-	qsort(nodes_array, TreeSize, sizeof(Tree_node *), PI_cmp);
-
-	PartitionArray = (int *) malloc( sizeof(int) * TreeSize );
-	PartitionCount = 0;
-	for(i=0; i < TreeSize; i++) PartitionArray[i]=0;
-
-	// Compare an item with the previous one
-	prev = 0;
-	for(curr=1; curr < TreeSize; ){ 
-		
-		// Search for the next Pcdata item
-		for(; (curr < TreeSize) && (nodes_array[curr]->type != TEXT); curr++) ;
+	int firstRow, lastRow, n, k, m, row, *items;
 
-		if (curr >= TreeSize) return; 
+	if (path[pathlen-1][0] != '=')
+		fatal_error("Only content queries can be located! (XBZIP_LOCATE)\n");
 
-		if ( nodes_array[curr]->type != TEXT )
-			fatal_error("It should be a TEXT node ! (xbwt_partition)\n");
+	search_path_rows(index, path, pathlen, &firstRow, &lastRow);
+	if (firstRow > lastRow) { *rows = NULL; return 0; }
 
-		x = nodes_array[curr]->parent;
-		y = nodes_array[prev]->parent;
+	// Pcdata items below the Tag-Attr path which contain the substring
+	n = locate_pc_items(index, path[pathlen-1] + 1, rankSymb_alpha(index, (UChar *) "=", firstRow - 1),
+						rankSymb_alpha(index, (UChar *) "=", lastRow) - 1, &items);
 
-		// Compare the upward labeled path
-		while(x && y && (x != y))
-		{
-			if (x->len_str != y->len_str) { break; }
-			aa = strncmp(x->str, y->str, x->len_str);
-			if (aa != 0) { break; }
-			x = x->parent; y = y->parent;
+	// From the item to its = row, then to the parent element 
+	// (through the attribute name, for an attribute value)
+	for(k=0; k < n; k++){
+		row = get_parent(index, selectSymb_alpha(index, (UChar *) "=", items[k] + 1));
+		if (get_node_type(index, row) == '@')
+			row = get_parent(index, row);
+		items[k] = row;
 		}
-	
-		if ( x != y ) // new path
-			PartitionCount++;
 
-		PartitionArray[PartitionCount-1]++;
+	// An element may contain more matching items
+	qsort(items, n, sizeof(int), Int_cmp);
+	for(k=0, m=0; k < n; k++)
+		if ((m == 0) || (items[k] != items[m-1]))
+			items[m++] = items[k];
 
-		// Advance pointers
-		prev = curr;
-		curr++;
-	}
+	*rows = items;
+	return m;
+}
+
+/* ----------------------------------------------------------------------------
+	Locates the occurrences of 'pattern' in the Pcdata items of ranks
+		[firstItem, lastItem] (from 0): *items gets the (increasing) ranks 
+		of the items containing them. Returns their number, *items is malloc'ed.
+	--------------------------------------------------------------------------- */
+int locate_pc_items(xbwt_index_type *index, UChar *pattern, int firstItem, int lastItem, int **items)
+{
+	void *memmem(const void *haystack, size_t hlen, const void *needle, size_t nlen);
+	int j, n, k, end, sum, samp, nsamp, rank, hintPos, hintRank, plen, error;
+	unsigned long i, occNum, *occArray, blocklen;
+	pc_cache_entry *e;
+
+	*items = (int *) malloc(sizeof(int) * (max(lastItem - firstItem, 0) + 1));
+	if (!(*items))
+		fatal_error("Error in allocating the located items! (LOCATE_PC_ITEMS)\n");
+
+	// Every item contains the empty pattern
+	n = 0;
+	plen = strlen((char *) pattern);
+	if (plen == 0) {
+		for(rank = firstItem; rank <= lastItem; rank++)
+			(*items)[n++] = rank;
+		return n;
+		}
+
+	for(j=0, sum=0, samp=0; (j < index->PcNumBlocks) && (sum <= lastItem); j++){
+
+		nsamp = ((index->PcItemSamples) && (index->PcBlockItems[j] > 0)) ? 
+					(index->PcBlockItems[j] - 1) / index->PcSampleRate : 0;
+
+		if (sum + index->PcBlockItems[j] > firstItem) {
+
+			// Statistics
+			Pcdata_Block_Counter++;
+			Pcdata_Byte_Counter += ((j == index->PcNumBlocks - 1) ? index->PcdataIndexLen : 
+									index->PcOffsetBlocks[j+1]) - index->PcOffsetBlocks[j];
+
+			// Counting is cheap, whereas locating scans the marked rows per occurrence
+			e = get_cached_fmindex(index, j, 0);
+			error = count(e->fmindex, pattern, plen, &occNum);
+			IFERROR(error);
+			error = get_length(e->fmindex, &blocklen);
+			IFERROR(error);
+
+			// Many occurrences (or no samples): the items of the block within the
+			// range are scanned over its text (see also get_text_content)
+			if ((occNum > 0) && ((!index->PcItemSamples) || (blocklen < occNum * PC_EXTRACT_BYTES))) {
+				e = get_cached_fmindex(index, j, 1);
+				for(k=1, rank=sum; (k <= e->textLen) && (rank <= lastItem); rank++){
+					for(end=k; (end < e->textLen) && (e->text[end] != '\0'); end++) ;
+					if ((rank >= firstItem) && memmem(e->text + k, end - k, pattern, plen))
+						(*items)[n++] = rank;
+					k = end + 1;	// skip the \0
+					}
+				}
+
+			// Few occurrences: the located positions are mapped to items, 
+			// by increasing positions, each from the previous one
+			else if (occNum > 0) {
+				error = locate(e->fmindex, pattern, plen, &occArray, &occNum);
+				IFERROR(error);
+				qsort(occArray, occNum, sizeof(unsigned long), Pos_cmp);
+				hintPos = 1; hintRank = 0;	// the first item starts at byte 1
+				for(i=0; i < occNum; i++){
+					rank = sum + pc_item_of_pos(index, e, samp, nsamp, (int) occArray[i], &hintPos, &hintRank);
+					if ((rank < firstItem) || (rank > lastItem) || ((n > 0) && ((*items)[n-1] == rank)))
+						continue;
+					(*items)[n++] = rank;
+					}
+				if (occNum > 0) free(occArray);
+				}
+			}
+
+		sum += index->PcBlockItems[j];
+		samp += nsamp;
+		}
+
+	return n;
+}
+
+/* ----------------------------------------------------------------------------
+	Returns the rank (from 0) within its block of the Pcdata item containing
+		byte 'pos' of the block, cached in 'e', whose 'nsamp' samples start 
+		at PcItemSamples[samp]. The \0 separators are counted by extracting
+		the text from the closest preceding sample, or from the hint if it 
+		is closer: a previous position within the block (*hintPos) and the 
+		rank of its item (*hintRank). The hint is then moved to 'pos'.
+	--------------------------------------------------------------------------- */
+int pc_item_of_pos(xbwt_index_type *index, pc_cache_entry *e, int samp, int nsamp, 
+				   int pos, int *hintPos, int *hintRank)
+{
+	int lo, hi, mid, from, rank, i, error;
+	unsigned long textlen;
+	UChar *text;
+
+	from = *hintPos; 
+	rank = *hintRank;
+
+	// Sample s > 0 is the starting byte of item s * PcSampleRate
+	for(lo=0, hi=nsamp; lo < hi; ){
+		mid = (lo + hi + 1) / 2;
+		if (index->PcItemSamples[samp + mid - 1] <= pos) lo = mid; 
+		else hi = mid - 1;
+		}
+	if (((lo > 0) && (index->PcItemSamples[samp + lo - 1] > from)) || (from > pos)) {
+		from = (lo == 0) ? 1 : index->PcItemSamples[samp + lo - 1];
+		rank = lo * index->PcSampleRate;
+		}
+
+	// extract() needs at least two bytes
+	if (pos > from) {
+		error = extract(e->fmindex, from, pos, &text, &textlen);
+		IFERROR(error);
+		for(i=0; (i < (int) textlen) && (from + i < pos); i++)
+			if (text[i] == '\0') rank++;
+		free(text);
+		}
+
+	*hintPos = pos; 
+	*hintRank = rank;
+	return rank;
 }
 
 
@@ -1335,14 +1823,19 @@ void get_node_labelNcode(xbwt_index_type *index, int row, UChar **symb, int *sym
 	if ( (row < 0) || (row >= index->SItemsNum) )
 		fatal_error("Out of bounds in row! (GET_CHILDREN)\n");
 
+	if (index->AlphaType == ALPHA_WAVELET) {
+		*symbcode = wavelet_access(&index->AlphaWM, row);
+		*symb = (UChar *) strndup((char *) index->Alphabet + index->AlphabetStart[*symbcode], 
+						strlen((char *) index->Alphabet + index->AlphabetStart[*symbcode]));
+		return;
+		}
+
 	// Compute the block containing the searched position
 	block = floor(row / BLOCK_ALPHA_LEN);
 	diffpos = row % BLOCK_ALPHA_LEN;
 
-	// Decoding the block
-	start = index->AlphaOffsetBlocks[block]; 
-	decompress_block(index->AlphaIndex+start, index->AlphaOffsetBlocks[block+1] - index->AlphaOffsetBlocks[block],
-						&alphablock, &alphablocklen);
+	// Fetch the decoded block (possibly from the cache)
+	alphablock = get_cached_block(index, ALPHA_STREAM, block, &alphablocklen);
 
 	//Scan the block symbol by symbol
 	i=0;
@@ -1373,7 +1866,6 @@ void get_node_labelNcode(xbwt_index_type *index, int row, UChar **symb, int *sym
 			}
 	*symb = strndup(alphablock + start, i-start);
 	*symbcode = get_symbol_code(index, *symb);
-	free(alphablock);
 }
 
 /* --------------------------------------------------------------------------------
@@ -1390,7 +1882,7 @@ int get_children(xbwt_index_type *index, int row, int *first, int *last)
 
 	// label of the input node
 	get_node_labelNcode(index, row, &symb, &symbCode);
-	if (symb[0] == '=') { *first = -1; *last = -1; return 0; }
+	if (symb[0] == '=') { *first = -1; *last = -1; free(symb); return 0; }
 
 	// PI-row where symb first occurs as prefix
 	rowSymb = index->F[symbCode];
@@ -1398,6 +1890,7 @@ int get_children(xbwt_index_type *index, int row, int *first, int *last)
 
 	// Rank of the current symbol
 	rankSymb = rankSymb_alpha(index, symb, row);
+	free(symb);
 
 	// children
 	*first = select1_last(index, x+rankSymb-1) + 1;
@@ -1437,11 +1930,13 @@ int get_parent(xbwt_index_type *index, int row)
 	---------------------------------------------------------------------------------------------- */
 UChar get_node_type(xbwt_index_type *index, int row)
 {
-	UChar *node_label;
+	UChar *node_label, type;
 	int label_code;
 
 	get_node_labelNcode(index, row, &node_label, &label_code);
-	return(node_label[0]);
+	type = node_label[0];
+	free(node_label);
+	return(type);
 }
 
 /* --------------------------------------------------------------------------------
@@ -1472,42 +1967,51 @@ int get_ith_symb_child(xbwt_index_type *index, int row, int rank, UChar *c)
 int get_text_content(xbwt_index_type *index, int row, int *cLen, UChar **c)
 {
 	char *strndup(const char *s, size_t n);
-	int pcItem, pcBlock, j, diffRank, sum, error, blockStartNext;
+	int pcItem, pcBlock, j, diffRank, sum, samp, blockStartNext, blocklen, error;
+	unsigned long textlen;
 	UChar *block;
-	unsigned long blocklen, blocklen1;
-	void *fmindex;
+	pc_cache_entry *e;
 
 	if (get_node_type(index,row) != '=')
 		{ *cLen = 0; *c = NULL; return -1; }
 
 	pcItem = rankSymb_alpha(index, "=", row);
 
-	// We search for the first block containing an occurrence
-	for(j=0, sum=0; (sum + index->PcBlockItems[j]) < pcItem; j++)
+	// We search for the first block containing an occurrence, 
+	// and for the first sample of that block
+	for(j=0, sum=0, samp=0; (sum + index->PcBlockItems[j]) < pcItem; j++){
 		sum += index->PcBlockItems[j];
+		if ((index->PcItemSamples) && (index->PcBlockItems[j] > 0))
+			samp += (index->PcBlockItems[j] - 1) / index->PcSampleRate;
+		}
 	pcBlock = j;
 
-	// We search for the exact Pcdata 
-	// --- THIS IS VERY SLOW: We should have a direct access to the diffRank-th Pcdata item ---
-
-	// Load the FM-index and decompress the indexed text
 	if(pcBlock == index->PcNumBlocks-1)
 		{ blockStartNext = index->PcdataIndexLen; }
 	else { 	blockStartNext = index->PcOffsetBlocks[pcBlock+1]; }
 
+	// Statistics
+	Pcdata_Block_Counter++;
+	Pcdata_Byte_Counter += blockStartNext - index->PcOffsetBlocks[pcBlock];
 
-	error = load_index_mem(&fmindex, 
-		index->PcdataIndex + index->PcOffsetBlocks[pcBlock], 
-		blockStartNext - index->PcOffsetBlocks[pcBlock]); 
-	IFERROR(error);
-	error = get_length(fmindex, &blocklen);
-	IFERROR(error);
-	error = extract(fmindex, 0, blocklen-1, &block, &blocklen1);		
+	// Extract the item from the closest preceding sample, unless the block is 
+	// short enough to be decompressed whole (which is then cached)
+	e = get_cached_fmindex(index, pcBlock, 0);
+	error = get_length(e->fmindex, &textlen);
 	IFERROR(error);
-	if (blocklen != blocklen1)
-		fatal_error("Error in decompressing the FM-indexed block!");
-	error = free_index(fmindex);
-	IFERROR(error);		
+	if ((index->PcItemSamples) && (!e->text) && (textlen >= PC_EXTRACT_BYTES)) {
+		diffRank = pcItem - sum - 1; // rank of the item within the block, from 0
+		get_pc_item(e->fmindex, (diffRank < index->PcSampleRate) ? 1 :
+					index->PcItemSamples[samp + diffRank / index->PcSampleRate - 1],
+					diffRank % index->PcSampleRate, cLen, c);
+		return 1;
+		}
+
+	// Otherwise get the decompressed text of the block from the FM-index cache,
+	// and scan it for the diffRank-th Pcdata item
+	e = get_cached_fmindex(index, pcBlock, 1);
+	block = e->text;
+	blocklen = e->textLen;
 
 	// Access the correct Pcdata item
 	for(diffRank = pcItem - sum; diffRank > 0; diffRank--){
@@ -1517,16 +2021,62 @@ int get_text_content(xbwt_index_type *index, int row, int *cLen, UChar **c)
 
 	// block points to the starting byte of the searched PcItem
 	// blocklen accounts for the #bytes remaining to be scanned
-	for(*cLen = 0; (block[*cLen] != '\0') && (*cLen < (int)blocklen) ; (*cLen)++) ;
+	for(*cLen = 0; (*cLen < blocklen) && (block[*cLen] != '\0'); (*cLen)++) ;
 	*c = strndup(block, *cLen);
-
-	// Statistics
-	Pcdata_Block_Counter++;
-	Pcdata_Byte_Counter += index->PcOffsetBlocks[pcBlock+1] - index->PcOffsetBlocks[pcBlock];
 	return 1;
 }
 
 
+/* --------------------------------------------------------------------------------
+	Extracts from the FM-index of a Pcdata block the item which follows 
+		by 'skip' items the one starting at byte 'from' of the block: 
+		the text is extracted in chunks of doubling length, 
+		each one starting at the item as soon as it is reached.
+		The item is returned in *c, which is malloc'ed.
+	------------------------------------------------------------------------------- */
+void get_pc_item(void *fmindex, int from, int skip, int *cLen, UChar **c)
+{
+	char *strndup(const char *s, size_t n);
+	int error, chunk, i, j;
+	unsigned long blocklen, textlen;
+	UChar *text;
+
+	error = get_length(fmindex, &blocklen);
+	IFERROR(error);
+
+	for(chunk = PC_EXTRACT_CHUNK; ; chunk *= 2){
+
+		// An empty item may end the block
+		if (from >= (int) blocklen) 
+			{ if (skip) break; *cLen = 0; *c = (UChar *) strndup("", 0); return; }
+
+		// extract() clamps the end of the range to the block
+		error = extract(fmindex, from, from + chunk - 1, &text, &textlen);
+		IFERROR(error);
+		if (textlen == 0) break;
+
+		// Skip the items preceding the searched one
+		for(i=0; (i < (int) textlen) && (skip > 0); i++)
+			if (text[i] == '\0') skip--;
+
+		// Search for the end of the item
+		if (skip == 0) {
+			for(j=i; (j < (int) textlen) && (text[j] != '\0'); j++) ;
+			if ((j < (int) textlen) || (from + (int) textlen >= (int) blocklen)) {
+				*cLen = j - i;
+				*c = (UChar *) strndup((char *) text + i, *cLen);
+				free(text);
+				return;
+				}
+			}
+		free(text);
+		from += i;
+		}
+
+	fatal_error("The Pcdata item is out of its block! (GET_PC_ITEM)\n");
+}
+
+
 /* --------------------------------------------------------------------------------
 	Returns in *snippet the text version of the subtree descending from row (node)
 	If row = 0, then it returns the entire document.
@@ -1535,9 +2085,27 @@ int get_text_content(xbwt_index_type *index, int row, int *cLen, UChar **c)
 	------------------------------------------------------------------------------- */
 void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, UChar **snippet, int *snippetLength)
 {
-	int parent, *Stack, snippetLengthMax, InAngleBrackets, cursor, top_stack;
+	xbzip_sink_type sink;
+	TextInt len;
+
+	// A snippet is usually short: the memory is doubled if needed 
+	sink_init_mem(&sink, 200000);
+	Subtree2Sink(index, row, printed_row, &sink);
+	sink_close(&sink);
+	sink_take_mem(&sink, snippet, &len);
+	*snippetLength = len;
+}
+
+
+/* --------------------------------------------------------------------------------
+	As Subtree2Text(), the text of the subtree being given to the sink (see 
+	xbzip_sink.c) while it is reconstructed. The sink is flushed, not closed.
+	------------------------------------------------------------------------------- */
+void Subtree2Sink(xbwt_index_type *index, int row, int *printed_row, xbzip_sink_type *sink)
+{
+	int parent, *Stack, *stmp, StackSize, InAngleBrackets, top_stack;
 	int tmp, first, last, num, tokenLen, PosSalpha, k;
-	UChar *token, c, *stmp;
+	UChar *token, c;
 
 
 	if (row < 0 ) { 
@@ -1568,31 +2136,19 @@ void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, UChar **sni
 			fatal_error("Unknown node type for subtree printing. (Subtree2Text)\n");
 		}
 
-	// We assume a maximum depth of 10000
-	Stack = (int *) malloc(sizeof(int) * 10000);
+	// The Stack keeps the children of the nodes on the current path,
+	// it is enlarged when a node has many children
+	StackSize = 10000;
+	Stack = (int *) malloc(sizeof(int) * StackSize);
 	if (!Stack) fatal_error("Error in allocating Stack! (Subtree2Text)");
 
-	// We work with chuncks of 200Kb
-	snippetLengthMax = 200000; 
-	*snippet = (UChar *) malloc(sizeof(UChar) * 200000 );
-
 	InAngleBrackets=0;	// flags if we are within <....>	
-	cursor=0;			// moves over the text under construction
 	top_stack=-1;		// points to the top of Stack
 
 	Stack[++top_stack] = parent; // Push the starting row
 
 	for( ; top_stack > -1; ) {
 
-		if (cursor >= snippetLengthMax)
-			fatal_error("Out-of-snippet in subtree retrieval! (Subtree2Text)\n");
-		if (cursor > snippetLengthMax - 100000){
-			snippetLengthMax += 100000;
-			stmp = realloc(*snippet, snippetLengthMax);
-			if( !stmp ) fatal_error("\nError in allocating the snippet space! (Subtree2Text)\n");
-			*snippet = stmp;
-			}
-
 		PosSalpha = Stack[top_stack--]; // Pop the top item
 
 		// Managing the closing tag 
@@ -1600,15 +2156,14 @@ void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, UChar **sni
 		if(PosSalpha < 0){
 			if (InAngleBrackets != 0)
 				fatal_error("InAngleBrackets is not 0 and PosAlpha is negative ! (Subtree2Text)\n");
-			(*snippet)[cursor++] = '<';
-			(*snippet)[cursor++] = '/';
+			SINK_PUTC(sink, '<');
+			SINK_PUTC(sink, '/');
 			// Cancel the <
 			get_node_labelNcode(index, -PosSalpha, &token, &tmp);
-			token++;
-			memcpy(*snippet+cursor,token,strlen(token));
-			cursor += strlen(token);			
+			sink_put(sink, token + 1, strlen((char *) token + 1));
+			free(token);
 			// Append the >
-			(*snippet)[cursor++] = '>';
+			SINK_PUTC(sink, '>');
 			continue; // back to Pop from Stack
 		} 
 		
@@ -1621,24 +2176,23 @@ void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, UChar **sni
 			if ((c == '=') || (c == '<')) {
 				InAngleBrackets=0;
 				Stack[++top_stack]=PosSalpha; // re-insert (push) into the stack
-				(*snippet)[cursor++] = '>';
+				SINK_PUTC(sink, '>');
 				continue; // back to Pop from Stack
 			} 
 			
-			(*snippet)[cursor++] = ' ';
+			SINK_PUTC(sink, ' ');
 			get_node_labelNcode(index, PosSalpha, &token, &tmp);
-			token++;
-			memcpy(*snippet+cursor,token,strlen(token));
-			cursor += strlen(token);
+			sink_put(sink, token + 1, strlen((char *) token + 1));
+			free(token);
 
 			// Create the attribute string
-			(*snippet)[cursor++] = '='; (*snippet)[cursor++] = '\"';
+			SINK_PUTC(sink, '='); SINK_PUTC(sink, '\"');
 			num=get_children(index,PosSalpha,&first,&last);
 			if (num > 1) fatal_error("I expected one single child! (Subtree2Text)\n");
 			get_text_content(index, first, &tokenLen, &token);
-			memcpy(*snippet+cursor,token,tokenLen);
-			cursor += tokenLen;
-			(*snippet)[cursor++] = '"';
+			sink_put(sink, token, tokenLen);
+			free(token);
+			SINK_PUTC(sink, '"');
 
 			// No pushing in the stack since we completed the attribute
 			continue; // back to pop from Stack
@@ -1651,12 +2205,11 @@ void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, UChar **sni
 		c = token[0];
 
 		if (c == '=') { 
+			free(token);
 			get_text_content(index, PosSalpha, &tokenLen, &token);
 			if (token[0] != (UChar) 255) // not dummy filler for empty tag
-				{
-				memcpy(*snippet+cursor,token,tokenLen);
-				cursor += tokenLen;
-				}
+				sink_put(sink, token, tokenLen);
+			free(token);
 			continue; // back to pop from Stack
 		}
 
@@ -1665,28 +2218,43 @@ void Subtree2Text(xbwt_index_type *index, int row, int *printed_row, UChar **sni
 		if (c == '<') { 
 			if (PosSalpha != 0) {
 				InAngleBrackets=1; 
-				memcpy(*snippet + cursor,token,tokenLen);
-				cursor += tokenLen;
+				sink_put(sink, token, tokenLen);
 				}
 			// Insert in the stack the children of the current node
 			num=get_children(index, PosSalpha, &first, &last);
+			if (top_stack + num + 2 > StackSize) {
+				StackSize = 2 * StackSize + num;
+				stmp = (int *) realloc(Stack, sizeof(int) * StackSize);
+				if (!stmp) fatal_error("Error in enlarging Stack! (Subtree2Text)");
+				Stack = stmp;
+				}
 			if (PosSalpha != 0)
 				Stack[++top_stack] = -PosSalpha; // Push negative Pos as closing tag: trick
 			for(k=last; k >= first; k--)
 				Stack[++top_stack] = k;
 			}
+		free(token);
 		}
 
-	// To avoid some spurious chars after the last tag
-	*snippetLength = cursor;
+	sink_flush(sink);
+	free(Stack);
 	*printed_row = parent;
 }
 
-void compress_block(uchar *source, int sourceLen, uchar **dest, int *destLen)
+/* ----------------------------------------------------------------------------
+	Compresses a block of the index with the workspace of bbz: *dest is
+		allocated by this procedure and fits the compressed data
+	--------------------------------------------------------------------------- */
+void compress_block(bigbzip_ctx *bbz, uchar *source, int sourceLen, uchar **dest, int *destLen)
 {
 	int err;		
 
-	bigbzip_compress(source, sourceLen, dest, destLen);
+	*destLen = BIGBZIP_BOUND(sourceLen);
+	*dest = (uchar *) malloc(*destLen);
+	if (!*dest)
+		fatal_error("Error in allocating a compressed block! (COMPRESS_BLOCK)\n");
+	bigbzip_compress_ctx(bbz, source, sourceLen, *dest, destLen);
+	*dest = (uchar *) realloc(*dest, *destLen);
 
 	// Using ZLib
     /*
@@ -1712,12 +2280,25 @@ void compress_block(uchar *source, int sourceLen, uchar **dest, int *destLen)
 
 }
 
-void decompress_block(uchar *source, int sourceLen, uchar **dest, int *destLen)
+/* ----------------------------------------------------------------------------
+	Decompresses a block of the index with the workspace of bbz into *dest,
+		which has room for *destSize bytes and is enlarged if needed
+	--------------------------------------------------------------------------- */
+void decompress_block(bigbzip_ctx *bbz, uchar *source, int sourceLen, 
+					  uchar **dest, int *destSize, int *destLen)
 {
 
 	int err;		
 
-	bigbzip_decompress(source, sourceLen, dest, destLen);
+	*destLen = bigbzip_text_len(source, sourceLen);
+	if (*destLen > *destSize) {
+		if (*dest) free(*dest);
+		*destSize = *destLen;
+		*dest = (uchar *) malloc(max(*destSize, 1));
+		if (!*dest)
+			fatal_error("Error in allocating a decompressed block! (DECOMPRESS_BLOCK)\n");
+		}
+	bigbzip_decompress_ctx(bbz, source, sourceLen, *dest, destLen);
 
     /*
 	// Using ZLib
@@ -1733,3 +2314,352 @@ void decompress_block(uchar *source, int sourceLen, uchar **dest, int *destLen)
     */
 
 }
+
+
+/* ----------------------------------------------------------------------------
+	The blocks of Last, Alpha and Pcdata are compressed independently:
+		the jobs added to 'jobs' are run by a pool of up to NUM_THREADS 
+		threads (the calling one included) in run_index_jobs(), each one
+		into its own buffer. layout_index_jobs() then concatenates the 
+		buffers in the order of the jobs, so the index does not depend 
+		on the #threads.
+	--------------------------------------------------------------------------- */
+void init_index_jobs(index_jobs_type *jobs, int size)
+{
+	jobs->size = max(size, 1);
+	jobs->job = (index_job_type *) malloc(sizeof(index_job_type) * jobs->size);
+	if (!jobs->job)
+		fatal_error("Error in allocating the index jobs! (INIT_INDEX_JOBS)\n");
+	jobs->num = 0;
+}
+
+void add_index_job(index_jobs_type *jobs, UChar *src, int srcLen, int type)
+{
+	index_job_type *job;
+
+	if (jobs->num == jobs->size) {
+		jobs->size *= 2;
+		jobs->job = (index_job_type *) realloc(jobs->job, sizeof(index_job_type) * jobs->size);
+		if (!jobs->job)
+			fatal_error("Error in allocating the index jobs! (ADD_INDEX_JOB)\n");
+		}
+
+	job = &jobs->job[jobs->num++];
+	job->src = src;
+	job->srcLen = srcLen;
+	job->dest = NULL;
+	job->destLen = 0;
+	job->type = type;
+}
+
+/* ----------------------------------------------------------------------------
+	Task of the pool: compresses the i-th block, with the workspace of
+		the thread, or builds the i-th FM-index
+	--------------------------------------------------------------------------- */
+void run_index_job(bbz_worker_type *w, int i)
+{
+	index_job_type *job = &((index_jobs_type *) w->arg)->job[i];
+	ulong fmindex_len; // for the FM-index
+	void *fmindex;     // for the FM-index
+	int error;
+
+	if (job->type == INDEX_JOB_BLOCK) {
+		compress_block(&w->ctx, job->src, job->srcLen, &job->dest, &job->destLen);
+		return;
+		}
+
+	// -a 2 -f 0 -b 1024
+	error = build_index(job->src, (ulong) job->srcLen, "-a 2 -f 0.005 -b 2048 -B 32", &fmindex);
+	IFERROR(error);
+	error = index_size(fmindex, &fmindex_len);
+	IFERROR(error);
+	job->dest = (UChar *) malloc(fmindex_len);
+	if (!job->dest)
+		fatal_error("Error in allocating a Pcdata index! (RUN_INDEX_JOB)\n");
+	error = save_index_mem(fmindex, job->dest);
+	IFERROR(error);
+	error = free_index(fmindex);
+	IFERROR(error);
+	job->destLen = (int) fmindex_len;
+}
+
+void run_index_jobs(index_jobs_type *jobs)
+{
+	bbz_pool_run(jobs->num, NUM_THREADS, run_index_job, jobs);
+}
+
+/* ----------------------------------------------------------------------------
+	Concatenates the buffers of the jobs into a new area, whose length
+		is returned: offsets[i] is the first byte of the i-th buffer
+	--------------------------------------------------------------------------- */
+int layout_index_jobs(index_jobs_type *jobs, UChar **area, int *offsets)
+{
+	int i, len;
+
+	for(i=0, len=0; i < jobs->num; i++)
+		len += jobs->job[i].destLen;
+
+	*area = (UChar *) malloc(sizeof(UChar) * max(len, 1));
+	if (!*area)
+		fatal_error("Error in allocating the compressed blocks! (LAYOUT_INDEX_JOBS)\n");
+
+	for(i=0, len=0; i < jobs->num; i++){
+		memcpy(*area + len, jobs->job[i].dest, jobs->job[i].destLen);
+		offsets[i] = len;
+		len += jobs->job[i].destLen;
+		free(jobs->job[i].dest);
+		jobs->job[i].dest = NULL;
+		}
+
+	return len;
+}
+
+void free_index_jobs(index_jobs_type *jobs)
+{
+	int i;
+
+	for(i=0; i < jobs->num; i++)
+		if (jobs->job[i].dest) free(jobs->job[i].dest);
+	free(jobs->job);
+}
+
+
+/* ----------------------------------------------------------------------------
+	Allocates an empty cache of 'size' decompressed blocks for the index
+	--------------------------------------------------------------------------- */
+void init_block_cache(xbwt_index_type *index, int size)
+{
+	int i;
+
+	if (size <= 0)
+		fatal_error("The block cache must have at least one entry! (INIT_BLOCK_CACHE)\n");
+
+	index->Cache = (block_cache_entry *) malloc(sizeof(block_cache_entry) * size);
+	if (!index->Cache)
+		fatal_error("Error in allocating the block cache! (INIT_BLOCK_CACHE)\n");
+
+	for(i=0; i < size; i++){
+		index->Cache[i].stream = -1;
+		index->Cache[i].block = -1;
+		index->Cache[i].data = NULL;
+		index->Cache[i].size = 0;
+		index->Cache[i].len = 0;
+		index->Cache[i].stamp = 0;
+		}
+	index->CacheSize = size;
+	index->CacheClock = 0;
+
+	index->BlockCoder = (bigbzip_ctx *) malloc(sizeof(bigbzip_ctx));
+	if (!index->BlockCoder)
+		fatal_error("Error in allocating the block decoder! (INIT_BLOCK_CACHE)\n");
+	bigbzip_ctx_init(index->BlockCoder);
+
+	init_pc_cache(index, size, PC_CACHE_MEM);
+}
+
+/* ----------------------------------------------------------------------------
+	Frees the decompressed blocks kept in the cache of the index
+	--------------------------------------------------------------------------- */
+void free_block_cache(xbwt_index_type *index)
+{
+	int i;
+
+	for(i=0; i < index->CacheSize; i++)
+		if (index->Cache[i].data) free(index->Cache[i].data);
+	free(index->Cache);
+	index->Cache = NULL;
+	index->CacheSize = 0;
+
+	bigbzip_ctx_free(index->BlockCoder);
+	free(index->BlockCoder);
+	index->BlockCoder = NULL;
+
+	free_pc_cache(index);
+}
+
+/* ----------------------------------------------------------------------------
+	Returns the decompressed 'block' of Last (stream = LAST_STREAM) or of
+	Alpha (stream = ALPHA_STREAM), and its length in *blockLen.
+		On a miss the least recently used entry is replaced by the block.
+		The returned string belongs to the cache: the caller must not free it,
+		and it stays valid only until the next call to this procedure.
+	--------------------------------------------------------------------------- */
+UChar *get_cached_block(xbwt_index_type *index, int stream, int block, int *blockLen)
+{
+	int i, victim;
+	block_cache_entry *e;
+
+	index->CacheClock++;
+
+	// Search for the block, keeping track of the least recently used entry
+	for(i=0, victim=0; i < index->CacheSize; i++){
+		e = &index->Cache[i];
+		if ((e->block == block) && (e->stream == stream)) {
+			if (stream == LAST_STREAM) Last_Cache_Hits++; else Alpha_Cache_Hits++;
+			e->stamp = index->CacheClock;
+			*blockLen = e->len;
+			return e->data;
+			}
+		if (e->stamp < index->Cache[victim].stamp) victim = i;
+		}
+
+	// Miss: decode the block into the buffer of the victim entry
+	e = &index->Cache[victim];
+
+	if (stream == LAST_STREAM) {
+		Last_Cache_Misses++;
+		decompress_block(index->BlockCoder, index->LastIndex + index->LastOffsetBlocks[block], 
+			index->LastOffsetBlocks[block+1] - index->LastOffsetBlocks[block], 
+			&e->data, &e->size, &e->len);
+	} else {
+		Alpha_Cache_Misses++;
+		decompress_block(index->BlockCoder, index->AlphaIndex + index->AlphaOffsetBlocks[block], 
+			index->AlphaOffsetBlocks[block+1] - index->AlphaOffsetBlocks[block], 
+			&e->data, &e->size, &e->len);
+		}
+
+	e->stream = stream;
+	e->block = block;
+	e->stamp = index->CacheClock;
+	*blockLen = e->len;
+	return e->data;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Allocates an empty cache of at most 'size' loaded FM-indexes of Pcdata,
+		which are charged at most 'maxmem' bytes
+	--------------------------------------------------------------------------- */
+void init_pc_cache(xbwt_index_type *index, int size, int maxmem)
+{
+	int i;
+
+	if (size <= 0)
+		fatal_error("The FM-index cache must have at least one entry! (INIT_PC_CACHE)\n");
+
+	index->PcCache = (pc_cache_entry *) malloc(sizeof(pc_cache_entry) * size);
+	if (!index->PcCache)
+		fatal_error("Error in allocating the FM-index cache! (INIT_PC_CACHE)\n");
+
+	for(i=0; i < size; i++){
+		index->PcCache[i].block = -1;
+		index->PcCache[i].fmindex = NULL;
+		index->PcCache[i].text = NULL;
+		index->PcCache[i].textLen = 0;
+		index->PcCache[i].mem = 0;
+		index->PcCache[i].stamp = 0;
+		}
+	index->PcCacheSize = size;
+	index->PcCacheMem = 0;
+	index->PcCacheMemMax = maxmem;
+}
+
+/* ----------------------------------------------------------------------------
+	Frees the FM-indexes (and texts) kept in the cache of the index
+	--------------------------------------------------------------------------- */
+void free_pc_cache(xbwt_index_type *index)
+{
+	int i;
+
+	for(i=0; i < index->PcCacheSize; i++)
+		evict_pc_cache_entry(index, &index->PcCache[i]);
+	free(index->PcCache);
+	index->PcCache = NULL;
+	index->PcCacheSize = 0;
+}
+
+/* ----------------------------------------------------------------------------
+	Empties an entry of the FM-index cache
+	--------------------------------------------------------------------------- */
+void evict_pc_cache_entry(xbwt_index_type *index, pc_cache_entry *e)
+{
+	int error;
+
+	if (e->fmindex) {
+		error = free_index(e->fmindex);
+		IFERROR(error);
+		}
+	if (e->text) free(e->text);
+	index->PcCacheMem -= e->mem;
+	e->block = -1;
+	e->fmindex = NULL;
+	e->text = NULL;
+	e->textLen = 0;
+	e->mem = 0;
+	e->stamp = 0;
+}
+
+/* ----------------------------------------------------------------------------
+	Returns the cache entry of the loaded FM-index of the Pcdata 'block',
+		whose text is also extracted if withText != 0.
+		On a miss the least recently used entry is replaced by the block.
+		An entry is charged the length of its block (an upper bound to the
+		memory taken by the FM-index handle) plus that of its text: the least 
+		recently used entries are evicted while the cache exceeds its memory
+		cap, except the one returned.
+		The entry belongs to the cache: the caller must not free its fields,
+		and it stays valid only until the next call to this procedure.
+	--------------------------------------------------------------------------- */
+pc_cache_entry *get_cached_fmindex(xbwt_index_type *index, int block, int withText)
+{
+	int i, victim, error, blockStart, blockStartNext;
+	unsigned long blocklen, textlen;
+	pc_cache_entry *e;
+
+	if ((block < 0) || (block >= index->PcNumBlocks))
+		fatal_error("Out-of-bound Pcdata block! (GET_CACHED_FMINDEX)\n");
+
+	index->CacheClock++;
+
+	// Search for the block, keeping track of the least recently used entry
+	for(i=0, victim=0, e=NULL; i < index->PcCacheSize; i++){
+		if (index->PcCache[i].block == block) { e = &index->PcCache[i]; break; }
+		if (index->PcCache[i].stamp < index->PcCache[victim].stamp) victim = i;
+		}
+
+	if (e) 
+		Pcdata_Cache_Hits++;
+	else {
+		// Miss: load the FM-index into the victim entry
+		Pcdata_Cache_Misses++;
+		e = &index->PcCache[victim];
+		evict_pc_cache_entry(index, e);
+
+		blockStart = index->PcOffsetBlocks[block];
+		blockStartNext = (block == index->PcNumBlocks - 1) ? 
+							index->PcdataIndexLen : index->PcOffsetBlocks[block+1];
+		error = load_index_mem(&e->fmindex, index->PcdataIndex + blockStart, 
+								blockStartNext - blockStart); 
+		IFERROR(error);
+		error = get_length(e->fmindex, &blocklen);
+		IFERROR(error);
+		e->block = block;
+		e->mem = (int) blocklen;
+		index->PcCacheMem += e->mem;
+		}
+	e->stamp = index->CacheClock;
+
+	if (withText && (!e->text)) {
+		error = get_length(e->fmindex, &blocklen);
+		IFERROR(error);
+		error = extract(e->fmindex, 0, blocklen-1, &e->text, &textlen);		
+		IFERROR(error);
+		if (blocklen != textlen)
+			fatal_error("Error in decompressing the FM-indexed block! (GET_CACHED_FMINDEX)\n");
+		e->textLen = (int) textlen;
+		e->mem += e->textLen;
+		index->PcCacheMem += e->textLen;
+		}
+
+	// Keep the cache within its memory cap
+	while (index->PcCacheMem > index->PcCacheMemMax) {
+		for(i=0, victim=-1; i < index->PcCacheSize; i++)
+			if ((index->PcCache[i].block >= 0) && (&index->PcCache[i] != e) &&
+				((victim < 0) || (index->PcCache[i].stamp < index->PcCache[victim].stamp)))
+				victim = i;
+		if (victim < 0) break; // e alone exceeds the cap, it is kept until the next call
+		evict_pc_cache_entry(index, &index->PcCache[victim]);
+		}
+
+	return e;
+}
@@ -18,32 +18,35 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include "xbzip_types.h"
+#include "xbzip.h"
 
 /** Initialize the hash table according to the number of estimated
- *   tokens; the load factor is set to 10 and the lists are managed
- *   via the MTF-rule. 
+ *   tokens: since n is often a (large) upper bound, the table starts
+ *   from at most 2^13 slots and then doubles when half full.
  *
  * @param ht pointer to an (empty) hash table.
  * @param n estimated number of items to be inserted.
  */
 
-void HHashtable_init(HHash_table *ht, int n)
+void HHashtable_init(HHash_table *ht, TextInt n)
 {
   
   int i;
 
-  ht->size  = (int) (1.2 * n + 13);     // Load factor ~ 80%
+  for (ht->size = 16; (ht->size < 2 * n) && (ht->size < (1 << 13)); ht->size *= 2) ;
   ht->card = 0;
+  ht->nodes_size = 0;
+  ht->nodes = NULL;
+  arena_init(&(ht->arena));
 
-  ht->table = (Hash_nodeptr_array) malloc(ht->size * sizeof(Hash_node *));
+  ht->table = (Hash_slot *) malloc(ht->size * sizeof(Hash_slot));
 
   if (ht->table == NULL) {
     fprintf(stderr,"Fatal Error: Hash table allocation\n");
     exit(-1); }
 
   for (i=0; i < ht->size; i++)
-    ht->table[i] = NULL;
+    ht->table[i].id = -1;
 }
 
 
@@ -61,9 +64,10 @@ void HHashtable_print(HHash_table *ht)
   printf("\n\n================== Hash Table ====================\n");
   printf("Table size = %d, number of stored objects = %d\n\n",ht->size,ht->card);
 
-  for(i=0; i<ht->size;i++)
-	  for(p = ht->table[i]; p ; p = p->next)
-		printf("token = \"%s\", len= %d, code= %d\n", p->str,p->len_str,p->code);
+  for(i=0; i<ht->card;i++) {
+	p = &(ht->nodes[i]);
+	printf("token = \"%s\", len= %d, code= %d\n", p->str,p->len_str,p->code);
+	}
 }
 
 
@@ -71,101 +75,159 @@ void HHashtable_print(HHash_table *ht)
 /** Computes the hash value for the given string. The function was
     proposed by Ramakrishnais and Zobel in a paper appeared in:
     Int. Conf. on DB Systems for advanced applications, 1997.
+    The slot is given by the lower bits of the returned value.
  * @param s input string whose hash value has to be computed.
  * @param len length of s.
- * @param ht pointer to an hash table. 
  */
-int HHashtable_func(char *s, int len, HHash_table *ht)
+unsigned int HHashtable_func(char *s, int len)
 {   
-  register int hfn;
+  register unsigned int hfn;
   int hfi;
-  int table_size = ht->size;
 
   hfn = 11;
   for (hfi=0; hfi<len ; hfi++)
     hfn = hfn ^ ((hfn<<5) + (hfn>>2) + (unsigned char) *s++);
-  hfn = abs(hfn % table_size);
   return(hfn);
 }
 
 
+/** Returns the slot of the given string, with hash value h: either
+ * the slot of its entry or the empty slot where it must be inserted.
+ */
+Hash_slot *HHashtable_probe(char *s, int slen, unsigned int h, HHash_table *ht)
+{
+  Hash_slot *hs;
+  Hash_node *hn;
+  int i, mask = ht->size - 1;
+
+  for (i = h & mask; ; i = (i + 1) & mask) {
+    hs = &(ht->table[i]);
+    if (hs->id < 0) return(hs);
+    if (hs->hash == h) {
+      hn = &(ht->nodes[hs->id]);
+      if ((slen == hn->len_str) && (memcmp(s,hn->str,slen) == 0))
+        return(hs);
+      }
+    }
+}
+
+
+/** Doubles the number of slots, and re-inserts the entries by their
+ *  stored hash values (no token is read).
+ */
+void HHashtable_grow(HHash_table *ht)
+{
+  Hash_slot *old = ht->table;
+  int i, j, old_size = ht->size, mask;
+
+  ht->size *= 2;
+  mask = ht->size - 1;
+  ht->table = (Hash_slot *) malloc(ht->size * sizeof(Hash_slot));
+  if (ht->table == NULL) {
+    fprintf(stderr,"Fatal Error: Hash table allocation\n");
+    exit(-1); }
+
+  for (i=0; i < ht->size; i++)
+    ht->table[i].id = -1;
+  for (i=0; i < old_size; i++)
+    if (old[i].id >= 0) {
+      for (j = old[i].hash & mask; ht->table[j].id >= 0; j = (j + 1) & mask) ;
+      ht->table[j] = old[i];
+      }
+  free(old);
+}
+
+
 /** Searches for the given string into the passed hash table (NULL if not).
+ *  The returned entry stays valid until the next insertion.
  * @param s string to be searched.
  * @param slen length of s (to manage also the NULL char).
  * @param ht pointer to the hash table to be searched.
  */
 Hash_node *HHashtable_search(char *s, int slen, HHash_table *ht)
 {   
-  Hash_node *hsp;  
+  Hash_slot *hs;
 
-  for (hsp = ht->table[HHashtable_func(s,slen,ht)]; hsp; hsp = hsp->next)
-    if ((slen == hsp->len_str)  && (memcmp(s,hsp->str,slen) == 0)) 
-	return(hsp);
-  return((Hash_node *)0);
+  hs = HHashtable_probe(s, slen, HHashtable_func(s,slen), ht);
+  if (hs->id < 0) return((Hash_node *)0);
+  return(&(ht->nodes[hs->id]));
 }
 
 
-
-/** Inserts the token in the hash table and returns 1 if new, 0
- *  otherwise; it also updates its code field and its number 
- *  of occurrences. 
+/** Returns the id of the given string, which is inserted if new 
+ *  (with code 0): ids are given by insertion order, thus they are 
+ *  dense in [0, card-1]. It also updates the number of occurrences.
  *
  * @param s string to be inserted.
  * @param slen length of s (to manage also the NULL char).
  * @param ht pointer to an hash table, it will be updated.
  */
-int HHashtable_insert(char *s, int slen, int code, HHash_table *ht)   
+int HHashtable_intern(char *s, int slen, HHash_table *ht)   
 {   
-  int hiv;
+  unsigned int h;
+  int i;
+  Hash_slot *hs;
   Hash_node *hip;
-  Hash_node *table_head;
-  Hash_node *hip_pred;
-  char *token;
-
-  hiv = HHashtable_func(s,slen,ht);  // compute the hash value
-  hip = HHashtable_search(s,slen,ht);   // check string occurrence
-
-  if (hip) {
-    hip->count_occ += 1;
-    hip->code = code;
-    
-    // move-to-front the searched token
-    if (ht->table[hiv] != hip){
-
-      // Find hip predecessor which surely does exist
-      // because hip is not the head of the list
-      for (hip_pred = ht->table[hiv]; hip_pred->next != hip; 
-	   hip_pred = hip_pred->next) ;
-
-      hip_pred->next = hip->next;   // jump hip in the old list
-      table_head = ht->table[hiv];   // save the old head of the list-entry
-      ht->table[hiv] = hip;        // hip is the new head of the list
-      hip->next = table_head;         
-    }
 
-    return(0);
+  h = HHashtable_func(s,slen);      // compute the hash value once
+  hs = HHashtable_probe(s,slen,h,ht);   // check string occurrence
 
-  } else {    //------ The token is new -------
-    hip = (Hash_node *) malloc(sizeof(Hash_node));
-
-    token = (char *) malloc(slen+1);
-    memcpy(token,s,slen);
-	token[slen] = '\0';
+  if (hs->id >= 0) {
+    ht->nodes[hs->id].count_occ += 1;
+    return(hs->id);
+    }
 
-    if (hip == NULL){
+  //------ The token is new -------
+  if (ht->card == ht->nodes_size) {
+    ht->nodes_size = (ht->nodes_size) ? 2 * ht->nodes_size : 64;
+    ht->nodes = (Hash_node *) realloc(ht->nodes, ht->nodes_size * sizeof(Hash_node));
+    if (ht->nodes == NULL){
       fprintf(stderr,"Error: Insert hash table\n");
-	  exit(-1); } 
-
-    hip->len_str = slen;
-    hip->count_occ = 1;
-    hip->str = token;
-    hip->next = ht->table[hiv];
-    hip->code = code;
-	ht->table[hiv] = hip;
-    ht->card += 1;
+      exit(-1); } 
+    for (i=0; i < ht->card; i++)  // the inline tokens have moved
+      if (ht->nodes[i].len_str <= HASH_INLINE_LEN) 
+        ht->nodes[i].str = ht->nodes[i].inl;
+    }
+
+  hip = &(ht->nodes[ht->card]);
+  if (slen <= HASH_INLINE_LEN) {
+    memcpy(hip->inl,s,slen);
+    hip->inl[slen] = '\0';
+    hip->str = hip->inl;
+    } 
+  else 
+    hip->str = arena_strndup(&(ht->arena), s, slen);
+
+  hip->len_str = slen;
+  hip->count_occ = 1;
+  hip->code = 0;
+  hip->id = ht->card;
+  hs->hash = h;
+  hs->id = ht->card;
+  ht->card += 1;
+
+  if (2 * ht->card > ht->size) 
+    HHashtable_grow(ht);
 	
-    return(1);
-  }
+  return(ht->card - 1);
+}
+
+
+/** Inserts the token in the hash table and returns 1 if new, 0
+ *  otherwise; it also updates its code field and its number 
+ *  of occurrences. 
+ *
+ * @param s string to be inserted.
+ * @param slen length of s (to manage also the NULL char).
+ * @param ht pointer to an hash table, it will be updated.
+ */
+int HHashtable_insert(char *s, int slen, int code, HHash_table *ht)   
+{   
+  int card = ht->card, id;
+
+  id = HHashtable_intern(s, slen, ht);
+  ht->nodes[id].code = code;
+  return(ht->card > card);
 }
 
 
@@ -176,20 +238,11 @@ int HHashtable_insert(char *s, int slen, int code, HHash_table *ht)
  */
 void HHashtable_clear(HHash_table *ht)
 {
-  int i;
-
-  for ( i = 0; i < ht->size; i++ ) {
-    Hash_node *hn = ht->table[i];
-    while ( hn ) {
-      Hash_node *toFree = hn;
-      hn = hn->next;
-      free(toFree->str);
-      free(toFree);
-    }
-  }
+  arena_free(&(ht->arena));
+  free(ht->nodes);
+  ht->nodes = NULL;
+  ht->nodes_size = 0;
   ht->card = 0;
   ht->size = 0;
   free(ht->table);
 }
-
-
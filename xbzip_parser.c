@@ -38,7 +38,7 @@
 #define create_node(_u_,_TYPE_,_el_,_el_len_,_parent_,_pos_){			\
 	{																	\
 		if(ud->buffer_nodes_fill == BUFFER_NODES_SIZE){					\
-			ud->buffer_nodes = (Tree_node *) malloc(sizeof(Tree_node) * BUFFER_NODES_SIZE);	\
+			ud->buffer_nodes = (Tree_node *) arena_alloc(ud->arena, sizeof(Tree_node) * BUFFER_NODES_SIZE);	\
 			ud->buffer_nodes_fill=0;									\
 			}															\
 		_u_ = (Tree_node *)ud->buffer_nodes;							\
@@ -53,19 +53,6 @@
 		_u_->last_child = NULL;											\
 		_u_->leftmost_child = NULL;										\
 		_u_->next_sibling = NULL;										\
-		_u_->upward_path = NULL;										\
-		if(_parent_ != NULL) {											\
-			if (_parent_->upward_path != NULL){							\
-				_u_->upward_path = (char *) malloc(_parent_->len_str + strlen(_parent_->upward_path) + 1); \
-				memcpy(_u_->upward_path,_parent_->str,_parent_->len_str);	\
-				memcpy(_u_->upward_path + _parent_->len_str,_parent_->upward_path, strlen(_parent_->upward_path));			\
-				_u_->upward_path[_parent_->len_str + strlen(_parent_->upward_path)]= '\0';				\
-				} else {												\
-				_u_->upward_path = (char *) malloc(_parent_->len_str + 1); \
-				memcpy(_u_->upward_path,_parent_->str,_parent_->len_str);	\
-				_u_->upward_path[_parent_->len_str]= '\0';				\
-					}													\
-			}															\
 		if(_parent_ != NULL) treeinsert_child(_parent_,_u_);			\
 	} }
 
@@ -75,12 +62,13 @@
 // ------------------------------------------------------------------------
 // A macro to manage memory for attr and their values
 // If needed, the current buffer is left and a new buffer is allocated
+// (all of them in the arena, released with it)
 // -------------------------------------------------------------------------
 
 #define update_ta_buffer(_len_){														\
-	if(ud->ta_buffer_fill + _len_ + 1 > ud->ta_buffer_size){							\
-		ud->ta_buffer_size = (ceil(_len_ / BUFFER_TA_SIZE) + 2) * BUFFER_TA_SIZE;		\
-		ud->ta_buffer = malloc(sizeof(UChar) * ud->ta_buffer_size);						\
+	if(ud->ta_buffer_fill + (_len_) + 1 > ud->ta_buffer_size){							\
+		ud->ta_buffer_size = ((_len_) / BUFFER_TA_SIZE + 2) * BUFFER_TA_SIZE;			\
+		ud->ta_buffer = arena_alloc(ud->arena, sizeof(UChar) * ud->ta_buffer_size);		\
 		ud->ta_buffer_fill=0; }	}			
 
 
@@ -92,18 +80,72 @@
 	_x_->top_stack = -1;														\
 	_x_->counter = 0;															\
 	_x_->parser = p;															\
+	_x_->arena = arena;															\
 	_x_->main_text = text;														\
 	_x_->text_buffer_len = 0;													\
-	_x_->ta_buffer = (UChar *) malloc(sizeof(UChar) * BUFFER_TA_SIZE);			\
+	_x_->ta_buffer = (UChar *) arena_alloc(arena, sizeof(UChar) * BUFFER_TA_SIZE);	\
 	_x_->ta_buffer_size = BUFFER_TA_SIZE;										\
 	_x_->ta_buffer_fill = 0;													\
-	_x_->buffer_nodes = (Tree_node *) malloc(sizeof(Tree_node) * BUFFER_NODES_SIZE); \
+	_x_->buffer_nodes = (Tree_node *) arena_alloc(arena, sizeof(Tree_node) * BUFFER_NODES_SIZE); \
 	_x_->buffer_nodes_fill=0;													\
 	_x_->empty_tag_flag = 0;															\
 	_x_->empty_tag_string[0] = (UChar) 255;										\
 	_x_->empty_tag_string[1] = (UChar) 0;										\
 	}
 
+
+//**************************************************************************
+// The bytes of the current parser event.
+//
+// If the whole text is in memory they are addressed by the (absolute)
+// byte index; otherwise they are in the buffer which Expat is parsing
+//**************************************************************************
+char *event_text(user_data *ud)
+{
+	const char *buf;
+	int offset, size;
+
+	if (ud->main_text)
+		return (char *) ud->main_text + XML_GetCurrentByteIndex(ud->parser);
+
+	buf = XML_GetInputContext(ud->parser, &offset, &size);
+	if (! buf)
+		fatal_error("Expat has been compiled without XML_CONTEXT_BYTES! (EVENT_TEXT)\n");
+	return (char *) buf + offset;
+}
+
+//**************************************************************************
+// Appends slen bytes to the pending text.
+//
+// If the whole text is in memory the pending text is a piece of it,
+// otherwise it is copied into the ta_buffer (and moved to a new one 
+// if it does not fit)
+//**************************************************************************
+void append_text(user_data *ud, char *s, int slen)
+{
+	UChar *old;
+
+	if (ud->main_text) {
+		if(ud->text_buffer_len == 0)
+			ud->text_buffer = (UChar *) s;
+		ud->text_buffer_len += slen;
+		return;
+		}
+
+	if(ud->text_buffer_len == 0)
+		ud->text_buffer = ud->ta_buffer + ud->ta_buffer_fill;
+	if(ud->ta_buffer_fill + slen + 1 > ud->ta_buffer_size){
+		old = ud->text_buffer;
+		update_ta_buffer(ud->text_buffer_len + slen);
+		memcpy(ud->ta_buffer, old, ud->text_buffer_len);
+		ud->text_buffer = ud->ta_buffer;
+		ud->ta_buffer_fill = ud->text_buffer_len;
+		}
+	memcpy(ud->ta_buffer + ud->ta_buffer_fill, s, slen);
+	ud->ta_buffer_fill += slen;
+	ud->text_buffer_len += slen;
+}
+
 //**************************************************************************
 // XML handlers
 //
@@ -123,9 +165,7 @@ void default_hndl(void *data, const char *s, int slen)
 	if(ud == NULL)
 		fatal_error("Unspecified -data- in char_hndl() function\n");
 
-	if(ud->text_buffer_len == 0)
-		ud->text_buffer = ud->main_text + XML_GetCurrentByteIndex(ud->parser);
-	ud->text_buffer_len += slen;
+	append_text(ud, event_text(ud), slen);
 
 	ud->empty_tag_flag = 0; // we are not in an empty tag
 
@@ -137,6 +177,7 @@ void start_hndl(void *data, const char *el, const char **attr)
 	register int i,j;
 	Tree_node *u,*v;
 	user_data *ud;
+	char *tag;
 
 	ud = (user_data *) data;
 	if(ud == NULL)
@@ -151,9 +192,17 @@ void start_hndl(void *data, const char *el, const char **attr)
 		ud->text_buffer_len=0;
 		}
 
-	// create node for current Tag as '<Tag'
-	create_node(u, TAGATTR, ud->main_text + XML_GetCurrentByteIndex(ud->parser), strlen(el)+1, 
-				ud->stack_nodes[ud->top_stack], ud->counter);
+	// create node for current Tag as '<Tag', kept in the text if it is in memory
+	tag = event_text(ud);
+	j = strlen(el)+1;
+	if (! ud->main_text) {
+		update_ta_buffer(j+1);
+		memcpy(ud->ta_buffer + ud->ta_buffer_fill, tag, j);
+		ud->ta_buffer[ud->ta_buffer_fill + j] = '\0';
+		tag = (char *) ud->ta_buffer + ud->ta_buffer_fill;
+		ud->ta_buffer_fill += (j+1);
+		}
+	create_node(u, TAGATTR, tag, j, ud->stack_nodes[ud->top_stack], ud->counter);
 
 	ud->stack_nodes[++ud->top_stack] = u;
 
@@ -187,7 +236,6 @@ void start_hndl(void *data, const char *el, const char **attr)
 
 void end_hndl(void *data, const char *el) 
 {
-	char *strndup(const char *s, size_t n);
 	Tree_node *u;
 	user_data *ud;
 
@@ -199,7 +247,7 @@ void end_hndl(void *data, const char *el)
 		if (ud->text_buffer_len != 0)
 			fatal_error("\nI'm in an empty tag but the text buffer is not empty! (END_HNDL)\n\n");
 		ud->text_buffer_len = 1;
-		ud->text_buffer = strndup(ud->empty_tag_string,2);
+		ud->text_buffer = (UChar *) arena_strndup(ud->arena, (char *) ud->empty_tag_string, 1);
 		ud->empty_tag_flag = 0; // reset
 		}
 
@@ -230,15 +278,13 @@ void char_hndl(void *data, const char *s, int slen)
 	ud->empty_tag_flag = 0; // we are not in an empty tag
 
 	// Catch internal/external entities and keep them expanded
-	if(ud->main_text[XML_GetCurrentByteIndex(ud->parser)] == '&'){
-		s=ud->main_text+XML_GetCurrentByteIndex(ud->parser);
+	s = event_text(ud);
+	if(s[0] == '&'){
 		for(slen=0; s[slen] != ';' ; slen++) ;
 		slen++;
 		}
 
-	if(ud->text_buffer_len == 0)
-		ud->text_buffer = ud->main_text + XML_GetCurrentByteIndex(ud->parser);
-	ud->text_buffer_len += slen;
+	append_text(ud, (char *) s, slen);
 }  
 
 
@@ -249,16 +295,20 @@ void char_hndl(void *data, const char *s, int slen)
 // 
 // We proceed by parsing the XML source via Expat and then constructing
 // a light-space tree. The key idea is to "merge" text parts which come
-// split due to parser features.
+// split due to parser features. The nodes and the copied tokens are 
+// taken from the arena, and released with it.
 //**************************************************************************
 
 
-Tree_node *xml2tree(UChar *text, int text_len, int *treesize)
+//**************************************************************************
+// Creates the parser and the root of the tree; text is NULL if the
+// XML document is not kept in memory
+//**************************************************************************
+Tree_node *xml2tree_init(user_data *ud, arena_type *arena, UChar *text)
 {	
 	XML_Parser p;
 	char *t;
 	Tree_node *root,*rp = NULL;
-	user_data ud[1];
 
 	p = XML_ParserCreate(NULL);
 	if (! p) fatal_error("Error in parser allocation!");
@@ -271,40 +321,83 @@ Tree_node *xml2tree(UChar *text, int text_len, int *treesize)
 	XML_SetUserData(p, (void *) ud);
 
 	// Create the root of the tree
-	t = (UChar *) malloc(sizeof(UChar) * 10);
-	memcpy(t,"<xml_xbwt",9);
-	t[9]='\0';
+	t = arena_strndup(arena, "<xml_xbwt", 9);
 	create_node(root,TAGATTR,t,strlen(t),rp, ud->counter);
 	ud->stack_nodes[++ud->top_stack] = root;
 
-	// parse the text in chunks < max(int), to keep XML_Parse happy
-    /*
-    unsigned long i = 0;
-    int bufsize = 10000000; // 10M chunks
-    bool done;
-    do {
-
-        done = i + bufsize > text_size; // checks if we've got the last bufferfull
-
-        if (! XML_Parse(p, text[i], bufsize, done)) {
-            fprintf(stderr, "Parse error at line %d:\n%s\n",
-                    XML_GetCurrentLineNumber(p),
-                    XML_ErrorString(XML_GetErrorCode(p)));
-            exit(-1);
-        }
-
-        i += bufsize;
-        
-	} while (!done);
-    */
-
-    if (! XML_Parse(p, text, text_len, 1)) {
-        fprintf(stderr, "Parse error at line %d:\n%s\n",
-                XML_GetCurrentLineNumber(p),
-                XML_ErrorString(XML_GetErrorCode(p)));
-        exit(-1);
-    }
-    
+	return root;
+}
+
+
+Tree_node *xml2tree(arena_type *arena, UChar *text, TextInt text_len, TextInt *treesize)
+{	
+	XML_Parser p;
+	TextInt i, chunk;
+	Tree_node *root;
+	user_data ud[1];
+
+	root = xml2tree_init(ud, arena, text);
+	p = ud->parser;
+
+	// parse the text in chunks < max(int), to keep XML_Parse happy:
+	// the handlers address the text by the (absolute) byte index
+	i = 0;
+	do {
+		chunk = min(text_len - i, XML_CHUNK_SIZE);
+		if (! XML_Parse(p, (char *) text + i, (int) chunk, i + chunk == text_len)) {
+			fprintf(stderr, "Parse error at line %d:\n%s\n",
+					(int) XML_GetCurrentLineNumber(p),
+					XML_ErrorString(XML_GetErrorCode(p)));
+			exit(-1);
+			}
+		i += chunk;
+		} while (i < text_len);
+
+	// keep track of the number of tree nodes and leaves
+	*treesize = ud->counter;
+	XML_ParserFree(p);
+	return root;
+}
+
+
+//**************************************************************************
+// As xml2tree(), the XML document being read from the file descriptor fd
+// (a file, a pipe or a socket) up to its end.
+//
+// The document is fed to Expat in blocks of XML_STREAM_SIZE bytes, and 
+// the tokens are copied into the ta_buffers as they are parsed: thus only 
+// the DOM tree is kept in memory. Its length is returned in text_len.
+//**************************************************************************
+Tree_node *xml2tree_fd(arena_type *arena, int fd, TextInt *text_len, TextInt *treesize)
+{	
+	XML_Parser p;
+	void *buf;
+	ssize_t n;
+	Tree_node *root;
+	user_data ud[1];
+
+	root = xml2tree_init(ud, arena, NULL);
+	p = ud->parser;
+
+	*text_len = 0;
+	do {
+		buf = XML_GetBuffer(p, XML_STREAM_SIZE);
+		if (! buf) fatal_error("Error in allocating the parser buffer! (XML2TREE_FD)\n");
+		do {
+			n = read(fd, buf, XML_STREAM_SIZE);
+			} while ((n < 0) && (errno == EINTR));
+		if (n < 0) fatal_error("Error in reading the XML document! (XML2TREE_FD)\n");
+		if (*text_len > TEXTINT_MAX - n)
+			fatal_error("Documents larger than 2Gb need the 64-bit build (-DXBZIP_64)! (XML2TREE_FD)\n");
+		*text_len += n;
+		if (! XML_ParseBuffer(p, (int) n, n == 0)) {
+			fprintf(stderr, "Parse error at line %d:\n%s\n",
+					(int) XML_GetCurrentLineNumber(p),
+					XML_ErrorString(XML_GetErrorCode(p)));
+			exit(-1);
+			}
+		} while (n > 0);
+
 	// keep track of the number of tree nodes and leaves
 	*treesize = ud->counter;
 	XML_ParserFree(p);
@@ -318,7 +411,7 @@ Tree_node *xml2tree(UChar *text, int text_len, int *treesize)
 // Pre-order visit of the DOM tree, in order to ensure that first
 // visited nodes are put in front of the array for subsequent "stable" sort.
 //**************************************************************************
-void tree2nodearray(Tree_node *u, Tree_node *array[], int *cursor)
+void tree2nodearray(Tree_node *u, Tree_node *array[], TextInt *cursor)
 {
 	if(!u) {return;}
 	else { 
@@ -329,3 +422,135 @@ void tree2nodearray(Tree_node *u, Tree_node *array[], int *cursor)
 	tree2nodearray(u->next_sibling, array, cursor);
 }
 
+
+
+//**************************************************************************
+// Sorts the (pre-order) node array according to the PI-component,
+// that is the upward path of tag-attr labels, stable w.r.t. position.
+//
+// We never materialize the upward paths. Each TAG-ATTR node gets the
+// rank of its token (see PItoken_cmp), so that the PI-component of a
+// node is the sequence of token ranks from its parent up to the root.
+// These sequences are ranked by doubling: at step k the rank of a
+// node covers the 2^k tokens above it, and is computed by radix-sorting
+// the pairs <rank(u), rank(2^k-th ancestor of u)>. The final order is
+// obtained by a counting sort of the nodes on the rank of their parent.
+// It takes O(n log depth) time and O(n) extra words.
+//
+// If PIrank is not NULL, PIrank[i] is set to the rank of the PI-component
+// of the i-th sorted node (0 for the root): equal ranks iff equal paths.
+//**************************************************************************
+void sort_nodearray(Tree_node *array[], TextInt n, TextInt *PIrank)
+{
+	Tree_node **reps, **sorted, *u;
+	TextInt *rank, *jump, *second, *order, *tmp, *count;
+	TextInt i, j, k, m, r, numreps, maxrank;
+	int pairs_done;
+	HHash_table ht;
+
+	rank = (TextInt *) malloc(sizeof(TextInt) * n);
+	jump = (TextInt *) malloc(sizeof(TextInt) * n);
+	second = (TextInt *) malloc(sizeof(TextInt) * n);
+	order = (TextInt *) malloc(sizeof(TextInt) * n);
+	tmp = (TextInt *) malloc(sizeof(TextInt) * n);
+	count = (TextInt *) malloc(sizeof(TextInt) * (n + 1));
+	reps = (Tree_node **) malloc(sizeof(Tree_node *) * n);
+	if ( !rank || !jump || !second || !order || !tmp || !count || !reps )
+		fatal_error("Error in allocating the sorting arrays! (SORT_NODEARRAY)\n");
+
+	// Positions are the pre-order numbers 0..n-1 of the nodes,
+	// and they are used as indexes in rank[] and jump[].
+	// One representative per distinct token, the root is kept apart
+	// since its token is the only one terminated by '\0'.
+	// For now rank[] keeps the id of the token in the hash table
+	HHashtable_init(&ht, n);
+	for(i=0, m=0, numreps=0; i < n; i++){
+		u = array[i];
+		if (u->type != TAGATTR) continue;
+		order[m++] = u->position;
+		jump[u->position] = (u->parent) ? u->parent->position : -1;
+		if (u->parent == NULL) { reps[numreps++] = u; continue; }
+		k = ht.card;
+		rank[u->position] = HHashtable_intern(u->str, u->len_str, &ht);
+		if (ht.card > k) reps[numreps++] = u;
+		}
+	HHashtable_clear(&ht);
+
+	// Rank the tokens, 0 is reserved to the empty sequence
+	// (second[] maps the ids to the ranks)
+	qsort(reps, numreps, sizeof(Tree_node *), PItoken_cmp);
+	for(i=0; i < numreps; i++){
+		if (reps[i]->parent == NULL) rank[reps[i]->position] = i+1;
+		else second[rank[reps[i]->position]] = i+1;
+		}
+	for(i=0; i < n; i++){
+		u = array[i];
+		if ((u->type == TAGATTR) && (u->parent != NULL))
+			rank[u->position] = second[rank[u->position]];
+		}
+	free(reps);
+	maxrank = numreps;
+
+	// Doubling steps over the TAG-ATTR nodes, until all ranks 
+	// are distinct or all of them cover the whole upward path
+	for(pairs_done = 0; (maxrank < m) && (!pairs_done); ){
+
+		pairs_done = 1;
+		for(i=0; i < m; i++){
+			j = order[i];
+			second[j] = (jump[j] >= 0) ? rank[jump[j]] : 0;
+			if (jump[j] >= 0) pairs_done = 0;
+			}
+		if (pairs_done) break;
+
+		// Radix sort of the pairs: by second component, then (stable) by first one
+		for(k=0; k <= maxrank; k++) count[k]=0;
+		for(i=0; i < m; i++) count[second[order[i]]]++;
+		for(k=0, r=0; k <= maxrank; k++) { j = count[k]; count[k] = r; r += j; }
+		for(i=0; i < m; i++) tmp[count[second[order[i]]]++] = order[i];
+
+		for(k=0; k <= maxrank; k++) count[k]=0;
+		for(i=0; i < m; i++) count[rank[tmp[i]]]++;
+		for(k=0, r=0; k <= maxrank; k++) { j = count[k]; count[k] = r; r += j; }
+		for(i=0; i < m; i++) order[count[rank[tmp[i]]]++] = tmp[i];
+
+		// New ranks (in tmp[], since the pairs refer to the old ones)
+		for(i=0, r=0; i < m; i++){
+			j = order[i];
+			if ( (i == 0) || (rank[j] != rank[order[i-1]]) || 
+				 (second[j] != second[order[i-1]]) ) r++;
+			tmp[j] = r;
+			}
+		for(i=0; i < m; i++) rank[order[i]] = tmp[order[i]];
+		maxrank = r;
+
+		// Double the jumps (in tmp[], for the same reason)
+		for(i=0; i < m; i++){
+			j = order[i];
+			tmp[j] = (jump[j] >= 0) ? jump[jump[j]] : -1;
+			}
+		for(i=0; i < m; i++) jump[order[i]] = tmp[order[i]];
+		}
+
+	// Counting sort of the nodes on the rank of their parent
+	// (the root has no parent and goes first): it is stable, hence
+	// nodes with the same PI-component are left in pre-order
+	sorted = (Tree_node **) malloc(sizeof(Tree_node *) * n);
+	if (!sorted) fatal_error("Error in allocating the sorted array! (SORT_NODEARRAY)\n");
+	for(k=0; k <= maxrank; k++) count[k]=0;
+	for(i=0; i < n; i++) {
+		u = array[i];
+		count[(u->parent) ? rank[u->parent->position] : 0]++;
+		}
+	for(k=0, r=0; k <= maxrank; k++) { j = count[k]; count[k] = r; r += j; }
+	for(i=0; i < n; i++) {
+		u = array[i];
+		sorted[count[(u->parent) ? rank[u->parent->position] : 0]++] = u;
+		}
+	memcpy(array, sorted, sizeof(Tree_node *) * n);
+	if (PIrank) 
+		for(i=0; i < n; i++) 
+			PIrank[i] = (array[i]->parent) ? rank[array[i]->parent->position] : 0;
+
+	free(sorted); free(count); free(tmp); free(order); free(second); free(jump); free(rank);
+}
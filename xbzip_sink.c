@@ -0,0 +1,181 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Paolo Ferragina, Universit di Pisa             *
+ *   Contact address: ferragina@di.unipi.it								   *
+ *                                                                         *
+ *   Description. Sinks receiving the reconstructed XML text               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "xbzip.h"
+
+/* ----------------------------------------------------------------------------
+	Initializes a sink giving its bytes to write(handle, buf, len), 
+	at most SINK_BUFFER_SIZE at a time
+	--------------------------------------------------------------------------- */
+void sink_init(xbzip_sink_type *sink, sink_write_type write, void *handle)
+{
+	sink->Write = write;
+	sink->Handle = handle;
+	sink->Fill = 0;
+	sink->Written = 0;
+	sink->Fd = -1;
+	sink->Mem = NULL;
+	sink->MemSize = 0;
+	sink->Buffer = (UChar *) malloc(SINK_BUFFER_SIZE);
+	if (!sink->Buffer)
+		fatal_error("Error in allocating the sink buffer! (SINK_INIT)\n");
+}
+
+
+/* ----------------------------------------------------------------------------
+	Initializes a sink writing to the file descriptor fd (a file, a pipe, 
+	a socket or stdout)
+	--------------------------------------------------------------------------- */
+void sink_init_fd(xbzip_sink_type *sink, int fd)
+{
+	sink_init(sink, sink_write_fd, (void *) sink);
+	sink->Fd = fd;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Initializes a sink collecting the text in memory, size is the expected
+	length of the text (the memory is enlarged if needed). 
+	The text is then taken by sink_take_mem()
+	--------------------------------------------------------------------------- */
+void sink_init_mem(xbzip_sink_type *sink, TextInt size)
+{
+	sink_init(sink, sink_write_mem, (void *) sink);
+	sink->MemSize = max(size, 1) + 1;	// room for the ending \0
+	sink->Mem = (UChar *) malloc(sink->MemSize);
+	if (!sink->Mem)
+		fatal_error("Error in allocating the text space! (SINK_INIT_MEM)\n");
+}
+
+
+/* ----------------------------------------------------------------------------
+	Appends len bytes to the sink: the long strings bypass the buffer
+	--------------------------------------------------------------------------- */
+void sink_put(xbzip_sink_type *sink, UChar *s, int len)
+{
+	if (sink->Fill + len > SINK_BUFFER_SIZE) {
+		sink_flush(sink);
+		if (len >= SINK_BUFFER_SIZE) {
+			sink->Write(sink->Handle, s, len);
+			sink->Written += len;
+			return;
+			}
+		}
+	memcpy(sink->Buffer + sink->Fill, s, len);
+	sink->Fill += len;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Writes the buffered bytes
+	--------------------------------------------------------------------------- */
+void sink_flush(xbzip_sink_type *sink)
+{
+	if (sink->Fill == 0) return;
+	sink->Write(sink->Handle, sink->Buffer, sink->Fill);
+	sink->Written += sink->Fill;
+	sink->Fill = 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Enlarges the memory of a memory sink to take a text of the given size,
+	so that it is written without reallocations. No effect on other sinks
+	--------------------------------------------------------------------------- */
+void sink_reserve(xbzip_sink_type *sink, TextInt size)
+{
+	UChar *stmp;
+
+	if ((sink->Write != sink_write_mem) || (size + 1 <= sink->MemSize)) return;
+	stmp = (UChar *) realloc(sink->Mem, size + 1);
+	if (!stmp) fatal_error("Error in allocating the text space! (SINK_RESERVE)\n");
+	sink->Mem = stmp;
+	sink->MemSize = size + 1;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Writes the buffered bytes and frees the buffer. The file descriptor 
+	of a file sink is not closed, the text of a memory sink is kept
+	--------------------------------------------------------------------------- */
+void sink_close(xbzip_sink_type *sink)
+{
+	sink_flush(sink);
+	free(sink->Buffer);
+	sink->Buffer = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Returns the text collected by a closed memory sink, terminated by \0 
+	(not counted in text_len). The caller frees it.
+	--------------------------------------------------------------------------- */
+void sink_take_mem(xbzip_sink_type *sink, UChar *text[], TextInt *text_len)
+{
+	if (sink->Write != sink_write_mem)
+		fatal_error("Not a memory sink! (SINK_TAKE_MEM)\n");
+	sink->Mem[sink->Written] = '\0';
+	*text = sink->Mem;
+	*text_len = sink->Written;
+	sink->Mem = NULL;
+	sink->MemSize = 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+	Write function of the file sink (handle is the sink): short writes 
+	and interrupted ones are resumed
+	--------------------------------------------------------------------------- */
+void sink_write_fd(void *handle, UChar *buf, int len)
+{
+	xbzip_sink_type *sink = (xbzip_sink_type *) handle;
+	ssize_t w;
+
+	while (len > 0) {
+		w = write(sink->Fd, buf, len);
+		if (w < 0) {
+			if (errno == EINTR) continue;
+			fatal_error("Error in writing the output! (SINK_WRITE_FD)\n");
+			}
+		buf += w;
+		len -= (int) w;
+		}
+}
+
+
+/* ----------------------------------------------------------------------------
+	Write function of the memory sink (handle is the sink): the memory 
+	is doubled when the expected length is exceeded
+	--------------------------------------------------------------------------- */
+void sink_write_mem(void *handle, UChar *buf, int len)
+{
+	xbzip_sink_type *sink = (xbzip_sink_type *) handle;
+	UChar *stmp;
+
+	if (sink->Written + len + 1 > sink->MemSize) {
+		sink->MemSize = max(2 * sink->MemSize, sink->Written + len + 1);
+		stmp = (UChar *) realloc(sink->Mem, sink->MemSize);
+		if (!stmp) fatal_error("Error in enlarging the text space! (SINK_WRITE_MEM)\n");
+		sink->Mem = stmp;
+		}
+	memcpy(sink->Mem + sink->Written, buf, len);
+}
@@ -36,6 +36,8 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
 #include <expat.h>
 
 
@@ -49,6 +51,16 @@ typedef unsigned long long	UInt64;
 #define True   ((Bool)1)
 #define False  ((Bool)0)
 
+// Lengths, counts and positions ranging over the whole document:
+// 64-bit in the build with -DXBZIP_64, for documents larger than 2Gb
+#ifdef XBZIP_64
+typedef long long			TextInt;
+#define TEXTINT_MAX			0x7FFFFFFFFFFFFFFFLL
+#else
+typedef int					TextInt;
+#define TEXTINT_MAX			0x7FFFFFFF
+#endif
+
 
 /* ---------- costants ----------- */
 
@@ -63,19 +75,51 @@ typedef unsigned long long	UInt64;
 
 #define MAX_NESTING			100000
 
-#define BUFFER_TA_SIZE		1024 * 1024 //blocks of 1Mb
-#define BUFFER_NODES_SIZE	50000       // about 1Mb space (sizeof = 28 bytes)
+#define LAST_COMPRESSED		0			// Slast in bigbzip-compressed blocks
+#define LAST_BITVECTOR		1			// Slast as a plain bitvector
+#define ALPHA_COMPRESSED	0			// Salpha in bigbzip-compressed blocks
+#define ALPHA_WAVELET		1			// Salpha codes in a wavelet matrix
+
+#define BV_SUPER_BITS		512			// bits in a rank superblock of a bitvector
+#define BV_SELECT_SAMPLE	512			// 0s (1s) between two select samples
+
+#define BUFFER_TA_SIZE		(1024 * 1024) //blocks of 1Mb
+#define BUFFER_NODES_SIZE	50000       // about 3Mb space (sizeof = 56 bytes)
+#define ARENA_BLOCK_SIZE	(1 << 22)	// bytes of an arena block (4Mb)
+#define ARENA_ALIGN			16			// alignment of the arena allocations
+#define HASH_INLINE_LEN		15			// longest token kept in a hash entry
+
+#define XML_CHUNK_SIZE		(1 << 30)	// bytes given to XML_Parse at once
+#define XML_STREAM_SIZE		(1 << 20)	// bytes read at once from a stream
+#define SINK_BUFFER_SIZE	(1 << 16)	// bytes collected before a sink write
+#define DATA_CHUNK_SIZE		(1 << 30)	// bytes given to PPMd at once
+#define DATA_PPMD			0			// coder of the streams: PPMd
+#define DATA_BIGBZIP		1			// or bigbzip (see data_compressor.c)
+#define PROLOGUE_ITEMS		7			// numbers in the prologue of a compressed file
+#define WIDE_PROLOGUE		0xFFFFFFFF	// first word of a 64-bit prologue
 
 /* ------------- global variables ---------- */
 extern int Verbose;
 extern int NUM1_IN_BLOCK;
 extern int BLOCK_ALPHA_LEN;
+extern int BLOCK_CACHE_SIZE;
+extern int NUM_THREADS;
+extern int DATA_CODER;
+extern int DATA_BLOCK_LEN;
+extern int LAST_TYPE;
+extern int ALPHA_TYPE;
 extern int Last_Block_Counter;
 extern int Last_Byte_Counter;
 extern int Alpha_Block_Counter;
 extern int Alpha_Byte_Counter;
 extern int Pcdata_Block_Counter;
 extern int Pcdata_Byte_Counter;
+extern int Last_Cache_Hits;
+extern int Last_Cache_Misses;
+extern int Alpha_Cache_Hits;
+extern int Alpha_Cache_Misses;
+extern int Pcdata_Cache_Hits;
+extern int Pcdata_Cache_Misses;
 
 
 // ------------------------------------------------------------
@@ -84,9 +128,8 @@ extern int Pcdata_Byte_Counter;
 typedef struct Tree_node {
   char	*str;          // token
   int len_str;         // length of the token (to manage also NULL)
-  int position;       // left-to-right numbering for "stable" sort
+  TextInt position;   // left-to-right numbering for "stable" sort
   int type;			  // TAGATTR or TEXT (for textual content and attribute value)
-  char  *upward_path;  // sequence of tag-attr labels according to our scheme with <,@
   struct Tree_node *parent; // parent for subsequent sorting phase
   struct Tree_node *leftmost_child;    // pointer to the leftmost child
   struct Tree_node *last_child;    // pointer to the last child (for fast insertion)
@@ -94,11 +137,57 @@ typedef struct Tree_node {
 } Tree_node;
 
 
+// ------------------------------------------------------------
+// Arena: memory taken in blocks of ARENA_BLOCK_SIZE bytes (or in
+// a block of its own for a larger request) and released at once
+// ------------------------------------------------------------
+typedef struct arena_block {
+	struct arena_block *next;
+	size_t size;			// usable bytes, following the header
+	size_t fill;			// bytes in use
+} arena_block;
+
+typedef struct arena_type {
+	arena_block *first;		// list of the blocks
+	arena_block *current;	// block serving the allocations
+} arena_type;
+
+// ------------------------------------------------------------
+// Context of the (de)compression jobs: the DOM tree, its tokens and
+// the XBWT arrays of a job live in its arena, which is emptied when
+// the job ends and can be reused by the next one
+// ------------------------------------------------------------
+typedef struct xbzip_context_type {
+	arena_type Arena;
+} xbzip_context_type;
+
+// ------------------------------------------------------------
+// Sink receiving a reconstructed text as it is produced: the bytes are
+// collected in a buffer of SINK_BUFFER_SIZE and then given to Write
+// (see xbzip_sink.c for the sinks writing to a file or to memory)
+// ------------------------------------------------------------
+typedef void (*sink_write_type)(void *handle, UChar *buf, int len);
+
+typedef struct xbzip_sink_type {
+	sink_write_type Write;
+	void *Handle;			// first argument of Write
+	UChar *Buffer;
+	int Fill;				// bytes in Buffer, not yet written
+	TextInt Written;		// bytes given to Write so far
+	int Fd;					// for the file sink
+	UChar *Mem;				// for the memory sink: the text, 
+	TextInt MemSize;		// its allocated length (Written is its length)
+} xbzip_sink_type;
+
+#define SINK_PUTC(s,c)	{ if ((s)->Fill == SINK_BUFFER_SIZE) sink_flush(s); \
+						  (s)->Buffer[(s)->Fill++] = (UChar) (c); }
+
 // ------------------------------------------------------------
 // Data structure passed through all XML parsing functions
 // ------------------------------------------------------------
 typedef struct user_data {
 	XML_Parser parser;
+	arena_type *arena;		// for the tree nodes and the tokens
 	Tree_node *stack_nodes[MAX_NESTING];
 	Tree_node *buffer_nodes;
 	int buffer_nodes_fill;  //size is BUFFER_NODES_SIZE
@@ -108,7 +197,7 @@ typedef struct user_data {
 	UChar *ta_buffer;
 	int ta_buffer_fill;
 	int ta_buffer_size;
-	int counter;
+	TextInt counter;
 	UChar *main_text;
 	int empty_tag_flag;  //flag 
 	UChar empty_tag_string[2]; // Special string indicating an empty tag
@@ -122,13 +211,16 @@ typedef struct xbwt_type {
 	UChar *Stype;		
 	UChar **Salpha;			
 	int   *LenSalpha;
-	int TextLength;
-	int SItemsNum;
-	int PcdataItems;
-	int PcdataTotLen;
-	int SalphaTotLen;  // NOT counting the Pcdata 
-	int TagAttrItemsTot;
+	int   *Scode;			// lexicographic code of the TAG-ATTR names (-1 for TEXT), see xbwtstr2xbwt
+	TextInt TextLength;
+	TextInt SItemsNum;
+	TextInt PcdataItems;
+	TextInt PcdataTotLen;
+	TextInt SalphaTotLen;  // NOT counting the Pcdata 
+	TextInt TagAttrItemsTot;
 	int TagAttrItemsCard;
+	TextInt *PartitionArray;	// #Pcdata items in each group having the same upward path
+	TextInt PartitionCount;	// #groups (NULL and 0 if not computed)
 } xbwt_type;
 
 
@@ -139,71 +231,269 @@ typedef struct xbwt_string_type {
 	UChar *lastStr;		
 	UChar *alphaStr;		
 	UChar *pcdataStr;		
-	int lastLen;
-	int alphaLen;
-	int pcdataLen;
-	int TextLength;
-	int SItemsNum;
+	TextInt lastLen;
+	TextInt alphaLen;
+	TextInt pcdataLen;
+	TextInt TextLength;
+	TextInt SItemsNum;
 	int TagAttrItemsCard;
-	int PcdataItems;
+	TextInt PcdataItems;
+	TextInt *PartitionArray;	// as in xbwt_type, used to build the Pcdata index
+	TextInt PartitionCount;
+	int *alphaCodes;		// as Scode in xbwt_type, if the decompressor knows them (else NULL)
 } xbwt_string_type;
 
 
+// ------------------------------------------------------------
+// (De)compression of the XBWT streams by data_(de)compress, 
+// possibly run by distinct threads of a pool of bigbzip (see 
+// start_data_jobs). 
+// ------------------------------------------------------------
+#define MAX_DATA_JOBS		3			// one per stream: Last, Salpha, Pcdata
+
+typedef struct data_job_type {
+	UChar *src;
+	TextInt srcLen;
+	UChar **dest;			// allocated by data_(de)compress
+	TextInt *destLen;
+	int decompress;			// 1 for data_decompress, 0 for data_compress
+} data_job_type;
+
+typedef struct data_jobs_type {
+	data_job_type job[MAX_DATA_JOBS];
+	int num;				// #jobs
+	struct bbz_pool_type *pool;	// threads running the jobs, from start_data_jobs
+} data_jobs_type;
+
+
+// ------------------------------------------------------------
+// Compression of the blocks of the index (Last and Alpha blocks,
+// Pcdata FM-indexes), possibly run by distinct threads of a pool
+// of bigbzip (see run_index_jobs). Each job writes its own buffer, 
+// the index is laid out afterwards in the order of the jobs.
+// ------------------------------------------------------------
+#define INDEX_JOB_BLOCK		0			// compress_block() of src
+#define INDEX_JOB_FMINDEX	1			// build_index() of src, saved in memory
+
+typedef struct index_job_type {
+	UChar *src;
+	int srcLen;
+	UChar *dest;			// allocated by the job
+	int destLen;
+	int type;				// INDEX_JOB_BLOCK or INDEX_JOB_FMINDEX
+} index_job_type;
+
+typedef struct index_jobs_type {
+	index_job_type *job;
+	int num;				// #jobs
+	int size;				// #allocated jobs
+} index_jobs_type;
+
+
+// ------------------------------------------------------------
+// Plain bitvector with rank/select directories (xbzip_bitvector.c)
+// ------------------------------------------------------------
+typedef struct bitvector_type {
+	UInt32 *Bits;			// bit i in Bits[i/32], plus one padding word
+	int Len;				// #bits
+	int Ones;				// #1s
+	int *RankSuper;			// #1s before each superblock of BV_SUPER_BITS bits
+	int *Select1Samples;	// superblock of the (k*BV_SELECT_SAMPLE+1)-th 1
+	int *Select0Samples;	// superblock of the (k*BV_SELECT_SAMPLE+1)-th 0
+} bitvector_type;
+
+#define BV_GET(bv,i)	(((bv)->Bits[(i) >> 5] >> ((i) & 31)) & 1)
+#define BV_SET(bv,i)	((bv)->Bits[(i) >> 5] |= ((UInt32) 1) << ((i) & 31))
+
+
+// ------------------------------------------------------------
+// Wavelet matrix over integer codes (xbzip_bitvector.c): level l 
+// stores the l-th most significant bit of the codes, stably 
+// sorted by their more significant bits (0s first).
+// ------------------------------------------------------------
+typedef struct wavelet_type {
+	int Len;				// #codes
+	int Levels;				// #bits per code
+	int *Zeros;				// #0s in each level
+	bitvector_type *Level;
+} wavelet_type;
+
+
+// ------------------------------------------------------------
+// Entry of the LRU cache of decompressed Last/Alpha blocks,
+// keyed by the pair (stream, block). 
+// ------------------------------------------------------------
+#define LAST_STREAM			0
+#define ALPHA_STREAM		1
+
+typedef struct block_cache_entry {
+	int stream;				// LAST_STREAM or ALPHA_STREAM, -1 if empty
+	int block;				// block number within the stream
+	UChar *data;			// decompressed block
+	int size;				// bytes allocated for data, reused by the next blocks
+	int len;
+	unsigned int stamp;		// time of the last access (0 if empty)
+} block_cache_entry;
+
+
+// ------------------------------------------------------------
+// Entry of the LRU cache of the loaded FM-indexes of the Pcdata
+// blocks, keyed by the block. The text of the block is extracted
+// only when an item is fetched from an index without the samples 
+// of the Pcdata items (see get_cached_fmindex).
+// ------------------------------------------------------------
+#define PC_CACHE_MEM		(64 << 20)	// default memory cap of the cache, in bytes
+#define PC_ITEM_SAMPLE_RATE	32			// Pcdata items between two sampled starting bytes
+#define PC_EXTRACT_CHUNK	256			// bytes first extracted to fetch a Pcdata item
+#define PC_EXTRACT_BYTES	(128 << 10)	// shorter blocks are decompressed whole instead
+
+typedef struct pc_cache_entry {
+	int block;				// Pcdata block, -1 if empty
+	void *fmindex;			// handle given by load_index_mem
+	UChar *text;			// the extracted block, or NULL
+	int textLen;
+	int mem;				// bytes charged to the entry
+	unsigned int stamp;		// time of the last access (0 if empty)
+} pc_cache_entry;
+
+
 // ------------------------------------------------------------
 // Data type containing all info about XBWT-index
 // ------------------------------------------------------------
 typedef struct xbwt_index_type {
+	int LastType;			// LAST_COMPRESSED or LAST_BITVECTOR
 	UChar *LastIndex;		
 	int LastIndexLen;
 	int *LastOffsetBlocks; // starting byte of the compressed block
 	int *LastPosBlocks;    // starting position of the block (var length)
 	int LastNumBlocks;
+	bitvector_type LastBV;	// Slast (LAST_BITVECTOR only)
 
+	int AlphaType;			// ALPHA_COMPRESSED or ALPHA_WAVELET
 	UChar *AlphaIndex;		
 	int AlphaIndexLen;
 	int *AlphaOffsetBlocks;  // starting byte of the compressed block
 	int *AlphaPrefixCounts;  // occurrences counted from the end of the block
 	int AlphaNumBlocks;
+	wavelet_type AlphaWM;	// symbol codes of Salpha (ALPHA_WAVELET only)
 
 	UChar *Alphabet;		// each item is ended by a null (includes =)
 	int AlphabetLen;
 	int AlphabetCard;
+	int *AlphabetStart;		// starting byte of each symbol (saved by ALPHA_WAVELET only)
 
 	UChar *PcdataIndex;
 	int PcdataIndexLen;
 	int *PcOffsetBlocks;	// starting byte of the compressed block
 	int *PcBlockItems;		// number of Pc-items per compressed block
 	int PcNumBlocks;
+	int *PcItemSamples;		// starting byte within its block of every PcSampleRate-th 
+							// item of a block, NULL in the old index files
+	int PcSampleRate;
+	int PcSamplesNum;
 
 	int *F;					// first row PI-prefixed by an item, undefined on =
 	int TextLength;
 	int SItemsNum;
 	int PcdataNum;
+
+	block_cache_entry *Cache;	// decompressed blocks (see get_cached_block)
+	int CacheSize;				// max #blocks in the cache
+	unsigned int CacheClock;	// access counter for the LRU policy
+	struct bigbzip_ctx *BlockCoder;	// workspace to decompress the blocks on a miss
+
+	pc_cache_entry *PcCache;	// loaded Pcdata FM-indexes (see get_cached_fmindex)
+	int PcCacheSize;			// max #entries in the cache
+	int PcCacheMem;				// bytes charged to its entries
+	int PcCacheMemMax;			// memory cap: LRU entries are evicted above it
 	} xbwt_index_type;
 
 
 // ------------------------------------------------------------
-// Element of the catenating lists in the hash table. the field
-// "code" contains the position of the token within the alphabet. 
+// Layout of an index file (version 2, see index2disk): the header,
+// the section table, then the arrays of the index in the order 
+// of index_sections(). Integers are native-endian and every 
+// section starts at an 8-byte aligned offset, so disk2index can 
+// point into the (mmapped) file without copying anything.
+// Files not starting with XBZI_MAGIC are in the old layout.
+// Version 3 appended the samples of the Pcdata items: files of 
+// version 2 have neither the last two fields of the header nor
+// the last section. Version 4 appended the block parameters 
+// (options -l and -a), which must be equal at query time.
+// ------------------------------------------------------------
+#define XBZI_MAGIC			"XBZI"
+#define XBZI_VERSION		4
+#define XBZI_HEADER_V2_LEN	offsetof(xbzi_header, PcSampleRate)
+#define XBZI_HEADER_V3_LEN	offsetof(xbzi_header, LastBlockOnes)
+#define XBZI_BYTE_ORDER		0x01020304	// detects files of other endianness
+#define XBZI_MAX_SECTIONS	160
+#define XBZI_ALIGN(x)		(((x) + 7) & ~7)
+
+typedef struct xbzi_header {
+	char Magic[4];
+	int Version;
+	int ByteOrder;
+	int TextLength;
+	int SItemsNum;
+	int PcdataNum;
+	int AlphabetLen;
+	int AlphabetCard;
+	int LastType;
+	int LastIndexLen;
+	int LastNumBlocks;
+	int AlphaType;
+	int AlphaIndexLen;
+	int AlphaNumBlocks;
+	int AlphaLevels;		// levels of the wavelet matrix (ALPHA_WAVELET only)
+	int PcdataIndexLen;
+	int PcNumBlocks;
+	int SectionsNum;
+	int PcSampleRate;		// Pcdata items between two samples (version 3)
+	int PcSamplesNum;
+	int LastBlockOnes;		// NUM1_IN_BLOCK of the index (version 4)
+	int AlphaBlockLen;		// BLOCK_ALPHA_LEN of the index (version 4)
+} xbzi_header;
+
+typedef struct xbzi_section {
+	UInt64 Offset;			// from the beginning of the file
+	UInt64 Length;			// in bytes, 0 if the array is missing
+} xbzi_section;
+
+
+// ------------------------------------------------------------
+// Entry of the hash table. The field "id" is the (dense) insertion 
+// rank of the token, whereas the field "code" is set by the user, e.g.
+// to the position of the token within the alphabet. Tokens of at most
+// HASH_INLINE_LEN bytes are kept in the entry itself.
 // ------------------------------------------------------------
 typedef struct Hash_node {
-  char	*str;          
+  char	*str;          // the token ('\0'-terminated, in inl[] or in the arena)
   int len_str;         // length of the token (to manage also NULL)
   int code;				
   int count_occ;		
-  struct Hash_node *next;    
+  int id;
+  char inl[HASH_INLINE_LEN + 1];
 } Hash_node;
 
-typedef Hash_node **Hash_nodeptr_array; //!< array of pointers to Hash_nodes
-
 // ------------------------------------------------------------
-// Hash table managed by catenating lists and MTF. 
-// The field "size" indicates the table size, whereas the field
-// "card" indicates the number of objects stored into the catenating lists. 
+// Hash table managed by open addressing (linear probing) over 
+// "size" slots, a power of two: each slot keeps the hash value of
+// its token and the id of its entry, so that a probe touches the 
+// entries only on a match of the hash values. The table is doubled
+// when it gets half full. The field "card" indicates the number of
+// stored tokens, whose entries are nodes[0, card-1].
 // ------------------------------------------------------------
+typedef struct Hash_slot {
+  unsigned int hash;
+  int id;               // -1 if the slot is empty
+} Hash_slot;
+
 typedef struct {
   int size;             
   int card;             // number of stored items
-  Hash_nodeptr_array table;   
+  Hash_slot *table;   
+  Hash_node *nodes;     // the entries, by id
+  int nodes_size;       // allocated entries
+  arena_type arena;     // for the tokens longer than HASH_INLINE_LEN
 } HHash_table;
 